@@ -0,0 +1,45 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QtGlobal>
+#include "plvglobal.h"
+
+namespace plv
+{
+    /** Monotonic clock used to timestamp element runs and frames. Values are
+      * in nanoseconds since the clock was first read and can be compared
+      * between threads. They are not related to the wall clock time.
+      */
+    class PLVCORE_EXPORT Clock
+    {
+    public:
+        static qint64 now();
+
+    private:
+        Clock();
+    };
+}
+
+#endif // CLOCK_H
@@ -30,8 +30,21 @@
 #include "Types.h"
 #include "PlvExceptions.h"
 
-#define CVMATDATA_MAX_OBJECT_POOL_SIZE (1024 * 1024 * 8)
+/** default maximum number of bytes kept in the CvMatData buffer pool,
+    enough for a few frames in flight per edge at 1080p */
+#ifndef CVMATDATA_MAX_OBJECT_POOL_SIZE
+#define CVMATDATA_MAX_OBJECT_POOL_SIZE (1024 * 1024 * 64)
+#endif
+
+/** largest image in bytes accepted by CvMatData::imageSize */
+#ifndef CVMATDATA_MAX_IMAGE_SIZE
+#define CVMATDATA_MAX_IMAGE_SIZE (1024 * 1024 * 512)
+#endif
+
+/** set to 0 to allocate a new buffer for every CvMatData::create */
+#ifndef CVMATDATA_USE_POOL
 #define CVMATDATA_USE_POOL 1
+#endif
 
 namespace plv
 {
@@ -78,6 +91,84 @@ namespace plv
         inline void setType( int type ) { m_type = type; }
     };
 
+    /** Thread safe pool of matrix buffers which are recycled by CvMatData.
+      * Buffers are returned to the pool when the last CvMatData referring to
+      * them is destroyed and handed out again by CvMatData::create when a
+      * matrix with the same width, height and type is requested. The total
+      * size of the pooled buffers is capped, the least recently returned
+      * buffers are evicted first.
+      */
+    class PLVCORE_EXPORT CvMatDataPool
+    {
+    public:
+        CvMatDataPool();
+        ~CvMatDataPool();
+
+        /** @returns the pool used by CvMatData or 0 during shutdown */
+        static CvMatDataPool* instance();
+
+        /** @returns a buffer with the given properties from the pool, or a
+            newly allocated buffer if there is none. Contents are undefined */
+        cv::Mat acquire( const CvMatDataProperties& props );
+
+        /** offers the buffer of mat to the pool. The buffer is only taken when
+            mat is its only user, so buffers which are still shared elsewhere
+            are left alone. Releases mat in all cases. */
+        void release( cv::Mat& mat );
+
+        /** sets the maximum number of bytes held by the pool and evicts
+            buffers when the pool is larger */
+        void setMaxBytes( qint64 bytes );
+        qint64 getMaxBytes() const;
+
+        /** @returns the number of bytes currently held by the pool */
+        qint64 getBytes() const;
+
+        /** @returns the number of buffers currently held by the pool */
+        int getCount() const;
+
+        /** @returns the number of acquire calls served from the pool */
+        qint64 getHitCount() const;
+
+        /** @returns the number of acquire calls which had to allocate */
+        qint64 getMissCount() const;
+
+        /** @returns the number of buffers dropped because of the byte cap */
+        qint64 getEvictionCount() const;
+
+        void resetStatistics();
+
+        /** frees all pooled buffers */
+        void clear();
+
+        /** allocates through the pool if it is enabled and available */
+        static cv::Mat allocate( const CvMatDataProperties& props );
+
+        /** returns mat to the pool if it is enabled and available */
+        static void recycle( cv::Mat& mat );
+
+        /** deep copy of mat into a buffer from the pool */
+        static cv::Mat clone( const cv::Mat& mat );
+
+    private:
+        Q_DISABLE_COPY( CvMatDataPool )
+
+        /** @returns true if the buffer of mat can be reused by another CvMatData */
+        static bool isPoolable( const cv::Mat& mat );
+        static qint64 byteSize( const cv::Mat& mat );
+
+        /** drops the oldest buffers until the pool holds at most bytes. Not locked */
+        void evict( qint64 bytes );
+
+        mutable QMutex m_mutex;
+        std::list<cv::Mat> m_buffers;
+        qint64 m_bytes;
+        qint64 m_maxBytes;
+        qint64 m_hits;
+        qint64 m_misses;
+        qint64 m_evictions;
+    };
+
     /** internal class to CvMatData. Not exported */
     class MatData : public QSharedData
     {
@@ -88,11 +179,13 @@ namespace plv
         // explicit copy of matrix header and data
         inline MatData( const MatData& other ) : QSharedData()
         {
-            mat = other.mat.clone();
+            mat = CvMatDataPool::clone( other.mat );
             inputArray = mat;
             outputArray = mat;
         }
-        inline ~MatData() {}
+
+        // last reference is gone, hand the buffer back to the pool
+        inline ~MatData() { CvMatDataPool::recycle( mat ); }
 
         /** actual opencv matrix */
         cv::Mat mat;
@@ -133,9 +226,28 @@ namespace plv
         inline const cv::Mat get() const { return d->mat; }
 
         /** returns a header which references the internal cv::Mat data.
-            When the reference count is larger than 1 a copy is made of
-            the matrix data. */
-        inline cv::Mat get() { return d->mat; }
+            The data is made writable first, see getWritable() */
+        inline cv::Mat get() { return getWritable(); }
+
+        /** Read only view on the matrix. Never copies, the data may be shared
+            with other consumers and threads and must not be modified. */
+        inline const cv::Mat& getReadOnly() const { return d->mat; }
+
+        /** Writable view on the matrix. When this object is the only user of
+            the pixel data it is handed out in place. Otherwise the data is
+            copied first, or when keepContents is false only a new buffer of
+            the same size and type is allocated, so the other users keep
+            seeing the original. */
+        cv::Mat& getWritable( bool keepContents = true );
+
+        /** @returns true when no other CvMatData or cv::Mat header refers to
+            the pixel data, so getWritable() will not copy */
+        bool isUnique() const;
+
+        /** @returns true when other CvMatData objects refer to the same data.
+            Unlike isUnique() this ignores plain cv::Mat headers, so it also
+            works for data which is owned elsewhere */
+        bool isShared() const;
 
         /** constructs matrix of the specified size and type
           ( depthAndChannels is CV_8UC1, CV_64FC3, CV_32SC(12) etc.)
@@ -151,6 +263,19 @@ namespace plv
             return create( props.width(), props.height(), props.type() );
         }
 
+        /** Returns the output matrix for an operation on in. When allowInPlace
+            is set, in is the only user of its data and has the properties props,
+            the data of in is handed over to the returned object and in is left
+            empty, so the operation can be done in place. References to the matrix
+            of in obtained before this call remain valid. Otherwise a new matrix
+            is created with create( props ) and in is left untouched. */
+        static CvMatData createOutput( CvMatData& in, const CvMatDataProperties& props, bool allowInPlace );
+
+        inline static CvMatData createOutput( CvMatData& in, bool allowInPlace )
+        {
+            return createOutput( in, in.properties(), allowInPlace );
+        }
+
         inline int type() const { return d->mat.type(); }
         inline int depth() const { return d->mat.depth(); }
         inline int channels() const { return d->mat.channels(); }
@@ -162,11 +287,20 @@ namespace plv
 
         static const char* depthToString( int depth );
 
-        inline operator cv::Mat&() { return d->mat; }
+        /** @returns the number of bytes of a continuous matrix of this size and
+            type, or -1 if type is not a matrix type or the size is not positive
+            or larger than CVMATDATA_MAX_IMAGE_SIZE. Checks sizes read from
+            files or the network before they are passed to create() */
+        static qint64 imageSize( int width, int height, int type );
+
+        /** writable access, see getWritable(). Note that binding a non const
+            CvMatData to a const cv::Mat& also selects this operator, use
+            getReadOnly() for input which is only read */
+        inline operator cv::Mat&() { return getWritable(); }
         inline operator const cv::Mat&() const { return d->mat; }
 
         inline operator cv::InputArray() const { return d->inputArray; }
-        inline operator const cv::_OutputArray&() { return d->outputArray; }
+        inline operator const cv::_OutputArray&() { getWritable(); return d->outputArray; }
 
     private:
         /** the internal open cv matrix */
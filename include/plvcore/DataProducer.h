@@ -83,6 +83,11 @@ namespace plv
           * a connection. */
          int maxOutputQueueSize() const;
 
+        /** @returns true when one of the connections on the output pins is
+          * full and has the BLOCK overflow policy. The pipeline will not
+          * dispatch this element until there is room again. */
+         virtual bool isOutputBlocked() const;
+
         /** calls the pre method on all output pins. This method should be called
             before processing starts */
          void preOutput();
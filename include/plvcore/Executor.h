@@ -0,0 +1,146 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <deque>
+
+#include <QList>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+#include "plvglobal.h"
+
+namespace plv
+{
+    class PipelineElement;
+
+    /** Callback interface through which an Executor reports finished tasks */
+    class PLVCORE_EXPORT ExecutorListener
+    {
+    public:
+        virtual ~ExecutorListener() {}
+
+        /** Called from the worker thread which ran the task, directly after
+            PipelineElement::run returned. Implementations should be thread safe
+            and return quickly, since the worker is blocked during the call. */
+        virtual void taskFinished( PipelineElement* element, unsigned int serial, bool result ) = 0;
+    };
+
+    /** Runs PipelineElements on a fixed set of worker threads owned by a single
+      * Pipeline. Every worker has its own task deque. A worker takes new work
+      * from the back of its own deque and steals from the front of the deques of
+      * other workers when it runs out. Tasks can be submitted with a worker
+      * affinity so an element which consumes the output of another element runs
+      * on the same thread and finds the frame in a warm cache.
+      */
+    class PLVCORE_EXPORT Executor
+    {
+    public:
+        /** Creates an executor with QThread::idealThreadCount() workers. The
+            listener is notified of every finished task. */
+        Executor( ExecutorListener* listener );
+        ~Executor();
+
+        /** Sets the number of worker threads. Only has effect when the
+            executor is not running. Values smaller than 1 select
+            QThread::idealThreadCount() */
+        void setWorkerCount( int count );
+        int getWorkerCount() const;
+
+        /** Starts the worker threads. Returns false if already running. */
+        bool start();
+
+        /** Waits until all submitted tasks are finished and stops the
+            worker threads. */
+        void stop();
+
+        bool isRunning() const;
+
+        /** Queues element->run(serial) for execution. If worker is a valid
+            worker index the task is queued on that worker, else tasks are
+            distributed round robin. Enqueued is the Clock::now() time at which
+            the element became ready, it is passed on to run(). Thread safe. */
+        void submit( PipelineElement* element, unsigned int serial, int worker = -1,
+                     qint64 enqueued = 0 );
+
+        /** @returns the index of the worker of this executor the calling thread
+            is, or -1 if the calling thread is not one of its workers */
+        int currentWorker() const;
+
+    private:
+        Q_DISABLE_COPY( Executor )
+
+        struct Task
+        {
+            PipelineElement* element;
+            unsigned int serial;
+            qint64 enqueued;
+            qint64 dispatched;
+
+            Task() : element(0), serial(0), enqueued(0), dispatched(0) {}
+            Task( PipelineElement* e, unsigned int s, qint64 q, qint64 d ) :
+                element(e), serial(s), enqueued(q), dispatched(d) {}
+        };
+
+        class Worker : public QThread
+        {
+        public:
+            Worker( Executor* executor, int index ) :
+                m_executor(executor), m_index(index) {}
+
+            Executor* m_executor;
+            int m_index;
+
+            /** protects m_deque, owner pushes and pops at the back,
+                thieves take from the front */
+            QMutex m_dequeMutex;
+            std::deque<Task> m_deque;
+
+        protected:
+            void run() { m_executor->workerLoop( this ); }
+        };
+
+        void workerLoop( Worker* self );
+        bool popLocal( Worker* self, Task& task );
+        bool steal( Worker* self, Task& task );
+
+        ExecutorListener* m_listener;
+        int m_workerCount;
+        QList<Worker*> m_workers;
+        bool m_running;
+
+        /** number of tasks submitted but not yet taken by a worker */
+        QAtomicInt m_pending;
+
+        /** used for round robin distribution of tasks without affinity */
+        QAtomicInt m_nextWorker;
+
+        /** idle workers sleep on m_workAvailable */
+        mutable QMutex m_idleMutex;
+        QWaitCondition m_workAvailable;
+    };
+}
+
+#endif // EXECUTOR_H
@@ -7,6 +7,7 @@
 namespace plv
 {
     class DataConsumer;
+    class ProcessingContext;
 
     class PLVCORE_EXPORT IInputPin : public Pin
     {
@@ -41,6 +42,9 @@ namespace plv
 
         void peekNext(unsigned int& serial, bool& isNull) const;
 
+        /** @returns the capture time of the next data item, see Data::getTimestamp() */
+        qint64 peekTimestamp() const;
+
         bool hasData() const;
         void flushConnection();
         bool fastforward( unsigned int target );
@@ -76,6 +80,10 @@ namespace plv
         virtual bool isDynamicallyTyped() const { return false; }
 
     protected:
+        /** implementation of getVariant for reentrant consumers, which
+            reads the input taken in advance from the context */
+        void getVariantFromContext( ProcessingContext* context, QVariant& data );
+
         DataConsumer* m_consumer;
 
         /** The input pin required type either CONNECTION_OPTIONAL or CONNECTION_REQUIRED */
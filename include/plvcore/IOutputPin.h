@@ -8,6 +8,7 @@ namespace plv
 {
     class DataProducer;
     class PinConnection;
+    class ProcessingContext;
 
     class PLVCORE_EXPORT IOutputPin : public Pin
     {
@@ -28,11 +29,20 @@ namespace plv
         void removeConnection( PinConnection* connection );
         void removeConnections();
 
+        /** @returns a copy of the connection list, use this when the
+            connections may change while iterating */
         std::list< RefPtr<PinConnection> > getConnections();
+
+        /** @returns the connection list without copying it */
+        const std::list< RefPtr<PinConnection> >& getConnections() const { return m_connections; }
         int connectionCount() const;
 
         int maxDataOnConnection() const;
 
+        /** @returns true when one of the connections is full.
+            See PinConnection::isFull() */
+        bool isBlocked() const;
+
         /** @returns true when pin is connected */
         inline bool isConnected() const { return !m_connections.empty(); }
 
@@ -44,6 +54,15 @@ namespace plv
 
         void putVariant( unsigned int serial, const QVariant& data );
 
+        /** Publishes data to the viewers and puts it on all connections.
+            Does no checking, used by putVariant() and to put the buffered
+            output of reentrant producers in serial order. The data is
+            stamped with captureTime, see Data::getTimestamp(). */
+        void publish( unsigned int serial, qint64 captureTime, const QVariant& data );
+
+        /** puts a NULL data item with serial on all synchronous connections */
+        void publishNull( unsigned int serial, qint64 captureTime );
+
         /** returns wheter put() has been called since last pre() */
         inline bool isCalled() const { return m_called; }
 
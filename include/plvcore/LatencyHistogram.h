@@ -0,0 +1,91 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+#include <QMetaType>
+#include "plvglobal.h"
+
+/** number of logarithmic buckets in a LatencyHistogram. Covers up to
+    about 2^33 microseconds, larger values end up in the last bucket */
+#ifndef LATENCY_HISTOGRAM_BUCKETS
+#define LATENCY_HISTOGRAM_BUCKETS 128
+#endif
+
+namespace plv
+{
+    /** Histogram of latencies with logarithmic buckets of microsecond
+      * resolution. Values below 4us get a bucket each, every power of two
+      * above that is split in four buckets so the relative error of a
+      * percentile is at most 25%. Values are added in nanoseconds.
+      * Not thread safe, the owner is responsible for locking.
+      */
+    class PLVCORE_EXPORT LatencyHistogram
+    {
+    public:
+        LatencyHistogram();
+
+        /** adds a latency in nanoseconds */
+        void add( qint64 nanoseconds );
+
+        /** adds count values to bucket without knowing their exact value.
+            The sum, min and max are estimated from the bucket bounds. Used to
+            convert histograms which only keep bucket counts. */
+        void addToBucket( int bucket, qint64 count );
+        void reset();
+
+        inline qint64 getCount() const { return m_count; }
+        inline qint64 getMin() const { return m_min; }
+        inline qint64 getMax() const { return m_max; }
+
+        /** @returns the mean latency in nanoseconds, 0 when empty */
+        qint64 getMean() const;
+
+        /** @returns an upper bound in nanoseconds of the latency below which
+            the given fraction (0.0 - 1.0) of all values fall, 0 when empty */
+        qint64 getPercentile( double fraction ) const;
+
+        inline int getBucketCount() const { return LATENCY_HISTOGRAM_BUCKETS; }
+        inline qint64 getBucketValue( int bucket ) const { return m_buckets[bucket]; }
+
+        /** @returns the smallest latency in nanoseconds counted in bucket */
+        static qint64 bucketLowerBound( int bucket );
+
+        /** @returns the first latency in nanoseconds not counted in bucket */
+        static qint64 bucketUpperBound( int bucket );
+
+        /** @returns the bucket in which a latency in nanoseconds is counted */
+        static int bucketIndex( qint64 nanoseconds );
+
+    private:
+        qint64 m_buckets[LATENCY_HISTOGRAM_BUCKETS];
+        qint64 m_count;
+        qint64 m_sum;
+        qint64 m_min;
+        qint64 m_max;
+    };
+}
+
+Q_DECLARE_METATYPE( plv::LatencyHistogram )
+
+#endif // LATENCYHISTOGRAM_H
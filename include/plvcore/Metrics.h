@@ -0,0 +1,185 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QtGlobal>
+#include <QAtomicInt>
+#include <QList>
+#include <QString>
+#include <QMetaType>
+
+#include "plvglobal.h"
+#include "LatencyHistogram.h"
+
+class QTextStream;
+
+namespace plv
+{
+    class PipelineElement;
+    class PinConnection;
+    class CvMatDataPool;
+
+    /** Histogram with the buckets of LatencyHistogram which can be updated
+      * from any thread with a single atomic increment. Only keeps the
+      * bucket counts.
+      */
+    class PLVCORE_EXPORT AtomicHistogram
+    {
+    public:
+        AtomicHistogram();
+
+        /** adds a duration in nanoseconds. Thread safe. */
+        inline void add( qint64 nanoseconds )
+        {
+            m_buckets[LatencyHistogram::bucketIndex( nanoseconds )].ref();
+        }
+
+        void reset();
+
+        /** @returns the current bucket counts as a LatencyHistogram */
+        LatencyHistogram snapshot() const;
+
+    private:
+        Q_DISABLE_COPY( AtomicHistogram )
+        QAtomicInt m_buckets[LATENCY_HISTOGRAM_BUCKETS];
+    };
+
+    /** Runtime counters of a single PipelineElement. Updated by the
+      * element on the hot path, read by MetricsSnapshot without locking.
+      */
+    class PLVCORE_EXPORT ElementMetrics
+    {
+    public:
+        ElementMetrics();
+
+        inline void frameProcessed() { m_frames.ref(); }
+        inline void nullFramePropagated() { m_nullFrames.ref(); }
+        inline void errorOccurred() { m_errors.ref(); }
+        inline void processingTime( qint64 nanoseconds ) { m_processingTime.add( nanoseconds ); }
+        inline void readyWait( qint64 nanoseconds ) { m_readyWait.add( nanoseconds ); }
+
+        /** sets the number of frames a producer has read or decoded ahead */
+        inline void setReadAhead( int frames ) { m_readAhead = frames; }
+
+        /** sets the amount of work an element has queued in the background,
+            for instance images waiting to be written */
+        inline void setBacklog( int items ) { m_backlog = items; }
+
+        /** counts an item the element dropped because it could not keep up */
+        inline void itemDropped() { m_dropped.ref(); }
+
+        inline int getFrameCount() const { return m_frames; }
+        inline int getNullFrameCount() const { return m_nullFrames; }
+        inline int getErrorCount() const { return m_errors; }
+        inline int getReadAhead() const { return m_readAhead; }
+        inline int getBacklog() const { return m_backlog; }
+        inline int getDropCount() const { return m_dropped; }
+        inline LatencyHistogram getProcessingTime() const { return m_processingTime.snapshot(); }
+        inline LatencyHistogram getReadyWait() const { return m_readyWait.snapshot(); }
+
+        void reset();
+
+    private:
+        Q_DISABLE_COPY( ElementMetrics )
+
+        QAtomicInt m_frames;
+        QAtomicInt m_nullFrames;
+        QAtomicInt m_errors;
+        QAtomicInt m_readAhead;
+        QAtomicInt m_backlog;
+        QAtomicInt m_dropped;
+
+        /** time spent in __process */
+        AtomicHistogram m_processingTime;
+
+        /** time between becoming ready and starting to process */
+        AtomicHistogram m_readyWait;
+    };
+
+    /** Copy of the metrics of a pipeline at one moment in time. Taken with
+      * Pipeline::getMetrics() from the thread the pipeline lives in.
+      */
+    class PLVCORE_EXPORT MetricsSnapshot
+    {
+    public:
+        struct Element
+        {
+            int id;
+            QString name;
+            int frames;
+            int nullFrames;
+            int errors;
+            int readAhead;
+            int backlog;
+            int dropped;
+            LatencyHistogram processingTime;
+            LatencyHistogram readyWait;
+        };
+
+        struct Connection
+        {
+            int id;
+            int fromElement;
+            int toElement;
+            int depth;
+            int capacity;
+            int highWaterMark;
+            int dropCount;
+        };
+
+        struct Pool
+        {
+            qint64 hits;
+            qint64 misses;
+            qint64 evictions;
+            int count;
+            qint64 bytes;
+            qint64 maxBytes;
+        };
+
+        MetricsSnapshot();
+
+        void addElement( const PipelineElement* element );
+        void addConnection( const PinConnection* connection );
+        void setPool( const CvMatDataPool* pool );
+
+        /** Clock::now() time at which the snapshot was taken */
+        qint64 timestamp;
+        float fps;
+        bool running;
+        QList<Element> elements;
+        QList<Connection> connections;
+
+        /** CvMatData buffer pool statistics since the pipeline was started */
+        Pool pool;
+
+        /** writes the snapshot as a single JSON object. Durations are in
+            microseconds. */
+        void writeJson( QTextStream& out ) const;
+        QString toJson() const;
+    };
+}
+
+Q_DECLARE_METATYPE( plv::MetricsSnapshot )
+
+#endif // METRICS_H
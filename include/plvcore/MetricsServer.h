@@ -0,0 +1,66 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QString>
+
+#include "plvglobal.h"
+#include "RefPtr.h"
+
+class QLocalServer;
+
+namespace plv
+{
+    class Pipeline;
+
+    /** Serves metrics snapshots of a pipeline on a local socket, a unix
+      * domain socket or a named pipe on Windows. Every client which connects
+      * is sent a single MetricsSnapshot as JSON followed by a newline, after
+      * which the connection is closed. Lives in the thread of the pipeline.
+      */
+    class PLVCORE_EXPORT MetricsServer : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        MetricsServer( Pipeline* pipeline, QObject* parent = 0 );
+        virtual ~MetricsServer();
+
+        /** starts listening on the local socket with the given name, removing
+            a stale socket left by a previous process. Returns false on error */
+        bool listen( const QString& name );
+        void close();
+
+        QString errorString() const;
+
+    private slots:
+        void newConnection();
+
+    private:
+        RefPtr<Pipeline> m_pipeline;
+        QLocalServer* m_server;
+    };
+}
+
+#endif // METRICSSERVER_H
@@ -22,14 +22,22 @@
 #ifndef PINCONNECTION_H
 #define PINCONNECTION_H
 
-#include <queue>
 #include <QMutexLocker>
 #include <QVariant>
+#include <QAtomicInt>
 
 #include "RefPtr.h"
 #include "RefCounted.h"
 #include "PlvExceptions.h"
 
+/** default maximum number of data items queued on a connection */
+#define PINCONNECTION_DEFAULT_CAPACITY 5
+
+/** largest number of data items queued on a connection. The ring buffer
+    cannot grow while the pipeline runs, so an unbounded connection is
+    limited to this capacity */
+#define PINCONNECTION_MAX_CAPACITY 1024
+
 namespace plv
 {
     class Pin;
@@ -50,10 +58,14 @@ namespace plv
             m_payload is empty */
         bool m_null;
 
+        /** Clock::now() at which the producer started producing the frame
+            this data was derived from, 0 when unknown */
+        qint64 m_timestamp;
+
     public:
-        inline Data(unsigned int serial=0, bool isNull = true) : m_serial(serial), m_null(isNull) {}
-        inline Data(unsigned int serial, const QVariant& payload ) : m_serial(serial), m_payload(payload), m_null(false) {}
-        inline Data(const Data& other) : m_serial(other.m_serial), m_payload(other.m_payload), m_null(other.m_null) {}
+        inline Data(unsigned int serial=0, bool isNull = true) : m_serial(serial), m_null(isNull), m_timestamp(0) {}
+        inline Data(unsigned int serial, const QVariant& payload ) : m_serial(serial), m_payload(payload), m_null(false), m_timestamp(0) {}
+        inline Data(const Data& other) : m_serial(other.m_serial), m_payload(other.m_payload), m_null(other.m_null), m_timestamp(other.m_timestamp) {}
         inline ~Data() {}
 
         inline unsigned int getSerial() const { return m_serial; }
@@ -62,6 +74,11 @@ namespace plv
         inline QVariant getPayload() const { return m_payload; }
         inline void setPayload( const QVariant& payload ) { m_payload = payload; }
 
+        /** capture time of the frame, see Clock. Set by the output pins
+          * from the capture time of the element which produced the data */
+        inline qint64 getTimestamp() const { return m_timestamp; }
+        inline void setTimestamp( qint64 timestamp ) { m_timestamp = timestamp; }
+
         /** used to signal a NULL entry. Null entries are ignored
           * by viewers but used to synchronize the system. This is done
           * automatically. Producers should generally never produce a Data item
@@ -70,6 +87,77 @@ namespace plv
         inline bool isNull() const { return m_null; }
     };
 
+    /** Bounded lock-free queue of Data items, based on the array queue of
+      * Dmitry Vyukov. Every slot carries a sequence number which tells whether
+      * it is free or holds an item for the current lap around the ring, so
+      * producers and consumers only contend on the slot they use.
+      *
+      * Several threads may push and pop concurrently. The serial and null
+      * flag of every slot are kept in atomics, which allows the scheduler
+      * to peek at the front item without taking a lock.
+      */
+    class PLVCORE_EXPORT DataRing
+    {
+    public:
+        /** creates a ring with at least size slots, rounded up to a power of two */
+        explicit DataRing( int size );
+        ~DataRing();
+
+        /** @returns the number of slots */
+        int getSize() const { return m_mask + 1; }
+
+        /** @returns the number of queued items. This is a snapshot which
+            may already be outdated when other threads use the ring */
+        int count() const;
+        bool isEmpty() const { return count() == 0; }
+
+        /** appends data. Returns false if all slots are in use */
+        bool push( const Data& data );
+
+        /** removes the front item. Returns false if the ring is empty */
+        bool pop( Data& data );
+
+        /** reads serial and null flag of the front item. Returns false
+            if the ring is empty */
+        bool peek( unsigned int& serial, bool& isNull ) const;
+
+        /** copies the front item, payload included. Only safe from the
+            thread which pops, since the payload is not atomic */
+        bool peek( Data& data ) const;
+
+        /** reads the timestamp of the front item. Only safe from the
+            thread which pops, like peek( Data& ) */
+        bool peekTimestamp( qint64& timestamp ) const;
+
+        /** turns the oldest non NULL item behind the front item into a NULL
+            item. Its payload is released when the item is popped. Returns
+            false if all those items are NULL. Must not run concurrently with push, which holds
+            for PinConnection since an output pin is only written by one
+            process call at a time */
+        bool nullifyOldest();
+
+    private:
+        Q_DISABLE_COPY( DataRing )
+
+        struct Slot
+        {
+            QAtomicInt sequence;
+            QAtomicInt serial;
+            QAtomicInt null;
+            qint64 timestamp;
+            QVariant payload;
+        };
+
+        Slot* m_slots;
+        int m_mask;
+
+        /** keep head and tail on separate cache lines, head is
+            written by the consumer and tail by the producer */
+        QAtomicInt m_head;
+        char m_padding[64 - sizeof(QAtomicInt)];
+        QAtomicInt m_tail;
+    };
+
     class PLVCORE_EXPORT PinConnection : public RefCounted
     {
       public:
@@ -96,6 +184,13 @@ namespace plv
 
         friend class Pipeline;
 
+        /** What happens when data is put on a connection which is at capacity */
+        enum OverflowPolicy {
+            BLOCK,       /** hold back the upstream element until there is room */
+            DROP_OLDEST, /** drop the oldest queued data */
+            DROP_NEWEST  /** drop the data being put */
+        };
+
         PinConnection( int id, IOutputPin* producer, IInputPin* consumer )
                 throw ( IllegalConnectionException,
                         IncompatibleTypeException,
@@ -108,12 +203,50 @@ namespace plv
         Data get();
         Data peek() const;
         void peek( unsigned int& serial, bool& isNull ) const;
+
+        /** @returns the timestamp of the front item. Only called by the
+            consumer, the connection must have data */
+        qint64 peekTimestamp() const;
         void put( const Data& data );
         bool fastforward( unsigned int target );
 
         bool isSynchronous() const;
         bool isAsynchronous() const;
 
+        /** Sets the maximum number of data items queued on this connection.
+            0 means unbounded, which is limited to PINCONNECTION_MAX_CAPACITY
+            items. Defaults to PINCONNECTION_DEFAULT_CAPACITY. Resizes the
+            ring buffer, so only call this while the pipeline is not running */
+        void setCapacity( int capacity );
+        int getCapacity() const;
+
+        void setOverflowPolicy( OverflowPolicy policy );
+        OverflowPolicy getOverflowPolicy() const;
+
+        /** @returns true when the policy is BLOCK and the connection is at
+            capacity, or when the policy drops items and the consumer is so
+            far behind that the NULL items of dropped serials used up the
+            headroom of a serial per worker on top of the capacity. The
+            pipeline will not dispatch the upstream element while this is
+            the case. */
+        bool isFull() const;
+
+        /** @returns the largest number of items queued since the last reset */
+        int getHighWaterMark() const;
+
+        /** @returns the number of data items dropped since the last reset.
+            On synchronous connections dropped items are replaced by a NULL
+            item, so the serial still arrives and consumers stay synchronized */
+        int getDropCount() const;
+
+        /** resets the high water mark and drop count */
+        void resetStatistics();
+
+        static QString overflowPolicyToString( OverflowPolicy policy );
+
+        /** converts str to a policy. Returns false if str is not a valid policy */
+        static bool overflowPolicyFromString( const QString& str, OverflowPolicy& policy );
+
         /** Throw away all data in this connection. */
         void flush();
 
@@ -124,6 +257,11 @@ namespace plv
         const IInputPin*  toPin() const;
 
     protected:
+        /** Sets the number of workers which may run the producer
+            concurrently, the ring buffer needs headroom for each of them
+            on top of the capacity. Called by the pipeline */
+        void setWorkerCount( int count );
+
         static bool canConnectPins( IOutputPin* out, IInputPin* in, QString& errStr );
 
         void connect() throw ( IllegalConnectionException,
@@ -142,8 +280,26 @@ namespace plv
         int m_id;
         IOutputPin* m_producer;
         IInputPin*  m_consumer;
-        std::queue< Data > m_queue;
+        DataRing* m_ring;
+
+        /** only protects connect, disconnect and resizing of the ring,
+            the data path does not take it */
         mutable QMutex m_connectionMutex;
+
+        QAtomicInt m_capacity;
+        int m_workerCount;
+        QAtomicInt m_policy;
+        QAtomicInt m_highWaterMark;
+        QAtomicInt m_dropCount;
+
+        /** @returns the number of items which may be queued,
+            which is the capacity or the maximum if it is unbounded */
+        int getLimit() const;
+
+        /** replaces the ring if it does not fit the capacity and worker
+            count. Expects m_connectionMutex to be locked */
+        void resizeRing();
+        void updateHighWaterMark();
     };
 }
 
@@ -26,6 +26,7 @@
 #include <list>
 
 #include <QMap>
+#include <QHash>
 #include <QList>
 #include <QQueue>
 #include <QSet>
@@ -34,13 +35,25 @@
 #include <QMutexLocker>
 #include <QTime>
 #include <QTimer>
-#include <QFuture>
-#include <QtConcurrentRun>
+#include <QAtomicInt>
 
 #include "RefPtr.h"
 #include "RefCounted.h"
 #include "PinConnection.h"
 #include "PipelineElement.h"
+#include "Executor.h"
+#include "ProcessingObserver.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
+
+/** interval in ms of the fallback heartbeat which polls producers that
+    do not signal when new data is available */
+#define PIPELINE_FALLBACK_HEARTBEAT_INTERVAL 20
+
+/** interval in ms at which latencyUpdate is emitted for every sink */
+#ifndef PIPELINE_LATENCY_UPDATE_INTERVAL
+#define PIPELINE_LATENCY_UPDATE_INTERVAL 1000
+#endif
 
 namespace plv
 {
@@ -58,22 +71,25 @@ namespace plv
     public:
         PipelineElement* m_element;
         unsigned int m_serial;
-        QFuture<bool> m_result;
+        int m_worker; /** preferred executor worker, -1 for none */
         bool m_dispatched;
+        qint64 m_enqueued; /** Clock::now() at which the element became ready */
+        bool m_result; /** result of the finished task, false stops the pipeline */
 
-        RunItem( PipelineElement* element, unsigned int serial ) :
-            m_element(element), m_serial(serial), m_dispatched(false) {}
+        RunItem( PipelineElement* element, unsigned int serial, int worker = -1 ) :
+            m_element(element), m_serial(serial), m_worker(worker), m_dispatched(false),
+            m_enqueued(Clock::now()), m_result(true) {}
 
         RunItem( const RunItem& other ) : m_element(other.m_element),
                                           m_serial(other.m_serial),
-                                          m_result(other.m_result),
-                                          m_dispatched(other.m_dispatched){}
+                                          m_worker(other.m_worker),
+                                          m_dispatched(other.m_dispatched),
+                                          m_enqueued(other.m_enqueued),
+                                          m_result(other.m_result){}
 
         inline unsigned int getSerial() const { return m_serial; }
         inline PipelineElement* getElement() const { return m_element; }
 
-        QFuture<bool> getFuture() const { assert( m_dispatched == true ); return m_result; }
-
         bool operator ==(const RunItem& other) const { return other.m_serial == m_serial && other.m_element == m_element; }
         bool operator < (const RunItem& other) const { return m_serial < other.m_serial; }
 
@@ -81,18 +97,16 @@ namespace plv
         {
             m_element = other.m_element;
             m_serial  = other.m_serial;
-            m_result  = other.m_result;
+            m_worker  = other.m_worker;
             m_dispatched = other.m_dispatched;
+            m_enqueued = other.m_enqueued;
+            m_result = other.m_result;
         }
 
-        void dispatch()
-        {
-            assert( m_element->getState() == PipelineElement::PLE_STARTED );
-            assert( m_dispatched == false );
-            m_element->setState( PipelineElement::PLE_DISPATCHED );
-            m_result = QtConcurrent::run( m_element, &PipelineElement::run, m_serial );
-            m_dispatched = true;
-        }
+        /** Submits the element to the executor, preferably on worker m_worker.
+            When the element is done the executor notifies the pipeline.
+            Reentrant elements take their input before they are submitted */
+        void dispatch( Executor& executor );
     };
 
     /** Helper class for a QThread to run its own event loop */
@@ -102,7 +116,7 @@ namespace plv
         void run() { exec(); }
     };
 
-    class PLVCORE_EXPORT Pipeline : public QObject, public RefCounted
+    class PLVCORE_EXPORT Pipeline : public QObject, public RefCounted, public ExecutorListener
     {
         Q_OBJECT
 
@@ -176,6 +190,56 @@ namespace plv
 
         void pipelineDataConsumerReady(unsigned int serial, DataConsumer* consumer);
 
+        /** Requests a call to schedule() from the pipeline's event loop. Is thread
+          * safe and may be called from any thread. Multiple requests made before
+          * the scheduler runs are coalesced into a single call. Called when a
+          * dispatched element is done, when a consumer has become ready and
+          * when a producer signals it has new data available.
+          */
+        void wakeScheduler();
+
+        /** Sets the number of worker threads used to run the elements of this
+          * pipeline. Values smaller than 1 select the number of cores. Takes
+          * effect the next time the pipeline is started.
+          */
+        void setWorkerCount( int count );
+        int getWorkerCount() const;
+
+        /** Installs an observer which is told about every element run, or
+          * removes it when observer is 0. The observer is not owned by the
+          * pipeline. May only be changed while the pipeline is not running.
+          */
+        void setProcessingObserver( ProcessingObserver* observer );
+        inline ProcessingObserver* getProcessingObserver() const { return m_processingObserver; }
+
+        /** Records the end-to-end latency in nanoseconds of a frame which
+          * left the pipeline at element, which is ignored when element is not
+          * a sink. Called from worker threads when an element finished a frame.
+          */
+        void recordLatency( PipelineElement* element, qint64 latency );
+
+        /** @returns a copy of the latency histogram of the sink with the given
+          * id, an empty histogram if there is no such sink. The histograms are
+          * reset when the pipeline is started and kept after it stops.
+          */
+        LatencyHistogram getLatencyHistogram( int id ) const;
+
+        /** @returns copies of the latency histograms of all sinks by id */
+        QHash<int, LatencyHistogram> getLatencyHistograms() const;
+
+        void resetLatencyHistograms();
+
+        /** @returns the counters of all elements and connections. Only reads
+          * atomic counters so it does not hold up the running pipeline. Call it
+          * from the thread the pipeline lives in, which is the only thread
+          * which adds or removes elements and connections. The counters are
+          * reset when the pipeline is started.
+          */
+        MetricsSnapshot getMetrics() const;
+
+        /** implementation of ExecutorListener, called from a worker thread */
+        virtual void taskFinished( PipelineElement* element, unsigned int serial, bool result );
+
     private:
         PipelineElementMap m_children;
         PipelineConnectionMap m_connections;
@@ -191,11 +255,37 @@ namespace plv
         QHash<int, QList<RunItem>* > m_readyQueue;
         mutable QMutex m_readyQueueMutex;
 
-        /** holds the runitems currently dispatched ordered by id*/
-        QHash<int, RunItem> m_runQueue;
+        /** holds the runitems currently dispatched ordered by id. Reentrant
+            elements can have several items in the run queue at once */
+        QMultiHash<int, RunItem> m_runQueue;
+
+        /** holds the runitems the executor has finished but which have not
+            been removed from the run queue yet. Filled by worker threads so
+            protected by the finishedQueueMutex */
+        QList<RunItem> m_finishedQueue;
+        QMutex m_finishedQueueMutex;
 
         int m_runQueueThreshold;
+
+        /** fallback timer which calls schedule() at a low rate for producers
+            which do not signal when they become ready */
         QTimer m_heartbeat;
+
+        /** 1 when a call to schedule() is pending in the event loop */
+        QAtomicInt m_scheduleRequested;
+
+        /** worker threads which run the elements of this pipeline */
+        Executor m_executor;
+
+        /** optional observer of element runs, used for profiling */
+        ProcessingObserver* m_processingObserver;
+
+        /** end-to-end latency of every sink. The set of sinks is fixed while
+            running, the histograms are protected by m_latencyMutex */
+        QHash<PipelineElement*, LatencyHistogram> m_latencyHistograms;
+        mutable QMutex m_latencyMutex;
+        QTime m_timeSinceLastLatencyUpdate;
+
         bool m_stepwise;
         bool m_producersReady;
 
@@ -230,6 +320,9 @@ namespace plv
         /** Removes all elements from the pipeline. not thread safe. */
         void removeAllElements();
 
+        /** @returns and clears the items finished since the last call */
+        QList<RunItem> takeFinishedItems();
+
         int getNewPipelineElementId();
         int getNewPinConnectionId();
 
@@ -259,10 +352,18 @@ namespace plv
         void pipelineStopped();
         void finished();
 
+        /** emitted after the pipeline has been stopped because of an error
+            in element ple */
+        void pipelineError(PlvErrorType type, plv::PipelineElement* ple);
+
         void stepTaken(unsigned int serial);
         void producersAreReady();
         void framesPerSecond(float);
 
+        /** emitted periodically while running with the latency histogram of
+            every sink of the pipeline */
+        void latencyUpdate(int elementId, const plv::LatencyHistogram& histogram);
+
         void pipelineLoaded(const QString&);
         void pipelineSaved(const QString&);
         void pipelineChanged(bool);
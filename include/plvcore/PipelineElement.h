@@ -34,6 +34,7 @@
 #include "plvglobal.h"
 #include "RefPtr.h"
 #include "PlvExceptions.h"
+#include "Metrics.h"
 
 namespace plv
 {
@@ -41,6 +42,19 @@ namespace plv
     //class IOutputPin;
     class Pipeline;
     class PinConnection;
+    class ProcessingContext;
+
+    /** Clock::now() timestamps of a single run of an element */
+    struct RunTimes
+    {
+        RunTimes() : serial(0), enqueued(0), dispatched(0), started(0), finished(0) {}
+
+        unsigned int serial;
+        qint64 enqueued;   /** the element became ready to process serial */
+        qint64 dispatched; /** the scheduler handed it to a worker */
+        qint64 started;    /** the worker started processing */
+        qint64 finished;   /** processing was done */
+    };
 
     class PLVCORE_EXPORT PipelineElement : public QObject, public RefCounted
     {
@@ -109,8 +123,17 @@ namespace plv
         virtual bool __process( unsigned int serial )   = 0;
 
         /** method which is called by the dispatcher to execute the __process() method
-            returns false on error, true on succes */
-        bool run( unsigned int serial );
+            returns false on error, true on succes. Enqueued and dispatched are the
+            Clock::now() times at which the element became ready for serial and was
+            handed to the executor, 0 when unknown. */
+        bool run( unsigned int serial, qint64 enqueued = 0, qint64 dispatched = 0 );
+
+        /** @returns the timestamps of the last finished run. Thread safe. */
+        RunTimes getLastRunTimes() const;
+
+        /** @returns the runtime counters of this element. Thread safe. */
+        inline ElementMetrics& getMetrics() { return m_metrics; }
+        inline const ElementMetrics& getMetrics() const { return m_metrics; }
 
         /** helper function for creating a partial ordering for cycle detection */
         virtual bool visit( QList<PipelineElement*>& ordering, QSet<PipelineElement*>& visited ) = 0;
@@ -123,12 +146,52 @@ namespace plv
         virtual bool isDataConsumer() const = 0;
         virtual bool isDataProducer() const = 0;
 
+        /** @returns true when this element may not be dispatched because a
+            connection it outputs to is full. Overridden by DataProducer. */
+        virtual bool isOutputBlocked() const { return false; }
+
         /** sets the serial number of the current process call. Not thread safe. */
         void setProcessingSerial( unsigned int serial );
 
-        /** returs the serial number of the current process call. Not thread safe. */
+        /** returs the serial number of the current process call. Not thread safe.
+            For reentrant elements it returns the serial of the invocation running
+            on the calling thread. */
         unsigned int getProcessingSerial() const;
 
+        /** sets the capture time of the current process call. Not thread safe. */
+        void setCaptureTime( qint64 timestamp );
+
+        /** returns the capture time of the current process call, which is the
+            Clock::now() time at which the producer started producing the oldest
+            frame in the input, or 0 when unknown. Output pins stamp their data
+            with it. Not thread safe. For reentrant elements it returns the
+            capture time of the invocation running on the calling thread. */
+        qint64 getCaptureTime() const;
+
+        /** @returns true when several invocations of this element may run at the
+            same time, each with its own serial. Elements declare this with
+            Q_CLASSINFO("reentrant", "true"). Only stateless elements should do
+            so, for instance elements which apply a filter to an image. Read
+            once during __init by the element types which support it. */
+        inline bool isReentrant() const { return m_reentrant; }
+
+        /** @returns true when the element can write its output into the buffer
+            of its input. Elements declare this with Q_CLASSINFO("inPlace", "true")
+            and pass it to CvMatData::createOutput, which only reuses the input
+            when no one else is using it. Read once during __init. */
+        inline bool isInPlace() const { return m_inPlace; }
+
+        /** Called by the pipeline scheduler, in dispatch order, just before a
+            reentrant element is dispatched for serial. Implementations take
+            the input data for serial so invocations which start out of order
+            still get the correct data. */
+        virtual void __prepare( unsigned int serial ) { Q_UNUSED(serial) }
+
+        /** @returns the context of the invocation of this element which runs
+            on the calling thread, or 0 if this element is not reentrant or is
+            not running on the calling thread */
+        ProcessingContext* getProcessingContext() const;
+
         /** signals this element that it is ready to be dispatched */
 //        virtual void signalReady() = 0;
 
@@ -171,6 +234,15 @@ namespace plv
         void startTimer();
         void stopTimer();
 
+        /** updates the average and last processing time with a new
+            measurement and emits onProcessingTimeUpdate */
+        void updateProcessingTime( int elapsed );
+
+        /** tells the pipeline this element is done with the frame captured at
+            captureTime, so it can update the latency of the pipeline's sinks.
+            Called at the end of every __process implementation. */
+        void frameFinished( qint64 captureTime );
+
         /** send a message to the pipeline to display to the user */
         inline void message(PlvMessageType type, const QString& msg)
         {
@@ -201,6 +273,22 @@ namespace plv
         /** serial number of current processing run. */
         unsigned int m_serial;
 
+        /** capture time of the frame of the current processing run */
+        qint64 m_captureTime;
+
+        /** timestamps of the last finished run, protected by m_runTimesMutex */
+        RunTimes m_lastRunTimes;
+        mutable QMutex m_runTimesMutex;
+
+        /** frame, error and timing counters, see getMetrics() */
+        ElementMetrics m_metrics;
+
+        /** true when invocations for different serials may run concurrently */
+        bool m_reentrant;
+
+        /** true when the output may be written into the input buffer */
+        bool m_inPlace;
+
         /** if set contains a pointer to the current pipeline, NULL otherwise */
         Pipeline* m_pipeline;
 
@@ -47,6 +47,15 @@ namespace plv
         static void serialize( const QString& filename, Pipeline* pipeline )
             throw(std::runtime_error); /*TODO checked exceptions*/
 
+        /** Converts value to the type of the property with the given name and
+          * sets it on ple. Enum properties are set by item name.
+          * @returns false and leaves ple untouched if ple has no declared
+          * property called name.
+          */
+        static bool setElementProperty( PipelineElement* ple,
+                                        const QString& name,
+                                        const QString& value );
+
     private:
         PipelineLoader();
         virtual ~PipelineLoader();
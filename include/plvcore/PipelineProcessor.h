@@ -22,6 +22,8 @@
 #ifndef PIPELINEPROCESSOR_H
 #define PIPELINEPROCESSOR_H
 
+#include <QQueue>
+
 #include "DataConsumer.h"
 
 /** Utility macro for implemented pure abstract methods in sub classes */
@@ -49,15 +51,32 @@ namespace plv
         // virtual bool readyToProcess() const { return true; }
 
         virtual bool __init();
+        virtual bool __deinit() throw();
 
         virtual bool __ready( unsigned int& serial );
         virtual bool __process( unsigned int serial );
 
+        /** takes the input for serial from the connections into a new
+            processing context. Only used when this processor is reentrant. */
+        virtual void __prepare( unsigned int serial );
+
         //virtual void acceptData(QVariant& data);
 
     private:
         /** does the actual processing */
         virtual bool process() = 0;
+
+        /** __process implementation for reentrant processors */
+        bool processReentrant( unsigned int serial );
+
+        /** marks context as done and puts the output of all done contexts
+            at the head of the queue on the output connections, so output
+            is put in serial order */
+        void finishContext( ProcessingContext* context );
+
+        /** contexts of dispatched invocations in dispatch order */
+        QQueue<ProcessingContext*> m_contexts;
+        QMutex m_contextsMutex;
     };
 }
 
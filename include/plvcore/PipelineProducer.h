@@ -46,13 +46,20 @@ namespace plv
         /** implementation for definition in PipelineElement */
         virtual bool requiredPinsConnected() const;
 
-        /** returns true when producer can produce. Will be polled by the pipeline */
+        /** returns true when producer can produce. Will be called by the pipeline
+            when it is woken up. Producers which become ready asynchronously
+            should call notifyReadyToProduce() when that happens */
         virtual bool readyToProduce() const = 0;
 
         /** does the actual producing */
         virtual bool produce() = 0;
 
     protected:
+        /** Wakes up the pipeline scheduler so it will call readyToProduce().
+            Call this when new data becomes available, for instance from a
+            capture thread. Thread safe. */
+        void notifyReadyToProduce();
+
         /** makes sure this processor is not already dispatched and calls
             the readyToProduce method and returns the result. If the result
             is true it will be scheduled for execution by the Pipeline. */
@@ -0,0 +1,198 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef PREFETCHPRODUCER_H
+#define PREFETCHPRODUCER_H
+
+#include <QList>
+#include <QPair>
+#include <QQueue>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVariant>
+
+#include "PipelineProducer.h"
+
+/** default number of frames a PrefetchProducer fetches ahead */
+#ifndef PREFETCHPRODUCER_DEFAULT_DEPTH
+#define PREFETCHPRODUCER_DEFAULT_DEPTH 4
+#endif
+
+/** Utility macro for implemented pure abstract methods in sub classes */
+#define PLV_PREFETCH_PRODUCER \
+public: \
+    virtual plv::PrefetchProducer::FetchResult fetch( plv::PrefetchFrame& frame );
+
+namespace plv
+{
+    class IOutputPin;
+
+    /** The output of a single frame of a PrefetchProducer, filled on the
+      * I/O thread and put on the output pins when the frame is produced.
+      */
+    class PLVCORE_EXPORT PrefetchFrame
+    {
+    public:
+        PrefetchFrame() : m_captureTime( 0 ) {}
+
+        /** queues value for output pin pin */
+        template<typename T> inline void put( IOutputPin* pin, const T& value )
+        {
+            m_outputs.append( qMakePair( pin, QVariant::fromValue( value ) ) );
+        }
+
+        inline void putVariant( IOutputPin* pin, const QVariant& value )
+        {
+            m_outputs.append( qMakePair( pin, value ) );
+        }
+
+        inline const QList< QPair<IOutputPin*, QVariant> >& getOutputs() const { return m_outputs; }
+
+        /** Clock::now() at which the frame was fetched, becomes the
+            capture time of the frame in the pipeline */
+        inline qint64 getCaptureTime() const { return m_captureTime; }
+        inline void setCaptureTime( qint64 captureTime ) { m_captureTime = captureTime; }
+
+    private:
+        QList< QPair<IOutputPin*, QVariant> > m_outputs;
+        qint64 m_captureTime;
+    };
+
+    /** A producer for sources which block, like video files, network
+      * streams or disks. Instead of readyToProduce() and produce() the
+      * implementation provides fetch(), which is called in a loop on a
+      * dedicated I/O thread while the pipeline is running. Fetched frames
+      * are kept in a bounded queue of prefetchDepth frames. readyToProduce()
+      * only checks that queue, so the scheduler never waits on I/O, and
+      * produce() puts the oldest fetched frame on the output pins.
+      *
+      * fetch() runs concurrently with the property setters, implementations
+      * should lock m_propertyMutex where they share state with them.
+      */
+    class PLVCORE_EXPORT PrefetchProducer : public PipelineProducer
+    {
+        Q_OBJECT
+
+        Q_PROPERTY( int prefetchDepth READ getPrefetchDepth WRITE setPrefetchDepth NOTIFY prefetchDepthChanged )
+
+    public:
+        enum FetchResult {
+            FETCH_FRAME, /** frame has been filled and can be produced */
+            FETCH_NONE,  /** no frame available yet, fetch() is called again */
+            FETCH_END,   /** the source has ended, fetch() is not called again */
+            FETCH_ERROR  /** an error occured, set with setFetchError(). The
+                             producer reports it when it is produced */
+        };
+
+        PrefetchProducer();
+        virtual ~PrefetchProducer();
+
+        /** called in a loop on the I/O thread, may block. Should return
+            regularly, with FETCH_NONE if need be, so the thread can be
+            stopped. */
+        virtual FetchResult fetch( PrefetchFrame& frame ) = 0;
+
+        /** implementation of PipelineProducer, true when a frame has been fetched */
+        virtual bool readyToProduce() const;
+
+        /** implementation of PipelineProducer, puts the oldest fetched frame */
+        virtual bool produce();
+
+        /** @returns the number of frames fetched but not yet produced */
+        int getPrefetchCount() const;
+
+        int getPrefetchDepth() const;
+
+    signals:
+        void prefetchDepthChanged( int depth );
+
+    public slots:
+        /** sets the number of frames fetched ahead, at least 1. Takes
+            effect the next time the pipeline is started */
+        void setPrefetchDepth( int depth );
+
+    protected:
+        /** starts the I/O thread after start() of the implementation */
+        virtual bool __start();
+
+        /** stops the I/O thread before stop() of the implementation. Frames
+            which have been fetched are produced after the next start */
+        virtual bool __stop();
+
+        /** discards the fetched frames before deinit() of the implementation */
+        virtual bool __deinit() throw();
+
+        /** sets the error reported when FETCH_ERROR is returned */
+        void setFetchError( PlvErrorType type, const QString& msg );
+
+        /** @returns true when the I/O thread has been asked to stop. Long
+            running fetch() implementations can poll this. */
+        bool isStopRequested() const;
+
+        /** sleeps msecs on the I/O thread or until the thread is asked to
+            stop. Used by fetch() to pace a source. Returns false when the
+            thread should stop */
+        bool sleepUnlessStopped( unsigned long msecs );
+
+        /** discards all frames fetched but not yet produced, for instance
+            after a seek. Only call this from fetch() */
+        void flushPrefetched();
+
+        /** @returns the number of frames the implementation is working on
+            ahead of the fetched frames, for instance decodes in flight. Added
+            to the read ahead reported in the metrics. Thread safe. */
+        virtual int getFetchAhead() const { return 0; }
+
+        /** called when the I/O thread is asked to stop. Implementations whose
+            fetch() blocks on something else than sleepUnlessStopped() wake
+            it up here. Called from the pipeline thread */
+        virtual void wakeFetch() {}
+
+    private:
+        class FetchThread : public QThread
+        {
+        public:
+            FetchThread( PrefetchProducer* producer ) : m_producer( producer ) {}
+        protected:
+            void run() { m_producer->fetchLoop(); }
+        private:
+            PrefetchProducer* m_producer;
+        };
+
+        void fetchLoop();
+
+        FetchThread m_fetchThread;
+        int m_prefetchDepth;
+
+        /** protects everything below, the queue is filled by the I/O
+            thread and emptied by produce() */
+        mutable QMutex m_prefetchMutex;
+        QWaitCondition m_prefetchSpace;
+        QQueue<PrefetchFrame> m_prefetched;
+        bool m_stopRequested;
+        bool m_fetchFailed;
+        PlvErrorType m_fetchErrorType;
+        QString m_fetchErrorString;
+    };
+}
+
+#endif // PREFETCHPRODUCER_H
@@ -0,0 +1,106 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef PROCESSINGCONTEXT_H
+#define PROCESSINGCONTEXT_H
+
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QPair>
+#include <QVariant>
+
+#include "plvglobal.h"
+
+namespace plv
+{
+    class Pin;
+    class IInputPin;
+    class IOutputPin;
+    class PipelineElement;
+
+    /** Holds the input and output data of a single invocation of a reentrant
+      * PipelineElement. Several invocations of a reentrant element can run at
+      * the same time, each on its own worker thread with its own context. The
+      * pins of the element read from and write to the context of the calling
+      * thread instead of directly to their connections.
+      */
+    class PLVCORE_EXPORT ProcessingContext
+    {
+    public:
+        ProcessingContext( PipelineElement* element, unsigned int serial );
+        ~ProcessingContext();
+
+        inline PipelineElement* getElement() const { return m_element; }
+        inline unsigned int getSerial() const { return m_serial; }
+
+        /** capture time of the input of this invocation, see
+            PipelineElement::getCaptureTime() */
+        inline qint64 getCaptureTime() const { return m_captureTime; }
+        void mergeCaptureTime( qint64 timestamp );
+
+        /** true when one of the synchronous inputs was a NULL data item */
+        inline bool isNull() const { return m_null; }
+        inline void setNull( bool null ) { m_null = null; }
+
+        /** true when the invocation has finished */
+        inline bool isDone() const { return m_done; }
+        inline void setDone( bool done ) { m_done = done; }
+
+        void setInput( const IInputPin* pin, const QVariant& v );
+        QVariant getInput( const IInputPin* pin ) const;
+
+        /** removes the input of pin from this context and returns it, so the
+            element holds the only reference and may process it in place */
+        QVariant takeInput( const IInputPin* pin );
+        bool hasInput( const IInputPin* pin ) const;
+
+        /** buffers the output until the results of all earlier
+            serials have been put on the connections */
+        void addOutput( IOutputPin* pin, const QVariant& v );
+        const QList< QPair<IOutputPin*, QVariant> >& getOutputs() const { return m_outputs; }
+
+        /** get() or put() has been called on pin during this invocation */
+        inline bool isCalled( const Pin* pin ) const { return m_called.contains(pin); }
+        inline void setCalled( const Pin* pin ) { m_called.insert(pin); }
+
+        /** @returns the context of the invocation running on the calling
+            thread or 0 if there is none */
+        static ProcessingContext* current();
+
+        /** sets the context of the invocation running on the calling thread */
+        static void setCurrent( ProcessingContext* context );
+
+    private:
+        Q_DISABLE_COPY( ProcessingContext )
+
+        PipelineElement* m_element;
+        unsigned int m_serial;
+        qint64 m_captureTime;
+        bool m_null;
+        bool m_done;
+        QHash<const IInputPin*, QVariant> m_inputs;
+        QList< QPair<IOutputPin*, QVariant> > m_outputs;
+        QSet<const Pin*> m_called;
+    };
+}
+
+#endif // PROCESSINGCONTEXT_H
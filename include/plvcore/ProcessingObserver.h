@@ -0,0 +1,53 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#ifndef PROCESSINGOBSERVER_H
+#define PROCESSINGOBSERVER_H
+
+#include <QtGlobal>
+#include "plvglobal.h"
+
+namespace plv
+{
+    class PipelineElement;
+
+    /** Callback interface for profiling tools which want to see every run of
+      * every element of a pipeline. Installed with
+      * Pipeline::setProcessingObserver.
+      */
+    class PLVCORE_EXPORT ProcessingObserver
+    {
+    public:
+        virtual ~ProcessingObserver() {}
+
+        /** Called from the worker thread after element finished processing
+            serial. Start and end are Clock::now() values taken around the
+            call to __process. Implementations should be thread safe and
+            return quickly, since they delay the worker. */
+        virtual void elementProcessed( PipelineElement* element,
+                                       unsigned int serial,
+                                       qint64 start,
+                                       qint64 end ) = 0;
+    };
+}
+
+#endif // PROCESSINGOBSERVER_H
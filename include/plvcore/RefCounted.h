@@ -22,6 +22,7 @@
 #ifndef REFCOUNTED_H
 #define REFCOUNTED_H
 
+#include <QAtomicInt>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QDebug>
@@ -31,11 +32,14 @@
 namespace plv
 {
 
+/** Base class for objects which are shared through RefPtr. The reference
+  * count is an atomic integer, so references can be taken and released
+  * from any thread without locking.
+  */
 class PLVCORE_EXPORT RefCounted
 {
 protected:
-    mutable int m_referenceCount;
-    mutable QMutex m_refMutex;
+    mutable QAtomicInt m_referenceCount;
 
 public:
     /** Initializes reference count to 0 */
@@ -49,6 +53,14 @@ public:
     {
     }
 
+    /** Assignment leaves the reference count of this object untouched,
+      * it belongs to this object and not to its value.
+      */
+    RefCounted& operator=( const RefCounted& )
+    {
+        return *this;
+    }
+
     /** RefCounted objects should generally not explicitely be destructed.
       * However, the Qt meta object system requires the destructor to be
       * public.
@@ -58,8 +70,7 @@ public:
     /** increases reference count by one */
     inline void inc() const
     {
-        QMutexLocker lock( &m_refMutex );
-        ++m_referenceCount;
+        m_referenceCount.ref();
     }
 
     /** decreases reference count by one. Deletes this object if
@@ -67,21 +78,17 @@ public:
       */
     inline void dec() const
     {
-        m_refMutex.lock();
-        --m_referenceCount;
-        if( m_referenceCount < 1 )
+        // deref has ordered semantics, so all writes done through
+        // other references are visible to the destructor
+        if( !m_referenceCount.deref() )
         {
-            m_refMutex.unlock();
             delete this;
-            return;
         }
-        m_refMutex.unlock();
     }
 
     /** @return number of references to this object */
     inline int getRefCount() const
     {
-        QMutexLocker lock( &m_refMutex );
         return m_referenceCount;
     }
 
@@ -90,7 +97,6 @@ public:
       */
     inline void resetRefCount()
     {
-        QMutexLocker lock( &m_refMutex );
         m_referenceCount = 0;
     }
 };
@@ -0,0 +1,92 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QtGlobal>
+#include <QString>
+#include "plvglobal.h"
+
+class QIODevice;
+
+/** maximum number of events recorded per thread, further events are dropped */
+#ifndef TRACER_EVENTS_PER_THREAD
+#define TRACER_EVENTS_PER_THREAD 65536
+#endif
+
+namespace plv
+{
+    class PipelineElement;
+
+    /** Records the execution of pipeline elements and scheduler events while
+      * tracing is enabled and writes them in the Trace Event JSON format which
+      * chrome://tracing and Perfetto can open.
+      *
+      * Every thread records into its own buffer so recording takes no locks.
+      * Call sites test isEnabled() first so tracing costs a single branch when
+      * it is off. Timestamps are Clock::now() values.
+      */
+    class PLVCORE_EXPORT Tracer
+    {
+    public:
+        static inline bool isEnabled() { return s_enabled != 0; }
+
+        /** discards all recorded events and starts recording. Should not be
+            called while a pipeline is running. */
+        static void start();
+
+        /** stops recording, the recorded events are kept */
+        static void stop();
+
+        /** sets the name under which the element with id appears in the
+            trace. Thread safe. */
+        static void nameElement( int id, const QString& name );
+
+        /** records a run of element for serial between start and end */
+        static void span( const PipelineElement* element, unsigned int serial,
+                          qint64 start, qint64 end );
+
+        /** records a scheduler event such as "ready" or "dispatch" for
+            element and serial. Name must be a string literal. */
+        static void instant( const char* name, const PipelineElement* element,
+                             unsigned int serial );
+
+        /** records the value of a counter such as "fps". Name must be a
+            string literal. */
+        static void counter( const char* name, double value );
+
+        /** @returns the number of events which did not fit in a buffer */
+        static int getDropCount();
+
+        /** writes all events recorded since start() as Trace Event JSON.
+            Should only be called when no thread is recording. */
+        static bool write( QIODevice* device );
+        static bool write( const QString& filename );
+
+    private:
+        Tracer();
+
+        static volatile int s_enabled;
+    };
+}
+
+#endif // TRACER_H
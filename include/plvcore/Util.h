@@ -23,6 +23,9 @@ namespace plv
             See http://opencv.willowgarage.com/documentation/cpp/imgproc_image_filtering.html#borderInterpolate */
         static void addDefaultBorderInterpolationTypes( Enum& e );
 
+        /** escapes a string for use in a JSON string literal */
+        static QString jsonEscape( const QString& str );
+
         static const QString& getBuildInformation() { return m_buildInformation; }
         static const QString& getBuildDate() { return m_buildDate; }
         static const QString& getBuildTime() { return m_buildTime; }
@@ -9,7 +9,9 @@ SUBDIRS =   src/plvcore \
             src/plvblobtracker \
             src/plvtcpserver \
             src/plvtest \
-            src/plvpluginexample
+            src/plvpluginexample \
+            src/plvbench \
+            src/plvconsole
 
 win32-msvc2010 {
     #SUBDIRS += src/plvmskinect
@@ -0,0 +1,212 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "ConnectionBenchmark.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+
+using namespace plv;
+
+bool LockedQueue::push( const Data& data )
+{
+    QMutexLocker lock( &m_mutex );
+    if( static_cast<int>( m_queue.size() ) >= m_size )
+        return false;
+    m_queue.push( data );
+    return true;
+}
+
+bool LockedQueue::pop( Data& data )
+{
+    QMutexLocker lock( &m_mutex );
+    if( m_queue.empty() )
+        return false;
+    data = m_queue.front();
+    m_queue.pop();
+    return true;
+}
+
+bool LockedQueue::peek( unsigned int& serial, bool& isNull ) const
+{
+    QMutexLocker lock( &m_mutex );
+    if( m_queue.empty() )
+        return false;
+    const Data& d = m_queue.front();
+    serial = d.getSerial();
+    isNull = d.isNull();
+    return true;
+}
+
+int LockedQueue::count() const
+{
+    QMutexLocker lock( &m_mutex );
+    return static_cast<int>( m_queue.size() );
+}
+
+namespace
+{
+    template<class Queue>
+    class ProducerThread : public QThread
+    {
+    public:
+        ProducerThread( Queue& queue, int items ) : m_queue( queue ), m_items( items ) {}
+
+    protected:
+        void run()
+        {
+            QVariant payload( 42 );
+            for( int i=0; i < m_items; ++i )
+            {
+                Data data( i, payload );
+                while( !m_queue.push( data ) )
+                    yieldCurrentThread();
+            }
+        }
+
+    private:
+        Queue& m_queue;
+        int m_items;
+    };
+
+    template<class Queue>
+    class ConsumerThread : public QThread
+    {
+    public:
+        ConsumerThread( Queue& queue, int items ) : m_queue( queue ), m_items( items ) {}
+
+    protected:
+        void run()
+        {
+            Data data;
+            for( int i=0; i < m_items; ++i )
+            {
+                while( !m_queue.pop( data ) )
+                    yieldCurrentThread();
+            }
+        }
+
+    private:
+        Queue& m_queue;
+        int m_items;
+    };
+
+    template<class Queue>
+    class PeekThread : public QThread
+    {
+    public:
+        PeekThread( Queue& queue ) : m_queue( queue ), m_peeks( 0 ) { m_stop = 0; }
+
+        void stop() { m_stop = 1; }
+        qint64 getPeeks() const { return m_peeks; }
+
+    protected:
+        void run()
+        {
+            unsigned int serial;
+            bool isNull;
+            while( m_stop == 0 )
+            {
+                m_queue.peek( serial, isNull );
+                ++m_peeks;
+            }
+        }
+
+    private:
+        Queue& m_queue;
+        qint64 m_peeks;
+        QAtomicInt m_stop;
+    };
+}
+
+ConnectionBenchmark::ConnectionBenchmark( int items, int size ) :
+    m_items( qMax(items, 1) ),
+    m_size( qMax(size, 1) )
+{
+}
+
+void ConnectionBenchmark::run( QTextStream& out )
+{
+    // warm up
+    single<LockedQueue>();
+    single<DataRing>();
+
+    double singleLocked = single<LockedQueue>();
+    double singleRing   = single<DataRing>();
+    double spscLocked   = transfer<LockedQueue>( false );
+    double spscRing     = transfer<DataRing>( false );
+    double peekLocked   = transfer<LockedQueue>( true );
+    double peekRing     = transfer<DataRing>( true );
+
+    out << "connection benchmark: " << m_items << " items, "
+        << m_size << " slots" << endl;
+    out << "single (ns per item)  mutex+queue: " << singleLocked
+        << " ring: " << singleRing << endl;
+    out << "spsc   (ns per item)  mutex+queue: " << spscLocked
+        << " ring: " << spscRing << endl;
+    out << "peek   (ns per item)  mutex+queue: " << peekLocked
+        << " ring: " << peekRing << endl;
+}
+
+template<class Queue>
+double ConnectionBenchmark::single()
+{
+    Queue queue( m_size );
+    QVariant payload( 42 );
+    Data data;
+
+    QElapsedTimer timer;
+    timer.start();
+    for( int i=0; i < m_items; ++i )
+    {
+        queue.push( Data( i, payload ) );
+        queue.pop( data );
+    }
+    return timer.nsecsElapsed() / static_cast<double>( m_items );
+}
+
+template<class Queue>
+double ConnectionBenchmark::transfer( bool withPeeker )
+{
+    Queue queue( m_size );
+    ProducerThread<Queue> producer( queue, m_items );
+    ConsumerThread<Queue> consumer( queue, m_items );
+    PeekThread<Queue> peeker( queue );
+
+    QElapsedTimer timer;
+    timer.start();
+    if( withPeeker )
+        peeker.start();
+    consumer.start();
+    producer.start();
+
+    producer.wait();
+    consumer.wait();
+    double elapsed = timer.nsecsElapsed() / static_cast<double>( m_items );
+
+    if( withPeeker )
+    {
+        peeker.stop();
+        peeker.wait();
+    }
+    return elapsed;
+}
@@ -0,0 +1,77 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef CONNECTIONBENCHMARK_H
+#define CONNECTIONBENCHMARK_H
+
+#include <queue>
+
+#include <QMutex>
+#include <QTextStream>
+
+#include <plvcore/PinConnection.h>
+
+/** Queue of Data items protected by a single mutex, the way
+    PinConnection stored its data before it used a DataRing */
+class LockedQueue
+{
+public:
+    LockedQueue( int size ) : m_size( size ) {}
+
+    bool push( const plv::Data& data );
+    bool pop( plv::Data& data );
+    bool peek( unsigned int& serial, bool& isNull ) const;
+    int count() const;
+
+private:
+    int m_size;
+    std::queue<plv::Data> m_queue;
+    mutable QMutex m_mutex;
+};
+
+/** Measures put and get throughput of the connection queue. The lock-free
+  * DataRing is compared with a mutex protected std::queue in three settings.
+  *
+  * single: one thread puts and gets every item, which measures the bare cost
+  *         of a queue operation.
+  * spsc:   a producer thread puts while a consumer thread gets, like an
+  *         element and its downstream element on different workers.
+  * peek:   as spsc, with a third thread peeking at the front item all the
+  *         time, like the scheduler checking which consumers are ready.
+  */
+class ConnectionBenchmark
+{
+public:
+    ConnectionBenchmark( int items, int size );
+
+    /** runs all measurements and writes the results to out */
+    void run( QTextStream& out );
+
+private:
+    /** @returns the average time in nanoseconds per item */
+    template<class Queue> double single();
+    template<class Queue> double transfer( bool withPeeker );
+
+    int m_items;
+    int m_size;
+};
+
+#endif // CONNECTIONBENCHMARK_H
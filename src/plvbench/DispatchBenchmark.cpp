@@ -0,0 +1,183 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "DispatchBenchmark.h"
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+using namespace plv;
+
+bool NoopElement::visit( QList<PipelineElement*>& ordering, QSet<PipelineElement*>& visited )
+{
+    if( !visited.contains(this) )
+    {
+        visited.insert(this);
+        ordering.append(this);
+    }
+    return true;
+}
+
+DispatchBenchmark::DispatchBenchmark( int elements, int iterations, int threads ) :
+    m_elementCount( qMax(elements, 1) ),
+    m_iterations( qMax(iterations, 1) ),
+    m_threads( threads > 0 ? threads : QThread::idealThreadCount() )
+{
+    for( int i=0; i < m_elementCount; ++i )
+    {
+        NoopElement* element = new NoopElement();
+        element->setState( PipelineElement::PLE_STARTED );
+        m_elements.append( element );
+    }
+}
+
+DispatchBenchmark::~DispatchBenchmark()
+{
+    qDeleteAll( m_elements );
+}
+
+void DispatchBenchmark::taskFinished( PipelineElement* element, unsigned int serial, bool result )
+{
+    Q_UNUSED( element )
+    Q_UNUSED( serial )
+    Q_UNUSED( result )
+    m_finished.release();
+}
+
+void DispatchBenchmark::run( QTextStream& out )
+{
+    // use the same number of threads for both paths
+    QThreadPool::globalInstance()->setMaxThreadCount( m_threads );
+
+    Executor executor( this );
+    executor.setWorkerCount( m_threads );
+    executor.start();
+
+    // warm up both thread pools
+    chainQtConcurrent();
+    chainExecutor( executor );
+
+    double chainQt   = chainQtConcurrent();
+    double chainExec = chainExecutor( executor );
+    double batchQt   = batchQtConcurrent();
+    double batchExec = batchExecutor( executor );
+
+    executor.stop();
+
+    out << "dispatch benchmark: " << m_elementCount << " elements, "
+        << m_iterations << " iterations, " << m_threads << " threads" << endl;
+    out << "chain (us per dispatch)  QtConcurrent: " << chainQt
+        << " Executor: " << chainExec << endl;
+    out << "batch (us per dispatch)  QtConcurrent: " << batchQt
+        << " Executor: " << batchExec << endl;
+}
+
+double DispatchBenchmark::chainQtConcurrent()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for( int i=0; i < m_iterations; ++i )
+    {
+        foreach( NoopElement* element, m_elements )
+        {
+            element->setState( PipelineElement::PLE_DISPATCHED );
+            QFuture<bool> future = QtConcurrent::run( element, &PipelineElement::run, (unsigned int)i );
+
+            // poll like the scheduler used to do
+            while( !future.isFinished() ) {}
+            element->setState( PipelineElement::PLE_STARTED );
+        }
+    }
+    return timer.nsecsElapsed() / (1000.0 * m_iterations * m_elementCount);
+}
+
+double DispatchBenchmark::chainExecutor( Executor& executor )
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for( int i=0; i < m_iterations; ++i )
+    {
+        int worker = -1;
+        foreach( NoopElement* element, m_elements )
+        {
+            element->setState( PipelineElement::PLE_DISPATCHED );
+            executor.submit( element, (unsigned int)i, worker );
+            m_finished.acquire();
+            element->setState( PipelineElement::PLE_STARTED );
+
+            // keep the rest of the chain on the first worker like the
+            // pipeline does for consumers of data produced on a worker
+            worker = 0;
+        }
+    }
+    return timer.nsecsElapsed() / (1000.0 * m_iterations * m_elementCount);
+}
+
+double DispatchBenchmark::batchQtConcurrent()
+{
+    QList< QFuture<bool> > futures;
+    QElapsedTimer timer;
+    timer.start();
+
+    for( int i=0; i < m_iterations; ++i )
+    {
+        futures.clear();
+        foreach( NoopElement* element, m_elements )
+        {
+            element->setState( PipelineElement::PLE_DISPATCHED );
+            futures.append( QtConcurrent::run( element, &PipelineElement::run, (unsigned int)i ) );
+        }
+        foreach( const QFuture<bool>& future, futures )
+        {
+            while( !future.isFinished() ) {}
+        }
+        foreach( NoopElement* element, m_elements )
+        {
+            element->setState( PipelineElement::PLE_STARTED );
+        }
+    }
+    return timer.nsecsElapsed() / (1000.0 * m_iterations * m_elementCount);
+}
+
+double DispatchBenchmark::batchExecutor( Executor& executor )
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for( int i=0; i < m_iterations; ++i )
+    {
+        foreach( NoopElement* element, m_elements )
+        {
+            element->setState( PipelineElement::PLE_DISPATCHED );
+            executor.submit( element, (unsigned int)i );
+        }
+        m_finished.acquire( m_elementCount );
+        foreach( NoopElement* element, m_elements )
+        {
+            element->setState( PipelineElement::PLE_STARTED );
+        }
+    }
+    return timer.nsecsElapsed() / (1000.0 * m_iterations * m_elementCount);
+}
@@ -0,0 +1,83 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef DISPATCHBENCHMARK_H
+#define DISPATCHBENCHMARK_H
+
+#include <QList>
+#include <QSemaphore>
+#include <QTextStream>
+
+#include <plvcore/PipelineElement.h>
+#include <plvcore/Executor.h>
+
+/** A pipeline element which does no work at all, used to measure
+    the overhead of dispatching an element to a worker thread */
+class NoopElement : public plv::PipelineElement
+{
+public:
+    NoopElement() {}
+    virtual ~NoopElement() {}
+
+    virtual bool __ready( unsigned int& serial ) { Q_UNUSED(serial) return true; }
+    virtual bool __process( unsigned int serial ) { setProcessingSerial(serial); return true; }
+    virtual bool visit( QList<PipelineElement*>& ordering, QSet<PipelineElement*>& visited );
+    virtual bool isEndNode() const { return true; }
+    virtual bool requiredPinsConnected() const { return true; }
+    virtual bool isDataConsumer() const { return false; }
+    virtual bool isDataProducer() const { return false; }
+};
+
+/** Compares the dispatch overhead of the pipeline Executor with that of
+  * QtConcurrent::run on the global thread pool followed by polling of the
+  * future, which is how the pipeline dispatched elements before.
+  *
+  * Two figures are measured for both paths. The round trip time of a chain
+  * of cheap elements run back to back, and the time needed to run a batch
+  * of independent cheap elements.
+  */
+class DispatchBenchmark : public plv::ExecutorListener
+{
+public:
+    DispatchBenchmark( int elements, int iterations, int threads );
+    virtual ~DispatchBenchmark();
+
+    /** runs all measurements and writes the results to out */
+    void run( QTextStream& out );
+
+    /** implementation of ExecutorListener */
+    virtual void taskFinished( plv::PipelineElement* element, unsigned int serial, bool result );
+
+private:
+    /** @returns the average time in microseconds of a single dispatch */
+    double chainQtConcurrent();
+    double chainExecutor( plv::Executor& executor );
+    double batchQtConcurrent();
+    double batchExecutor( plv::Executor& executor );
+
+    int m_elementCount;
+    int m_iterations;
+    int m_threads;
+    QList<NoopElement*> m_elements;
+    QSemaphore m_finished;
+};
+
+#endif // DISPATCHBENCHMARK_H
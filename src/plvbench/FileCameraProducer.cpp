@@ -0,0 +1,184 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#include "FileCameraProducer.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include <opencv/highgui.h>
+#include <plvcore/CvMatDataPin.h>
+
+using namespace plv;
+
+FileCameraProducer::FileCameraProducer() :
+    m_width(640),
+    m_height(480),
+    m_next(0)
+{
+    m_outputPin = createCvMatDataOutputPin( "output", this );
+
+    m_outputPin->addSupportedChannels(3);
+    m_outputPin->addSupportedDepth(CV_8U);
+}
+
+FileCameraProducer::~FileCameraProducer()
+{
+}
+
+bool FileCameraProducer::init()
+{
+    m_frames.clear();
+    m_next = 0;
+
+    if( m_filename.isEmpty() )
+    {
+        for( int i=0; i < FILECAMERAPRODUCER_SYNTHETIC_FRAMES; ++i )
+        {
+            cv::Mat frame( m_height, m_width, CV_8UC3 );
+            cv::randu( frame, cv::Scalar::all(0), cv::Scalar::all(256) );
+            addFrame( frame );
+        }
+        return true;
+    }
+
+    QFileInfo info( m_filename );
+    if( info.isDir() )
+    {
+        QDir dir( m_filename );
+        dir.setFilter( QDir::Files | QDir::NoDotAndDotDot | QDir::Readable );
+        dir.setSorting( QDir::Name );
+        foreach( const QFileInfo& entry, dir.entryInfoList() )
+        {
+            if( m_frames.size() >= FILECAMERAPRODUCER_MAX_FRAMES )
+                break;
+            cv::Mat image = cv::imread( entry.absoluteFilePath().toStdString() );
+            if( image.data != 0 )
+                addFrame( image );
+        }
+    }
+    else
+    {
+        loadFile( m_filename );
+    }
+
+    if( m_frames.isEmpty() )
+    {
+        setError( PlvPipelineInitError, tr("No frames could be read from %1").arg(m_filename) );
+        return false;
+    }
+    return true;
+}
+
+bool FileCameraProducer::loadFile( const QString& path )
+{
+    cv::Mat image = cv::imread( path.toStdString() );
+    if( image.data != 0 )
+        return addFrame( image );
+
+    // not an image, try to decode it as video
+    cv::VideoCapture capture( path.toStdString() );
+    cv::Mat frame;
+    while( m_frames.size() < FILECAMERAPRODUCER_MAX_FRAMES && capture.read( frame ) )
+    {
+        addFrame( frame );
+    }
+    return !m_frames.isEmpty();
+}
+
+bool FileCameraProducer::addFrame( const cv::Mat& frame )
+{
+    CvMatData data = CvMatData::create( m_width, m_height, CV_8UC3 );
+    cv::Mat& dst = data;
+    if( frame.cols == m_width && frame.rows == m_height )
+        frame.copyTo( dst );
+    else
+        cv::resize( frame, dst, cv::Size( m_width, m_height ) );
+    m_frames.append( data );
+    return true;
+}
+
+bool FileCameraProducer::deinit() throw()
+{
+    m_frames.clear();
+    return true;
+}
+
+bool FileCameraProducer::readyToProduce() const
+{
+    return !m_frames.isEmpty();
+}
+
+bool FileCameraProducer::produce()
+{
+    const CvMatData& frame = m_frames.at( m_next );
+    m_next = (m_next + 1) % m_frames.size();
+
+    // hand out a private copy like a camera does with a fresh buffer
+    CvMatData out = CvMatData::create( frame.properties() );
+    cv::Mat& dst = out;
+    frame.getReadOnly().copyTo( dst );
+    m_outputPin->put( out );
+    return true;
+}
+
+QString FileCameraProducer::getFilename() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_filename;
+}
+
+void FileCameraProducer::setFilename(const QString& filename)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_filename = filename;
+    emit filenameChanged(m_filename);
+}
+
+int FileCameraProducer::getWidth() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_width;
+}
+
+void FileCameraProducer::setWidth(int w)
+{
+    QMutexLocker lock(m_propertyMutex);
+    if( w > 0 )
+        m_width = w;
+    emit widthChanged(m_width);
+}
+
+int FileCameraProducer::getHeight() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_height;
+}
+
+void FileCameraProducer::setHeight(int h)
+{
+    QMutexLocker lock(m_propertyMutex);
+    if( h > 0 )
+        m_height = h;
+    emit heightChanged(m_height);
+}
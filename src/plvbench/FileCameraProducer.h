@@ -0,0 +1,100 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#ifndef FILECAMERAPRODUCER_H
+#define FILECAMERAPRODUCER_H
+
+#include <QList>
+#include <plvcore/PipelineProducer.h>
+#include <plvcore/CvMatData.h>
+
+namespace plv
+{
+    class CvMatDataOutputPin;
+}
+
+/** number of frames generated when no file is set */
+#ifndef FILECAMERAPRODUCER_SYNTHETIC_FRAMES
+#define FILECAMERAPRODUCER_SYNTHETIC_FRAMES 16
+#endif
+
+/** maximum number of frames read from a video file */
+#ifndef FILECAMERAPRODUCER_MAX_FRAMES
+#define FILECAMERAPRODUCER_MAX_FRAMES 256
+#endif
+
+/** Stand in for the camera producers when benchmarking. Reads the frames of
+  * an image, a directory of images or a video file into memory in init()
+  * and replays them as fast as the pipeline accepts them. Generates noise
+  * frames when no file is set. Every frame is copied into a new image like
+  * a camera would deliver it, so disk and decoder speed do not influence
+  * the measurement but allocation does.
+  */
+class FileCameraProducer : public plv::PipelineProducer
+{
+    Q_OBJECT
+    Q_DISABLE_COPY( FileCameraProducer )
+
+    Q_CLASSINFO("author", "Richard Loos")
+    Q_CLASSINFO("name", "File Camera Producer")
+    Q_CLASSINFO("description", "Replays images or a video from memory in place of a camera.")
+    Q_PROPERTY( QString filename READ getFilename WRITE setFilename NOTIFY filenameChanged )
+    Q_PROPERTY( int width READ getWidth WRITE setWidth NOTIFY widthChanged )
+    Q_PROPERTY( int height READ getHeight WRITE setHeight NOTIFY heightChanged )
+
+    /** required standard method declaration for plv::PipelineProducer */
+    PLV_PIPELINE_PRODUCER
+
+public:
+    FileCameraProducer();
+    virtual ~FileCameraProducer();
+
+    virtual bool init();
+    virtual bool deinit() throw();
+
+    QString getFilename() const;
+    int getWidth() const;
+    int getHeight() const;
+
+public slots:
+    void setFilename(const QString& filename);
+    void setWidth(int w);
+    void setHeight(int h);
+
+signals:
+    void filenameChanged(const QString& filename);
+    void widthChanged(int w);
+    void heightChanged(int h);
+
+private:
+    bool addFrame( const cv::Mat& frame );
+    bool loadFile( const QString& path );
+
+    QString m_filename;
+    int m_width;
+    int m_height;
+    int m_next;
+    QList<plv::CvMatData> m_frames;
+    plv::CvMatDataOutputPin* m_outputPin;
+};
+
+#endif // FILECAMERAPRODUCER_H
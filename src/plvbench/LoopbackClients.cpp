@@ -0,0 +1,244 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "LoopbackClients.h"
+#include "Proto.h"
+
+#include <QDataStream>
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <QtEndian>
+#include <QDebug>
+
+LoopbackClient::LoopbackClient( quint16 port, bool lowDelay, QAtomicInt* frames ) :
+    m_socket( 0 ),
+    m_port( port ),
+    m_lowDelay( lowDelay ),
+    m_ackPending( false ),
+    m_ackSerial( 0 ),
+    m_frames( frames ),
+    m_connected( false ),
+    m_version( PROTO_VERSION_1 ),
+    m_blockSize( -1 )
+{
+}
+
+LoopbackClient::~LoopbackClient()
+{
+    delete m_socket;
+}
+
+void LoopbackClient::connectToServer()
+{
+    if( m_socket == 0 )
+    {
+        m_socket = new QTcpSocket( this );
+        connect( m_socket, SIGNAL( connected() ), this, SLOT( connected() ) );
+        connect( m_socket, SIGNAL( readyRead() ), this, SLOT( readData() ) );
+        connect( m_socket, SIGNAL( error(QAbstractSocket::SocketError) ),
+                 this, SLOT( error(QAbstractSocket::SocketError) ) );
+    }
+    m_socket->connectToHost( QHostAddress( QHostAddress::LocalHost ), m_port );
+}
+
+void LoopbackClient::disconnectFromServer()
+{
+    m_connected = false;
+    if( m_socket != 0 )
+        m_socket->abort();
+}
+
+void LoopbackClient::connected()
+{
+    m_connected = true;
+    m_version = PROTO_VERSION_1;
+    m_blockSize = -1;
+    m_ackPending = false;
+    m_socket->setSocketOption( QAbstractSocket::LowDelayOption, m_lowDelay ? 1 : 0 );
+    writeMessage( PROTO_INIT, PROTO_VERSION );
+}
+
+void LoopbackClient::error( QAbstractSocket::SocketError socketError )
+{
+    Q_UNUSED( socketError )
+    m_connected = false;
+    qWarning() << "loopback client:" << m_socket->errorString();
+}
+
+void LoopbackClient::writeMessage( quint32 opcode, quint32 value )
+{
+    // messages to the server are always version 1
+    QByteArray bytes;
+    QDataStream out( &bytes, QIODevice::WriteOnly );
+    out.setVersion( QDataStream::Qt_4_0 );
+    out << (quint32)(2*sizeof(quint32));
+    out << opcode;
+    out << value;
+    m_socket->write( bytes );
+}
+
+void LoopbackClient::readData()
+{
+    readMessages();
+
+    // one cumulative ack for everything read in one go
+    if( m_ackPending )
+    {
+        m_ackPending = false;
+        writeMessage( PROTO_ACK, m_ackSerial );
+    }
+}
+
+void LoopbackClient::readMessages()
+{
+    forever
+    {
+        if( m_blockSize < 0 )
+        {
+            if( m_socket->bytesAvailable() < (qint64)sizeof(quint32) )
+                return;
+
+            uchar size[sizeof(quint32)];
+            m_socket->read( reinterpret_cast<char*>( size ), sizeof(quint32) );
+            m_blockSize = m_version >= PROTO_VERSION_2 ? qFromLittleEndian<quint32>( size )
+                                                       : qFromBigEndian<quint32>( size );
+        }
+
+        if( m_socket->bytesAvailable() < m_blockSize )
+            return;
+
+        // read the whole message like a real client would
+        m_buffer.resize( m_blockSize );
+        m_socket->read( m_buffer.data(), m_blockSize );
+        m_blockSize = -1;
+        if( m_buffer.size() < 2 * (int)sizeof(quint32) )
+            continue;
+
+        const uchar* fields = reinterpret_cast<const uchar*>( m_buffer.constData() );
+        quint32 opcode = m_version >= PROTO_VERSION_2 ? qFromLittleEndian<quint32>( fields )
+                                                      : qFromBigEndian<quint32>( fields );
+        quint32 value  = m_version >= PROTO_VERSION_2 ? qFromLittleEndian<quint32>( fields + 4 )
+                                                      : qFromBigEndian<quint32>( fields + 4 );
+        switch( opcode )
+        {
+        case PROTO_INIT:
+            m_version = value;
+            break;
+        case PROTO_FRAME:
+            writeMessage( PROTO_ACK, value );
+            m_frames->ref();
+            break;
+        case PROTO_FRAME_V2:
+            m_ackPending = true;
+            m_ackSerial = value;
+            m_frames->ref();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+LoopbackClients::LoopbackClients( int count, quint16 port, int threads, bool lowDelay ) :
+    m_frames( count ),
+    m_marks( count ),
+    m_connected( 0 ),
+    m_minFps( 0 ),
+    m_meanFps( 0 )
+{
+    for( int i=0; i < (threads < 1 ? 1 : threads); ++i )
+    {
+        Thread* thread = new Thread();
+        m_threads.append( thread );
+        thread->start();
+    }
+
+    for( int i=0; i < count; ++i )
+    {
+        LoopbackClient* client = new LoopbackClient( port, lowDelay, &m_frames[i] );
+        client->moveToThread( m_threads.at( i % m_threads.size() ) );
+        m_clients.append( client );
+    }
+}
+
+LoopbackClients::~LoopbackClients()
+{
+    stop();
+}
+
+void LoopbackClients::start()
+{
+    foreach( LoopbackClient* client, m_clients )
+    {
+        QMetaObject::invokeMethod( client, "connectToServer", Qt::QueuedConnection );
+    }
+}
+
+void LoopbackClients::stop()
+{
+    foreach( LoopbackClient* client, m_clients )
+    {
+        QMetaObject::invokeMethod( client, "disconnectFromServer", Qt::BlockingQueuedConnection );
+    }
+
+    foreach( Thread* thread, m_threads )
+    {
+        thread->quit();
+        thread->wait();
+    }
+
+    // the threads are done so the clients can be deleted from here
+    qDeleteAll( m_clients );
+    qDeleteAll( m_threads );
+    m_clients.clear();
+    m_threads.clear();
+}
+
+void LoopbackClients::mark()
+{
+    for( int i=0; i < m_frames.size(); ++i )
+        m_marks[i] = m_frames[i];
+}
+
+void LoopbackClients::measure( double seconds )
+{
+    if( m_frames.isEmpty() || seconds <= 0 )
+        return;
+
+    int minFrames = -1;
+    qint64 totalFrames = 0;
+    for( int i=0; i < m_frames.size(); ++i )
+    {
+        int frames = m_frames[i] - m_marks[i];
+        if( minFrames < 0 || frames < minFrames )
+            minFrames = frames;
+        totalFrames += frames;
+    }
+    m_minFps = minFrames / seconds;
+    m_meanFps = totalFrames / seconds / m_frames.size();
+
+    m_connected = 0;
+    foreach( LoopbackClient* client, m_clients )
+    {
+        if( client->isConnected() )
+            ++m_connected;
+    }
+}
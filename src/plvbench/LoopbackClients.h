@@ -0,0 +1,117 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef LOOPBACKCLIENTS_H
+#define LOOPBACKCLIENTS_H
+
+#include <QAbstractSocket>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+
+QT_FORWARD_DECLARE_CLASS( QTcpSocket )
+
+/** A stand-in for a TCPClientProducer. It negotiates the newest
+  * protocol version, acknowledges the frames like TCPClientProducer does
+  * and throws their contents away, so many of them fit in one process.
+  */
+class LoopbackClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    LoopbackClient( quint16 port, bool lowDelay, QAtomicInt* frames );
+    virtual ~LoopbackClient();
+
+    inline bool isConnected() const { return m_connected; }
+
+public slots:
+    void connectToServer();
+    void disconnectFromServer();
+
+private slots:
+    void connected();
+    void readData();
+    void error( QAbstractSocket::SocketError socketError );
+
+private:
+    void writeMessage( quint32 opcode, quint32 value );
+    void readMessages();
+
+    QTcpSocket* m_socket;
+    quint16 m_port;
+    bool m_lowDelay;
+    bool m_ackPending;
+    quint32 m_ackSerial;
+    QAtomicInt* m_frames;
+    volatile bool m_connected;
+    int m_version;
+    qint64 m_blockSize;
+    QByteArray m_buffer;
+};
+
+/** Runs a number of LoopbackClients on a few threads of their own and
+  * counts the frames each of them received.
+  */
+class LoopbackClients
+{
+public:
+    LoopbackClients( int count, quint16 port, int threads, bool lowDelay );
+    ~LoopbackClients();
+
+    /** connects all clients */
+    void start();
+
+    /** disconnects all clients and stops their threads */
+    void stop();
+
+    /** starts counting frames */
+    void mark();
+
+    /** stops counting and remembers the frame rates over seconds
+        and the number of connected clients */
+    void measure( double seconds );
+
+    inline int getCount() const { return m_frames.size(); }
+    inline int getConnectedCount() const { return m_connected; }
+    inline double getMinFps() const { return m_minFps; }
+    inline double getMeanFps() const { return m_meanFps; }
+
+private:
+    class Thread : public QThread
+    {
+    protected:
+        void run() { exec(); }
+    };
+
+    QList<Thread*> m_threads;
+    QList<LoopbackClient*> m_clients;
+    QVector<QAtomicInt> m_frames;
+    QVector<int> m_marks;
+    int m_connected;
+    double m_minFps;
+    double m_meanFps;
+};
+
+#endif // LOOPBACKCLIENTS_H
@@ -0,0 +1,745 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#include "PipelineBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QDomDocument>
+#include <QFile>
+#include <QMutexLocker>
+
+#include <plvcore/Clock.h>
+#include <plvcore/CvMatData.h>
+#include <plvcore/DataConsumer.h>
+#include <plvcore/DataProducer.h>
+#include <plvcore/IInputPin.h>
+#include <plvcore/IOutputPin.h>
+#include <plvcore/PinConnection.h>
+#include <plvcore/PipelineElementFactory.h>
+#include <plvcore/PipelineLoader.h>
+#include <plvcore/PipelineProducer.h>
+#include <plvcore/Util.h>
+
+#include "FileCameraProducer.h"
+#include "LoopbackClients.h"
+
+using namespace plv;
+
+PipelineBenchmark::PipelineBenchmark( int frames, int warmup, int threads ) :
+    m_pipeline( new Pipeline() ),
+    m_width( 0 ),
+    m_height( 0 ),
+    m_frames( frames ),
+    m_warmup( warmup ),
+    m_threads( threads ),
+    m_steps( 0 ),
+    m_lastSteps( 0 ),
+    m_measureStart( 0 ),
+    m_measureEnd( 0 ),
+    m_poolMisses( 0 ),
+    m_poolHits( 0 ),
+    m_poolEvictions( 0 ),
+    m_clientCount( 0 ),
+    m_clientPort( 0 ),
+    m_clientThreads( 0 ),
+    m_lowDelay( false ),
+    m_clients( 0 ),
+    m_reportsPerFrame( 0 ),
+    m_incompleteFrames( 0 )
+{
+    m_measureFrom = -1;
+
+    // stepTaken is emitted from within the scheduler, queue it
+    // so we never stop the pipeline from inside schedule()
+    connect( m_pipeline.getPtr(), SIGNAL( stepTaken(unsigned int) ),
+             this, SLOT( stepTaken(unsigned int) ),
+             Qt::QueuedConnection );
+
+    connect( m_pipeline.getPtr(), SIGNAL( pipelineError(PlvErrorType, plv::PipelineElement*) ),
+             this, SLOT( pipelineError(PlvErrorType, plv::PipelineElement*) ),
+             Qt::QueuedConnection );
+
+    connect( m_pipeline.getPtr(), SIGNAL( pipelineMessage(QtMsgType, QString) ),
+             this, SLOT( pipelineMessage(QtMsgType, QString) ) );
+
+    connect( &m_sampleTimer, SIGNAL( timeout() ), this, SLOT( sampleQueues() ) );
+    connect( &m_stallTimer, SIGNAL( timeout() ), this, SLOT( checkStalled() ) );
+}
+
+PipelineBenchmark::~PipelineBenchmark()
+{
+    if( m_pipeline->isRunning() )
+        m_pipeline->stop();
+    m_pipeline->setProcessingObserver( 0 );
+
+    delete m_clients;
+
+    // elements and connections hold a reference to the pipeline
+    m_pipeline->clear();
+    qDeleteAll( m_elementStats );
+}
+
+QStringList PipelineBenchmark::syntheticPipelines()
+{
+    return QStringList() << "blobs" << "camera" << "test" << "tcp" << "shm" << "drop";
+}
+
+PipelineElement* PipelineBenchmark::addElement( const QString& type, QString& error )
+{
+    PipelineElement* element = PipelineElementFactory::construct( type );
+    if( element == 0 )
+    {
+        error = QString( "element type %1 is not available, is its plugin built?" ).arg( type );
+        return 0;
+    }
+    m_pipeline->addElement( element );
+    return element;
+}
+
+bool PipelineBenchmark::connectPins( PipelineElement* from, const QString& outName,
+                                     PipelineElement* to, const QString& inName,
+                                     QString& error, PinConnection** connection )
+{
+    IOutputPin* out = 0;
+    foreach( const RefPtr<IOutputPin>& pin, dynamic_cast<DataProducer*>( from )->getOutputPins() )
+    {
+        if( pin->getName() == outName )
+            out = pin.getPtr();
+    }
+
+    IInputPin* in = 0;
+    foreach( const RefPtr<IInputPin>& pin, dynamic_cast<DataConsumer*>( to )->getInputPins() )
+    {
+        if( pin->getName() == inName )
+            in = pin.getPtr();
+    }
+
+    if( out == 0 || in == 0 )
+    {
+        error = QString( "can not connect %1.%2 to %3.%4, no such pin" )
+                .arg( from->getName() ).arg( outName )
+                .arg( to->getName() ).arg( inName );
+        return false;
+    }
+
+    try
+    {
+        int id = m_pipeline->connectPins( out, in );
+        if( connection != 0 )
+            *connection = m_pipeline->getConnection( id );
+    }
+    catch( plv::Exception& e )
+    {
+        error = QString( "can not connect %1.%2 to %3.%4: %5" )
+                .arg( from->getName() ).arg( outName )
+                .arg( to->getName() ).arg( inName ).arg( e.what() );
+        return false;
+    }
+    return true;
+}
+
+bool PipelineBenchmark::build( const QString& name, QString& error )
+{
+    m_name = name;
+
+    if( name == "blobs" )
+    {
+        // single channel chain, most elements can work in place
+        PipelineElement* producer  = addElement( "BlobProducer", error );
+        PipelineElement* smooth    = addElement( "plvopencv::GaussianSmooth", error );
+        PipelineElement* threshold = addElement( "plvopencv::ImageThreshold", error );
+        PipelineElement* dilate    = addElement( "plvopencv::DilateErode", error );
+        if( producer == 0 || smooth == 0 || threshold == 0 || dilate == 0 )
+            return false;
+
+        return connectPins( producer, "output", smooth, "input", error ) &&
+               connectPins( smooth, "output", threshold, "input", error ) &&
+               connectPins( threshold, "output", dilate, "input", error );
+    }
+
+    if( name == "camera" )
+    {
+        // colour camera image converted once and fanned out to three branches
+        PipelineElement* producer = addElement( "FileCameraProducer", error );
+        PipelineElement* convert  = addElement( "plvopencv::ImageColorConvert", error );
+        PipelineElement* smooth   = addElement( "plvopencv::GaussianSmooth", error );
+        PipelineElement* canny    = addElement( "plvopencv::EdgeDetectorCanny", error );
+        PipelineElement* flip     = addElement( "plvopencv::ImageFlip", error );
+        if( producer == 0 || convert == 0 || smooth == 0 || canny == 0 || flip == 0 )
+            return false;
+
+        return connectPins( producer, "output", convert, "input", error ) &&
+               connectPins( convert, "output", smooth, "input", error ) &&
+               connectPins( convert, "output", canny, "input", error ) &&
+               connectPins( convert, "output", flip, "input", error );
+    }
+
+    if( name == "test" )
+    {
+        // floating point images and unconnected scalar outputs
+        PipelineElement* producer  = addElement( "TestProducer", error );
+        PipelineElement* threshold = addElement( "plvopencv::ImageThreshold", error );
+        PipelineElement* smooth    = addElement( "plvopencv::GaussianSmooth", error );
+        if( producer == 0 || threshold == 0 || smooth == 0 )
+            return false;
+
+        return connectPins( producer, "CV_32F1", threshold, "input", error ) &&
+               connectPins( threshold, "output", smooth, "input", error );
+    }
+
+    if( name == "tcp" )
+    {
+        // camera images sent to the clients of a TCP server
+        PipelineElement* producer = addElement( "FileCameraProducer", error );
+        PipelineElement* server   = addElement( "TCPServerProcessor", error );
+        if( producer == 0 || server == 0 )
+            return false;
+
+        return connectPins( producer, "output", server, "generic pin", error );
+    }
+
+    if( name == "shm" )
+    {
+        // camera images passed through shared memory, the reading half
+        // would normally run in another process
+        PipelineElement* producer = addElement( "FileCameraProducer", error );
+        PipelineElement* sink     = addElement( "plvopencv::SharedMemorySink", error );
+        PipelineElement* reader   = addElement( "plvopencv::SharedMemoryProducer", error );
+        PipelineElement* flip     = addElement( "plvopencv::ImageFlip", error );
+        if( producer == 0 || sink == 0 || reader == 0 || flip == 0 )
+            return false;
+
+        return connectPins( producer, "output", sink, "input", error ) &&
+               connectPins( reader, "image_output", flip, "input", error );
+    }
+
+    if( name == "drop" )
+    {
+        // a fast branch next to a slow sink on a connection which drops
+        // the oldest images, the producer should keep up with the fast
+        // branch while the drop count of the slow edge goes up
+        PipelineElement* producer = addElement( "FileCameraProducer", error );
+        PipelineElement* flip     = addElement( "plvopencv::ImageFlip", error );
+        PipelineElement* slow     = addElement( "SlowSink", error );
+        if( producer == 0 || flip == 0 || slow == 0 )
+            return false;
+
+        PinConnection* slowEdge = 0;
+        if( !connectPins( producer, "output", flip, "input", error ) ||
+            !connectPins( producer, "output", slow, "input", error, &slowEdge ) )
+            return false;
+
+        slowEdge->setCapacity( 2 );
+        slowEdge->setOverflowPolicy( PinConnection::DROP_OLDEST );
+        return true;
+    }
+
+    error = QString( "unknown pipeline %1, expected a .plv file or one of %2" )
+            .arg( name ).arg( syntheticPipelines().join( ", " ) );
+    return false;
+}
+
+bool PipelineBenchmark::load( const QString& filename, QString& error )
+{
+    m_name = filename;
+
+    QFile file( filename );
+    QDomDocument doc;
+    if( !file.open( QIODevice::ReadOnly ) || !doc.setContent( &file ) )
+    {
+        error = QString( "can not read pipeline file %1" ).arg( filename );
+        return false;
+    }
+
+    // replace the camera producers by file camera producers
+    QDomNodeList elements = doc.elementsByTagName( "element" );
+    for( unsigned int i=0; i < elements.length(); ++i )
+    {
+        QDomElement element = elements.item( i ).toElement();
+        if( element.attribute( "name" ).endsWith( "CameraProducer" ) )
+        {
+            element.setAttribute( "name", FileCameraProducer::staticMetaObject.className() );
+            QDomElement properties = element.firstChildElement( "properties" );
+            properties.removeChild( properties.firstChildElement( "cameraId" ) );
+        }
+    }
+
+    try
+    {
+        PipelineLoader::deserialize( &doc, m_pipeline.getPtr() );
+    }
+    catch( std::runtime_error& e )
+    {
+        error = QString( "can not load pipeline %1: %2" ).arg( filename ).arg( e.what() );
+        return false;
+    }
+    return true;
+}
+
+void PipelineBenchmark::configureProducers( int width, int height, const QString& source )
+{
+    m_width  = width;
+    m_height = height;
+
+    foreach( const RefPtr<PipelineElement>& element, m_pipeline->getChildren() )
+    {
+        if( dynamic_cast<PipelineProducer*>( element.getPtr() ) == 0 )
+            continue;
+
+        const QMetaObject* metaObject = element->metaObject();
+        if( metaObject->indexOfProperty( "width" ) >= 0 )
+            PipelineLoader::setElementProperty( element, "width", QString::number( width ) );
+        if( metaObject->indexOfProperty( "height" ) >= 0 )
+            PipelineLoader::setElementProperty( element, "height", QString::number( height ) );
+
+        if( !source.isEmpty() && dynamic_cast<FileCameraProducer*>( element.getPtr() ) != 0 )
+            PipelineLoader::setElementProperty( element, "filename", source );
+    }
+}
+
+void PipelineBenchmark::prepareStatistics()
+{
+    qDeleteAll( m_elementStats );
+    m_elementStats.clear();
+    m_connectionStats.clear();
+    m_inFlight.clear();
+    m_latencies.clear();
+    m_latencies.reserve( m_frames );
+    m_incompleteFrames = 0;
+    m_reportsPerFrame = 0;
+
+    foreach( const RefPtr<PipelineElement>& element, m_pipeline->getChildren() )
+    {
+        ElementStats* stats = new ElementStats();
+        stats->element    = element.getPtr();
+        stats->isProducer = dynamic_cast<PipelineProducer*>( element.getPtr() ) != 0;
+        stats->isEndNode  = element->isEndNode();
+        stats->durations.reserve( m_frames );
+        m_elementStats.insert( element.getPtr(), stats );
+
+        if( stats->isProducer )
+            ++m_reportsPerFrame;
+        if( stats->isEndNode )
+            ++m_reportsPerFrame;
+    }
+
+    foreach( const RefPtr<PinConnection>& connection, m_pipeline->getConnections() )
+    {
+        ConnectionStats stats;
+        stats.connection = connection;
+        m_connectionStats.append( stats );
+    }
+}
+
+void PipelineBenchmark::setLoopbackClients( int count, int port, int threads )
+{
+    m_clientCount = count;
+    m_clientPort = port;
+    m_clientThreads = threads;
+}
+
+void PipelineBenchmark::configureTcp( int window, bool lowDelay )
+{
+    m_lowDelay = lowDelay;
+    foreach( const RefPtr<PipelineElement>& element, m_pipeline->getChildren() )
+    {
+        const QMetaObject* meta = element->metaObject();
+        if( meta->indexOfProperty( "lowDelay" ) >= 0 )
+            element->setProperty( "lowDelay", lowDelay );
+        if( window > 0 && meta->indexOfProperty( "maxFramesInFlight" ) >= 0 )
+            element->setProperty( "maxFramesInFlight", window );
+    }
+}
+
+bool PipelineBenchmark::run( QString& error )
+{
+    prepareStatistics();
+    m_steps = 0;
+    m_lastSteps = 0;
+    m_error.clear();
+    m_lastMessage.clear();
+
+    m_pipeline->setWorkerCount( m_threads );
+    m_pipeline->setProcessingObserver( this );
+    m_pipeline->start();
+    if( !m_pipeline->isRunning() )
+    {
+        m_pipeline->setProcessingObserver( 0 );
+        error = QString( "pipeline failed to start: %1" ).arg( m_lastMessage );
+        return false;
+    }
+
+    // the server listens once the pipeline has started, the
+    // clients connect while the pipeline warms up
+    delete m_clients;
+    m_clients = 0;
+    if( m_clientCount > 0 )
+    {
+        m_clients = new LoopbackClients( m_clientCount, m_clientPort, m_clientThreads, m_lowDelay );
+        m_clients->start();
+    }
+
+    if( m_warmup == 0 )
+        startMeasuring( 0 );
+
+    m_sampleTimer.start( PIPELINEBENCHMARK_SAMPLE_INTERVAL );
+    m_stallTimer.start( PIPELINEBENCHMARK_STALL_TIMEOUT );
+    m_loop.exec();
+
+    m_pipeline->setProcessingObserver( 0 );
+    error = m_error;
+    return m_error.isEmpty();
+}
+
+void PipelineBenchmark::startMeasuring( unsigned int serial )
+{
+    CvMatDataPool* pool = CvMatDataPool::instance();
+    if( pool != 0 )
+    {
+        m_poolMisses = pool->getMissCount();
+        m_poolHits   = pool->getHitCount();
+        m_poolEvictions = pool->getEvictionCount();
+    }
+    if( m_clients != 0 )
+        m_clients->mark();
+    m_measureStart = Clock::now();
+    m_measureFrom.fetchAndStoreOrdered( static_cast<int>( serial ) );
+}
+
+void PipelineBenchmark::finish( const QString& error )
+{
+    m_measureFrom.fetchAndStoreOrdered( -1 );
+    m_sampleTimer.stop();
+    m_stallTimer.stop();
+
+    if( m_clients != 0 )
+        m_clients->stop();
+
+    if( m_pipeline->isRunning() )
+        m_pipeline->stop();
+
+    m_error = error;
+    m_loop.quit();
+}
+
+void PipelineBenchmark::stepTaken( unsigned int serial )
+{
+    // steps can still arrive after the run was stopped
+    if( !m_pipeline->isRunning() )
+        return;
+
+    ++m_steps;
+
+    // the frame with this serial has not been dispatched yet
+    if( m_steps == m_warmup )
+        startMeasuring( serial );
+
+    if( m_steps == m_warmup + m_frames )
+    {
+        m_measureEnd = Clock::now();
+
+        CvMatDataPool* pool = CvMatDataPool::instance();
+        if( pool != 0 )
+        {
+            m_poolMisses = pool->getMissCount() - m_poolMisses;
+            m_poolHits   = pool->getHitCount() - m_poolHits;
+            m_poolEvictions = pool->getEvictionCount() - m_poolEvictions;
+        }
+        if( m_clients != 0 )
+            m_clients->measure( (m_measureEnd - m_measureStart) / 1e9 );
+        finish( QString() );
+    }
+}
+
+void PipelineBenchmark::pipelineError( PlvErrorType type, PipelineElement* ple )
+{
+    Q_UNUSED( type );
+
+    // the pipeline has already stopped itself
+    finish( QString( "pipeline stopped because of an error in %1: %2" )
+            .arg( elementName( ple ) ).arg( ple->getErrorString() ) );
+}
+
+void PipelineBenchmark::pipelineMessage( QtMsgType type, const QString& msg )
+{
+    if( type != QtDebugMsg )
+        m_lastMessage = msg;
+}
+
+void PipelineBenchmark::sampleQueues()
+{
+    for( int i=0; i < m_connectionStats.size(); ++i )
+    {
+        ConnectionStats& stats = m_connectionStats[i];
+        int depth = stats.connection->size();
+        stats.depthSum += depth;
+        stats.depthSamples += 1;
+        stats.maxDepth = qMax( stats.maxDepth, depth );
+    }
+}
+
+void PipelineBenchmark::checkStalled()
+{
+    if( m_steps == m_lastSteps )
+    {
+        finish( QString( "no frame was produced for %1 ms" ).arg( PIPELINEBENCHMARK_STALL_TIMEOUT ) );
+        return;
+    }
+    m_lastSteps = m_steps;
+}
+
+void PipelineBenchmark::elementProcessed( PipelineElement* element,
+                                          unsigned int serial,
+                                          qint64 start,
+                                          qint64 end )
+{
+    int from = m_measureFrom;
+    if( from < 0 || serial < static_cast<unsigned int>( from ) )
+        return;
+
+    ElementStats* stats = m_elementStats.value( element );
+    if( stats == 0 )
+        return;
+
+    {
+        QMutexLocker lock( &stats->mutex );
+        stats->durations.append( end - start );
+    }
+
+    if( !stats->isProducer && !stats->isEndNode )
+        return;
+
+    QMutexLocker lock( &m_frameMutex );
+    QHash<unsigned int, FrameTiming>::iterator itr = m_inFlight.find( serial );
+    if( itr == m_inFlight.end() )
+    {
+        // forget the frame which is too old to complete still
+        if( m_inFlight.remove( serial - PIPELINEBENCHMARK_MAX_FRAMES_IN_FLIGHT ) > 0 )
+            ++m_incompleteFrames;
+
+        itr = m_inFlight.insert( serial, FrameTiming() );
+        itr->pending = m_reportsPerFrame;
+    }
+
+    // end nodes can finish a frame before the producer reported its start
+    FrameTiming& frame = itr.value();
+    if( stats->isProducer )
+    {
+        frame.start = frame.started ? qMin( frame.start, start ) : start;
+        frame.started = true;
+        --frame.pending;
+    }
+    if( stats->isEndNode )
+    {
+        frame.end = qMax( frame.end, end );
+        --frame.pending;
+    }
+
+    if( frame.pending == 0 )
+    {
+        m_latencies.append( frame.end - frame.start );
+        m_inFlight.erase( itr );
+    }
+}
+
+PipelineBenchmark::Summary PipelineBenchmark::summarize( QVector<qint64> durations )
+{
+    Summary summary;
+    summary.count = durations.size();
+    if( summary.count == 0 )
+        return summary;
+
+    std::sort( durations.begin(), durations.end() );
+
+    double total = 0;
+    foreach( qint64 duration, durations )
+        total += duration;
+
+    // nearest rank percentiles, durations are in ns
+    const int n = durations.size();
+    summary.mean = total / n / 1000.0;
+    summary.p50  = durations.at( qMax( 0, static_cast<int>( std::ceil( 0.5   * n ) ) - 1 ) ) / 1000.0;
+    summary.p99  = durations.at( qMax( 0, static_cast<int>( std::ceil( 0.99  * n ) ) - 1 ) ) / 1000.0;
+    summary.p999 = durations.at( qMax( 0, static_cast<int>( std::ceil( 0.999 * n ) ) - 1 ) ) / 1000.0;
+    summary.max  = durations.last() / 1000.0;
+    return summary;
+}
+
+QString PipelineBenchmark::elementName( PipelineElement* element )
+{
+    return QString( "%1#%2" ).arg( element->getName() ).arg( element->getId() );
+}
+
+QString PipelineBenchmark::connectionName( PinConnection* connection )
+{
+    const IOutputPin* from = connection->fromPin();
+    const IInputPin* to = connection->toPin();
+    return QString( "%1.%2 -> %3.%4" )
+            .arg( elementName( from->getOwner() ) ).arg( from->getName() )
+            .arg( elementName( to->getOwner() ) ).arg( to->getName() );
+}
+
+/** quotes str as a CSV field */
+static QString csvField( const QString& str )
+{
+    QString escaped = str;
+    escaped.replace( '"', "\"\"" );
+    return '"' + escaped + '"';
+}
+
+void PipelineBenchmark::writeJson( QTextStream& out ) const
+{
+    const double seconds = (m_measureEnd - m_measureStart) / 1e9;
+    const Summary latency = summarize( m_latencies );
+    const int incomplete = m_incompleteFrames + m_inFlight.size();
+
+    out << "{" << endl
+        << "  \"pipeline\": \"" << Util::jsonEscape( m_name ) << "\"," << endl
+        << "  \"width\": " << m_width << "," << endl
+        << "  \"height\": " << m_height << "," << endl
+        << "  \"threads\": " << m_pipeline->getWorkerCount() << "," << endl
+        << "  \"warmupFrames\": " << m_warmup << "," << endl
+        << "  \"frames\": " << m_frames << "," << endl
+        << "  \"completedFrames\": " << latency.count << "," << endl
+        << "  \"incompleteFrames\": " << incomplete << "," << endl
+        << "  \"seconds\": " << seconds << "," << endl
+        << "  \"fps\": " << ( seconds > 0 ? m_frames / seconds : 0 ) << "," << endl
+        << "  \"latencyUs\": { \"mean\": " << latency.mean
+        << ", \"p50\": " << latency.p50
+        << ", \"p99\": " << latency.p99
+        << ", \"p999\": " << latency.p999
+        << ", \"max\": " << latency.max << " }," << endl
+        << "  \"allocationsPerFrame\": " << static_cast<double>( m_poolMisses ) / m_frames << "," << endl
+        << "  \"reusedBuffersPerFrame\": " << static_cast<double>( m_poolHits ) / m_frames << "," << endl
+        << "  \"poolEvictions\": " << m_poolEvictions << "," << endl;
+
+    if( m_clients != 0 )
+    {
+        out << "  \"clients\": { \"count\": " << m_clients->getCount()
+            << ", \"connected\": " << m_clients->getConnectedCount()
+            << ", \"minFps\": " << m_clients->getMinFps()
+            << ", \"meanFps\": " << m_clients->getMeanFps()
+            << ", \"lowDelay\": " << ( m_lowDelay ? "true" : "false" ) << " }," << endl;
+    }
+
+    out << "  \"elements\": [";
+    bool first = true;
+    foreach( const RefPtr<PipelineElement>& element, m_pipeline->getChildren() )
+    {
+        const ElementStats* stats = m_elementStats.value( element.getPtr() );
+        if( stats == 0 )
+            continue;
+
+        const Summary time = summarize( stats->durations );
+        out << ( first ? "" : "," ) << endl
+            << "    { \"name\": \"" << Util::jsonEscape( elementName( stats->element ) ) << "\""
+            << ", \"runs\": " << time.count
+            << ", \"meanUs\": " << time.mean
+            << ", \"p50Us\": " << time.p50
+            << ", \"p99Us\": " << time.p99
+            << ", \"p999Us\": " << time.p999
+            << ", \"maxUs\": " << time.max << " }";
+        first = false;
+    }
+    out << endl << "  ]," << endl;
+
+    out << "  \"connections\": [";
+    first = true;
+    foreach( const ConnectionStats& stats, m_connectionStats )
+    {
+        PinConnection* connection = stats.connection.getPtr();
+        out << ( first ? "" : "," ) << endl
+            << "    { \"name\": \"" << Util::jsonEscape( connectionName( connection ) ) << "\""
+            << ", \"capacity\": " << connection->getCapacity()
+            << ", \"policy\": \"" << Util::jsonEscape( PinConnection::overflowPolicyToString( connection->getOverflowPolicy() ) ) << "\""
+            << ", \"meanDepth\": " << ( stats.depthSamples > 0 ? static_cast<double>( stats.depthSum ) / stats.depthSamples : 0 )
+            << ", \"maxDepth\": " << stats.maxDepth
+            << ", \"highWaterMark\": " << connection->getHighWaterMark()
+            << ", \"dropped\": " << connection->getDropCount() << " }";
+        first = false;
+    }
+    out << endl << "  ]" << endl
+        << "}" << endl;
+}
+
+void PipelineBenchmark::writeCsv( QTextStream& out ) const
+{
+    const double seconds = (m_measureEnd - m_measureStart) / 1e9;
+    const Summary latency = summarize( m_latencies );
+    const QString pipeline = csvField( m_name );
+
+    out << "scope,name,metric,value" << endl;
+    out << "pipeline," << pipeline << ",width," << m_width << endl
+        << "pipeline," << pipeline << ",height," << m_height << endl
+        << "pipeline," << pipeline << ",threads," << m_pipeline->getWorkerCount() << endl
+        << "pipeline," << pipeline << ",frames," << m_frames << endl
+        << "pipeline," << pipeline << ",completedFrames," << latency.count << endl
+        << "pipeline," << pipeline << ",incompleteFrames," << m_incompleteFrames + m_inFlight.size() << endl
+        << "pipeline," << pipeline << ",seconds," << seconds << endl
+        << "pipeline," << pipeline << ",fps," << ( seconds > 0 ? m_frames / seconds : 0 ) << endl
+        << "pipeline," << pipeline << ",latencyMeanUs," << latency.mean << endl
+        << "pipeline," << pipeline << ",latencyP50Us," << latency.p50 << endl
+        << "pipeline," << pipeline << ",latencyP99Us," << latency.p99 << endl
+        << "pipeline," << pipeline << ",latencyP999Us," << latency.p999 << endl
+        << "pipeline," << pipeline << ",latencyMaxUs," << latency.max << endl
+        << "pipeline," << pipeline << ",allocationsPerFrame," << static_cast<double>( m_poolMisses ) / m_frames << endl
+        << "pipeline," << pipeline << ",reusedBuffersPerFrame," << static_cast<double>( m_poolHits ) / m_frames << endl
+        << "pipeline," << pipeline << ",poolEvictions," << m_poolEvictions << endl;
+
+    if( m_clients != 0 )
+    {
+        out << "pipeline," << pipeline << ",clients," << m_clients->getCount() << endl
+            << "pipeline," << pipeline << ",clientsConnected," << m_clients->getConnectedCount() << endl
+            << "pipeline," << pipeline << ",clientMinFps," << m_clients->getMinFps() << endl
+            << "pipeline," << pipeline << ",clientMeanFps," << m_clients->getMeanFps() << endl;
+    }
+
+    foreach( const RefPtr<PipelineElement>& element, m_pipeline->getChildren() )
+    {
+        const ElementStats* stats = m_elementStats.value( element.getPtr() );
+        if( stats == 0 )
+            continue;
+
+        const Summary time = summarize( stats->durations );
+        const QString name = csvField( elementName( stats->element ) );
+        out << "element," << name << ",runs," << time.count << endl
+            << "element," << name << ",meanUs," << time.mean << endl
+            << "element," << name << ",p50Us," << time.p50 << endl
+            << "element," << name << ",p99Us," << time.p99 << endl
+            << "element," << name << ",p999Us," << time.p999 << endl
+            << "element," << name << ",maxUs," << time.max << endl;
+    }
+
+    foreach( const ConnectionStats& stats, m_connectionStats )
+    {
+        PinConnection* connection = stats.connection.getPtr();
+        const QString name = csvField( connectionName( connection ) );
+        out << "connection," << name << ",capacity," << connection->getCapacity() << endl
+            << "connection," << name << ",meanDepth,"
+            << ( stats.depthSamples > 0 ? static_cast<double>( stats.depthSum ) / stats.depthSamples : 0 ) << endl
+            << "connection," << name << ",maxDepth," << stats.maxDepth << endl
+            << "connection," << name << ",highWaterMark," << connection->getHighWaterMark() << endl
+            << "connection," << name << ",dropped," << connection->getDropCount() << endl;
+    }
+}
@@ -0,0 +1,224 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#ifndef PIPELINEBENCHMARK_H
+#define PIPELINEBENCHMARK_H
+
+#include <QAtomicInt>
+#include <QEventLoop>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+
+#include <plvcore/plvglobal.h>
+#include <plvcore/Pipeline.h>
+#include <plvcore/ProcessingObserver.h>
+#include <plvcore/RefPtr.h>
+
+class LoopbackClients;
+
+/** interval in ms at which the connection queues are sampled */
+#ifndef PIPELINEBENCHMARK_SAMPLE_INTERVAL
+#define PIPELINEBENCHMARK_SAMPLE_INTERVAL 5
+#endif
+
+/** time in ms without a new frame after which a run is aborted */
+#ifndef PIPELINEBENCHMARK_STALL_TIMEOUT
+#define PIPELINEBENCHMARK_STALL_TIMEOUT 10000
+#endif
+
+/** frames which have not completed after this many newer frames
+    were started are counted as incomplete and forgotten */
+#ifndef PIPELINEBENCHMARK_MAX_FRAMES_IN_FLIGHT
+#define PIPELINEBENCHMARK_MAX_FRAMES_IN_FLIGHT 1024
+#endif
+
+/** Runs a complete pipeline through the real scheduler and reports
+  * sustained fps, end to end latency, per element processing time,
+  * connection queue depths and image allocations per frame.
+  *
+  * The pipeline is either one of the synthetic pipelines built in code or
+  * a pipeline file. Camera producers in pipeline files are replaced by a
+  * FileCameraProducer so the benchmark runs on machines without a camera.
+  * All producers with width and height properties are set to the requested
+  * resolution.
+  *
+  * End to end latency of a frame is the time from the start of the first
+  * producer run until the last end node finished that frame. Only frames
+  * started after the warmup are measured.
+  *
+  * For pipelines with a TCP server, a number of LoopbackClients can be
+  * connected to it during the run. Their frame rates are reported next
+  * to the fps of the pipeline.
+  */
+class PipelineBenchmark : public QObject, public plv::ProcessingObserver
+{
+    Q_OBJECT
+
+public:
+    PipelineBenchmark( int frames, int warmup, int threads );
+    virtual ~PipelineBenchmark();
+
+    /** names accepted by build() */
+    static QStringList syntheticPipelines();
+
+    /** builds the synthetic pipeline called name. Fails when one of the
+        element types is not available, which happens when the plugin
+        providing it was not built */
+    bool build( const QString& name, QString& error );
+
+    /** loads the pipeline file filename */
+    bool load( const QString& filename, QString& error );
+
+    /** sets the resolution of all producers and the file camera
+        producers replay. Call after build() or load() */
+    void configureProducers( int width, int height, const QString& source );
+
+    /** connects count stand-in clients on threads threads to the TCP server
+        on port of the pipeline while it runs */
+    void setLoopbackClients( int count, int port, int threads );
+
+    /** sets the window of the TCP servers to window frames and the low
+        delay mode of the servers and the loopback clients. A window of 0
+        keeps the default of the servers */
+    void configureTcp( int window, bool lowDelay );
+
+    /** runs warmup plus the measured number of frames */
+    bool run( QString& error );
+
+    void writeJson( QTextStream& out ) const;
+    void writeCsv( QTextStream& out ) const;
+
+    /** implementation of ProcessingObserver, called from the worker threads */
+    virtual void elementProcessed( plv::PipelineElement* element,
+                                   unsigned int serial,
+                                   qint64 start,
+                                   qint64 end );
+
+private slots:
+    void stepTaken( unsigned int serial );
+    void pipelineError( PlvErrorType type, plv::PipelineElement* ple );
+    void pipelineMessage( QtMsgType type, const QString& msg );
+    void sampleQueues();
+    void checkStalled();
+
+private:
+    /** summary of a set of durations in microseconds */
+    struct Summary
+    {
+        Summary() : count(0), mean(0), p50(0), p99(0), p999(0), max(0) {}
+        int count;
+        double mean;
+        double p50;
+        double p99;
+        double p999;
+        double max;
+    };
+
+    struct ElementStats
+    {
+        ElementStats() : element(0), isProducer(false), isEndNode(false) {}
+        plv::PipelineElement* element;
+        bool isProducer;
+        bool isEndNode;
+        QMutex mutex;
+        QVector<qint64> durations;
+    };
+
+    struct ConnectionStats
+    {
+        ConnectionStats() : depthSum(0), depthSamples(0), maxDepth(0) {}
+        plv::RefPtr<plv::PinConnection> connection;
+        qint64 depthSum;
+        int depthSamples;
+        int maxDepth;
+    };
+
+    /** a frame which has not been seen by all producers and end nodes yet */
+    struct FrameTiming
+    {
+        FrameTiming() : start(0), end(0), pending(0), started(false) {}
+        qint64 start;
+        qint64 end;
+        int pending;
+        bool started;
+    };
+
+    plv::PipelineElement* addElement( const QString& type, QString& error );
+    bool connectPins( plv::PipelineElement* from, const QString& outName,
+                      plv::PipelineElement* to, const QString& inName,
+                      QString& error, plv::PinConnection** connection = 0 );
+    void prepareStatistics();
+    void startMeasuring( unsigned int serial );
+    void finish( const QString& error );
+
+    static Summary summarize( QVector<qint64> durations );
+    static QString elementName( plv::PipelineElement* element );
+    static QString connectionName( plv::PinConnection* connection );
+
+    plv::RefPtr<plv::Pipeline> m_pipeline;
+    QString m_name;
+    int m_width;
+    int m_height;
+    int m_frames;
+    int m_warmup;
+    int m_threads;
+
+    int m_steps;
+    int m_lastSteps;
+    QString m_error;
+    QString m_lastMessage;
+    QEventLoop m_loop;
+    QTimer m_sampleTimer;
+    QTimer m_stallTimer;
+
+    /** first serial which is measured, -1 while warming up or stopped */
+    QAtomicInt m_measureFrom;
+    qint64 m_measureStart;
+    qint64 m_measureEnd;
+
+    qint64 m_poolMisses;
+    qint64 m_poolHits;
+    qint64 m_poolEvictions;
+
+    int m_clientCount;
+    int m_clientPort;
+    int m_clientThreads;
+    bool m_lowDelay;
+    LoopbackClients* m_clients;
+
+    /** read only while the pipeline runs, so the lookup needs no lock */
+    QHash<plv::PipelineElement*, ElementStats*> m_elementStats;
+    QList<ConnectionStats> m_connectionStats;
+    int m_reportsPerFrame;
+
+    QMutex m_frameMutex;
+    QHash<unsigned int, FrameTiming> m_inFlight;
+    QVector<qint64> m_latencies;
+    int m_incompleteFrames;
+};
+
+#endif // PIPELINEBENCHMARK_H
@@ -0,0 +1,186 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "RefCountBenchmark.h"
+
+#include <list>
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVector>
+
+#include <plvcore/RefPtr.h>
+
+using namespace plv;
+
+namespace
+{
+    template<class Base>
+    class Connection : public Base
+    {
+    };
+
+    template<class Base>
+    class Pin : public Base
+    {
+    public:
+        RefPtr< Connection<Base> > m_connection;
+        std::list< RefPtr< Connection<Base> > > m_connections;
+    };
+
+    template<class Base>
+    struct Element
+    {
+        RefPtr< Pin<Base> > m_in;
+        RefPtr< Pin<Base> > m_out;
+    };
+
+    /** one frame worth of reference traffic for a single element */
+    template<class Base>
+    inline int touch( const Element<Base>& element )
+    {
+        int work = 0;
+
+        // the scheduler looks at the input pin and its connection
+        RefPtr< Pin<Base> > in = element.m_in;
+        RefPtr< Connection<Base> > inConnection = in->m_connection;
+        work += inConnection.isNotNull() ? 1 : 0;
+
+        // getConnections() returns a copy of the list
+        RefPtr< Pin<Base> > out = element.m_out;
+        std::list< RefPtr< Connection<Base> > > connections = out->m_connections;
+        for( typename std::list< RefPtr< Connection<Base> > >::const_iterator itr = connections.begin();
+             itr != connections.end(); ++itr )
+        {
+            RefPtr< Connection<Base> > connection = *itr;
+            work += connection.isNotNull() ? 1 : 0;
+        }
+        return work;
+    }
+
+    template<class Base>
+    class FrameThread : public QThread
+    {
+    public:
+        FrameThread( const QVector< Element<Base> >& elements, int first, int step, int frames ) :
+            m_elements( elements ), m_first( first ), m_step( step ), m_frames( frames ), m_work( 0 ) {}
+
+        int getWork() const { return m_work; }
+
+    protected:
+        void run()
+        {
+            for( int f=0; f < m_frames; ++f )
+            {
+                for( int i=m_first; i < m_elements.size(); i += m_step )
+                {
+                    m_work += touch( m_elements.at(i) );
+                }
+            }
+        }
+
+    private:
+        const QVector< Element<Base> >& m_elements;
+        int m_first;
+        int m_step;
+        int m_frames;
+        int m_work;
+    };
+
+    /** builds a chain where every element also has a side branch */
+    template<class Base>
+    void buildPipeline( QVector< Element<Base> >& elements, int count )
+    {
+        elements.resize( count );
+        for( int i=0; i < count; ++i )
+        {
+            elements[i].m_in = new Pin<Base>();
+            elements[i].m_out = new Pin<Base>();
+        }
+        for( int i=0; i < count; ++i )
+        {
+            RefPtr< Connection<Base> > side = new Connection<Base>();
+            elements[i].m_out->m_connections.push_back( side );
+            if( i + 1 < count )
+            {
+                RefPtr< Connection<Base> > next = new Connection<Base>();
+                elements[i].m_out->m_connections.push_back( next );
+                elements[i+1].m_in->m_connection = next;
+            }
+        }
+    }
+}
+
+RefCountBenchmark::RefCountBenchmark( int elements, int frames, int threads ) :
+    m_elementCount( qMax(elements, 1) ),
+    m_frames( qMax(frames, 1) ),
+    m_threads( threads > 0 ? threads : QThread::idealThreadCount() )
+{
+}
+
+void RefCountBenchmark::run( QTextStream& out )
+{
+    // warm up
+    frames<MutexRefCounted>( 1 );
+    frames<RefCounted>( 1 );
+
+    double singleMutex   = frames<MutexRefCounted>( 1 );
+    double singleAtomic  = frames<RefCounted>( 1 );
+    double threadsMutex  = frames<MutexRefCounted>( m_threads );
+    double threadsAtomic = frames<RefCounted>( m_threads );
+
+    out << "refcount benchmark: " << m_elementCount << " elements, "
+        << m_frames << " frames, " << m_threads << " threads" << endl;
+    out << "object size (bytes)        mutex: " << sizeof(MutexRefCounted)
+        << " atomic: " << sizeof(RefCounted) << endl;
+    out << "1 thread (us per frame)    mutex: " << singleMutex
+        << " atomic: " << singleAtomic << endl;
+    out << m_threads << " threads (us per frame)   mutex: " << threadsMutex
+        << " atomic: " << threadsAtomic << endl;
+}
+
+template<class Base>
+double RefCountBenchmark::frames( int threads )
+{
+    QVector< Element<Base> > elements;
+    buildPipeline( elements, m_elementCount );
+
+    QList< FrameThread<Base>* > workers;
+    for( int i=0; i < threads; ++i )
+    {
+        workers.append( new FrameThread<Base>( elements, i, threads, m_frames ) );
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    foreach( FrameThread<Base>* worker, workers )
+    {
+        worker->start();
+    }
+    foreach( FrameThread<Base>* worker, workers )
+    {
+        worker->wait();
+    }
+    double elapsed = timer.nsecsElapsed() / (1000.0 * m_frames);
+
+    qDeleteAll( workers );
+    return elapsed;
+}
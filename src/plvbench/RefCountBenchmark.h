@@ -0,0 +1,89 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef REFCOUNTBENCHMARK_H
+#define REFCOUNTBENCHMARK_H
+
+#include <QMutex>
+#include <QTextStream>
+
+#include <plvcore/RefCounted.h>
+
+/** Reference counting with a mutex per object, the way
+    plv::RefCounted counted references before it used atomics */
+class MutexRefCounted
+{
+public:
+    MutexRefCounted() : m_referenceCount( 0 ) {}
+    virtual ~MutexRefCounted() {}
+
+    inline void inc() const
+    {
+        QMutexLocker lock( &m_refMutex );
+        ++m_referenceCount;
+    }
+
+    inline void dec() const
+    {
+        m_refMutex.lock();
+        --m_referenceCount;
+        if( m_referenceCount < 1 )
+        {
+            m_refMutex.unlock();
+            delete this;
+            return;
+        }
+        m_refMutex.unlock();
+    }
+
+private:
+    mutable int m_referenceCount;
+    mutable QMutex m_refMutex;
+};
+
+/** Measures the cost of the RefPtr traffic the scheduler and the pins
+  * generate for every frame, in a pipeline of 30 elements connected as a
+  * chain where every element also feeds a viewer style side branch.
+  *
+  * Per element and frame the connection list of the output pin is copied,
+  * the input pin and its connection are referenced and every outgoing
+  * connection is referenced while putting data. The same work is done with
+  * the old mutex based counting and with plv::RefCounted, single threaded
+  * and with several threads working on neighbouring elements at once.
+  */
+class RefCountBenchmark
+{
+public:
+    RefCountBenchmark( int elements, int frames, int threads );
+
+    /** runs all measurements and writes the results to out */
+    void run( QTextStream& out );
+
+private:
+    /** @returns the average time in microseconds per frame */
+    template<class Base> double frames( int threads );
+
+    int m_elementCount;
+    int m_frames;
+    int m_threads;
+};
+
+#endif // REFCOUNTBENCHMARK_H
@@ -0,0 +1,74 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+
+#include "SlowSink.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+
+#include <plvcore/CvMatData.h>
+#include <plvcore/CvMatDataPin.h>
+
+using namespace plv;
+
+SlowSink::SlowSink() :
+    m_delay(SLOWSINK_DEFAULT_DELAY)
+{
+    m_inputPin = createCvMatDataInputPin( "input", this );
+
+    m_inputPin->addAllChannels();
+    m_inputPin->addAllDepths();
+}
+
+SlowSink::~SlowSink()
+{
+}
+
+bool SlowSink::process()
+{
+    CvMatData in = m_inputPin->get();
+    Q_UNUSED( in );
+
+    // QThread::msleep is protected in Qt 4, wait on a condition
+    // which is never signalled instead
+    QMutex mutex;
+    QWaitCondition never;
+    QMutexLocker lock( &mutex );
+    never.wait( &mutex, getDelay() );
+    return true;
+}
+
+int SlowSink::getDelay() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_delay;
+}
+
+void SlowSink::setDelay(int ms)
+{
+    QMutexLocker lock(m_propertyMutex);
+    if( ms >= 0 )
+        m_delay = ms;
+    emit delayChanged(m_delay);
+}
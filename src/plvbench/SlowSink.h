@@ -0,0 +1,72 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#ifndef SLOWSINK_H
+#define SLOWSINK_H
+
+#include <plvcore/PipelineProcessor.h>
+
+namespace plv
+{
+    class CvMatDataInputPin;
+}
+
+/** default time in ms a SlowSink takes for every image */
+#ifndef SLOWSINK_DEFAULT_DELAY
+#define SLOWSINK_DEFAULT_DELAY 20
+#endif
+
+/** Stand in for a slow consumer, such as a recorder or a network sink.
+  * Takes delay ms for every image it receives, so the connection feeding
+  * it overflows when the producer is faster.
+  */
+class SlowSink : public plv::PipelineProcessor
+{
+    Q_OBJECT
+    Q_DISABLE_COPY( SlowSink )
+
+    Q_CLASSINFO("author", "Richard Loos")
+    Q_CLASSINFO("name", "Slow Sink")
+    Q_CLASSINFO("description", "Waits delay ms for every image, to benchmark overflowing connections.")
+    Q_PROPERTY( int delay READ getDelay WRITE setDelay NOTIFY delayChanged )
+
+    /** required standard method declaration for plv::PipelineProcessor */
+    PLV_PIPELINE_PROCESSOR
+
+public:
+    SlowSink();
+    virtual ~SlowSink();
+
+    int getDelay() const;
+
+public slots:
+    void setDelay(int ms);
+
+signals:
+    void delayChanged(int ms);
+
+private:
+    int m_delay;
+    plv::CvMatDataInputPin* m_inputPin;
+};
+
+#endif // SLOWSINK_H
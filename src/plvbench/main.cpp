@@ -0,0 +1,231 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvbench module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+#include <plvcore/Application.h>
+#include <plvcore/CvMatData.h>
+#include <plvcore/PipelineElementFactory.h>
+#include <plvcore/Tracer.h>
+
+#include "DispatchBenchmark.h"
+#include "ConnectionBenchmark.h"
+#include "RefCountBenchmark.h"
+#include "FileCameraProducer.h"
+#include "SlowSink.h"
+#include "PipelineBenchmark.h"
+
+static void usage( QTextStream& out )
+{
+    out << "usage: plvbench <benchmark> [options]" << endl
+        << endl
+        << "benchmarks:" << endl
+        << "  dispatch        dispatch overhead of Executor versus QtConcurrent" << endl
+        << "  connection      throughput of the connection ring versus a locked queue" << endl
+        << "  refcount        per frame cost of atomic versus mutex reference counting" << endl
+        << "  pipeline        fps, latency, element times, queue depths and allocations" << endl
+        << "                  of a complete pipeline" << endl
+        << endl
+        << "options:" << endl
+        << "  --elements <n>    number of elements (default 8, refcount 30)" << endl
+        << "  --iterations <n>  number of iterations (default 10000)" << endl
+        << "  --threads <n>     number of worker threads (default number of cores)" << endl
+        << "  --items <n>       items per connection measurement (default 1000000)" << endl
+        << "  --slots <n>       connection queue size (default 8)" << endl
+        << endl
+        << "pipeline options:" << endl
+        << "  --pipeline <p>    .plv file or one of " << PipelineBenchmark::syntheticPipelines().join( ", " )
+        << " (default blobs)" << endl
+        << "  --width <n>       width of the produced images (default 640)" << endl
+        << "  --height <n>      height of the produced images (default 480)" << endl
+        << "  --source <path>   image, image directory or video replayed instead of" << endl
+        << "                    camera input (default generated noise)" << endl
+        << "  --frames <n>      number of measured frames (default 1000)" << endl
+        << "  --warmup <n>      number of frames run before measuring (default 100)" << endl
+        << "  --format <f>      json or csv (default json)" << endl
+        << "  --pool-size <mb>  maximum size of the image buffer pool in megabytes" << endl
+        << "                    (default " << CVMATDATA_MAX_OBJECT_POOL_SIZE / (1024 * 1024) << ")" << endl
+        << "  --output <file>   write the results to file instead of stdout" << endl
+        << "  --trace <file>    write a chrome://tracing / Perfetto trace of the run," << endl
+        << "                    including the warmup frames" << endl
+        << "  --clients <n>     connect n stand-in clients to the TCP server of the" << endl
+        << "                    pipeline, see the tcp pipeline (default 0)" << endl
+        << "  --port <n>        port of the TCP server (default 1337)" << endl
+        << "  --client-threads <n>" << endl
+        << "                    threads running the clients (default 2)" << endl
+        << "  --window <n>      frames the TCP server sends ahead of the acks" << endl
+        << "                    (default the default of the server)" << endl
+        << "  --low-delay       disable Nagle's algorithm on server and clients" << endl;
+}
+
+/** returns the integer value of option name or defaultValue if not given */
+static int intOption( const QStringList& args, const QString& name, int defaultValue )
+{
+    int idx = args.indexOf( name );
+    if( idx < 0 || idx + 1 >= args.size() )
+        return defaultValue;
+
+    bool ok;
+    int value = args.at( idx + 1 ).toInt( &ok );
+    return ok ? value : defaultValue;
+}
+
+/** returns the value of option name or defaultValue if not given */
+static QString stringOption( const QStringList& args, const QString& name, const QString& defaultValue )
+{
+    int idx = args.indexOf( name );
+    if( idx < 0 || idx + 1 >= args.size() )
+        return defaultValue;
+    return args.at( idx + 1 );
+}
+
+static int runPipelineBenchmark( QCoreApplication& app, const QStringList& args, int threads, QTextStream& out )
+{
+    QTextStream err( stderr );
+
+    int frames = intOption( args, "--frames", 1000 );
+    int warmup = intOption( args, "--warmup", 100 );
+    QString format = stringOption( args, "--format", "json" );
+    int poolSize = intOption( args, "--pool-size", -1 );
+    if( frames < 1 || warmup < 0 || (format != "json" && format != "csv") )
+    {
+        usage( err );
+        return 1;
+    }
+
+    // load the element plugins, this also registers the plvcore types
+    plv::Application parlevision( &app );
+    parlevision.init();
+    plvRegisterPipelineElement<FileCameraProducer>();
+    plvRegisterPipelineElement<SlowSink>();
+
+    plv::CvMatDataPool* pool = plv::CvMatDataPool::instance();
+    if( poolSize >= 0 && pool != 0 )
+        pool->setMaxBytes( static_cast<qint64>( poolSize ) * 1024 * 1024 );
+
+    PipelineBenchmark bench( frames, warmup, threads );
+    QString pipeline = stringOption( args, "--pipeline", "blobs" );
+    QString error;
+    bool ok = pipeline.endsWith( ".plv" ) ? bench.load( pipeline, error )
+                                          : bench.build( pipeline, error );
+    if( !ok )
+    {
+        err << error << endl;
+        return 1;
+    }
+
+    bench.configureProducers( intOption( args, "--width", 640 ),
+                              intOption( args, "--height", 480 ),
+                              stringOption( args, "--source", QString() ) );
+    bench.setLoopbackClients( intOption( args, "--clients", 0 ),
+                              intOption( args, "--port", 1337 ),
+                              intOption( args, "--client-threads", 2 ) );
+    bench.configureTcp( intOption( args, "--window", 0 ), args.contains( "--low-delay" ) );
+
+    QString traceFilename = stringOption( args, "--trace", QString() );
+    if( !traceFilename.isEmpty() )
+        plv::Tracer::start();
+
+    ok = bench.run( error );
+
+    if( !traceFilename.isEmpty() )
+    {
+        plv::Tracer::stop();
+        if( plv::Tracer::getDropCount() > 0 )
+            err << "trace buffers full, dropped " << plv::Tracer::getDropCount() << " events" << endl;
+        if( !plv::Tracer::write( traceFilename ) )
+            err << "can not write " << traceFilename << endl;
+    }
+
+    if( !ok )
+    {
+        err << error << endl;
+        return 1;
+    }
+
+    QString filename = stringOption( args, "--output", QString() );
+    QFile file( filename );
+    QTextStream fileStream( &file );
+    if( !filename.isEmpty() )
+    {
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+        {
+            err << "can not write " << filename << endl;
+            return 1;
+        }
+    }
+    QTextStream& results = filename.isEmpty() ? out : fileStream;
+
+    if( format == "csv" )
+        bench.writeCsv( results );
+    else
+        bench.writeJson( results );
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QStringList args = app.arguments();
+    if( args.size() < 2 )
+    {
+        usage( out );
+        return 1;
+    }
+
+    const QString& benchmark = args.at(1);
+    int threads    = intOption( args, "--threads", 0 );
+    int iterations = intOption( args, "--iterations", 10000 );
+
+    if( benchmark == "dispatch" )
+    {
+        DispatchBenchmark bench( intOption( args, "--elements", 8 ), iterations, threads );
+        bench.run( out );
+        return 0;
+    }
+
+    if( benchmark == "connection" )
+    {
+        ConnectionBenchmark bench( intOption( args, "--items", 1000000 ), intOption( args, "--slots", 8 ) );
+        bench.run( out );
+        return 0;
+    }
+
+    if( benchmark == "refcount" )
+    {
+        RefCountBenchmark bench( intOption( args, "--elements", 30 ), iterations, threads );
+        bench.run( out );
+        return 0;
+    }
+
+    if( benchmark == "pipeline" )
+    {
+        return runPipelineBenchmark( app, args, threads, out );
+    }
+
+    usage( out );
+    return 1;
+}
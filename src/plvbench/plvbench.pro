@@ -0,0 +1,41 @@
+TARGET = plvbench
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+DESTDIR = ../../libs/
+
+DEPENDPATH += . \
+              ..
+include (../../common.pri)
+
+LIBS += -L../../libs -lplvcore
+
+CONFIG(debug, debug|release):DEFINES += DEBUG
+QT += core
+QT -= gui
+QT += xml
+QT += network
+
+INCLUDEPATH +=  ../../include \
+                ../../include/plvcore \
+                ../plvtcpserver
+
+SOURCES += main.cpp \
+    DispatchBenchmark.cpp \
+    ConnectionBenchmark.cpp \
+    RefCountBenchmark.cpp \
+    PipelineBenchmark.cpp \
+    FileCameraProducer.cpp \
+    SlowSink.cpp \
+    LoopbackClients.cpp
+
+HEADERS += \
+    DispatchBenchmark.h \
+    ConnectionBenchmark.h \
+    RefCountBenchmark.h \
+    PipelineBenchmark.h \
+    FileCameraProducer.h \
+    SlowSink.h \
+    LoopbackClients.h
@@ -66,13 +66,19 @@ BlobDetector::~BlobDetector()
 bool BlobDetector::process()
 {
     CvMatData in = m_inputImage->get();
-    cv::Mat& src = in;
 
-    if( src.depth() == CV_16U )
+    if( in.depth() == CV_16U )
     {
-        src.convertTo(src, CV_8U, 1.0 / std::numeric_limits<unsigned short>::max() );
+        // convert into a new image, the input may be shared
+        CvMatData converted = CvMatData::create( in.width(), in.height(), CV_8U, in.channels() );
+        in.getReadOnly().convertTo( converted, CV_8U, 1.0 / std::numeric_limits<unsigned short>::max() );
+        in = converted;
     }
 
+    // findContours modifies its input, this only copies the
+    // image when other elements are still using it
+    cv::Mat& src = in.getWritable();
+
     QList<Blob> newBlobs;
 
     int mode = CV_RETR_LIST;
@@ -0,0 +1,279 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvconsole module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#include "ConsoleRunner.h"
+
+#include <csignal>
+
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include <plvcore/Pipeline.h>
+#include <plvcore/PipelineElement.h>
+#include <plvcore/PipelineLoader.h>
+#include <plvcore/Metrics.h>
+#include <plvcore/MetricsServer.h>
+
+using namespace plv;
+
+/** set from the signal handler, polled from the event loop */
+static volatile sig_atomic_t s_interrupted = 0;
+
+static void interruptHandler( int )
+{
+    s_interrupted = 1;
+}
+
+/** interval in ms at which the interrupt flag is polled */
+#define CONSOLERUNNER_INTERRUPT_POLL_INTERVAL 100
+
+ConsoleRunner::ConsoleRunner( QObject* parent ) :
+    QObject( parent ),
+    m_pipeline( new Pipeline() ),
+    m_frameLimit( 0 ),
+    m_frameCount( 0 ),
+    m_exitCode( EXIT_OK ),
+    m_stopping( false ),
+    m_metricsInterval( 0 ),
+    m_metricsServer( 0 )
+{
+    // stepTaken and pipelineError are emitted from within the scheduler,
+    // queue them so we never stop the pipeline from inside schedule()
+    connect( m_pipeline.getPtr(), SIGNAL( stepTaken(unsigned int) ),
+             this, SLOT( stepTaken(unsigned int) ),
+             Qt::QueuedConnection );
+
+    connect( m_pipeline.getPtr(), SIGNAL( pipelineError(PlvErrorType, plv::PipelineElement*) ),
+             this, SLOT( pipelineError(PlvErrorType, plv::PipelineElement*) ),
+             Qt::QueuedConnection );
+
+    connect( m_pipeline.getPtr(), SIGNAL( pipelineMessage(QtMsgType, QString) ),
+             this, SLOT( pipelineMessage(QtMsgType, QString) ) );
+
+    connect( &m_interruptTimer, SIGNAL( timeout() ), this, SLOT( checkInterrupted() ) );
+    connect( &m_metricsTimer, SIGNAL( timeout() ), this, SLOT( printMetrics() ) );
+}
+
+ConsoleRunner::~ConsoleRunner()
+{
+    // the server holds a reference to the pipeline
+    delete m_metricsServer;
+
+    if( m_pipeline->isRunning() )
+        m_pipeline->stop();
+
+    // elements and connections hold a reference to the pipeline
+    m_pipeline->clear();
+}
+
+bool ConsoleRunner::load( const QString& filename )
+{
+    try
+    {
+        PipelineLoader::deserialize( filename, m_pipeline.getPtr() );
+    }
+    catch( std::runtime_error& e )
+    {
+        QTextStream err( stderr );
+        err << "Failed to load pipeline " << filename << ": " << e.what() << endl;
+        return false;
+    }
+    return true;
+}
+
+PipelineElement* ConsoleRunner::findElement( const QString& key, QString& reason ) const
+{
+    bool isId;
+    int id = key.toInt( &isId );
+    if( isId )
+    {
+        PipelineElement* element = m_pipeline->getElement( id );
+        if( element == 0 )
+            reason = tr("no element with id %1").arg(id);
+        return element;
+    }
+
+    PipelineElement* found = 0;
+    foreach( const RefPtr<PipelineElement>& element, m_pipeline->getChildren() )
+    {
+        if( element->getName().compare( key, Qt::CaseInsensitive ) == 0 )
+        {
+            if( found != 0 )
+            {
+                reason = tr("more than one element is called %1, use the element id").arg(key);
+                return 0;
+            }
+            found = element.getPtr();
+        }
+    }
+    if( found == 0 )
+        reason = tr("no element called %1").arg(key);
+    return found;
+}
+
+bool ConsoleRunner::setOverride( const QString& assignment )
+{
+    QTextStream err( stderr );
+
+    int eq  = assignment.indexOf( '=' );
+    int dot = assignment.lastIndexOf( '.', eq );
+    if( eq < 0 || dot <= 0 || dot + 1 == eq )
+    {
+        err << "Invalid property override " << assignment
+            << ", expected element.property=value" << endl;
+        return false;
+    }
+
+    QString elementKey = assignment.left( dot );
+    QString name  = assignment.mid( dot + 1, eq - dot - 1 );
+    QString value = assignment.mid( eq + 1 );
+
+    QString reason;
+    PipelineElement* element = findElement( elementKey, reason );
+    if( element == 0 )
+    {
+        err << "Invalid property override " << assignment << ": " << reason << endl;
+        return false;
+    }
+
+    if( !PipelineLoader::setElementProperty( element, name, value ) )
+    {
+        err << "Invalid property override " << assignment << ": "
+            << element->getName() << " has no property " << name << endl;
+        return false;
+    }
+    return true;
+}
+
+void ConsoleRunner::setFrameLimit( unsigned int frames )
+{
+    m_frameLimit = frames;
+}
+
+void ConsoleRunner::setWorkerCount( int count )
+{
+    m_pipeline->setWorkerCount( count );
+}
+
+void ConsoleRunner::setMetricsInterval( int interval )
+{
+    m_metricsInterval = interval;
+}
+
+bool ConsoleRunner::listenMetrics( const QString& name )
+{
+    if( m_metricsServer == 0 )
+        m_metricsServer = new MetricsServer( m_pipeline.getPtr(), this );
+
+    if( !m_metricsServer->listen( name ) )
+    {
+        QTextStream err( stderr );
+        err << "Can not serve metrics on " << name << ": "
+            << m_metricsServer->errorString() << endl;
+        return false;
+    }
+    return true;
+}
+
+void ConsoleRunner::installSignalHandlers()
+{
+    std::signal( SIGINT, interruptHandler );
+    std::signal( SIGTERM, interruptHandler );
+}
+
+void ConsoleRunner::start()
+{
+    m_pipeline->start();
+    if( !m_pipeline->isRunning() )
+    {
+        // the reason has been reported through pipelineMessage
+        quit( EXIT_START_FAILED );
+        return;
+    }
+    m_interruptTimer.start( CONSOLERUNNER_INTERRUPT_POLL_INTERVAL );
+    if( m_metricsInterval > 0 )
+        m_metricsTimer.start( m_metricsInterval );
+}
+
+void ConsoleRunner::stop()
+{
+    if( m_pipeline->isRunning() )
+        m_pipeline->stop();
+
+    QTextStream err( stderr );
+    err << "Pipeline stopped after " << m_frameCount << " frames" << endl;
+    quit( m_exitCode );
+}
+
+void ConsoleRunner::stepTaken( unsigned int )
+{
+    ++m_frameCount;
+    if( m_frameLimit > 0 && m_frameCount >= m_frameLimit && !m_stopping )
+    {
+        m_stopping = true;
+        stop();
+    }
+}
+
+void ConsoleRunner::pipelineError( PlvErrorType type, PipelineElement* ple )
+{
+    // the pipeline has already stopped itself
+    QTextStream err( stderr );
+    err << "Pipeline stopped because of an error in " << ple->getName()
+        << " (" << ple->getId() << "): " << ple->getErrorString() << endl;
+
+    m_stopping = true;
+    quit( EXIT_ELEMENT_ERROR + type );
+}
+
+void ConsoleRunner::pipelineMessage( QtMsgType type, const QString& msg )
+{
+    if( type == QtDebugMsg )
+        return;
+
+    QTextStream err( stderr );
+    err << msg << endl;
+}
+
+void ConsoleRunner::checkInterrupted()
+{
+    if( s_interrupted && !m_stopping )
+    {
+        m_stopping = true;
+        stop();
+    }
+}
+
+void ConsoleRunner::printMetrics()
+{
+    QTextStream out( stdout );
+    m_pipeline->getMetrics().writeJson( out );
+    out << endl;
+}
+
+void ConsoleRunner::quit( int exitCode )
+{
+    m_interruptTimer.stop();
+    m_metricsTimer.stop();
+    m_exitCode = exitCode;
+    QCoreApplication::exit( exitCode );
+}
@@ -0,0 +1,120 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvconsole module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#ifndef CONSOLERUNNER_H
+#define CONSOLERUNNER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+#include <plvcore/plvglobal.h>
+#include <plvcore/RefPtr.h>
+
+namespace plv
+{
+    class Pipeline;
+    class PipelineElement;
+    class MetricsServer;
+}
+
+/** Runs a pipeline without a user interface. Loads the pipeline from
+  * file, applies property overrides and runs it either until it is
+  * interrupted or for a fixed number of frames.
+  */
+class ConsoleRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** process exit codes */
+    enum ExitCode {
+        EXIT_OK            = 0,
+        EXIT_USAGE         = 1, /** invalid command line */
+        EXIT_LOAD_FAILED   = 2, /** pipeline could not be loaded */
+        EXIT_START_FAILED  = 3, /** pipeline could not be initialised or started */
+        EXIT_ELEMENT_ERROR = 4  /** pipeline stopped by pipelineElementError,
+                                    the PlvErrorType is added to this value */
+    };
+
+    ConsoleRunner( QObject* parent = 0 );
+    virtual ~ConsoleRunner();
+
+    /** loads the pipeline from filename. Returns false on error */
+    bool load( const QString& filename );
+
+    /** applies an override of the form element.property=value where
+      * element is either the id or the name of the element. Returns
+      * false and prints the reason if the override can not be applied.
+      */
+    bool setOverride( const QString& assignment );
+
+    /** number of frames to run for. 0 means run until interrupted */
+    void setFrameLimit( unsigned int frames );
+
+    /** number of worker threads, values smaller than 1 select the number of cores */
+    void setWorkerCount( int count );
+
+    /** prints a metrics snapshot as a line of JSON on stdout every
+        interval ms while running. 0 disables printing */
+    void setMetricsInterval( int interval );
+
+    /** serves metrics snapshots on the local socket with the given name.
+        Returns false and prints the reason if the socket can not be opened */
+    bool listenMetrics( const QString& name );
+
+    /** exit code to return from main once the event loop has finished */
+    inline int getExitCode() const { return m_exitCode; }
+
+    /** installs handlers for SIGINT and SIGTERM which stop the pipeline */
+    static void installSignalHandlers();
+
+public slots:
+    /** starts the pipeline. Quits the application on failure */
+    void start();
+
+    /** stops the pipeline if it is running and quits the application */
+    void stop();
+
+private slots:
+    void stepTaken( unsigned int serial );
+    void pipelineError( PlvErrorType type, plv::PipelineElement* ple );
+    void pipelineMessage( QtMsgType type, const QString& msg );
+    void checkInterrupted();
+    void printMetrics();
+
+private:
+    plv::PipelineElement* findElement( const QString& key, QString& reason ) const;
+    void quit( int exitCode );
+
+    plv::RefPtr<plv::Pipeline> m_pipeline;
+    unsigned int m_frameLimit;
+    unsigned int m_frameCount;
+    int m_exitCode;
+    bool m_stopping;
+    QTimer m_interruptTimer;
+    QTimer m_metricsTimer;
+    int m_metricsInterval;
+    plv::MetricsServer* m_metricsServer;
+};
+
+#endif // CONSOLERUNNER_H
@@ -0,0 +1,171 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvconsole module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+
+#include <plvcore/Application.h>
+#include <plvcore/CvMatData.h>
+#include <plvcore/Tracer.h>
+
+#include "ConsoleRunner.h"
+
+static void usage( QTextStream& out )
+{
+    out << "usage: plvconsole [options] <pipeline.plv>" << endl
+        << endl
+        << "Runs a pipeline without user interface until it is interrupted," << endl
+        << "the frame limit is reached or an element reports an error." << endl
+        << endl
+        << "options:" << endl
+        << "  --frames <n>                      stop after n frames (default 0, run forever)" << endl
+        << "  --threads <n>                     number of worker threads (default number of cores)" << endl
+        << "  --set <element>.<property>=<value> override a property of the element with" << endl
+        << "                                    the given id or name, may be repeated" << endl
+        << "  --metrics <ms>                    print element and connection metrics as a" << endl
+        << "                                    line of JSON on stdout every ms milliseconds" << endl
+        << "  --metrics-socket <name>           serve metrics as JSON on the local socket name" << endl
+        << "  --pool-size <mb>                  maximum size of the image buffer pool in" << endl
+        << "                                    megabytes (default " << CVMATDATA_MAX_OBJECT_POOL_SIZE / (1024 * 1024) << ")" << endl
+        << "  --trace <file.json>               record element runs and scheduler events and" << endl
+        << "                                    write them as a chrome://tracing / Perfetto trace" << endl
+        << endl
+        << "exit status:" << endl
+        << "  0  pipeline finished or was interrupted" << endl
+        << "  1  invalid command line or property override" << endl
+        << "  2  pipeline could not be loaded" << endl
+        << "  3  pipeline could not be started" << endl
+        << "  4+ pipeline stopped because of an element error, 4 plus the error type" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    int frames  = 0;
+    int threads = 0;
+    QStringList overrides;
+    QString traceFilename;
+    QString metricsSocket;
+    int metricsInterval = 0;
+    int poolSize = -1;
+    QString filename;
+
+    while( !args.isEmpty() )
+    {
+        QString arg = args.takeFirst();
+        if( arg == "--frames" || arg == "--threads" || arg == "--set" || arg == "--trace"
+            || arg == "--metrics" || arg == "--metrics-socket" || arg == "--pool-size" )
+        {
+            if( args.isEmpty() )
+            {
+                usage( err );
+                return ConsoleRunner::EXIT_USAGE;
+            }
+            QString value = args.takeFirst();
+            bool ok = true;
+            if( arg == "--frames" )
+                frames = value.toInt( &ok );
+            else if( arg == "--threads" )
+                threads = value.toInt( &ok );
+            else if( arg == "--trace" )
+                traceFilename = value;
+            else if( arg == "--metrics" )
+                metricsInterval = value.toInt( &ok );
+            else if( arg == "--metrics-socket" )
+                metricsSocket = value;
+            else if( arg == "--pool-size" )
+                poolSize = value.toInt( &ok );
+            else
+                overrides.append( value );
+
+            if( !ok || frames < 0 || metricsInterval < 0 || (arg == "--pool-size" && poolSize < 0) )
+            {
+                usage( err );
+                return ConsoleRunner::EXIT_USAGE;
+            }
+        }
+        else if( arg.startsWith( "-" ) || !filename.isEmpty() )
+        {
+            usage( err );
+            return ConsoleRunner::EXIT_USAGE;
+        }
+        else
+        {
+            filename = arg;
+        }
+    }
+
+    if( filename.isEmpty() )
+    {
+        usage( err );
+        return ConsoleRunner::EXIT_USAGE;
+    }
+
+    plv::Application parlevision(&app);
+    parlevision.init();
+
+    plv::CvMatDataPool* pool = plv::CvMatDataPool::instance();
+    if( poolSize >= 0 && pool != 0 )
+        pool->setMaxBytes( static_cast<qint64>( poolSize ) * 1024 * 1024 );
+
+    ConsoleRunner runner;
+    if( !runner.load( filename ) )
+        return ConsoleRunner::EXIT_LOAD_FAILED;
+
+    foreach( const QString& assignment, overrides )
+    {
+        if( !runner.setOverride( assignment ) )
+            return ConsoleRunner::EXIT_USAGE;
+    }
+
+    runner.setFrameLimit( frames );
+    runner.setWorkerCount( threads );
+    runner.setMetricsInterval( metricsInterval );
+    if( !metricsSocket.isEmpty() && !runner.listenMetrics( metricsSocket ) )
+        return ConsoleRunner::EXIT_START_FAILED;
+    ConsoleRunner::installSignalHandlers();
+
+    if( !traceFilename.isEmpty() )
+        plv::Tracer::start();
+
+    // start from the event loop so the runner can quit it
+    QTimer::singleShot( 0, &runner, SLOT(start()) );
+    app.exec();
+
+    if( !traceFilename.isEmpty() )
+    {
+        plv::Tracer::stop();
+        if( plv::Tracer::getDropCount() > 0 )
+            err << "trace buffers full, dropped " << plv::Tracer::getDropCount() << " events" << endl;
+        if( !plv::Tracer::write( traceFilename ) )
+            err << "could not write trace to " << traceFilename << endl;
+    }
+
+    return runner.getExitCode();
+}
@@ -0,0 +1,29 @@
+TARGET = plvconsole
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+# plugins are loaded from the plugins directory next to the executable
+DESTDIR = ../../libs/
+
+DEPENDPATH += . \
+              ..
+include (../../common.pri)
+
+# only plvcore, so the runner does not pull in plvgui or a display
+LIBS += -L../../libs -lplvcore
+
+CONFIG(debug, debug|release):DEFINES += DEBUG
+QT += core
+QT -= gui
+QT += xml
+
+INCLUDEPATH +=  ../../include \
+                ../../include/plvcore
+
+SOURCES += main.cpp \
+    ConsoleRunner.cpp
+
+HEADERS += \
+    ConsoleRunner.h
@@ -32,6 +32,8 @@
 #include "PipelineElement.h"
 #include "Pipeline.h"
 #include "PipelineLoader.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
 
 #include <QxtCore>
 #include <QxtLogger>
@@ -75,6 +77,8 @@ void Application::loadBuiltins()
 
     qRegisterMetaType< PlvMessageType >( "PlvMessageType" );
     qRegisterMetaType< PlvErrorType >( "PlvErrorType" );
+    qRegisterMetaType< plv::LatencyHistogram >( "plv::LatencyHistogram" );
+    qRegisterMetaType< plv::MetricsSnapshot >( "plv::MetricsSnapshot" );
 
     // register stream operators to enable streaming of data types
     //qRegisterMetaTypeStreamOperators< plv::Data >("plv::Data");
@@ -21,6 +21,8 @@
 
 #include "CvMatData.h"
 
+#include <QMutexLocker>
+
 using namespace plv;
 
 //CvMatData::CvMatData() : d( new MatData() )
@@ -65,12 +67,283 @@ CvMatData CvMatData::create( int width, int height, int type )
     assert( width > 0 );
     assert( height > 0 );
 
-    cv::Mat mat;
-    mat.create( cv::Size(width, height), type );
+    cv::Mat mat = CvMatDataPool::allocate( CvMatDataProperties( width, height, type ) );
     CvMatData data(mat);
     return data;
 }
 
+CvMatData CvMatData::createOutput( CvMatData& in, const CvMatDataProperties& props, bool allowInPlace )
+{
+    if( allowInPlace && !in.isEmpty() && in.properties() == props && in.isUnique() )
+    {
+        // move the data, the MatData object and its matrix stay alive
+        // so references to it held by the caller remain valid
+        CvMatData out( in );
+        in.d = new MatData();
+        return out;
+    }
+    return create( props );
+}
+
+Q_GLOBAL_STATIC( CvMatDataPool, s_matDataPool )
+
+CvMatDataPool::CvMatDataPool() :
+    m_bytes( 0 ),
+    m_maxBytes( CVMATDATA_MAX_OBJECT_POOL_SIZE ),
+    m_hits( 0 ),
+    m_misses( 0 ),
+    m_evictions( 0 )
+{
+}
+
+CvMatDataPool::~CvMatDataPool()
+{
+    clear();
+}
+
+CvMatDataPool* CvMatDataPool::instance()
+{
+    return s_matDataPool();
+}
+
+cv::Mat CvMatDataPool::acquire( const CvMatDataProperties& props )
+{
+    QMutexLocker lock( &m_mutex );
+
+    // most recently returned buffers are at the back
+    for( std::list<cv::Mat>::reverse_iterator itr = m_buffers.rbegin();
+         itr != m_buffers.rend(); ++itr )
+    {
+        if( CvMatDataProperties( *itr ) == props )
+        {
+            cv::Mat mat = *itr;
+            m_bytes -= byteSize( mat );
+            m_buffers.erase( --(itr.base()) );
+            ++m_hits;
+            return mat;
+        }
+    }
+    ++m_misses;
+    lock.unlock();
+
+    // allocate outside the lock
+    cv::Mat mat;
+    mat.create( cv::Size( props.width(), props.height() ), props.type() );
+    return mat;
+}
+
+void CvMatDataPool::release( cv::Mat& mat )
+{
+    if( !isPoolable( mat ) )
+    {
+        mat.release();
+        return;
+    }
+
+    qint64 size = byteSize( mat );
+
+    QMutexLocker lock( &m_mutex );
+    if( size > m_maxBytes )
+    {
+        ++m_evictions;
+        lock.unlock();
+        mat.release();
+        return;
+    }
+
+    evict( m_maxBytes - size );
+    m_buffers.push_back( mat );
+    m_bytes += size;
+    lock.unlock();
+
+    // the pool now holds the only other reference
+    mat.release();
+}
+
+void CvMatDataPool::setMaxBytes( qint64 bytes )
+{
+    QMutexLocker lock( &m_mutex );
+    m_maxBytes = qMax( bytes, (qint64)0 );
+    evict( m_maxBytes );
+}
+
+qint64 CvMatDataPool::getMaxBytes() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_maxBytes;
+}
+
+qint64 CvMatDataPool::getBytes() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_bytes;
+}
+
+int CvMatDataPool::getCount() const
+{
+    QMutexLocker lock( &m_mutex );
+    return static_cast<int>( m_buffers.size() );
+}
+
+qint64 CvMatDataPool::getHitCount() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_hits;
+}
+
+qint64 CvMatDataPool::getMissCount() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_misses;
+}
+
+qint64 CvMatDataPool::getEvictionCount() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_evictions;
+}
+
+void CvMatDataPool::resetStatistics()
+{
+    QMutexLocker lock( &m_mutex );
+    m_hits = 0;
+    m_misses = 0;
+    m_evictions = 0;
+}
+
+void CvMatDataPool::clear()
+{
+    QMutexLocker lock( &m_mutex );
+    m_buffers.clear();
+    m_bytes = 0;
+}
+
+void CvMatDataPool::evict( qint64 bytes )
+{
+    while( m_bytes > bytes && !m_buffers.empty() )
+    {
+        m_bytes -= byteSize( m_buffers.front() );
+        m_buffers.pop_front();
+        ++m_evictions;
+    }
+}
+
+cv::Mat CvMatDataPool::allocate( const CvMatDataProperties& props )
+{
+#if CVMATDATA_USE_POOL
+    CvMatDataPool* pool = instance();
+    if( pool != 0 )
+        return pool->acquire( props );
+#endif
+    cv::Mat mat;
+    mat.create( cv::Size( props.width(), props.height() ), props.type() );
+    return mat;
+}
+
+void CvMatDataPool::recycle( cv::Mat& mat )
+{
+#if CVMATDATA_USE_POOL
+    // the pool may already be gone when static objects are destroyed
+    CvMatDataPool* pool = instance();
+    if( pool != 0 )
+    {
+        pool->release( mat );
+        return;
+    }
+#endif
+    mat.release();
+}
+
+cv::Mat CvMatDataPool::clone( const cv::Mat& mat )
+{
+    if( mat.empty() || mat.dims != 2 )
+        return mat.clone();
+
+    cv::Mat copy = allocate( CvMatDataProperties( mat ) );
+    mat.copyTo( copy );
+    return copy;
+}
+
+bool CvMatDataPool::isPoolable( const cv::Mat& mat )
+{
+    // only whole, continuous 2D buffers allocated by OpenCV which
+    // are not referenced by any other cv::Mat header
+    return !mat.empty() &&
+           mat.dims == 2 &&
+           mat.refcount != 0 &&
+           *mat.refcount == 1 &&
+           mat.data == mat.datastart &&
+           mat.isContinuous();
+}
+
+qint64 CvMatDataPool::byteSize( const cv::Mat& mat )
+{
+    return static_cast<qint64>( mat.dataend - mat.datastart );
+}
+
+bool CvMatData::isShared() const
+{
+    return d.constData()->ref != 1;
+}
+
+bool CvMatData::isUnique() const
+{
+    const MatData* data = d.constData();
+    if( data->ref != 1 )
+        return false;
+
+    // the pixel data can still be shared with other cv::Mat headers,
+    // data without a reference count is owned by someone else
+    const cv::Mat& mat = data->mat;
+    if( mat.empty() )
+        return true;
+    return mat.refcount != 0 && *mat.refcount == 1;
+}
+
+cv::Mat& CvMatData::getWritable( bool keepContents )
+{
+    if( !isUnique() )
+    {
+        // replace the shared data instead of letting QSharedDataPointer
+        // detach, which would always copy and only looks at its own count
+        const cv::Mat& shared = d.constData()->mat;
+        if( shared.empty() )
+        {
+            d = new MatData();
+        }
+        else if( keepContents || shared.dims != 2 )
+        {
+            d = new MatData( CvMatDataPool::clone( shared ) );
+        }
+        else
+        {
+            d = new MatData( CvMatDataPool::allocate( CvMatDataProperties( shared ) ) );
+        }
+    }
+
+    // unique at this point, so this does not detach
+    return d->mat;
+}
+
+qint64 CvMatData::imageSize( int width, int height, int type )
+{
+    if( (type & ~CV_MAT_TYPE_MASK) != 0 || CV_MAT_DEPTH( type ) > CV_64F )
+        return -1;
+
+    if( width <= 0 || height <= 0 )
+        return -1;
+
+    // check the pixel count first so the byte count cannot overflow
+    qint64 pixels = static_cast<qint64>( width ) * height;
+    if( pixels > CVMATDATA_MAX_IMAGE_SIZE )
+        return -1;
+
+    qint64 size = pixels * CV_ELEM_SIZE( type );
+    if( size > CVMATDATA_MAX_IMAGE_SIZE )
+        return -1;
+    return size;
+}
+
 const char* CvMatData::depthToString( int depth )
 {
     switch( CV_MAT_DEPTH( depth ) )
@@ -145,17 +418,31 @@ QDataStream &operator>>(QDataStream &in, CvMatData& d)
     in >> cols;
     in >> len;
 
-    char* data;
-    uint length = (uint)len;
-    in.readBytes( data, length );
-
-    // temporary matrix, we need to explicitly copy the data because
-    // using the constructor with user allocated data disables refcounting
-    cv::Mat mat( (int)rows, (int)cols, (int)type );
-    assert( (uint)(mat.dataend - mat.datastart) == length );
-    memcpy( mat.datastart, data, mat.dataend - mat.datastart );
-    d = mat;
-    delete[] data;
+    // the length written by writeBytes
+    quint32 length;
+    in >> length;
+
+    if( rows <= 0 || cols <= 0 )
+    {
+        in.skipRawData( length );
+        d = CvMatData();
+        return in;
+    }
+
+    // check the header before anything is allocated
+    if( CvMatData::imageSize( cols, rows, type ) != length )
+    {
+        in.skipRawData( length );
+        in.setStatus( QDataStream::ReadCorruptData );
+        d = CvMatData();
+        return in;
+    }
+
+    // read the data straight into a matrix from the pool
+    CvMatData data = CvMatData::create( cols, rows, type );
+    cv::Mat& mat = data.getWritable( false );
+    in.readRawData( reinterpret_cast<char*>( mat.data ), length );
+    d = data;
     return in;
 }
 
@@ -131,11 +131,11 @@ QSet<PipelineElement*> DataConsumer::getConnectedElementsToInputs() const
     for( InputPinMap::const_iterator itr = m_inputPins.begin();
         itr != m_inputPins.end(); ++itr )
     {
-        RefPtr<IInputPin> in = itr.value();
+        const IInputPin* in = itr.value().getPtr();
         if( in->isConnected() )
         {
-            RefPtr<PinConnection> connection = in->getConnection();
-            RefPtr<const IOutputPin> fromPin = connection->fromPin();
+            const PinConnection* connection = in->getConnection();
+            const IOutputPin* fromPin = connection->fromPin();
             PipelineElement* pinOwner = fromPin->getOwner();
             elements.insert( pinOwner );
         }
@@ -148,7 +148,7 @@ bool DataConsumer::requiredInputPinsConnected() const
     for( InputPinMap::const_iterator itr = m_inputPins.begin();
          itr != m_inputPins.end(); ++itr )
     {
-        RefPtr<IInputPin> in = itr.value();
+        const IInputPin* in = itr.value().getPtr();
         if( in->isRequired() )
             if( !in->isConnected() )
                 return false;
@@ -338,6 +338,10 @@ void DataConsumer::preInput( bool& nullDetected )
 {
     nullDetected = false;
 
+    // the oldest capture time of all synchronous input is the capture
+    // time of this run, it is passed on with the output
+    qint64 captureTime = 0;
+
     // call pre on input pins and look for null data items
     for( InputPinMap::iterator itr = m_inputPins.begin();
          itr != m_inputPins.end(); ++itr )
@@ -350,9 +354,14 @@ void DataConsumer::preInput( bool& nullDetected )
             bool isNull;
             in->peekNext(serial, isNull);
             if( isNull ) nullDetected = true;
+
+            qint64 timestamp = in->peekTimestamp();
+            if( timestamp != 0 && (captureTime == 0 || timestamp < captureTime) )
+                captureTime = timestamp;
         }
         in->pre();
     }
+    setCaptureTime( captureTime );
 }
 
 void DataConsumer::postInput()
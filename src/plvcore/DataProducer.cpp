@@ -97,15 +97,15 @@ QSet<DataProducer*> DataProducer::getConnectedElementsToOutputs() const
     for( OutputPinMap::const_iterator itr = m_outputPins.begin();
         itr != m_outputPins.end(); ++itr )
     {
-        RefPtr<IOutputPin> out = itr.value();
+        const IOutputPin* out = itr.value().getPtr();
         if( out->isConnected() )
         {
-            std::list< RefPtr<PinConnection> > connections = out->getConnections();
+            const std::list< RefPtr<PinConnection> >& connections = out->getConnections();
             for( std::list< RefPtr<PinConnection> >::const_iterator connItr = connections.begin();
                  connItr != connections.end(); ++connItr )
             {
-                RefPtr<PinConnection> connection = *connItr;
-                RefPtr<const IInputPin> toPin = connection->toPin();
+                const PinConnection* connection = connItr->getPtr();
+                const IInputPin* toPin = connection->toPin();
                 DataProducer* pinOwner = static_cast<DataProducer*>(toPin->getOwner());
                 elements.insert( pinOwner );
             }
@@ -119,7 +119,7 @@ bool DataProducer::isEndNode() const
     for( OutputPinMap::const_iterator itr = m_outputPins.begin();
          itr != m_outputPins.end(); ++itr )
     {
-        RefPtr<IOutputPin> out = itr.value();
+        const IOutputPin* out = itr.value().getPtr();
         if( out->isConnected() )
             return false;
     }
@@ -185,6 +185,18 @@ int DataProducer::maxOutputQueueSize() const
     return maxQueueSize;
 }
 
+bool DataProducer::isOutputBlocked() const
+{
+    for( OutputPinMap::const_iterator itr = m_outputPins.begin();
+        itr!=m_outputPins.end(); ++itr )
+    {
+        IOutputPin* outputPin = itr.value();
+        if( outputPin->isBlocked() )
+            return true;
+    }
+    return false;
+}
+
 void DataProducer::preOutput()
 {
     for( OutputPinMap::iterator itr = m_outputPins.begin();
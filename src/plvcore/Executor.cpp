@@ -0,0 +1,207 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "Executor.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "PipelineElement.h"
+#include "Clock.h"
+
+using namespace plv;
+
+Executor::Executor( ExecutorListener* listener ) :
+    m_listener( listener ),
+    m_workerCount( QThread::idealThreadCount() ),
+    m_running( false )
+{
+    m_pending = 0;
+    m_nextWorker = 0;
+
+    if( m_workerCount < 1 )
+        m_workerCount = 1;
+}
+
+Executor::~Executor()
+{
+    if( isRunning() )
+        stop();
+}
+
+void Executor::setWorkerCount( int count )
+{
+    QMutexLocker lock( &m_idleMutex );
+    if( m_running )
+    {
+        qWarning() << "Executor::setWorkerCount ignored, executor is running";
+        return;
+    }
+    m_workerCount = count > 0 ? count : qMax( QThread::idealThreadCount(), 1 );
+}
+
+int Executor::getWorkerCount() const
+{
+    QMutexLocker lock( &m_idleMutex );
+    return m_workerCount;
+}
+
+bool Executor::isRunning() const
+{
+    QMutexLocker lock( &m_idleMutex );
+    return m_running;
+}
+
+bool Executor::start()
+{
+    QMutexLocker lock( &m_idleMutex );
+    if( m_running )
+        return false;
+
+    assert( m_workers.isEmpty() );
+    m_running = true;
+    m_pending = 0;
+    m_nextWorker = 0;
+
+    for( int i=0; i < m_workerCount; ++i )
+    {
+        Worker* worker = new Worker( this, i );
+        worker->setObjectName( QString("worker %1").arg( i ) );
+        m_workers.append( worker );
+    }
+    lock.unlock();
+
+    foreach( Worker* worker, m_workers )
+    {
+        worker->start();
+    }
+    return true;
+}
+
+void Executor::stop()
+{
+    QMutexLocker lock( &m_idleMutex );
+    if( !m_running )
+        return;
+
+    // workers exit when there is no more pending work
+    m_running = false;
+    m_workAvailable.wakeAll();
+    lock.unlock();
+
+    foreach( Worker* worker, m_workers )
+    {
+        worker->wait();
+        assert( worker->m_deque.empty() );
+        delete worker;
+    }
+    m_workers.clear();
+}
+
+void Executor::submit( PipelineElement* element, unsigned int serial, int worker,
+                       qint64 enqueued )
+{
+    assert( !m_workers.isEmpty() );
+
+    if( worker < 0 || worker >= m_workers.size() )
+    {
+        worker = m_nextWorker.fetchAndAddRelaxed(1) % m_workers.size();
+        if( worker < 0 )
+            worker += m_workers.size();
+    }
+
+    // count the task before it becomes visible so the
+    // pending count never drops below zero
+    m_pending.ref();
+
+    Worker* w = m_workers.at( worker );
+    QMutexLocker dequeLock( &w->m_dequeMutex );
+    w->m_deque.push_back( Task( element, serial, enqueued, Clock::now() ) );
+    dequeLock.unlock();
+
+    // taking the idle mutex makes sure a worker which just found no
+    // work is either still awake or already waiting, so the wake up
+    // can not get lost
+    QMutexLocker idleLock( &m_idleMutex );
+    m_workAvailable.wakeOne();
+}
+
+int Executor::currentWorker() const
+{
+    Worker* worker = dynamic_cast<Worker*>( QThread::currentThread() );
+    if( worker != 0 && worker->m_executor == this )
+        return worker->m_index;
+    return -1;
+}
+
+bool Executor::popLocal( Worker* self, Task& task )
+{
+    QMutexLocker lock( &self->m_dequeMutex );
+    if( self->m_deque.empty() )
+        return false;
+
+    // newest task first, its input is most likely still in cache
+    task = self->m_deque.back();
+    self->m_deque.pop_back();
+    return true;
+}
+
+bool Executor::steal( Worker* self, Task& task )
+{
+    int count = m_workers.size();
+    for( int i=1; i < count; ++i )
+    {
+        Worker* victim = m_workers.at( (self->m_index + i) % count );
+        QMutexLocker lock( &victim->m_dequeMutex );
+        if( !victim->m_deque.empty() )
+        {
+            // oldest task, the one least likely to be hot in the victim's cache
+            task = victim->m_deque.front();
+            victim->m_deque.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void Executor::workerLoop( Worker* self )
+{
+    forever
+    {
+        Task task;
+        if( popLocal( self, task ) || steal( self, task ) )
+        {
+            m_pending.deref();
+
+            bool result = task.element->run( task.serial, task.enqueued, task.dispatched );
+            m_listener->taskFinished( task.element, task.serial, result );
+            continue;
+        }
+
+        QMutexLocker lock( &m_idleMutex );
+        if( m_pending == 0 )
+        {
+            if( !m_running )
+                return;
+            m_workAvailable.wait( &m_idleMutex );
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "IInputPin.h"
 #include "DataConsumer.h"
+#include "ProcessingContext.h"
 
 using namespace plv;
 
@@ -75,6 +76,12 @@ void IInputPin::peekNext( unsigned int& serial, bool& isNull ) const
     m_connection->peek(serial, isNull);
 }
 
+qint64 IInputPin::peekTimestamp() const
+{
+    assert( m_connection != 0 );
+    return m_connection->peekTimestamp();
+}
+
 void IInputPin::pre()
 {
     m_called = false;
@@ -109,6 +116,14 @@ void IInputPin::acceptData(const Data& data)
 
 void IInputPin::getVariant(QVariant& v)
 {
+    // reentrant consumers have their input taken in advance
+    ProcessingContext* context = m_consumer->getProcessingContext();
+    if( context != 0 )
+    {
+        getVariantFromContext( context, v );
+        return;
+    }
+
     // check if get is not called twice during one process call
     if( m_called )
     {
@@ -131,3 +146,25 @@ void IInputPin::getVariant(QVariant& v)
     Data d = m_connection->get();
     v.setValue(d.getPayload());
 }
+
+void IInputPin::getVariantFromContext( ProcessingContext* context, QVariant& v )
+{
+    if( context->isCalled( this ) )
+    {
+        QString msg = tr("Illegal: method get() called twice during process() "
+                         "on InputPin %1 of processor %2.")
+                      .arg(m_name)
+                      .arg(m_consumer->getName());
+        throw RuntimeError(msg,__FILE__, __LINE__ );
+    }
+    context->setCalled( this );
+    if( !context->hasInput( this ) )
+    {
+        QString msg = tr("Illegal: method get() called on InputPin which "
+                         "has no data available. Pin name is %1 of processor %2")
+                        .arg(m_name)
+                        .arg(m_consumer->getName());
+        throw RuntimeError(msg, __FILE__, __LINE__);
+    }
+    v.setValue(context->takeInput( this ));
+}
@@ -1,5 +1,6 @@
 #include "IOutputPin.h"
 #include "DataProducer.h"
+#include "ProcessingContext.h"
 
 using namespace plv;
 
@@ -83,6 +84,17 @@ int IOutputPin::maxDataOnConnection() const
     return max;
 }
 
+bool IOutputPin::isBlocked() const
+{
+    for(std::list< RefPtr<PinConnection> >::const_iterator itr = m_connections.begin();
+            itr != m_connections.end(); ++itr)
+    {
+        if( (*itr)->isFull() )
+            return true;
+    }
+    return false;
+}
+
 void IOutputPin::pre()
 {
     m_called = false;
@@ -94,22 +106,44 @@ void IOutputPin::post()
     // this is to keep everything synchronized
     if( this->isConnected() && !m_called )
     {
-        unsigned int serial = m_producer->getProcessingSerial();
-        Data nullData( serial );
+        publishNull( m_producer->getProcessingSerial(), m_producer->getCaptureTime() );
+    }
+}
 
-        // publish to all pin connections
-        for(std::list< RefPtr<PinConnection> >::iterator itr = m_connections.begin();
-                itr != m_connections.end(); ++itr)
-        {
-            PinConnection* connection = (*itr).getPtr();
-            if( connection->isSynchronous() )
-                connection->put( nullData );
-        }
+void IOutputPin::publishNull( unsigned int serial, qint64 captureTime )
+{
+    Data nullData( serial );
+    nullData.setTimestamp( captureTime );
+
+    // publish to all pin connections
+    for(std::list< RefPtr<PinConnection> >::iterator itr = m_connections.begin();
+            itr != m_connections.end(); ++itr)
+    {
+        PinConnection* connection = (*itr).getPtr();
+        if( connection->isSynchronous() )
+            connection->put( nullData );
     }
 }
 
 void IOutputPin::putVariant( unsigned int serial, const QVariant& v )
 {
+    // output of reentrant producers is buffered until it is its turn
+    ProcessingContext* context = m_producer->getProcessingContext();
+    if( context != 0 )
+    {
+        if( context->isCalled( this ) )
+        {
+            QString msg = tr("Illegal: method put() called twice during process() "
+                             "on OutputPin. Pin name is \"%1\" of processor \"%2\"")
+                             .arg( this->m_name )
+                             .arg( m_producer->getName() );
+            throw RuntimeError( msg,__FILE__, __LINE__ );
+        }
+        context->setCalled( this );
+        context->addOutput( this, v );
+        return;
+    }
+
     // check if get is not called twice during one process call
     if( m_called )
     {
@@ -122,8 +156,14 @@ void IOutputPin::putVariant( unsigned int serial, const QVariant& v )
     }
     m_called = true;
 
-    // propagate the serial number
+    publish( serial, m_producer->getCaptureTime(), v );
+}
+
+void IOutputPin::publish( unsigned int serial, qint64 captureTime, const QVariant& v )
+{
+    // propagate the serial number and the capture time
     Data data( serial, v );
+    data.setTimestamp( captureTime );
 
     // publish data to viewers
     emit newData( serial, v );
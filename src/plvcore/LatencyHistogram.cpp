@@ -0,0 +1,133 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "LatencyHistogram.h"
+
+#include <cstring>
+
+using namespace plv;
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::reset()
+{
+    memset( m_buckets, 0, sizeof(m_buckets) );
+    m_count = 0;
+    m_sum   = 0;
+    m_min   = 0;
+    m_max   = 0;
+}
+
+int LatencyHistogram::bucketIndex( qint64 nanoseconds )
+{
+    quint64 us = nanoseconds > 0 ? static_cast<quint64>( nanoseconds / 1000 ) : 0;
+    if( us < 4 )
+        return static_cast<int>( us );
+
+    // position of the highest bit, at least 2 here
+    int octave = 0;
+    for( quint64 v = us; v > 1; v >>= 1 )
+        ++octave;
+
+    int sub = static_cast<int>( (us >> (octave - 2)) & 3 );
+    int index = 4 + (octave - 2) * 4 + sub;
+    return index < LATENCY_HISTOGRAM_BUCKETS ? index : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+qint64 LatencyHistogram::bucketLowerBound( int bucket )
+{
+    if( bucket < 4 )
+        return bucket * 1000;
+
+    int octave = 2 + (bucket - 4) / 4;
+    int sub    = (bucket - 4) % 4;
+    return ( static_cast<qint64>(4 + sub) << (octave - 2) ) * 1000;
+}
+
+qint64 LatencyHistogram::bucketUpperBound( int bucket )
+{
+    if( bucket < 4 )
+        return (bucket + 1) * 1000;
+
+    int octave = 2 + (bucket - 4) / 4;
+    return bucketLowerBound( bucket ) + ( Q_INT64_C(1) << (octave - 2) ) * 1000;
+}
+
+void LatencyHistogram::add( qint64 nanoseconds )
+{
+    if( nanoseconds < 0 )
+        nanoseconds = 0;
+
+    ++m_buckets[bucketIndex(nanoseconds)];
+
+    if( m_count == 0 || nanoseconds < m_min ) m_min = nanoseconds;
+    if( m_count == 0 || nanoseconds > m_max ) m_max = nanoseconds;
+    m_sum += nanoseconds;
+    ++m_count;
+}
+
+void LatencyHistogram::addToBucket( int bucket, qint64 count )
+{
+    if( count <= 0 )
+        return;
+
+    qint64 lower = bucketLowerBound( bucket );
+    qint64 upper = bucketUpperBound( bucket ) - 1;
+
+    m_buckets[bucket] += count;
+    if( m_count == 0 || lower < m_min ) m_min = lower;
+    if( m_count == 0 || upper > m_max ) m_max = upper;
+    m_sum += count * ((lower + upper) / 2);
+    m_count += count;
+}
+
+qint64 LatencyHistogram::getMean() const
+{
+    return m_count > 0 ? m_sum / m_count : 0;
+}
+
+qint64 LatencyHistogram::getPercentile( double fraction ) const
+{
+    if( m_count == 0 )
+        return 0;
+
+    qint64 rank = static_cast<qint64>( fraction * m_count + 0.5 );
+    if( rank < 1 ) rank = 1;
+    if( rank > m_count ) rank = m_count;
+
+    qint64 seen = 0;
+    for( int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i )
+    {
+        seen += m_buckets[i];
+        if( seen >= rank )
+        {
+            // the exact extremes are known, do not report beyond them
+            qint64 bound = bucketUpperBound( i );
+            if( bound > m_max ) bound = m_max;
+            if( bound < m_min ) bound = m_min;
+            return bound;
+        }
+    }
+    return m_max;
+}
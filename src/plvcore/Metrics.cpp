@@ -0,0 +1,191 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "Metrics.h"
+
+#include <QTextStream>
+
+#include "Clock.h"
+#include "CvMatData.h"
+#include "PipelineElement.h"
+#include "PinConnection.h"
+#include "IInputPin.h"
+#include "IOutputPin.h"
+#include "Util.h"
+
+using namespace plv;
+
+AtomicHistogram::AtomicHistogram()
+{
+    reset();
+}
+
+void AtomicHistogram::reset()
+{
+    for( int i=0; i < LATENCY_HISTOGRAM_BUCKETS; ++i )
+        m_buckets[i] = 0;
+}
+
+LatencyHistogram AtomicHistogram::snapshot() const
+{
+    LatencyHistogram histogram;
+    for( int i=0; i < LATENCY_HISTOGRAM_BUCKETS; ++i )
+        histogram.addToBucket( i, m_buckets[i] );
+    return histogram;
+}
+
+ElementMetrics::ElementMetrics()
+{
+    reset();
+}
+
+void ElementMetrics::reset()
+{
+    m_frames = 0;
+    m_nullFrames = 0;
+    m_errors = 0;
+    m_readAhead = 0;
+    m_backlog = 0;
+    m_dropped = 0;
+    m_processingTime.reset();
+    m_readyWait.reset();
+}
+
+MetricsSnapshot::MetricsSnapshot() :
+    timestamp( Clock::now() ),
+    fps( -1.0f ),
+    running( false )
+{
+    pool.hits      = 0;
+    pool.misses    = 0;
+    pool.evictions = 0;
+    pool.count     = 0;
+    pool.bytes     = 0;
+    pool.maxBytes  = 0;
+}
+
+void MetricsSnapshot::addElement( const PipelineElement* element )
+{
+    const ElementMetrics& metrics = element->getMetrics();
+
+    Element e;
+    e.id             = element->getId();
+    e.name           = element->getName();
+    e.frames         = metrics.getFrameCount();
+    e.nullFrames     = metrics.getNullFrameCount();
+    e.errors         = metrics.getErrorCount();
+    e.readAhead      = metrics.getReadAhead();
+    e.backlog        = metrics.getBacklog();
+    e.dropped        = metrics.getDropCount();
+    e.processingTime = metrics.getProcessingTime();
+    e.readyWait      = metrics.getReadyWait();
+    elements.append( e );
+}
+
+void MetricsSnapshot::addConnection( const PinConnection* connection )
+{
+    Connection c;
+    c.id            = connection->getId();
+    c.fromElement   = connection->fromPin()->getOwner()->getId();
+    c.toElement     = connection->toPin()->getOwner()->getId();
+    c.depth         = connection->size();
+    c.capacity      = connection->getCapacity();
+    c.highWaterMark = connection->getHighWaterMark();
+    c.dropCount     = connection->getDropCount();
+    connections.append( c );
+}
+
+void MetricsSnapshot::setPool( const CvMatDataPool* p )
+{
+    pool.hits      = p->getHitCount();
+    pool.misses    = p->getMissCount();
+    pool.evictions = p->getEvictionCount();
+    pool.count     = p->getCount();
+    pool.bytes     = p->getBytes();
+    pool.maxBytes  = p->getMaxBytes();
+}
+
+static void writeHistogram( QTextStream& out, const LatencyHistogram& h )
+{
+    out << "{\"count\":" << h.getCount()
+        << ",\"mean_us\":" << h.getMean() / 1000
+        << ",\"p50_us\":" << h.getPercentile( 0.5 ) / 1000
+        << ",\"p90_us\":" << h.getPercentile( 0.9 ) / 1000
+        << ",\"p99_us\":" << h.getPercentile( 0.99 ) / 1000
+        << ",\"max_us\":" << h.getMax() / 1000 << "}";
+}
+
+void MetricsSnapshot::writeJson( QTextStream& out ) const
+{
+    out << "{\"timestamp_us\":" << timestamp / 1000
+        << ",\"running\":" << (running ? "true" : "false")
+        << ",\"fps\":" << fps
+        << ",\"elements\":[";
+
+    for( int i=0; i < elements.size(); ++i )
+    {
+        const Element& e = elements.at( i );
+        out << (i > 0 ? "," : "")
+            << "{\"id\":" << e.id
+            << ",\"name\":\"" << Util::jsonEscape( e.name ) << "\""
+            << ",\"frames\":" << e.frames
+            << ",\"null_frames\":" << e.nullFrames
+            << ",\"errors\":" << e.errors
+            << ",\"read_ahead\":" << e.readAhead
+            << ",\"backlog\":" << e.backlog
+            << ",\"dropped\":" << e.dropped
+            << ",\"processing_time\":";
+        writeHistogram( out, e.processingTime );
+        out << ",\"ready_wait\":";
+        writeHistogram( out, e.readyWait );
+        out << "}";
+    }
+
+    out << "],\"connections\":[";
+    for( int i=0; i < connections.size(); ++i )
+    {
+        const Connection& c = connections.at( i );
+        out << (i > 0 ? "," : "")
+            << "{\"id\":" << c.id
+            << ",\"from\":" << c.fromElement
+            << ",\"to\":" << c.toElement
+            << ",\"depth\":" << c.depth
+            << ",\"capacity\":" << c.capacity
+            << ",\"high_water_mark\":" << c.highWaterMark
+            << ",\"dropped\":" << c.dropCount << "}";
+    }
+
+    out << "],\"pool\":{\"hits\":" << pool.hits
+        << ",\"misses\":" << pool.misses
+        << ",\"evictions\":" << pool.evictions
+        << ",\"buffers\":" << pool.count
+        << ",\"bytes\":" << pool.bytes
+        << ",\"max_bytes\":" << pool.maxBytes << "}}";
+}
+
+QString MetricsSnapshot::toJson() const
+{
+    QString json;
+    QTextStream out( &json );
+    writeJson( out );
+    out.flush();
+    return json;
+}
@@ -0,0 +1,75 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "MetricsServer.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include "Pipeline.h"
+#include "Metrics.h"
+
+using namespace plv;
+
+MetricsServer::MetricsServer( Pipeline* pipeline, QObject* parent ) :
+    QObject( parent ),
+    m_pipeline( pipeline ),
+    m_server( new QLocalServer( this ) )
+{
+    connect( m_server, SIGNAL(newConnection()), this, SLOT(newConnection()) );
+}
+
+MetricsServer::~MetricsServer()
+{
+    close();
+}
+
+bool MetricsServer::listen( const QString& name )
+{
+    QLocalServer::removeServer( name );
+    return m_server->listen( name );
+}
+
+void MetricsServer::close()
+{
+    m_server->close();
+}
+
+QString MetricsServer::errorString() const
+{
+    return m_server->errorString();
+}
+
+void MetricsServer::newConnection()
+{
+    while( m_server->hasPendingConnections() )
+    {
+        QLocalSocket* socket = m_server->nextPendingConnection();
+        connect( socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()) );
+
+        QByteArray json = m_pipeline->getMetrics().toJson().toUtf8();
+        json.append( '\n' );
+        socket->write( json );
+
+        // pending data is written before the connection is closed
+        socket->disconnectFromServer();
+    }
+}
@@ -28,6 +28,7 @@
 
 #include <QStringBuilder>
 #include <QString>
+#include <QDebug>
 
 using namespace plv;
 
@@ -37,11 +38,18 @@ PinConnection::PinConnection( int id, IOutputPin* producer, IInputPin* consumer
             DuplicateConnectionException ) :
         m_id(id),
         m_producer( producer ),
-        m_consumer( consumer )
+        m_consumer( consumer ),
+        m_ring( 0 ),
+        m_capacity( PINCONNECTION_DEFAULT_CAPACITY ),
+        m_workerCount( 1 ),
+        m_policy( BLOCK ),
+        m_highWaterMark( 0 ),
+        m_dropCount( 0 )
 {
     assert(m_consumer != 0);
     assert(m_producer != 0);
 
+    resizeRing();
     connect();
 }
 
@@ -51,6 +59,8 @@ PinConnection::~PinConnection()
     // disconnection should be called before deletion
     assert(m_consumer == 0);
     assert(m_producer == 0);
+
+    delete m_ring;
 }
 
 bool PinConnection::canConnectPins( IOutputPin* out, IInputPin* in,
@@ -181,19 +191,19 @@ void PinConnection::connect()
 
 bool PinConnection::fastforward( unsigned int target )
 {
-    QMutexLocker lock(&m_connectionMutex);
-
     bool success = false;
-    while( !success && !m_queue.empty())
+    unsigned int serial;
+    bool isNull;
+    while( !success && m_ring->peek( serial, isNull ) )
     {
-        Data data = m_queue.front();
-        if( data.getSerial() == target )
+        if( serial == target )
         {
             success = true;
         }
         else
         {
-            m_queue.pop();
+            Data dropped;
+            m_ring->pop( dropped );
         }
     }
     return success;
@@ -211,12 +221,9 @@ bool PinConnection::isAsynchronous() const
 
 void PinConnection::flush()
 {
-    QMutexLocker lock(&m_connectionMutex);
     // clear queue
-    while(!m_queue.empty())
-    {
-        m_queue.pop();
-    }
+    Data data;
+    while( m_ring->pop( data ) ) {}
 }
 
 void PinConnection::disconnect()
@@ -232,28 +239,24 @@ void PinConnection::disconnect()
     m_consumer = 0;
 
     // clear queue
-    while (!m_queue.empty())
-    {
-        m_queue.pop();
-    }
+    Data data;
+    while( m_ring->pop( data ) ) {}
 }
 
 bool PinConnection::hasData() const
 {
-    QMutexLocker lock( &m_connectionMutex );
-    return !m_queue.empty();
+    return !m_ring->isEmpty();
 }
 
 int PinConnection::size() const
 {
-    QMutexLocker lock( &m_connectionMutex );
-    return static_cast<int>( m_queue.size() );
+    return m_ring->count();
 }
 
 Data PinConnection::get()
 {
-    QMutexLocker lock( &m_connectionMutex );
-    if( m_queue.empty() )
+    Data d;
+    if( !m_ring->pop( d ) )
     {
         QString producerName = m_producer->getOwner()->getName();
         QString consumerName = m_consumer->getOwner()->getName();
@@ -265,15 +268,13 @@ Data PinConnection::get()
 
         throw RuntimeError( msg, __FILE__, __LINE__ );
     }
-    Data d = m_queue.front();
-    m_queue.pop();
     return d;
 }
 
 Data PinConnection::peek() const
 {
-    QMutexLocker lock( &m_connectionMutex );
-    if( m_queue.empty() )
+    Data d;
+    if( !m_ring->peek( d ) )
     {
         QString producerName = m_producer->getOwner()->getName();
         QString consumerName = m_consumer->getOwner()->getName();
@@ -285,13 +286,12 @@ Data PinConnection::peek() const
 
         throw RuntimeError( msg, __FILE__, __LINE__ );
     }
-    return m_queue.front();
+    return d;
 }
 
 void PinConnection::peek( unsigned int& serial, bool& isNull ) const
 {
-    QMutexLocker lock( &m_connectionMutex );
-    if( m_queue.empty() )
+    if( !m_ring->peek( serial, isNull ) )
     {
         QString producerName = m_producer->getOwner()->getName();
         QString consumerName = m_consumer->getOwner()->getName();
@@ -303,19 +303,205 @@ void PinConnection::peek( unsigned int& serial, bool& isNull ) const
 
         throw RuntimeError( msg, __FILE__, __LINE__ );
     }
-    const Data& d = m_queue.front();
-    serial = d.getSerial();
-    isNull = d.isNull();
+}
+
+qint64 PinConnection::peekTimestamp() const
+{
+    qint64 timestamp = 0;
+    if( !m_ring->peekTimestamp( timestamp ) )
+    {
+        QString producerName = m_producer->getOwner()->getName();
+        QString consumerName = m_consumer->getOwner()->getName();
+
+        QString msg = "Illegal: method peekTimestamp() called on PinConnection"
+                      "which has no data available"
+                      " with producer owner " % producerName %
+                      " and consumer owner " % consumerName;
+
+        throw RuntimeError( msg, __FILE__, __LINE__ );
+    }
+    return timestamp;
 }
 
 void PinConnection::put(const Data& data)
 {
-    QMutexLocker lock(&m_connectionMutex);
-    m_queue.push(data);
-    lock.unlock();
+    // BLOCK is enforced by the pipeline, which does not dispatch an
+    // element while one of its output connections is full
+    OverflowPolicy policy = static_cast<OverflowPolicy>( int(m_policy) );
+    bool overflow = policy != BLOCK && m_ring->count() >= getLimit();
+
+    Data item = data;
+    if( overflow )
+    {
+        m_dropCount.ref();
+
+        if( m_consumer->isSynchronous() )
+        {
+            // synchronous consumers need every serial, so we drop the payload
+            // but keep a NULL item with the serial to stay synchronized
+            if( policy == DROP_NEWEST || !m_ring->nullifyOldest() )
+            {
+                item = Data( data.getSerial() );
+                item.setTimestamp( data.getTimestamp() );
+            }
+        }
+        else
+        {
+            // asynchronous consumers are notified once for every queued
+            // item, dropping the oldest item keeps that count in line
+            if( policy == DROP_NEWEST )
+                return;
+
+            Data dropped;
+            m_ring->pop( dropped );
+        }
+    }
+
+    // the ring has room for the point at which isFull() holds back the
+    // producer plus the serials of reentrant elements which were already
+    // dispatched, so it is only full when the pipeline did not do so
+    if( !m_ring->push( item ) )
+    {
+        QString msg = "PinConnection::put() called on a full connection"
+                      " with producer owner " % m_producer->getOwner()->getName() %
+                      " and consumer owner " % m_consumer->getOwner()->getName();
+
+        throw RuntimeError( msg, __FILE__, __LINE__ );
+    }
+    updateHighWaterMark();
+
+    if( overflow && !m_consumer->isSynchronous() )
+        return;
+
     m_consumer->acceptData(data);
 }
 
+void PinConnection::updateHighWaterMark()
+{
+    int size = m_ring->count();
+    int mark = m_highWaterMark;
+    while( size > mark && !m_highWaterMark.testAndSetRelaxed( mark, size ) )
+    {
+        mark = m_highWaterMark;
+    }
+}
+
+int PinConnection::getLimit() const
+{
+    int capacity = m_capacity;
+    return capacity > 0 ? capacity : PINCONNECTION_MAX_CAPACITY;
+}
+
+void PinConnection::resizeRing()
+{
+    // reentrant elements may have a serial running on every worker
+    // when their output connection fills up, dropping edges are only
+    // held back after another serial for every worker, see isFull()
+    int size = getLimit() + 2 * m_workerCount + 1;
+    if( m_ring != 0 && size <= m_ring->getSize() && size * 2 >= m_ring->getSize() )
+        return;
+
+    if( m_ring != 0 && !m_ring->isEmpty() )
+    {
+        qWarning() << "PinConnection cannot resize a connection which holds data";
+        return;
+    }
+    delete m_ring;
+    m_ring = new DataRing( size );
+}
+
+void PinConnection::setCapacity( int capacity )
+{
+    if( capacity > PINCONNECTION_MAX_CAPACITY )
+    {
+        qWarning() << "PinConnection::setCapacity limiting capacity" << capacity
+                   << "to" << PINCONNECTION_MAX_CAPACITY;
+        capacity = PINCONNECTION_MAX_CAPACITY;
+    }
+
+    QMutexLocker lock( &m_connectionMutex );
+    m_capacity = capacity > 0 ? capacity : 0;
+    resizeRing();
+}
+
+void PinConnection::setWorkerCount( int count )
+{
+    QMutexLocker lock( &m_connectionMutex );
+    m_workerCount = qMax( count, 1 );
+    resizeRing();
+}
+
+int PinConnection::getCapacity() const
+{
+    return m_capacity;
+}
+
+void PinConnection::setOverflowPolicy( OverflowPolicy policy )
+{
+    m_policy = policy;
+}
+
+PinConnection::OverflowPolicy PinConnection::getOverflowPolicy() const
+{
+    return static_cast<OverflowPolicy>( int(m_policy) );
+}
+
+bool PinConnection::isFull() const
+{
+    int count = m_ring->count();
+    if( m_policy == BLOCK )
+        return count >= getLimit();
+
+    // a synchronous consumer still gets a NULL item for every dropped
+    // serial, so a dropping edge grows past the limit when its consumer
+    // falls behind. Hold the producer back once the headroom is used up
+    return count >= getLimit() + m_workerCount;
+}
+
+int PinConnection::getHighWaterMark() const
+{
+    return m_highWaterMark;
+}
+
+int PinConnection::getDropCount() const
+{
+    return m_dropCount;
+}
+
+void PinConnection::resetStatistics()
+{
+    m_highWaterMark = 0;
+    m_dropCount = 0;
+}
+
+QString PinConnection::overflowPolicyToString( OverflowPolicy policy )
+{
+    switch( policy )
+    {
+    case DROP_OLDEST:
+        return "dropOldest";
+    case DROP_NEWEST:
+        return "dropNewest";
+    case BLOCK:
+    default:
+        return "block";
+    }
+}
+
+bool PinConnection::overflowPolicyFromString( const QString& str, OverflowPolicy& policy )
+{
+    QString lower = str.trimmed().toLower();
+    if( lower == "block" )
+        policy = BLOCK;
+    else if( lower == "dropoldest" )
+        policy = DROP_OLDEST;
+    else if( lower == "dropnewest" )
+        policy = DROP_NEWEST;
+    else
+        return false;
+    return true;
+}
+
 const IOutputPin* PinConnection::fromPin() const
 {
     return m_producer;
@@ -325,3 +511,204 @@ const IInputPin*  PinConnection::toPin() const
 {
     return m_consumer;
 }
+
+DataRing::DataRing( int size )
+{
+    // round up to a power of two so the slot index is a mask
+    int slots = 2;
+    while( slots < size )
+        slots <<= 1;
+
+    m_slots = new Slot[slots];
+    m_mask = slots - 1;
+    for( int i=0; i < slots; ++i )
+    {
+        m_slots[i].sequence = i;
+        m_slots[i].serial = 0;
+        m_slots[i].null = 1;
+        m_slots[i].timestamp = 0;
+    }
+    m_head = 0;
+    m_tail = 0;
+}
+
+DataRing::~DataRing()
+{
+    delete[] m_slots;
+}
+
+/** difference of two positions, positions wrap around so
+    they are subtracted as unsigned values */
+static inline int positionDiff( int a, int b )
+{
+    return static_cast<int>( static_cast<unsigned int>(a) - static_cast<unsigned int>(b) );
+}
+
+/** Qt 4 has no ordered load, adding zero with acquire semantics
+    makes the slot contents written before the sequence visible */
+static inline int loadAcquire( const QAtomicInt& value )
+{
+    return const_cast<QAtomicInt&>( value ).fetchAndAddAcquire( 0 );
+}
+
+int DataRing::count() const
+{
+    // read head first, tail can only grow in the meantime
+    int head = m_head;
+    int tail = m_tail;
+    int count = positionDiff( tail, head );
+    if( count < 0 )
+        return 0;
+    return qMin( count, m_mask + 1 );
+}
+
+bool DataRing::push( const Data& data )
+{
+    Slot* slot;
+    int pos = m_tail;
+    forever
+    {
+        slot = &m_slots[pos & m_mask];
+        int diff = positionDiff( loadAcquire( slot->sequence ), pos );
+        if( diff == 0 )
+        {
+            // slot is free for this lap, claim it
+            if( m_tail.testAndSetRelaxed( pos, pos + 1 ) )
+                break;
+        }
+        else if( diff < 0 )
+        {
+            // slot still holds the item of the previous lap
+            return false;
+        }
+        pos = m_tail;
+    }
+
+    slot->serial = static_cast<int>( data.getSerial() );
+    slot->null = data.isNull() ? 1 : 0;
+    slot->timestamp = data.getTimestamp();
+    slot->payload = data.getPayload();
+
+    // publish the item
+    slot->sequence.fetchAndStoreRelease( pos + 1 );
+    return true;
+}
+
+bool DataRing::pop( Data& data )
+{
+    Slot* slot;
+    int pos = m_head;
+    forever
+    {
+        slot = &m_slots[pos & m_mask];
+        int diff = positionDiff( loadAcquire( slot->sequence ), pos + 1 );
+        if( diff == 0 )
+        {
+            if( m_head.testAndSetAcquire( pos, pos + 1 ) )
+                break;
+        }
+        else if( diff < 0 )
+        {
+            return false;
+        }
+        pos = m_head;
+    }
+
+    // taking the null flag makes a concurrent nullifyOldest skip this slot
+    unsigned int serial = static_cast<unsigned int>( int(slot->serial) );
+    bool isNull = slot->null.fetchAndStoreOrdered( 1 ) != 0;
+    if( isNull )
+        data = Data( serial );
+    else
+        data = Data( serial, slot->payload );
+    data.setTimestamp( slot->timestamp );
+    slot->payload = QVariant();
+
+    // hand the slot back to the producers for the next lap
+    slot->sequence.fetchAndStoreRelease( pos + m_mask + 1 );
+    return true;
+}
+
+bool DataRing::peek( unsigned int& serial, bool& isNull ) const
+{
+    forever
+    {
+        int pos = m_head;
+        const Slot* slot = &m_slots[pos & m_mask];
+        int diff = positionDiff( loadAcquire( slot->sequence ), pos + 1 );
+        if( diff < 0 )
+            return false;
+
+        if( diff == 0 )
+        {
+            unsigned int s = static_cast<unsigned int>( int(slot->serial) );
+            bool n = slot->null != 0;
+
+            // the values are only valid if the item was not popped meanwhile
+            if( m_head == pos )
+            {
+                serial = s;
+                isNull = n;
+                return true;
+            }
+        }
+    }
+}
+
+bool DataRing::peek( Data& data ) const
+{
+    int pos = m_head;
+    const Slot* slot = &m_slots[pos & m_mask];
+    if( positionDiff( loadAcquire( slot->sequence ), pos + 1 ) != 0 )
+        return false;
+
+    unsigned int serial = static_cast<unsigned int>( int(slot->serial) );
+    if( slot->null != 0 )
+        data = Data( serial );
+    else
+        data = Data( serial, slot->payload );
+    data.setTimestamp( slot->timestamp );
+    return true;
+}
+
+bool DataRing::peekTimestamp( qint64& timestamp ) const
+{
+    int pos = m_head;
+    const Slot* slot = &m_slots[pos & m_mask];
+    if( positionDiff( loadAcquire( slot->sequence ), pos + 1 ) != 0 )
+        return false;
+
+    timestamp = slot->timestamp;
+    return true;
+}
+
+bool DataRing::nullifyOldest()
+{
+    // the front item is never nulled, the scheduler may already have
+    // peeked at it and dispatched the consumer expecting its payload
+    int tail = m_tail;
+    for( int pos = m_head + 1; positionDiff( tail, pos ) > 0; ++pos )
+    {
+        // the consumer popped up to here meanwhile, restart behind the front
+        int head = m_head;
+        if( positionDiff( pos, head ) <= 0 )
+        {
+            pos = head;
+            continue;
+        }
+
+        Slot* slot = &m_slots[pos & m_mask];
+
+        // stop at slots which are not (or no longer) filled for this lap
+        if( positionDiff( loadAcquire( slot->sequence ), pos + 1 ) != 0 )
+        {
+            if( positionDiff( m_head, pos ) > 0 )
+                continue;
+            return false;
+        }
+
+        if( slot->null.testAndSetOrdered( 0, 1 ) )
+            return true;
+    }
+    return false;
+}
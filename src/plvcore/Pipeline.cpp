@@ -24,7 +24,6 @@
 #include <QDebug>
 #include <QStringBuilder>
 #include <list>
-#include <QtConcurrentRun>
 #include <QTime>
 #include <QMutableMapIterator>
 
@@ -38,19 +37,45 @@
 #include "PipelineLoader.h"
 #include "IInputPin.h"
 #include "IOutputPin.h"
+#include "CvMatData.h"
+#include "Tracer.h"
 
 using namespace plv;
 
+void RunItem::dispatch( Executor& executor )
+{
+    assert( m_dispatched == false );
+    if( m_element->isReentrant() )
+    {
+        // several serials can be in flight, take the input
+        // for this one now while we are still in serial order
+        m_element->__prepare( m_serial );
+    }
+    else
+    {
+        assert( m_element->getState() == PipelineElement::PLE_STARTED );
+        m_element->setState( PipelineElement::PLE_DISPATCHED );
+    }
+    if( Tracer::isEnabled() )
+        Tracer::instant( "dispatch", m_element, m_serial );
+
+    executor.submit( m_element, m_serial, m_worker, m_enqueued );
+    m_dispatched = true;
+}
+
 Pipeline::Pipeline() :
         m_serial( 1 ),
         m_running(false),
         m_runQueueThreshold(10),
+        m_executor(this),
+        m_processingObserver(0),
         m_stepwise(false),
         m_producersReady(false),
         m_numFramesSinceLastFPSCalculation(0),
         m_fps(-1.0f),
         m_testCount(0)
 {
+    m_scheduleRequested = 0;
     //m_pipelineThread.start();
 }
 
@@ -249,6 +274,7 @@ int Pipeline::connectPins( IOutputPin* outputPin, IInputPin* inputPin)
 {
     int id = getNewPinConnectionId();
     RefPtr<PinConnection> connection = new PinConnection(id, outputPin, inputPin);
+    connection->setWorkerCount( m_executor.getWorkerCount() );
 
     QMutexLocker lock( &m_pipelineMutex );
     m_connections.insert(id, connection);
@@ -267,11 +293,138 @@ void Pipeline::pinConnectionDisconnect( int id )
 
 void Pipeline::pipelineDataConsumerReady(unsigned int serial, DataConsumer *consumer)
 {
+    // prefer the worker which produced the data, the
+    // consumer will then find its input in a warm cache
+    int worker = m_executor.currentWorker();
+
+    if( Tracer::isEnabled() )
+        Tracer::instant( "ready", consumer, serial );
+
     QMutexLocker lock(&m_readyQueueMutex);
-    RunItem item(consumer, serial);
+    RunItem item(consumer, serial, worker);
     int id = consumer->getId();
     QList<RunItem>* list = m_readyQueue.value(id);
     list->append(item);
+    lock.unlock();
+
+    wakeScheduler();
+}
+
+void Pipeline::wakeScheduler()
+{
+    // only post a new request if none is pending
+    if( m_scheduleRequested.testAndSetOrdered(0, 1) )
+    {
+        QMetaObject::invokeMethod( this, "schedule", Qt::QueuedConnection );
+    }
+}
+
+void Pipeline::taskFinished( PipelineElement* element, unsigned int serial, bool result )
+{
+    RunItem item( element, serial );
+    item.m_result = result;
+
+    QMutexLocker lock( &m_finishedQueueMutex );
+    m_finishedQueue.append( item );
+    lock.unlock();
+
+    wakeScheduler();
+}
+
+QList<RunItem> Pipeline::takeFinishedItems()
+{
+    QMutexLocker lock( &m_finishedQueueMutex );
+    QList<RunItem> finished = m_finishedQueue;
+    m_finishedQueue.clear();
+    return finished;
+}
+
+void Pipeline::setWorkerCount( int count )
+{
+    m_executor.setWorkerCount( count );
+
+    // connections keep a ring slot for every worker
+    QMutexLocker lock( &m_pipelineMutex );
+    foreach( RefPtr<PinConnection> connection, m_connections )
+    {
+        connection->setWorkerCount( m_executor.getWorkerCount() );
+    }
+}
+
+int Pipeline::getWorkerCount() const
+{
+    return m_executor.getWorkerCount();
+}
+
+void Pipeline::setProcessingObserver( ProcessingObserver* observer )
+{
+    QMutexLocker lock( &m_pipelineMutex );
+    assert( !m_running );
+    m_processingObserver = observer;
+}
+
+void Pipeline::recordLatency( PipelineElement* element, qint64 latency )
+{
+    QMutexLocker lock( &m_latencyMutex );
+    QHash<PipelineElement*, LatencyHistogram>::iterator itr = m_latencyHistograms.find( element );
+    if( itr != m_latencyHistograms.end() )
+        itr.value().add( latency );
+}
+
+LatencyHistogram Pipeline::getLatencyHistogram( int id ) const
+{
+    QMutexLocker lock( &m_latencyMutex );
+    QHashIterator<PipelineElement*, LatencyHistogram> itr( m_latencyHistograms );
+    while( itr.hasNext() )
+    {
+        itr.next();
+        if( itr.key()->getId() == id )
+            return itr.value();
+    }
+    return LatencyHistogram();
+}
+
+QHash<int, LatencyHistogram> Pipeline::getLatencyHistograms() const
+{
+    QHash<int, LatencyHistogram> histograms;
+    QMutexLocker lock( &m_latencyMutex );
+    QHashIterator<PipelineElement*, LatencyHistogram> itr( m_latencyHistograms );
+    while( itr.hasNext() )
+    {
+        itr.next();
+        histograms.insert( itr.key()->getId(), itr.value() );
+    }
+    return histograms;
+}
+
+MetricsSnapshot Pipeline::getMetrics() const
+{
+    MetricsSnapshot snapshot;
+    snapshot.fps = m_fps;
+    snapshot.running = m_running;
+
+    foreach( RefPtr<PipelineElement> element, m_children )
+        snapshot.addElement( element.getPtr() );
+
+    foreach( RefPtr<PinConnection> connection, m_connections )
+        snapshot.addConnection( connection.getPtr() );
+
+    CvMatDataPool* pool = CvMatDataPool::instance();
+    if( pool != 0 )
+        snapshot.setPool( pool );
+
+    return snapshot;
+}
+
+void Pipeline::resetLatencyHistograms()
+{
+    QMutexLocker lock( &m_latencyMutex );
+    QMutableHashIterator<PipelineElement*, LatencyHistogram> itr( m_latencyHistograms );
+    while( itr.hasNext() )
+    {
+        itr.next();
+        itr.value().reset();
+    }
 }
 
 bool Pipeline::init()
@@ -397,7 +550,7 @@ void Pipeline::clear()
 
 void Pipeline::start()
 {
-    int numThreads = QThreadPool::globalInstance()->maxThreadCount();
+    int numThreads = m_executor.getWorkerCount();
 
     qDebug() << "Starting pipeline using " << numThreads << " threads.";
 
@@ -482,14 +635,49 @@ void Pipeline::start()
         return;
     }
 
-    // start the heartbeat
-    m_heartbeat.start(0);
+    foreach(RefPtr<PinConnection> conn, m_connections)
+    {
+        conn->resetStatistics();
+    }
+
+    foreach( RefPtr<PipelineElement> element, m_children )
+    {
+        element->getMetrics().reset();
+    }
+
+    CvMatDataPool* pool = CvMatDataPool::instance();
+    if( pool != 0 )
+        pool->resetStatistics();
+
+    // name the elements in a trace which might be recorded during this run
+    foreach( RefPtr<PipelineElement> element, m_children )
+        Tracer::nameElement( element->getId(), element->getName() );
+
+    // latency is measured at the elements where frames leave the pipeline
+    QMutexLocker latencyLock( &m_latencyMutex );
+    m_latencyHistograms.clear();
+    foreach( RefPtr<PipelineElement> element, m_children )
+    {
+        if( element->isEndNode() )
+            m_latencyHistograms.insert( element.getPtr(), LatencyHistogram() );
+    }
+    latencyLock.unlock();
+
+    m_executor.start();
+
+    // start the fallback heartbeat, the scheduler is normally
+    // woken up by the elements themselves
+    m_heartbeat.start(PIPELINE_FALLBACK_HEARTBEAT_INTERVAL);
 
     m_running = true;
     m_runQueueThreshold = m_processors.size() + m_producers.size() + 1;
     m_timeSinceLastFPSCalculation.start();
+    m_timeSinceLastLatencyUpdate.start();
     lock.unlock();
     emit pipelineStarted();
+
+    // kick off the first scheduling round
+    wakeScheduler();
 }
 
 void Pipeline::stop()
@@ -505,23 +693,17 @@ void Pipeline::stop()
     // TODO insert a timeout here for elements which will not finish
     while( m_runQueue.size() != 0 )
     {
-        QMutableHashIterator<int, RunItem> i(m_runQueue);
-        while(i.hasNext())
+        foreach( const RunItem& item, takeFinishedItems() )
         {
-            i.next();
-            RunItem& item = i.value();
             PipelineElement* element = item.getElement();
-
-            PipelineElement::State state = element->getState();
-            if( state == PipelineElement::PLE_DONE ||
-                state == PipelineElement::PLE_ERROR )
-            {
-                i.remove();
-                element->setState(PipelineElement::PLE_STARTED);
-            }
+            m_runQueue.remove( element->getId(), item );
+            element->setState(PipelineElement::PLE_STARTED);
         }
     }
 
+    // all elements are done, join the worker threads
+    m_executor.stop();
+
     // TODO formalize this procedure (s of pipeline) more!
     QMapIterator<int, RefPtr<PipelineElement> > itr( m_children );
     while( itr.hasNext() )
@@ -564,67 +746,100 @@ void Pipeline::finish()
 
 void Pipeline::schedule()
 {
+    // clear the pending request first so wake ups which arrive
+    // while we are scheduling result in another call
+    m_scheduleRequested.fetchAndStoreOrdered(0);
+
     QMutexLocker pleLock(&m_pipelineMutex);
+
+    // a request might still have been pending when the pipeline was stopped
+    if( !m_running )
+        return;
+
     //QString msg = QString("upping m_testCount (%1) with one").arg(m_testCount);
     //qDebug() << msg;
     ++m_testCount;
     assert( m_testCount == 1);
     pleLock.unlock();
 
-    // remove stale entries from runqueue
-    QMutableHashIterator<int, RunItem> i(m_runQueue);
-    while(i.hasNext())
+    // remove finished entries from runqueue
+    PipelineElement* failed = 0;
+    foreach( const RunItem& runItem, takeFinishedItems() )
     {
-        i.next();
-        RunItem& runItem = i.value();
+        PipelineElement* element = runItem.getElement();
+        m_runQueue.remove( element->getId(), runItem );
 
-        QFuture<bool> future = runItem.getFuture();
-        if( future.isFinished() )
+        if( !runItem.m_result ||
+            element->getState() == PipelineElement::PLE_ERROR )
         {
-            bool result = future.result();
-            if( !result )
-            {
-                // stop on error
-                QString msg = tr("Pipeline stopped because of an error in %1. The error is %2")
-                              .arg(runItem.getElement()->getName())
-                              .arg(runItem.getElement()->getErrorString());
-                stop();
-                emit pipelineMessage(QtWarningMsg, msg);
-                return;
-            }
-            runItem.getElement()->setState(PipelineElement::PLE_STARTED);
-            i.remove();
+            failed = element;
+        }
+        else if( !element->isReentrant() )
+        {
+            element->setState(PipelineElement::PLE_STARTED);
         }
     }
 
-    // dispatch processors
+    if( failed != 0 )
+    {
+        // stop on error
+        QString msg = tr("Pipeline stopped because of an error in %1. The error is %2")
+                      .arg(failed->getName())
+                      .arg(failed->getErrorString());
+        stop();
+        emit pipelineMessage(QtWarningMsg, msg);
+        emit pipelineError(failed->getErrorType(), failed);
+        return;
+    }
+
+    // dispatch processors. Reentrant elements can run as many
+    // serials at once as there are workers, others one at a time.
+    // Items are dispatched outside the lock since reentrant
+    // elements take their input during dispatch.
+    int maxReentrant = m_executor.getWorkerCount();
+    QList<RunItem> dispatchList;
     QMutexLocker rqLock(&m_readyQueueMutex);
 
     foreach( QList<RunItem>* queue, m_readyQueue ) {
-        if (!queue->isEmpty()) {
-            RunItem& item = queue->first();
-            PipelineElement* readyElem = item.getElement();
-            if (!m_runQueue.contains(readyElem->getId()))
-            {
-                assert(readyElem->getState() < PipelineElement::PLE_DISPATCHED);
-                item.dispatch();
-                m_runQueue.insert(readyElem->getId(), item);
-                queue->removeFirst();
-            }
+        int running = -1;
+        while (!queue->isEmpty()) {
+            PipelineElement* readyElem = queue->first().getElement();
+            if( running == -1 )
+                running = m_runQueue.count(readyElem->getId());
+            int maxRunning = readyElem->isReentrant() ? maxReentrant : 1;
+            if( running >= maxRunning )
+                break;
+
+            // backpressure, wait until downstream has room again
+            if( readyElem->isOutputBlocked() )
+                break;
+
+            assert(readyElem->isReentrant() ||
+                   readyElem->getState() < PipelineElement::PLE_DISPATCHED);
+            dispatchList.append(queue->takeFirst());
+            ++running;
         }
     }
 
     rqLock.unlock();
 
-    // run producers
-    bool runProducers = false;
-    int max = 0;
-    foreach(RefPtr<PinConnection> conn, m_connections)
+    foreach( RunItem item, dispatchList )
     {
-        max = qMax(conn->size(), max);
+        item.dispatch(m_executor);
+        m_runQueue.insert(item.getElement()->getId(), item);
     }
-    if (max < 5) runProducers = true;
 
+    // run producers, producers run in lock step so they are all held
+    // back when one of them feeds a connection which is full
+    bool runProducers = true;
+    foreach( PipelineProducer* producer, m_producers)
+    {
+        if( producer->isOutputBlocked() )
+        {
+            runProducers = false;
+            break;
+        }
+    }
 
     if(runProducers)
     {
@@ -643,7 +858,7 @@ void Pipeline::schedule()
             foreach( PipelineProducer* producer, m_producers)
             {
                 RunItem item( producer, m_serial );
-                item.dispatch();
+                item.dispatch(m_executor);
                 m_runQueue.insert(producer->getId(), item);
             }
 
@@ -659,11 +874,25 @@ void Pipeline::schedule()
                 m_numFramesSinceLastFPSCalculation = 0;
                 qDebug() << "FPS: " << (int)m_fps;
                 emit framesPerSecond(m_fps);
+
+                if( Tracer::isEnabled() )
+                    Tracer::counter( "fps", m_fps );
             }
             emit stepTaken(m_serial);
         }
     }
 
+    if( m_timeSinceLastLatencyUpdate.elapsed() > PIPELINE_LATENCY_UPDATE_INTERVAL )
+    {
+        m_timeSinceLastLatencyUpdate.restart();
+        QHashIterator<int, LatencyHistogram> latencyItr( getLatencyHistograms() );
+        while( latencyItr.hasNext() )
+        {
+            latencyItr.next();
+            emit latencyUpdate( latencyItr.key(), latencyItr.value() );
+        }
+    }
+
 #if 0
     int maxIdx = m_ordering.size();
     QMutableMapIterator<unsigned int, int> itr(m_pipelineStages);
@@ -896,8 +1125,12 @@ void Pipeline::pipelineElementError( PlvErrorType type, PipelineElement* ple )
     QString msg = ple->getErrorString();
     handleMessage(qtType, msg);
 	
-	// stop the pipeline
-	stop();
+	// stop the pipeline, it might already be stopped by an earlier error
+	if( isRunning() )
+	{
+		stop();
+	}
+	emit pipelineError(type, ple);
 }
 
 void Pipeline::handleMessage(PlvMessageType type, const QString& msg)
@@ -31,8 +31,11 @@
 #include <algorithm>
 #include <opencv/cv.h>
 
+#include "Clock.h"
 #include "Pipeline.h"
+#include "ProcessingContext.h"
 #include "RefCounted.h"
+#include "Tracer.h"
 
 using namespace plv;
 
@@ -44,6 +47,10 @@ PipelineElement::PipelineElement() :
         m_errorType(PlvNoError),
         m_errorString(""),
         m_serial(0),
+        m_captureTime(0),
+        m_reentrant(false),
+        m_inPlace(false),
+        m_pipeline(0),
         m_propertyMutex( new QMutex( QMutex::Recursive ) )
 {
 }
@@ -81,12 +88,45 @@ void PipelineElement::setProcessingSerial( unsigned int serial )
     m_serial = serial;
 }
 
+void PipelineElement::setCaptureTime( qint64 timestamp )
+{
+    m_captureTime = timestamp;
+}
+
+qint64 PipelineElement::getCaptureTime() const
+{
+    if( m_reentrant )
+    {
+        ProcessingContext* context = getProcessingContext();
+        if( context != 0 )
+            return context->getCaptureTime();
+    }
+    return m_captureTime;
+}
+
 /** returs the serial number of the current process call */
 unsigned int PipelineElement::getProcessingSerial() const
 {
+    if( m_reentrant )
+    {
+        ProcessingContext* context = getProcessingContext();
+        if( context != 0 )
+            return context->getSerial();
+    }
     return m_serial;
 }
 
+ProcessingContext* PipelineElement::getProcessingContext() const
+{
+    if( !m_reentrant )
+        return 0;
+
+    ProcessingContext* context = ProcessingContext::current();
+    if( context != 0 && context->getElement() == this )
+        return context;
+    return 0;
+}
+
 QString PipelineElement::getName() const
 {
     QString name = this->getClassProperty("name");
@@ -133,6 +173,7 @@ void PipelineElement::setProperty(const char *name, const QVariant &value)
 
 void PipelineElement::setError( PlvErrorType type, const QString& msg )
 {
+    m_metrics.errorOccurred();
     setState(PLE_ERROR);
 
     QMutexLocker lock( &m_pleMutex );
@@ -159,11 +200,25 @@ void PipelineElement::startTimer()
 
 void PipelineElement::stopTimer()
 {
-    int elapsed = m_timer.elapsed();
+    updateProcessingTime( m_timer.elapsed() );
+}
+
+void PipelineElement::updateProcessingTime( int elapsed )
+{
+    QMutexLocker lock( &m_pleMutex );
     m_avgProcessingTime = m_avgProcessingTime > 0 ?
                           elapsed * 0.01f + m_avgProcessingTime * 0.99f : elapsed;
     m_lastProcesingTime = elapsed;
-    emit onProcessingTimeUpdate((int)m_avgProcessingTime, elapsed);
+    int avg = (int)m_avgProcessingTime;
+    lock.unlock();
+
+    emit onProcessingTimeUpdate(avg, elapsed);
+}
+
+void PipelineElement::frameFinished( qint64 captureTime )
+{
+    if( m_pipeline != 0 && captureTime != 0 )
+        m_pipeline->recordLatency( this, Clock::now() - captureTime );
 }
 
 PipelineElement::State PipelineElement::getState()
@@ -205,6 +260,9 @@ bool PipelineElement::__deinit() throw()
     m_avgProcessingTime = 0;
     m_lastProcesingTime = 0;
     m_serial = 0;
+    m_captureTime = 0;
+    m_reentrant = false;
+    m_inPlace = false;
     m_errorType = PlvNoError;
     m_errorString = "";
     return true;
@@ -234,17 +292,28 @@ bool PipelineElement::__stop()
     return true;
 }
 
-bool PipelineElement::run( unsigned int serial )
+/** milliseconds passed since start, a Clock::now() value */
+static inline int elapsedMillis( qint64 start )
 {
-    assert(getState() == PLE_DISPATCHED);
+    return static_cast<int>( (Clock::now() - start) / 1000000 );
+}
+
+bool PipelineElement::run( unsigned int serial, qint64 enqueued, qint64 dispatched )
+{
+    // reentrant elements can run several times at once, their
+    // state only changes on error
+    bool reentrant = isReentrant();
+    assert( reentrant || getState() == PLE_DISPATCHED );
 
     bool retval = false;
 
     //qDebug() << "PipelineElement::run for object " << this->getName()
     //         << " running in thread " << QThread::currentThread();
 
-    setState(PLE_RUNNING);
-    startTimer();
+    if( !reentrant ) setState(PLE_RUNNING);
+
+    // a local start time, concurrent invocations can not share one
+    qint64 start = Clock::now();
     try
     {
         // calls implementation (producer or procesor) specific private __process method
@@ -256,7 +325,7 @@ bool PipelineElement::run( unsigned int serial )
                  << " of file " << re.getFileName()
                  << " on line " << re.getLineNumber()
                  << " of type PlvRuntimeException with message: " << re.what();
-        stopTimer();
+        updateProcessingTime( elapsedMillis( start ) );
         setError(PlvPipelineRuntimeError, re.what());
         return false;
     }
@@ -264,7 +333,7 @@ bool PipelineElement::run( unsigned int serial )
     {
         qWarning() << "Uncaught exception in PipelineElement::process()"
                    << "of type PlvException with message: " << e.what();
-        stopTimer();
+        updateProcessingTime( elapsedMillis( start ) );
         setError(PlvPipelineRuntimeError, e.what());
         return false;
     }
@@ -272,7 +341,7 @@ bool PipelineElement::run( unsigned int serial )
     {
         qWarning() << "Uncaught exception in PipelineElement::process()"
                  << "of type cv::Exception with message: " << e.what();
-        stopTimer();
+        updateProcessingTime( elapsedMillis( start ) );
         setError(PlvPipelineRuntimeError, e.what());
         return false;
     }
@@ -280,7 +349,7 @@ bool PipelineElement::run( unsigned int serial )
     {
         qWarning() << "Uncaught exception in PipelineElement::process()"
                  << "of type std::runtime_error with message: " << err.what();
-        stopTimer();
+        updateProcessingTime( elapsedMillis( start ) );
         setError(PlvPipelineRuntimeError, err.what());
         return false;
     }
@@ -288,15 +357,45 @@ bool PipelineElement::run( unsigned int serial )
     {
         qWarning() << "Uncaught exception in PipelineElement::process()"
                    << "of unknown type.";
-        stopTimer();
+        updateProcessingTime( elapsedMillis( start ) );
         setError(PlvPipelineRuntimeError, "Unknown exception caught");
         return false;
     }
-    stopTimer();
+    qint64 finish = Clock::now();
+    updateProcessingTime( static_cast<int>( (finish - start) / 1000000 ) );
 
-    if (getState() != PLE_ERROR)
+    m_metrics.frameProcessed();
+    m_metrics.processingTime( finish - start );
+    if( enqueued != 0 )
+        m_metrics.readyWait( start - enqueued );
+
+    RunTimes times;
+    times.serial     = serial;
+    times.enqueued   = enqueued != 0 ? enqueued : start;
+    times.dispatched = dispatched != 0 ? dispatched : start;
+    times.started    = start;
+    times.finished   = finish;
+
+    QMutexLocker lock( &m_runTimesMutex );
+    m_lastRunTimes = times;
+    lock.unlock();
+
+    ProcessingObserver* observer = m_pipeline != 0 ? m_pipeline->getProcessingObserver() : 0;
+    if( observer != 0 )
+        observer->elementProcessed( this, serial, start, finish );
+
+    if( Tracer::isEnabled() )
+        Tracer::span( this, serial, start, finish );
+
+    if (!reentrant && getState() != PLE_ERROR)
     {
         setState(PLE_DONE);
     }
     return retval;
 }
+
+RunTimes PipelineElement::getLastRunTimes() const
+{
+    QMutexLocker lock( &m_runTimesMutex );
+    return m_lastRunTimes;
+}
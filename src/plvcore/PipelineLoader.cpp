@@ -33,6 +33,7 @@
 #include <QMetaProperty>
 #include <QStringBuilder>
 #include <QDateTime>
+#include <QDebug>
 #include <QUrl>
 
 using namespace plv;
@@ -182,6 +183,15 @@ QString PipelineLoader::serialize( Pipeline* pl )
 
         xmlSourcePinId.appendChild( xmlSourcePinIdText );
         xmlSourceId.appendChild( xmlSourceIdText );
+
+        QDomElement xmlCapacity = doc.createElement( "capacity" );
+        xmlConnection.appendChild( xmlCapacity );
+        xmlCapacity.appendChild( doc.createTextNode( QString::number( connection->getCapacity() ) ) );
+
+        QDomElement xmlPolicy = doc.createElement( "policy" );
+        xmlConnection.appendChild( xmlPolicy );
+        QString policy = PinConnection::overflowPolicyToString( connection->getOverflowPolicy() );
+        xmlPolicy.appendChild( doc.createTextNode( policy ) );
     }
     return doc.toString();
 }
@@ -287,33 +297,15 @@ void PipelineLoader::parseElements( QDomNodeList* list, Pipeline* pipeline )
                 QString propNameXml = element.nodeName();
                 QString propValueXml = element.text();
 
-                // convert the data to a known QVariant datatype
-                // if the property is unknown it will add the property
-                // as string
-
-                const QMetaObject* metaObject = ple->metaObject();
-                int index = metaObject->indexOfProperty( propNameXml.toAscii() );
-                QMetaProperty property = metaObject->property(index);
-                QVariant propValue;
-                if( property.type() == QVariant::UserType )
+                if( !setElementProperty( ple, propNameXml, propValueXml ) )
                 {
-                    propValue = ple->property( propNameXml.toAscii() );
-                    if( propValue.canConvert<plv::Enum>() )
-                    {
-                        plv::Enum e = propValue.value<plv::Enum>();
-                        e.setSelected( propValueXml );
-                        propValue.setValue( e );
-
-                    }
+                    qWarning() << "Ignoring unknown property " << propNameXml
+                               << " of element " << ple->getName();
+                    continue;
                 }
-                else
-                {
-                    propValue = convertData( property.type(), propValueXml );
-                }
-                ple->setProperty( propNameXml.toAscii(), propValue );
 
                 qDebug()<< "Found property with name: " << propNameXml
-                        << " and value: " << propValue;
+                        << " and value: " << ple->property( propNameXml.toAscii() );
 
             }
         }
@@ -415,8 +407,66 @@ void PipelineLoader::parseConnections( QDomNodeList* list, Pipeline* pipeline )
         {
             throw std::runtime_error( tr("Cannot connect pins because : %1").arg(errstr).toStdString() );
         }
-        pipeline->connectPins( iop, iip );
+        int id = pipeline->connectPins( iop, iip );
+
+        // optional queue settings, older files do not have these
+        PinConnection* connection = pipeline->getConnection( id );
+        QDomElement capacityNode = connectionNode.firstChildElement( "capacity" );
+        if( !capacityNode.isNull() )
+        {
+            bool ok;
+            int capacity = capacityNode.text().toInt( &ok );
+            if( !ok || capacity < 0 )
+            {
+                QString msg = tr("Invalid connection capacity %1").arg(capacityNode.text());
+                throw std::runtime_error( msg.toStdString() );
+            }
+            connection->setCapacity( capacity );
+        }
+
+        QDomElement policyNode = connectionNode.firstChildElement( "policy" );
+        if( !policyNode.isNull() )
+        {
+            PinConnection::OverflowPolicy policy;
+            if( !PinConnection::overflowPolicyFromString( policyNode.text(), policy ) )
+            {
+                QString msg = tr("Invalid connection policy %1").arg(policyNode.text());
+                throw std::runtime_error( msg.toStdString() );
+            }
+            connection->setOverflowPolicy( policy );
+        }
+    }
+}
+
+bool PipelineLoader::setElementProperty( PipelineElement* ple,
+                                         const QString& name,
+                                         const QString& value )
+{
+    // convert the data to the QVariant datatype of the property,
+    // unknown properties are not set at all
+    const QMetaObject* metaObject = ple->metaObject();
+    int index = metaObject->indexOfProperty( name.toAscii() );
+    if( index < 0 )
+        return false;
+
+    QMetaProperty property = metaObject->property(index);
+    QVariant propValue;
+    if( property.type() == QVariant::UserType )
+    {
+        propValue = ple->property( name.toAscii() );
+        if( propValue.canConvert<plv::Enum>() )
+        {
+            plv::Enum e = propValue.value<plv::Enum>();
+            e.setSelected( value );
+            propValue.setValue( e );
+        }
+    }
+    else
+    {
+        propValue = convertData( property.type(), value );
     }
+    ple->setProperty( name.toAscii(), propValue );
+    return true;
 }
 
 int PipelineLoader::propertyIndex( QObject* qobject, const QString& name )
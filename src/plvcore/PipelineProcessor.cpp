@@ -22,6 +22,7 @@
 #include "PipelineProcessor.h"
 #include "Pin.h"
 #include "Pipeline.h"
+#include "ProcessingContext.h"
 
 using namespace plv;
 
@@ -49,9 +50,65 @@ bool PipelineProcessor::requiredPinsConnected() const
 bool PipelineProcessor::__init()
 {
     this->initInputPins();
+
+    m_reentrant = getClassProperty("reentrant") == "true";
+    if( m_reentrant && m_hasAsynchronousPin )
+    {
+        // asynchronous input can not be taken in advance
+        qWarning() << tr("Processor %1 is reentrant but has asynchronous "
+                         "input connections, running it non reentrant.")
+                      .arg(this->getName());
+        m_reentrant = false;
+    }
+
+    m_inPlace = getClassProperty("inPlace") == "true";
     return PipelineElement::__init();
 }
 
+bool PipelineProcessor::__deinit() throw()
+{
+    // drop the contexts of invocations which never finished,
+    // for instance because the pipeline stopped on an error
+    QMutexLocker lock( &m_contextsMutex );
+    qDeleteAll( m_contexts );
+    m_contexts.clear();
+    lock.unlock();
+
+    return PipelineElement::__deinit();
+}
+
+void PipelineProcessor::__prepare( unsigned int serial )
+{
+    assert( m_reentrant );
+
+    ProcessingContext* context = new ProcessingContext( this, serial );
+
+    QMutexLocker lock( &m_pleMutex );
+    setProcessingSerial( serial );
+
+    // take the data for this serial from all connected pins,
+    // which are all synchronous for reentrant processors
+    for( InputPinMap::iterator itr = m_inputPins.begin();
+         itr != m_inputPins.end(); ++itr )
+    {
+        IInputPin* in = itr.value().getPtr();
+        if( in->isConnected() )
+        {
+            Data d = in->getConnection()->get();
+            assert( d.getSerial() == serial );
+            context->mergeCaptureTime( d.getTimestamp() );
+            if( d.isNull() )
+                context->setNull( true );
+            else
+                context->setInput( in, d.getPayload() );
+        }
+    }
+    lock.unlock();
+
+    QMutexLocker contextsLock( &m_contextsMutex );
+    m_contexts.enqueue( context );
+}
+
 bool PipelineProcessor::__ready( unsigned int& serial )
 {
     if( getState() >= PLE_DISPATCHED )
@@ -65,6 +122,9 @@ bool PipelineProcessor::__ready( unsigned int& serial )
 
 bool PipelineProcessor::__process( unsigned int serial )
 {
+    if( m_reentrant )
+        return processReentrant( serial );
+
     assert( requiredPinsConnected() );
     assert( getState() == PLE_RUNNING );
 
@@ -99,6 +159,7 @@ bool PipelineProcessor::__process( unsigned int serial )
         // call post on output pins to propagate NULL down pipeline
         this->preOutput();
         this->postOutput();
+        getMetrics().nullFramePropagated();
         return true;
     }
 
@@ -128,6 +189,9 @@ bool PipelineProcessor::__process( unsigned int serial )
         qWarning() << msg;
     }
 
+    if( retval )
+        frameFinished( getCaptureTime() );
+
     processingSerial = getProcessingSerial();
     msg = QString("__process end => PipelineProcessor(%3):serial: %1 processing serial: %2").arg(serial).arg(processingSerial).arg(this->getName());
     qDebug() << msg;
@@ -136,4 +200,91 @@ bool PipelineProcessor::__process( unsigned int serial )
     return retval;
 }
 
+bool PipelineProcessor::processReentrant( unsigned int serial )
+{
+    ProcessingContext* context = 0;
+
+    QMutexLocker contextsLock( &m_contextsMutex );
+    foreach( ProcessingContext* c, m_contexts )
+    {
+        if( c->getSerial() == serial && !c->isDone() )
+        {
+            context = c;
+            break;
+        }
+    }
+    contextsLock.unlock();
+    assert( context != 0 );
+
+    // a NULL input results in NULL output on all pins
+    if( context->isNull() )
+    {
+        finishContext( context );
+        getMetrics().nullFramePropagated();
+        return true;
+    }
+
+    // the property mutex is not held during process() like it is for
+    // normal processors since that would serialize all invocations
+    bool retval = false;
+    ProcessingContext::setCurrent( context );
+    try
+    {
+        retval = this->process();
+    }
+    catch( ... )
+    {
+        ProcessingContext::setCurrent( 0 );
+        finishContext( context );
+        throw;
+    }
+    ProcessingContext::setCurrent( 0 );
+
+    // the context is deleted once its output is published
+    qint64 captureTime = context->getCaptureTime();
+    finishContext( context );
+
+    if( retval )
+        frameFinished( captureTime );
+
+    if(!retval && getState() != PLE_ERROR)
+    {
+        QString msg = tr("Method process() on PipelineProcessor %1 returned false "
+                         "but error state was not set.").arg(this->getName());
+        qWarning() << msg;
+    }
+    return retval;
+}
+
+void PipelineProcessor::finishContext( ProcessingContext* context )
+{
+    QMutexLocker lock( &m_contextsMutex );
+    context->setDone( true );
+
+    // put the output of all finished invocations
+    // which are next in line on the connections
+    while( !m_contexts.isEmpty() && m_contexts.head()->isDone() )
+    {
+        ProcessingContext* head = m_contexts.dequeue();
+        unsigned int serial = head->getSerial();
 
+        QSet<IOutputPin*> published;
+        typedef QPair<IOutputPin*, QVariant> Output;
+        foreach( const Output& output, head->getOutputs() )
+        {
+            output.first->publish( serial, head->getCaptureTime(), output.second );
+            published.insert( output.first );
+        }
+
+        // propagate NULL on the pins without output
+        const OutputPinMap& outputPins = getOutputPins();
+        for( OutputPinMap::const_iterator itr = outputPins.begin();
+             itr != outputPins.end(); ++itr )
+        {
+            IOutputPin* out = itr.value().getPtr();
+            if( !published.contains(out) && out->isConnected() )
+                out->publishNull( serial, head->getCaptureTime() );
+        }
+        delete head;
+    }
+}
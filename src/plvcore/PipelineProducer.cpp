@@ -21,6 +21,8 @@
 
 #include "PipelineProducer.h"
 #include "Pin.h"
+#include "Pipeline.h"
+#include "Clock.h"
 
 using namespace plv;
 
@@ -38,6 +40,15 @@ bool PipelineProducer::requiredPinsConnected() const
     return true;
 }
 
+void PipelineProducer::notifyReadyToProduce()
+{
+    Pipeline* pipeline = getPipeline();
+    if( pipeline != 0 )
+    {
+        pipeline->wakeScheduler();
+    }
+}
+
 bool PipelineProducer::__ready( unsigned int& serial )
 {
     // serial ignored by producers
@@ -63,6 +74,9 @@ bool PipelineProducer::__process( unsigned int serial )
     // set the serial number for this processing run
     setProcessingSerial( serial );
 
+    // frames are timestamped when they enter the pipeline
+    setCaptureTime( Clock::now() );
+
     // call pre processing callback on all output pins
     this->preOutput();
 
@@ -76,6 +90,7 @@ bool PipelineProducer::__process( unsigned int serial )
 
     lock.unlock();
     if(!retval) setState(PLE_ERROR);
+    else frameFinished( getCaptureTime() );
 
     return retval;
 }
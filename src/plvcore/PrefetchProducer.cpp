@@ -0,0 +1,233 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "PrefetchProducer.h"
+
+#include <QDebug>
+
+#include "Clock.h"
+#include "IOutputPin.h"
+
+using namespace plv;
+
+PrefetchProducer::PrefetchProducer() :
+    m_fetchThread( this ),
+    m_prefetchDepth( PREFETCHPRODUCER_DEFAULT_DEPTH ),
+    m_stopRequested( false ),
+    m_fetchFailed( false ),
+    m_fetchErrorType( PlvNoError )
+{
+}
+
+PrefetchProducer::~PrefetchProducer()
+{
+    assert( !m_fetchThread.isRunning() );
+}
+
+int PrefetchProducer::getPrefetchDepth() const
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_prefetchDepth;
+}
+
+void PrefetchProducer::setPrefetchDepth( int depth )
+{
+    QMutexLocker lock( m_propertyMutex );
+    m_prefetchDepth = depth < 1 ? 1 : depth;
+    emit prefetchDepthChanged( m_prefetchDepth );
+}
+
+int PrefetchProducer::getPrefetchCount() const
+{
+    QMutexLocker lock( &m_prefetchMutex );
+    return m_prefetched.size();
+}
+
+bool PrefetchProducer::__start()
+{
+    if( !PipelineProducer::__start() )
+        return false;
+
+    // frames fetched before the last stop are produced first, the
+    // source has already moved past them. They enter the pipeline now
+    QMutexLocker lock( &m_prefetchMutex );
+    qint64 now = Clock::now();
+    for( int i=0; i < m_prefetched.size(); ++i )
+        m_prefetched[i].setCaptureTime( now );
+    m_stopRequested = false;
+    m_fetchFailed = false;
+    m_fetchErrorType = PlvNoError;
+    m_fetchErrorString.clear();
+    lock.unlock();
+
+    m_fetchThread.start();
+    return true;
+}
+
+bool PrefetchProducer::__stop()
+{
+    QMutexLocker lock( &m_prefetchMutex );
+    m_stopRequested = true;
+    m_prefetchSpace.wakeAll();
+    lock.unlock();
+    wakeFetch();
+
+    // fetch() is expected to return regularly. The fetched frames
+    // are kept for the next start
+    m_fetchThread.wait();
+
+    return PipelineProducer::__stop();
+}
+
+bool PrefetchProducer::__deinit() throw()
+{
+    // release the frames before the implementation closes the source
+    QMutexLocker lock( &m_prefetchMutex );
+    m_prefetched.clear();
+    lock.unlock();
+
+    return PipelineProducer::__deinit();
+}
+
+void PrefetchProducer::setFetchError( PlvErrorType type, const QString& msg )
+{
+    QMutexLocker lock( &m_prefetchMutex );
+    m_fetchErrorType = type;
+    m_fetchErrorString = msg;
+}
+
+bool PrefetchProducer::isStopRequested() const
+{
+    QMutexLocker lock( &m_prefetchMutex );
+    return m_stopRequested;
+}
+
+bool PrefetchProducer::sleepUnlessStopped( unsigned long msecs )
+{
+    qint64 deadline = Clock::now() + static_cast<qint64>( msecs ) * 1000000;
+
+    // the wait condition is also signalled when a frame is produced
+    QMutexLocker lock( &m_prefetchMutex );
+    qint64 now = Clock::now();
+    while( !m_stopRequested && now < deadline )
+    {
+        m_prefetchSpace.wait( &m_prefetchMutex, static_cast<unsigned long>( (deadline - now) / 1000000 + 1 ) );
+        now = Clock::now();
+    }
+    return !m_stopRequested;
+}
+
+void PrefetchProducer::flushPrefetched()
+{
+    QMutexLocker lock( &m_prefetchMutex );
+    m_prefetched.clear();
+}
+
+void PrefetchProducer::fetchLoop()
+{
+    int depth = getPrefetchDepth();
+
+    forever
+    {
+        // wait for room in the queue
+        QMutexLocker lock( &m_prefetchMutex );
+        while( m_prefetched.size() >= depth && !m_stopRequested )
+            m_prefetchSpace.wait( &m_prefetchMutex );
+
+        if( m_stopRequested )
+            return;
+        lock.unlock();
+
+        PrefetchFrame frame;
+        FetchResult result = this->fetch( frame );
+
+        switch( result )
+        {
+        case FETCH_FRAME:
+            if( frame.getCaptureTime() == 0 )
+                frame.setCaptureTime( Clock::now() );
+            lock.relock();
+            m_prefetched.enqueue( frame );
+            getMetrics().setReadAhead( m_prefetched.size() + getFetchAhead() );
+            lock.unlock();
+            notifyReadyToProduce();
+            break;
+        case FETCH_NONE:
+            break;
+        case FETCH_END:
+            qDebug() << getName() << "reached the end of its source";
+            return;
+        case FETCH_ERROR:
+            lock.relock();
+            m_fetchFailed = true;
+            if( m_fetchErrorType == PlvNoError )
+            {
+                m_fetchErrorType = PlvPipelineRuntimeError;
+                m_fetchErrorString = tr("Failed to fetch a frame");
+            }
+            lock.unlock();
+            notifyReadyToProduce();
+            return;
+        }
+    }
+}
+
+bool PrefetchProducer::readyToProduce() const
+{
+    QMutexLocker lock( &m_prefetchMutex );
+    return !m_prefetched.isEmpty() || m_fetchFailed;
+}
+
+bool PrefetchProducer::produce()
+{
+    QMutexLocker lock( &m_prefetchMutex );
+
+    // the queue can be flushed by a seek after readyToProduce()
+    // returned true, the pins will then produce NULL for this serial
+    if( m_prefetched.isEmpty() && !m_fetchFailed )
+        return true;
+
+    // frames fetched before the error are produced first
+    if( m_prefetched.isEmpty() )
+    {
+        PlvErrorType type = m_fetchErrorType;
+        QString msg = m_fetchErrorString;
+        lock.unlock();
+        setError( type, msg );
+        return false;
+    }
+
+    PrefetchFrame frame = m_prefetched.dequeue();
+    getMetrics().setReadAhead( m_prefetched.size() + getFetchAhead() );
+    m_prefetchSpace.wakeOne();
+    lock.unlock();
+
+    // the frame entered the pipeline when it was fetched
+    setCaptureTime( frame.getCaptureTime() );
+
+    unsigned int serial = getProcessingSerial();
+    typedef QPair<IOutputPin*, QVariant> Output;
+    foreach( const Output& output, frame.getOutputs() )
+    {
+        output.first->putVariant( serial, output.second );
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "ProcessingContext.h"
+
+#include <QThreadStorage>
+
+using namespace plv;
+
+/** QThreadStorage deletes the data it holds when it is replaced,
+    so the context pointer is kept in a per thread slot */
+static QThreadStorage<ProcessingContext**> s_currentContext;
+
+ProcessingContext::ProcessingContext( PipelineElement* element, unsigned int serial ) :
+    m_element( element ),
+    m_serial( serial ),
+    m_captureTime( 0 ),
+    m_null( false ),
+    m_done( false )
+{
+}
+
+ProcessingContext::~ProcessingContext()
+{
+}
+
+void ProcessingContext::mergeCaptureTime( qint64 timestamp )
+{
+    // keep the oldest frame, 0 means unknown
+    if( timestamp != 0 && (m_captureTime == 0 || timestamp < m_captureTime) )
+        m_captureTime = timestamp;
+}
+
+void ProcessingContext::setInput( const IInputPin* pin, const QVariant& v )
+{
+    m_inputs.insert( pin, v );
+}
+
+QVariant ProcessingContext::getInput( const IInputPin* pin ) const
+{
+    return m_inputs.value( pin );
+}
+
+QVariant ProcessingContext::takeInput( const IInputPin* pin )
+{
+    return m_inputs.take( pin );
+}
+
+bool ProcessingContext::hasInput( const IInputPin* pin ) const
+{
+    return m_inputs.contains( pin );
+}
+
+void ProcessingContext::addOutput( IOutputPin* pin, const QVariant& v )
+{
+    m_outputs.append( qMakePair( pin, v ) );
+}
+
+ProcessingContext* ProcessingContext::current()
+{
+    if( !s_currentContext.hasLocalData() )
+        return 0;
+    return *s_currentContext.localData();
+}
+
+void ProcessingContext::setCurrent( ProcessingContext* context )
+{
+    if( !s_currentContext.hasLocalData() )
+    {
+        s_currentContext.setLocalData( new ProcessingContext*(0) );
+    }
+    *s_currentContext.localData() = context;
+}
@@ -31,11 +31,12 @@ RefCounted::RefCounted() :
 
 RefCounted::~RefCounted()
 {
-    if(m_referenceCount > 0)
+    int count = m_referenceCount;
+    if(count > 0)
     {
         qWarning()  << "Destructor called on RefCounted object still in use "
                     << "(reference count = "
-                    << m_referenceCount
+                    << count
                     << ").";
     }
 }
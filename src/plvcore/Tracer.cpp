@@ -0,0 +1,300 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvcore module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "Tracer.h"
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadStorage>
+#include <QAtomicInt>
+
+#include "Clock.h"
+#include "PipelineElement.h"
+#include "Util.h"
+
+using namespace plv;
+
+volatile int Tracer::s_enabled = 0;
+
+namespace
+{
+    enum TraceEventType
+    {
+        TRACE_SPAN,
+        TRACE_INSTANT,
+        TRACE_COUNTER
+    };
+
+    struct TraceEvent
+    {
+        TraceEventType type;
+        const char* name;
+        int elementId;
+        unsigned int serial;
+        qint64 start;
+        qint64 end;
+        double value;
+    };
+
+    /** Events of a single thread. Only the owning thread writes, the
+        count is published with release semantics after an event is
+        complete so a reader never sees a partially written event. */
+    struct TraceBuffer
+    {
+        TraceBuffer( int tid, const QString& name ) :
+            m_tid( tid ), m_name( name ), m_events( new TraceEvent[TRACER_EVENTS_PER_THREAD] )
+        {
+            m_count = 0;
+            m_dropped = 0;
+        }
+
+        ~TraceBuffer() { delete[] m_events; }
+
+        inline TraceEvent* next()
+        {
+            int count = m_count;
+            if( count >= TRACER_EVENTS_PER_THREAD )
+            {
+                m_dropped.ref();
+                return 0;
+            }
+            return &m_events[count];
+        }
+
+        inline void commit() { m_count.fetchAndAddRelease( 1 ); }
+
+        int m_tid;
+        QString m_name;
+        TraceEvent* m_events;
+        QAtomicInt m_count;
+        QAtomicInt m_dropped;
+    };
+
+    /** per thread pointer to its buffer. The generation is used to detect
+        buffers which have been discarded by Tracer::start() */
+    struct TraceSlot
+    {
+        TraceBuffer* buffer;
+        int generation;
+    };
+
+    struct TraceRegistry
+    {
+        TraceRegistry() : generation( 0 ) {}
+        ~TraceRegistry() { qDeleteAll( buffers ); }
+
+        QMutex mutex;
+        QList<TraceBuffer*> buffers;
+        QHash<int, QString> names;
+        int generation;
+    };
+}
+
+Q_GLOBAL_STATIC( TraceRegistry, s_registry )
+
+/** QThreadStorage deletes the data it holds when the thread exits but
+    buffers have to outlive the worker threads, so only the slot is owned */
+static QThreadStorage<TraceSlot*> s_slot;
+
+static TraceBuffer* currentBuffer()
+{
+    TraceRegistry* registry = s_registry();
+    TraceSlot* slot = s_slot.localData();
+
+    // generation is only written by start() when nobody is recording
+    if( slot != 0 && slot->generation == registry->generation )
+        return slot->buffer;
+
+    if( slot == 0 )
+    {
+        slot = new TraceSlot;
+        s_slot.setLocalData( slot );
+    }
+
+    QMutexLocker lock( &registry->mutex );
+    QString name = QThread::currentThread()->objectName();
+    if( name.isEmpty() )
+        name = QString("thread %1").arg( registry->buffers.size() );
+
+    slot->buffer = new TraceBuffer( registry->buffers.size() + 1, name );
+    slot->generation = registry->generation;
+    registry->buffers.append( slot->buffer );
+    return slot->buffer;
+}
+
+void Tracer::start()
+{
+    TraceRegistry* registry = s_registry();
+    QMutexLocker lock( &registry->mutex );
+    s_enabled = 0;
+    qDeleteAll( registry->buffers );
+    registry->buffers.clear();
+    ++registry->generation;
+    s_enabled = 1;
+}
+
+void Tracer::stop()
+{
+    s_enabled = 0;
+}
+
+void Tracer::nameElement( int id, const QString& name )
+{
+    TraceRegistry* registry = s_registry();
+    QMutexLocker lock( &registry->mutex );
+    registry->names.insert( id, name );
+}
+
+void Tracer::span( const PipelineElement* element, unsigned int serial,
+                   qint64 start, qint64 end )
+{
+    TraceBuffer* buffer = currentBuffer();
+    TraceEvent* event = buffer->next();
+    if( event == 0 )
+        return;
+
+    event->type      = TRACE_SPAN;
+    event->name      = 0;
+    event->elementId = element->getId();
+    event->serial    = serial;
+    event->start     = start;
+    event->end       = end;
+    event->value     = 0.0;
+    buffer->commit();
+}
+
+void Tracer::instant( const char* name, const PipelineElement* element,
+                      unsigned int serial )
+{
+    TraceBuffer* buffer = currentBuffer();
+    TraceEvent* event = buffer->next();
+    if( event == 0 )
+        return;
+
+    event->type      = TRACE_INSTANT;
+    event->name      = name;
+    event->elementId = element != 0 ? element->getId() : -1;
+    event->serial    = serial;
+    event->start     = Clock::now();
+    event->end       = event->start;
+    event->value     = 0.0;
+    buffer->commit();
+}
+
+void Tracer::counter( const char* name, double value )
+{
+    TraceBuffer* buffer = currentBuffer();
+    TraceEvent* event = buffer->next();
+    if( event == 0 )
+        return;
+
+    event->type      = TRACE_COUNTER;
+    event->name      = name;
+    event->elementId = -1;
+    event->serial    = 0;
+    event->start     = Clock::now();
+    event->end       = event->start;
+    event->value     = value;
+    buffer->commit();
+}
+
+int Tracer::getDropCount()
+{
+    TraceRegistry* registry = s_registry();
+    QMutexLocker lock( &registry->mutex );
+    int dropped = 0;
+    foreach( TraceBuffer* buffer, registry->buffers )
+        dropped += buffer->m_dropped;
+    return dropped;
+}
+
+/** Trace Event timestamps are in microseconds */
+static QString micros( qint64 ns )
+{
+    return QString::number( ns / 1000.0, 'f', 3 );
+}
+
+bool Tracer::write( QIODevice* device )
+{
+    TraceRegistry* registry = s_registry();
+    QMutexLocker lock( &registry->mutex );
+
+    QTextStream out( device );
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    foreach( TraceBuffer* buffer, registry->buffers )
+    {
+        out << (first ? "" : ",")
+            << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->m_tid
+            << ",\"args\":{\"name\":\"" << Util::jsonEscape( buffer->m_name ) << "\"}}";
+        first = false;
+
+        int count = buffer->m_count.fetchAndAddAcquire( 0 );
+        for( int i=0; i < count; ++i )
+        {
+            const TraceEvent& event = buffer->m_events[i];
+            out << ",\n{\"pid\":1,\"tid\":" << buffer->m_tid
+                << ",\"ts\":" << micros( event.start );
+
+            QString element;
+            if( event.elementId != -1 )
+            {
+                element = registry->names.value( event.elementId,
+                                                 QString("element %1").arg( event.elementId ) );
+            }
+
+            switch( event.type )
+            {
+            case TRACE_SPAN:
+                out << ",\"ph\":\"X\",\"cat\":\"element\",\"name\":\"" << Util::jsonEscape( element ) << "\""
+                    << ",\"dur\":" << micros( event.end - event.start )
+                    << ",\"args\":{\"id\":" << event.elementId << ",\"serial\":" << event.serial << "}}";
+                break;
+            case TRACE_INSTANT:
+                out << ",\"ph\":\"i\",\"s\":\"t\",\"cat\":\"scheduler\",\"name\":\"" << event.name << "\""
+                    << ",\"args\":{\"element\":\"" << Util::jsonEscape( element ) << "\""
+                    << ",\"serial\":" << event.serial << "}}";
+                break;
+            case TRACE_COUNTER:
+                out << ",\"ph\":\"C\",\"name\":\"" << event.name << "\""
+                    << ",\"args\":{\"" << event.name << "\":" << event.value << "}}";
+                break;
+            }
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+bool Tracer::write( const QString& filename )
+{
+    QFile file( filename );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+        return false;
+    return write( &file );
+}
@@ -40,6 +40,22 @@ QString Util::m_buildInformation = QString("[%1 %2][%3 %4.%5 %6]")
         .arg( m_compilerVersionMinor )
         .arg( m_buildType );
 
+QString Util::jsonEscape( const QString& str )
+{
+    QString escaped;
+    escaped.reserve( str.size() );
+    foreach( QChar c, str )
+    {
+        if( c == '"' || c == '\\' )
+            escaped.append( '\\' ).append( c );
+        else if( c.unicode() < 0x20 )
+            escaped.append( QString("\\u%1").arg( c.unicode(), 4, 16, QChar('0') ) );
+        else
+            escaped.append( c );
+    }
+    return escaped;
+}
+
 void Util::addDefaultBorderInterpolationTypes( plv::Enum& e )
 {
     e.add( "default", cv::BORDER_DEFAULT );
@@ -6,6 +6,11 @@ DEPENDPATH +=   .\
                 ..
 
 include (../../common.pri)
+
+# Clock uses QElapsedTimer::nsecsElapsed, which appeared in Qt 4.8
+equals(QT_MAJOR_VERSION, 4):lessThan(QT_MINOR_VERSION, 8) {
+    error("ParleVision requires Qt 4.8 or later")
+}
 macx {
     
     # Make sure there is no mess in ./
@@ -28,6 +33,7 @@ CONFIG(debug, debug|release):DEFINES += DEBUG
 QT += core
 QT -= gui
 QT += xml
+QT += network
 
 #to include qxt project
 CONFIG  += qxt
@@ -64,7 +70,15 @@ SOURCES += \
     OutputPin.cpp \
     IInputPin.cpp \
     IOutputPin.cpp \
-    DynamicInputPin.cpp
+    DynamicInputPin.cpp \
+    Executor.cpp \
+    ProcessingContext.cpp \
+    Clock.cpp \
+    LatencyHistogram.cpp \
+    Tracer.cpp \
+    Metrics.cpp \
+    MetricsServer.cpp \
+    PrefetchProducer.cpp
 
 HEADERS += ../../include/plvcore/plvglobal.h \
     ../../include/plvcore/Application.h \
@@ -92,5 +106,14 @@ HEADERS += ../../include/plvcore/plvglobal.h \
     ../../include/plvcore/IOutputPin.h \
     ../../include/plvcore/IInputPin.h \
     ../../include/plvcore/DynamicInputPin.h \
+    ../../include/plvcore/Executor.h \
+    ../../include/plvcore/ProcessingContext.h \
+    ../../include/plvcore/Clock.h \
+    ../../include/plvcore/ProcessingObserver.h \
+    ../../include/plvcore/LatencyHistogram.h \
+    ../../include/plvcore/Tracer.h \
+    ../../include/plvcore/Metrics.h \
+    ../../include/plvcore/MetricsServer.h \
+    ../../include/plvcore/PrefetchProducer.h \
 
 
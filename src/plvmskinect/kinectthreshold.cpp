@@ -56,7 +56,7 @@ bool KinectThreshold::process()
     CvMatData in = m_inputPin->get();
     CvMatData out = CvMatData::create( in.width(), in.height(), in.type() );
 
-    const cv::Mat& src = in;
+    const cv::Mat& src = in.getReadOnly();
     cv::Mat& dst = out;
 
     // perform threshold operation on the image
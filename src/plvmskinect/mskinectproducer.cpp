@@ -141,6 +141,9 @@ void MSKinectProducer::newDepthFrame( int deviceIndex, plv::CvMatData depth )
     QMutexLocker lock( &m_kinectProducerMutex );
     assert( deviceIndex > -1 && deviceIndex < m_deviceCount );
     m_depthFrames[deviceIndex] = depth;
+    lock.unlock();
+
+    notifyReadyToProduce();
 }
 
 void MSKinectProducer::newVideoFrame( int deviceIndex, plv::CvMatData video )
@@ -148,6 +151,9 @@ void MSKinectProducer::newVideoFrame( int deviceIndex, plv::CvMatData video )
     QMutexLocker lock( &m_kinectProducerMutex );
     assert( deviceIndex > -1 && deviceIndex < m_deviceCount );
     m_videoFrames[deviceIndex] = video;
+    lock.unlock();
+
+    notifyReadyToProduce();
 }
 
 void MSKinectProducer::newSkeletonFrame( int deviceIndex, plvmskinect::SkeletonFrame frame )
@@ -85,8 +85,8 @@ bool Add::process()
 
     CvMatData out = CvMatData::create(in1.properties());
 
-    const cv::Mat& src1 = in1;
-    const cv::Mat& src2 = in2;
+    const cv::Mat& src1 = in1.getReadOnly();
+    const cv::Mat& src2 = in2.getReadOnly();
     cv::Mat& dst = out;
 
     // does a weighted add
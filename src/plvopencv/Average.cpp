@@ -67,7 +67,7 @@ bool Average::process()
     }
 
     CvMatData in = m_inputPin->get();
-    const cv::Mat& src = in;
+    const cv::Mat& src = in.getReadOnly();
 
     if( m_avg.width() != in.width() || m_avg.height() != in.height() || m_avg.channels() != in.channels() )
     {
@@ -81,6 +81,8 @@ bool Average::process()
 
     if( m_total >= m_numFrames )
     {
+        // new buffer, downstream elements may still be using the previous output
+        m_out = CvMatData::create( in.width(), in.height(), CV_8U, in.channels() );
         avg.convertTo(m_out, m_out.type(), 1.0 / m_total );
         m_outputPin->put(m_out);
 
@@ -74,6 +74,9 @@ void CameraProducer::newFrame( plv::CvMatData frame )
     m_frames.append(frame);
     if( m_frames.size() > m_maxBufferSize )
         m_frames.removeFirst();
+    lock.unlock();
+
+    notifyReadyToProduce();
 }
 
 bool CameraProducer::init()
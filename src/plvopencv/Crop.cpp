@@ -52,7 +52,7 @@ bool CropImage::process()
     CvMatData img = m_in->get();
 
     // open input image for reading
-    const cv::Mat& mat = img;
+    const cv::Mat& mat = img.getReadOnly();
 
     if( m_x1 + m_x2 >= img.width() || m_y1 + m_y2 >= img.height() )
     {
@@ -51,7 +51,7 @@ bool CropSubImage::process()
     RectangleData data = m_regions->get();
 
     // open input image for reading
-    const cv::Mat& in = img;
+    const cv::Mat& in = img.getReadOnly();
 
     QList<CvMatData> subregions;
     QList<QRect> rects = data.getRects();
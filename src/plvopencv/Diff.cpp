@@ -58,8 +58,8 @@ bool Diff::process()
     //TODO check format of images
 
     // open input images for reading
-    const cv::Mat& in1 = img1;
-    const cv::Mat& in2 = img2;
+    const cv::Mat& in1 = img1.getReadOnly();
+    const cv::Mat& in2 = img2.getReadOnly();
 
     //get a new output image of same depth and size as input image
     CvMatData imgOut = CvMatData::create( img1.properties() );
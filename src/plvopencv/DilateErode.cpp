@@ -56,8 +56,12 @@ DilateErode::~DilateErode()
 bool DilateErode::process()
 {
     CvMatData in = m_inputPin->get();
-    CvMatData out = CvMatData::create(in.properties());
-    CvMatData out2 = CvMatData::create(in.properties());
+    const cv::Mat& src = in.getReadOnly();
+
+    // reuses the input buffer when no one else needs it, the
+    // second operation always runs in place on the output
+    CvMatData out = CvMatData::createOutput( in, isInPlace() );
+    cv::Mat& dst = out;
 
     cv::Mat element;
     cv::Point point(-1,-1);
@@ -67,15 +71,15 @@ bool DilateErode::process()
     // first dilation, then erosion
     case BGDEO_ERODE_DELATE:
         // first erosion, then dilation
-        cv::erode(in, out, element, point, m_erosionIterations);
-        cv::dilate(out, out2, element, point, m_dilationIterations);
+        cv::erode(src, dst, element, point, m_erosionIterations);
+        cv::dilate(dst, dst, element, point, m_dilationIterations);
         break;
     case BGDEO_DELATE_ERODE:
-        cv::dilate(in, out, element, point, m_dilationIterations);
-        cv::erode(out, out2, element, point, m_erosionIterations);
+        cv::dilate(src, dst, element, point, m_dilationIterations);
+        cv::erode(dst, dst, element, point, m_erosionIterations);
         break;
     }
-    m_outputPin->put(out2);
+    m_outputPin->put(out);
     return true;
 }
 
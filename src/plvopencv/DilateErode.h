@@ -39,6 +39,7 @@ namespace plvopencv
         Q_DISABLE_COPY( DilateErode )
         Q_CLASSINFO("author", "Richard Loos");
         Q_CLASSINFO("name", "Dilate and/or Erode an image");
+        Q_CLASSINFO("inPlace", "true");
         Q_CLASSINFO("description", "Dilates and/or erodes an image");
 
         Q_PROPERTY( int erosionIterations READ getErosionIterations WRITE setErosionIterations NOTIFY erosionIterationsChanged )
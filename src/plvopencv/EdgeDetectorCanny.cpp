@@ -54,6 +54,15 @@ EdgeDetectorCanny::~EdgeDetectorCanny()
 
 bool EdgeDetectorCanny::process()
 {
+    // this processor is reentrant, copy the
+    // properties so they can not change halfway
+    QMutexLocker lock( m_propertyMutex );
+    double thresholdLow  = m_thresholdLow;
+    double thresholdHigh = m_thresholdHigh;
+    int apertureSize     = m_apertureSize;
+    bool l2Gradient      = m_l2Gradient;
+    lock.unlock();
+
     // get the source
     CvMatData in = m_inputPin->get();
 
@@ -61,14 +70,14 @@ bool EdgeDetectorCanny::process()
     CvMatData out = CvMatData::create( in.properties() );
 
     // open for reading
-    const cv::Mat& src = in;
+    const cv::Mat& src = in.getReadOnly();
 
     // open image for writing
     cv::Mat& edges = out;
 
     // do a canny edge detection operator of the image
     // the input should be grayscaled
-    cv::Canny( src, edges, m_thresholdLow, m_thresholdHigh, m_apertureSize, m_l2Gradient );
+    cv::Canny( src, edges, thresholdLow, thresholdHigh, apertureSize, l2Gradient );
 
     // publish the new image
     m_outputPin->put( out );
@@ -39,6 +39,7 @@ namespace plvopencv
         Q_DISABLE_COPY( EdgeDetectorCanny )
         Q_CLASSINFO("author", "Wim, Dennis, Richard")
         Q_CLASSINFO("name", "Canny edge detector")
+        Q_CLASSINFO("reentrant", "true")
         Q_CLASSINFO("description", "Edge detection using the Canny method. See "
                     "<a href='http://opencv.willowgarage.com/documentation/cpp/imgproc_feature_detection.html?highlight=canny#Canny'>"
                     "OpenCV reference"
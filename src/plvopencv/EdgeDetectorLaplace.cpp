@@ -66,7 +66,7 @@ bool EdgeDetectorLaplace::process()
     CvMatData dstPtr = CvMatData::create( props );
 
     // open for reading
-    const cv::Mat& src = srcPtr;
+    const cv::Mat& src = srcPtr.getReadOnly();
 
     // open for writing
     cv::Mat& dst = dstPtr;
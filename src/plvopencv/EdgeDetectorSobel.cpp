@@ -83,7 +83,7 @@ bool EdgeDetectorSobel::process()
     CvMatData dstPtr = CvMatData::create( srcPtr.properties() );
 
     // open for reading
-    const cv::Mat& src = srcPtr;
+    const cv::Mat& src = srcPtr.getReadOnly();
 
     // open image for writing
     cv::Mat& dst = dstPtr;
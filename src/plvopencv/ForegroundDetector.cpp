@@ -79,7 +79,7 @@ bool ForegroundDetector::stop()
 bool ForegroundDetector::process()
 {
     CvMatData in = m_inInput->get();
-    const cv::Mat& mat_in = in;
+    const cv::Mat& mat_in = in.getReadOnly();
 
     IplImage current_frame = mat_in;
 
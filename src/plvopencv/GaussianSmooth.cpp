@@ -54,13 +54,22 @@ GaussianSmooth::~GaussianSmooth()
 
 bool GaussianSmooth::process()
 {
+    // this processor is reentrant, copy the
+    // properties so they can not change halfway
+    QMutexLocker lock( m_propertyMutex );
+    cv::Size kernelSize( m_kernelSizeWidth, m_kernelSizeHeight );
+    double sigmaOne = m_sigmaOne;
+    double sigmaTwo = m_sigmaTwo;
+    int borderType  = m_borderType.getSelectedValue();
+    lock.unlock();
+
     CvMatData srcPtr = m_inputPin->get();
-    CvMatData dstPtr = CvMatData::create( srcPtr.properties() );
 
     // open for reading
-    const cv::Mat& src = srcPtr;
+    const cv::Mat& src = srcPtr.getReadOnly();
 
-    // open image for writing
+    // open image for writing, reuses the input buffer when no one else needs it
+    CvMatData dstPtr = CvMatData::createOutput( srcPtr, isInPlace() );
     cv::Mat& dst = dstPtr;
 
     // perform smooth operation on the image
@@ -71,9 +80,7 @@ bool GaussianSmooth::process()
     // * ksize  The Gaussian kernel size; ksize.width and ksize.height can differ, but they both must be positive and odd. Or, they can be zeros, then they are computed from sigma*
     // * sigmaX, sigmaY  The Gaussian kernel standard deviations in X and Y direction. If sigmaY is zero, it is set to be equal to sigmaX . If they are both zeros, they are computed from ksize.width and ksize.height , respectively, see getGaussianKernel() . To fully control the result regardless of possible future modification of all this semantics, it is recommended to specify all of ksize , sigmaX and sigmaY
     // * borderType  The pixel extrapolation method; see borderInterpolate()
-    cv::GaussianBlur( src, dst, cv::Size(m_kernelSizeWidth,m_kernelSizeHeight),
-                      m_sigmaOne, m_sigmaTwo,
-                      m_borderType.getSelectedValue() );
+    cv::GaussianBlur( src, dst, kernelSize, sigmaOne, sigmaTwo, borderType );
 
     // publish the new image
     m_outputPin->put( dstPtr );
@@ -49,6 +49,8 @@ namespace plvopencv
         Q_DISABLE_COPY( GaussianSmooth )
         Q_CLASSINFO("author", "Richard Loos")
         Q_CLASSINFO("name", "Gaussian Smooth")
+        Q_CLASSINFO("reentrant", "true")
+        Q_CLASSINFO("inPlace", "true")
         Q_CLASSINFO("description", "Smooths and image using Gaussian smoothing"
                     "See OpenCV reference for meaning of parameters."
                     "<a href='http://opencv.willowgarage.com/documentation/cpp/imgproc_image_filtering.html#GaussianBlur'>"
@@ -352,20 +352,27 @@ bool ImageColorConvert::process()
     assert(m_inputPin != 0);
     assert(m_outputPin != 0);
 
+    // this processor is reentrant, copy the
+    // properties so they can not change halfway
+    QMutexLocker lock( m_propertyMutex );
+    int conversionType = m_conversionType.getSelectedValue();
+    int outChannels    = m_outChannels;
+    lock.unlock();
+
     CvMatData in = m_inputPin->get();
 
     CvMatDataProperties props = in.properties();
-    props.setNumChannels( m_outChannels );
+    props.setNumChannels( outChannels );
     CvMatData out = CvMatData::create( props );
 
     // open for reading
-    const cv::Mat& src = in;
+    const cv::Mat& src = in.getReadOnly();
 
     // open image for writing
     cv::Mat& dst = out;
 
     // cvCvtColor function, see OpenCV documentation for details
-    cv::cvtColor(src, dst, m_conversionType.getSelectedValue(), m_outChannels );
+    cv::cvtColor(src, dst, conversionType, outChannels );
 
     // publish the new image
     m_outputPin->put( out );
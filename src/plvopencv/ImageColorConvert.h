@@ -41,6 +41,7 @@ namespace plvopencv
         Q_DISABLE_COPY( ImageColorConvert )
         Q_CLASSINFO("author", "Richard")
         Q_CLASSINFO("name", "Color and scale conversion")
+        Q_CLASSINFO("reentrant", "true")
         Q_CLASSINFO("description", "Color and scale converion using the cv::cvtColor method. See "
                     "<a href='http://opencv.willowgarage.com/documentation/cpp/imgproc_miscellaneous_image_transformations.html?highlight=cvtcolor#cvtColor'>"
                     "OpenCV reference"
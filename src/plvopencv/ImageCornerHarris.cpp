@@ -65,7 +65,7 @@ bool ImageCornerHarris::process()
     CvMatDataProperties props( in.width(), in.height(), CV_32FC1 );
     CvMatData out = CvMatData::create( props );
 
-    const cv::Mat& src = in;
+    const cv::Mat& src = in.getReadOnly();
     cv::Mat& dst = out;
 
     // do a canny edge detection operator of the image
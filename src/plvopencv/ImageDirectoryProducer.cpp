@@ -28,11 +28,63 @@
 #include <opencv/highgui.h>
 #include <plvcore/CvMatDataPin.h>
 #include <QDir>
+#include <QFile>
+#include <QRunnable>
 
 using namespace plv;
 using namespace plvopencv;
 
-ImageDirectoryProducer::ImageDirectoryProducer() : m_idx(0)
+/** default number of images decoded ahead */
+#define IMAGEDIRECTORYPRODUCER_DEFAULT_LOOKAHEAD 8
+
+namespace
+{
+    /** decodes a single image on the decode pool */
+    class DecodeTask : public QRunnable
+    {
+    public:
+        DecodeTask( ImageDirectoryProducer* producer, int slot,
+                    const QString& path, bool memoryMap ) :
+            m_producer( producer ), m_slot( slot ), m_path( path ), m_memoryMap( memoryMap ) {}
+
+        void run()
+        {
+            cv::Mat image;
+            if( m_memoryMap )
+            {
+                QFile file( m_path );
+                if( file.open( QIODevice::ReadOnly ) && file.size() > 0 )
+                {
+                    uchar* bytes = file.map( 0, file.size() );
+                    if( bytes != 0 )
+                    {
+                        cv::Mat buffer( 1, (int)file.size(), CV_8U, bytes );
+                        image = cv::imdecode( buffer, CV_LOAD_IMAGE_UNCHANGED );
+                        file.unmap( bytes );
+                    }
+                }
+            }
+            else
+            {
+                image = cv::imread( m_path.toStdString(), CV_LOAD_IMAGE_UNCHANGED );
+            }
+            m_producer->decoded( m_slot, image );
+        }
+
+    private:
+        ImageDirectoryProducer* m_producer;
+        int m_slot;
+        QString m_path;
+        bool m_memoryMap;
+    };
+}
+
+ImageDirectoryProducer::ImageDirectoryProducer() :
+    m_idx(0),
+    m_decodeThreads(QThread::idealThreadCount()),
+    m_lookAhead(IMAGEDIRECTORYPRODUCER_DEFAULT_LOOKAHEAD),
+    m_memoryMap(false),
+    m_nextDecode(0)
 {
     m_imgOutputPin = createCvMatDataOutputPin("image_output", this );
     m_fileNameOutputPin  = createOutputPin<QString>("file name", this );
@@ -68,6 +120,45 @@ void ImageDirectoryProducer::setDirectory(const QString& directory)
     }
 }
 
+int ImageDirectoryProducer::getDecodeThreads()
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_decodeThreads;
+}
+
+void ImageDirectoryProducer::setDecodeThreads(int threads)
+{
+    QMutexLocker lock( m_propertyMutex );
+    m_decodeThreads = threads < 1 ? 1 : threads;
+    emit decodeThreadsChanged(m_decodeThreads);
+}
+
+int ImageDirectoryProducer::getLookAhead()
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_lookAhead;
+}
+
+void ImageDirectoryProducer::setLookAhead(int images)
+{
+    QMutexLocker lock( m_propertyMutex );
+    m_lookAhead = images < 1 ? 1 : images;
+    emit lookAheadChanged(m_lookAhead);
+}
+
+bool ImageDirectoryProducer::getMemoryMap()
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_memoryMap;
+}
+
+void ImageDirectoryProducer::setMemoryMap(bool memoryMap)
+{
+    QMutexLocker lock( m_propertyMutex );
+    m_memoryMap = memoryMap;
+    emit memoryMapChanged(memoryMap);
+}
+
 bool ImageDirectoryProducer::init()
 {
     QDir dir(m_directory);
@@ -85,6 +176,7 @@ bool ImageDirectoryProducer::init()
 
     m_entryInfoList = dir.entryInfoList();
     m_idx = 0;
+    m_nextDecode = 0;
     return true;
 }
 
@@ -92,31 +184,83 @@ bool ImageDirectoryProducer::deinit() throw ()
 {
     m_entryInfoList.clear();
     m_idx = 0;
+    m_nextDecode = 0;
     return true;
 }
 
-bool ImageDirectoryProducer::readyToProduce() const
+bool ImageDirectoryProducer::start()
 {
-    return m_idx < m_entryInfoList.size();
+    m_decodePool.setMaxThreadCount( getDecodeThreads() );
+    return true;
 }
 
-bool ImageDirectoryProducer::produce()
+bool ImageDirectoryProducer::stop()
 {
-    QFileInfo fileInfo = m_entryInfoList.at(m_idx);
+    // the fetch thread has already stopped. Images up to m_idx have been
+    // fetched and are kept by PrefetchProducer, the decodes in flight
+    // after them are dropped and submitted again on restart
+    m_decodePool.waitForDone();
 
-    //load the image
-    const std::string& path = fileInfo.absoluteFilePath().toStdString();
-    cv::Mat image = cv::imread(path, CV_LOAD_IMAGE_UNCHANGED);
-    if(image.data == 0)
+    QMutexLocker lock( &m_decodeMutex );
+    m_decoded.clear();
+    m_nextDecode = m_idx;
+    return true;
+}
+
+void ImageDirectoryProducer::decoded( int slot, const cv::Mat& image )
+{
+    QMutexLocker lock( &m_decodeMutex );
+    m_decoded.insert( slot, image );
+    m_decodeDone.wakeAll();
+}
+
+int ImageDirectoryProducer::getFetchAhead() const
+{
+    QMutexLocker lock( &m_decodeMutex );
+    return m_nextDecode - m_idx;
+}
+
+PrefetchProducer::FetchResult ImageDirectoryProducer::fetch( PrefetchFrame& frame )
+{
+    // called on the fetch thread
+    int lookAhead = getLookAhead();
+    bool memoryMap = getMemoryMap();
+
+    QMutexLocker lock( &m_decodeMutex );
+    if( m_idx >= m_entryInfoList.size() )
+        return FETCH_END;
+
+    // keep the decoders busy on the images after this one
+    while( m_nextDecode < m_entryInfoList.size() && m_nextDecode < m_idx + lookAhead )
     {
-        setError( PlvPipelineRuntimeError, tr("Failed to load image %1.").arg(fileInfo.absolutePath()));
-        return false;
+        QString path = m_entryInfoList.at(m_nextDecode).absoluteFilePath();
+        m_decodePool.start( new DecodeTask( this, m_nextDecode, path, memoryMap ) );
+        ++m_nextDecode;
+    }
+
+    // images are produced in directory order
+    while( !m_decoded.contains(m_idx) )
+    {
+        lock.unlock();
+        if( isStopRequested() )
+            return FETCH_NONE;
+        lock.relock();
+        m_decodeDone.wait( &m_decodeMutex, 100 );
     }
 
-    m_imgOutputPin->put( CvMatData(image) );
-    m_fileNameOutputPin->put( fileInfo.fileName() );
-    m_filePathOutputPin->put( fileInfo.absolutePath() );
+    cv::Mat image = m_decoded.take(m_idx);
+    QFileInfo fileInfo = m_entryInfoList.at(m_idx);
     m_idx++;
+    lock.unlock();
 
-    return true;
+    if(image.data == 0)
+    {
+        setFetchError( PlvPipelineRuntimeError, tr("Failed to load image %1.").arg(fileInfo.absoluteFilePath()));
+        return FETCH_ERROR;
+    }
+
+    frame.put( m_imgOutputPin, CvMatData(image) );
+    frame.put( m_fileNameOutputPin, fileInfo.fileName() );
+    frame.put( m_filePathOutputPin, fileInfo.absolutePath() );
+    return FETCH_FRAME;
 }
@@ -23,7 +23,10 @@
 #define IMAGEDIRECTORYPRODUCER_H
 
 #include <QMutex>
-#include <plvcore/PipelineProducer.h>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QHash>
+#include <plvcore/PrefetchProducer.h>
 #include <plvcore/OutputPin.h>
 #include <plvcore/CvMatData.h>
 #include <plvcore/Enum.h>
@@ -36,7 +39,7 @@ namespace plv
 
 namespace plvopencv
 {
-    class ImageDirectoryProducer : public plv::PipelineProducer
+    class ImageDirectoryProducer : public plv::PrefetchProducer
     {
         Q_OBJECT
         Q_CLASSINFO("author", "Richard Loos")
@@ -44,9 +47,12 @@ namespace plvopencv
         Q_CLASSINFO("description", "A producer that loads all the images in a directory.")
 
         Q_PROPERTY( QString directory READ getDirectory WRITE setDirectory NOTIFY directoryChanged )
+        Q_PROPERTY( int decodeThreads READ getDecodeThreads WRITE setDecodeThreads NOTIFY decodeThreadsChanged )
+        Q_PROPERTY( int lookAhead READ getLookAhead WRITE setLookAhead NOTIFY lookAheadChanged )
+        Q_PROPERTY( bool memoryMap READ getMemoryMap WRITE setMemoryMap NOTIFY memoryMapChanged )
 
-        /** required standard method declaration for plv::PipelineElement */
-        PLV_PIPELINE_PRODUCER
+        /** images are decoded ahead, see PrefetchProducer */
+        PLV_PREFETCH_PRODUCER
 
     public:
         ImageDirectoryProducer();
@@ -54,16 +60,41 @@ namespace plvopencv
 
         virtual bool init();
         virtual bool deinit() throw ();
+        virtual bool start();
+        virtual bool stop();
 
         QString getDirectory();
         void updateDirectory(const QString& s){ setDirectory(s); directoryChanged(s); }
 
+        int getDecodeThreads();
+        int getLookAhead();
+        bool getMemoryMap();
+
+        /** called by the decode tasks when image slot has been decoded */
+        void decoded( int slot, const cv::Mat& image );
+
     signals:
         void directoryChanged(const QString& newValue);
+        void decodeThreadsChanged(int newValue);
+        void lookAheadChanged(int newValue);
+        void memoryMapChanged(bool newValue);
 
     public slots:
         void setDirectory(const QString& directory);
 
+        /** number of threads decoding images, takes effect on the next start */
+        void setDecodeThreads(int threads);
+
+        /** number of images decoded ahead of the image being produced */
+        void setLookAhead(int images);
+
+        /** read files through a memory mapping instead of with imread */
+        void setMemoryMap(bool memoryMap);
+
+    protected:
+        /** images decoding or decoded but not yet fetched */
+        virtual int getFetchAhead() const;
+
     protected:
         plv::CvMatData m_loadedImage;
         plv::CvMatDataOutputPin* m_imgOutputPin;
@@ -74,6 +105,19 @@ namespace plvopencv
         QString m_directory;
         QFileInfoList m_entryInfoList;
         int m_idx;
+        int m_decodeThreads;
+        int m_lookAhead;
+        bool m_memoryMap;
+
+        /** decodes run on their own pool so they do not compete with
+            the pipeline workers for the global pool */
+        QThreadPool m_decodePool;
+
+        /** protects the decode state below */
+        mutable QMutex m_decodeMutex;
+        QWaitCondition m_decodeDone;
+        QHash<int, cv::Mat> m_decoded; /** finished decodes by index, empty on failure */
+        int m_nextDecode; /** index of the next image to submit */
     };
 }
 
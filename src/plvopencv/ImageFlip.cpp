@@ -53,19 +53,19 @@ ImageFlip::~ImageFlip() {}
 bool ImageFlip::process()
 {
     CvMatData in = m_inputPin->get();
-    CvMatData out = CvMatData::create(in.properties());
 
     // open for reading
-    const cv::Mat& src = in;
+    const cv::Mat& src = in.getReadOnly();
 
-    // open image for writing
+    // open image for writing, reuses the input buffer when no one else needs it
+    CvMatData out = CvMatData::createOutput( in, isInPlace() );
     cv::Mat& target = out;
 
     // do a flip of the image
     cv::flip( src, target, m_method.getSelectedValue() );
 
     // publish the new image
-    m_outputPin->put( target );
+    m_outputPin->put( out );
 
     return true;
 }
@@ -39,6 +39,7 @@ namespace plvopencv
         Q_DISABLE_COPY( ImageFlip )
         Q_CLASSINFO("author", "Ported from old version by Wim & Dennis")
         Q_CLASSINFO("name", "Flip")
+        Q_CLASSINFO("inPlace", "true")
         Q_CLASSINFO("description", "Flip image. FlipX means \"flip around x-axis\". Same for FlipY.");
 
         Q_PROPERTY( plv::Enum method READ getMethod WRITE setMethod NOTIFY methodChanged  )
@@ -56,9 +56,10 @@ ImageThreshold::~ImageThreshold(){}
 bool ImageThreshold::process()
 {
     CvMatData in = m_inputPin->get();
-    CvMatData out = CvMatData::create( in.width(), in.height(), in.type() );
+    const cv::Mat& src = in.getReadOnly();
 
-    const cv::Mat& src = in;
+    // reuses the input buffer when no one else needs it
+    CvMatData out = CvMatData::createOutput( in, isInPlace() );
     cv::Mat& dst = out;
 
     // perform threshold operation on the image
@@ -45,6 +45,7 @@ namespace plvopencv
         Q_DISABLE_COPY( ImageThreshold )
         Q_CLASSINFO("author", "Niek Hoeijmakers, Richard Loos")
         Q_CLASSINFO("name", "Threshold")
+        Q_CLASSINFO("inPlace", "true")
         Q_CLASSINFO("description", "A processor that removes all image data above or below a given threshold."
                     "This processor uses cv::threshold, see "
                     "<a href='http://opencv.willowgarage.com/documentation/cpp/imgproc_miscellaneous_image_transformations.html#threshold'>"
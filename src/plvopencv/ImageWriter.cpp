@@ -0,0 +1,154 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvopencv module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "ImageWriter.h"
+
+#include <assert.h>
+
+#include <QDebug>
+#include <QFile>
+
+#include <opencv/highgui.h>
+#include <plvcore/Metrics.h>
+
+using namespace plv;
+using namespace plvopencv;
+
+ImageWriter::ImageWriter() :
+    m_metrics( 0 ),
+    m_capacity( 1 ),
+    m_stopping( false )
+{
+}
+
+ImageWriter::~ImageWriter()
+{
+    stop();
+}
+
+void ImageWriter::start( int threads, int capacity, ElementMetrics* metrics )
+{
+    assert( m_writers.isEmpty() );
+
+    QMutexLocker lock( &m_mutex );
+    m_metrics  = metrics;
+    m_capacity = capacity < 1 ? 1 : capacity;
+    m_stopping = false;
+    lock.unlock();
+
+    for( int i=0; i < (threads < 1 ? 1 : threads); ++i )
+    {
+        Writer* writer = new Writer( this );
+        m_writers.append( writer );
+        writer->start( QThread::LowPriority );
+    }
+}
+
+void ImageWriter::stop()
+{
+    QMutexLocker lock( &m_mutex );
+    m_stopping = true;
+    m_jobAvailable.wakeAll();
+    lock.unlock();
+
+    // the writers empty the queue before they exit
+    foreach( Writer* writer, m_writers )
+    {
+        writer->wait();
+        delete writer;
+    }
+    m_writers.clear();
+}
+
+void ImageWriter::write( const ImageWriteJob& job )
+{
+    QMutexLocker lock( &m_mutex );
+    while( m_jobs.size() >= m_capacity )
+        m_spaceAvailable.wait( &m_mutex );
+
+    m_jobs.enqueue( job );
+    updateBacklog();
+    m_jobAvailable.wakeOne();
+}
+
+bool ImageWriter::tryWrite( const ImageWriteJob& job )
+{
+    QMutexLocker lock( &m_mutex );
+    if( m_jobs.size() >= m_capacity )
+        return false;
+
+    m_jobs.enqueue( job );
+    updateBacklog();
+    m_jobAvailable.wakeOne();
+    return true;
+}
+
+int ImageWriter::getBacklog() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_jobs.size();
+}
+
+void ImageWriter::updateBacklog()
+{
+    if( m_metrics != 0 )
+        m_metrics->setBacklog( m_jobs.size() );
+}
+
+bool ImageWriter::writeNow( const ImageWriteJob& job )
+{
+    // never overwrite existing files
+    if( QFile::exists( job.filename ) )
+    {
+        qWarning() << "plv::opencv::ImageWriter not overwriting existing file " << job.filename;
+        return false;
+    }
+
+    // Only 8-bit (or 16-bit in the case of PNG, JPEG 2000 and TIFF) single-channel
+    // or 3-channel (with BGR channel order) images can be saved using imwrite.
+    const cv::Mat& mat = job.image.getReadOnly();
+    if( !cv::imwrite( job.filename.toStdString(), mat, job.params ) )
+    {
+        qWarning() << "plv::opencv::ImageWriter failed to save image " << job.filename;
+        return false;
+    }
+    return true;
+}
+
+void ImageWriter::writerLoop()
+{
+    forever
+    {
+        QMutexLocker lock( &m_mutex );
+        while( m_jobs.isEmpty() && !m_stopping )
+            m_jobAvailable.wait( &m_mutex );
+
+        if( m_jobs.isEmpty() )
+            return;
+
+        ImageWriteJob job = m_jobs.dequeue();
+        updateBacklog();
+        m_spaceAvailable.wakeOne();
+        lock.unlock();
+
+        writeNow( job );
+    }
+}
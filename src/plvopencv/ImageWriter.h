@@ -0,0 +1,108 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvopencv module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <vector>
+
+#include <QList>
+#include <QQueue>
+#include <QString>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <plvcore/CvMatData.h>
+
+namespace plv
+{
+    class ElementMetrics;
+}
+
+namespace plvopencv
+{
+    /** A single image to be written to disk */
+    struct ImageWriteJob
+    {
+        QString filename;
+        plv::CvMatData image;
+        std::vector<int> params; /** parameters for cv::imwrite */
+    };
+
+    /** Encodes and writes images on a bounded pool of background threads so
+      * image compression and disk I/O do not hold up the pipeline. Existing
+      * files are never overwritten. The number of queued images is reported
+      * as the backlog of the given metrics.
+      */
+    class ImageWriter
+    {
+    public:
+        ImageWriter();
+        ~ImageWriter();
+
+        /** starts threads writers with room for capacity queued images */
+        void start( int threads, int capacity, plv::ElementMetrics* metrics );
+
+        /** writes all queued images and stops the writer threads */
+        void stop();
+
+        /** queues job, waits for room when the queue is full */
+        void write( const ImageWriteJob& job );
+
+        /** queues job, returns false without queueing when the queue is full */
+        bool tryWrite( const ImageWriteJob& job );
+
+        /** number of images queued but not yet taken by a writer */
+        int getBacklog() const;
+
+        /** writes a job on the calling thread, returns false on failure */
+        static bool writeNow( const ImageWriteJob& job );
+
+    private:
+        Q_DISABLE_COPY( ImageWriter )
+
+        class Writer : public QThread
+        {
+        public:
+            Writer( ImageWriter* writer ) : m_writer( writer ) {}
+        protected:
+            void run() { m_writer->writerLoop(); }
+        private:
+            ImageWriter* m_writer;
+        };
+
+        void writerLoop();
+        void updateBacklog();
+
+        QList<Writer*> m_writers;
+        plv::ElementMetrics* m_metrics;
+        int m_capacity;
+        bool m_stopping;
+
+        mutable QMutex m_mutex;
+        QWaitCondition m_jobAvailable;
+        QWaitCondition m_spaceAvailable;
+        QQueue<ImageWriteJob> m_jobs;
+    };
+}
+
+#endif // IMAGEWRITER_H
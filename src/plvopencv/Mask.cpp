@@ -59,8 +59,8 @@ bool Mask::process()
     CvMatData in2 = m_inputPin2->get();
     CvMatData out = CvMatData::create(in1.properties());
 
-    const cv::Mat& src  = in1;
-    const cv::Mat& maskIn = in2;
+    const cv::Mat& src  = in1.getReadOnly();
+    const cv::Mat& maskIn = in2.getReadOnly();
     cv::Mat& dst = out;
 
     cv::Mat mask;
@@ -45,7 +45,7 @@ bool PixelSum::process()
 {
     CvMatData in = m_inputPin->get();
 
-    const cv::Mat& src = in;
+    const cv::Mat& src = in.getReadOnly();
 
     // tuple of 1,2,3 or 4 values depending on the number of channels
     cv::Scalar scalar = cv::sum( src );
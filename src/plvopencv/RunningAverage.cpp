@@ -50,13 +50,13 @@ RunningAverage::~RunningAverage()
 bool RunningAverage::process()
 {
     CvMatData in = m_inputPin->get();
-    const cv::Mat& src = in;
+    const cv::Mat& src = in.getReadOnly();
 
     if( m_avg.width() != in.width() || m_avg.height() != in.height() || in.type() != m_out.type() )
     {
         m_avg = CvMatData::create( in.width(), in.height(), CV_32F, in.channels() );
         m_tmp = CvMatData::create( in.width(), in.height(), CV_32F, in.channels() );
-        m_out = CvMatData::create( in.width(), in.height(), in.type(), in.channels() );
+        m_out = CvMatData::create( in.properties() );
 
         if( src.depth() == CV_8U )
         {
@@ -80,8 +80,10 @@ bool RunningAverage::process()
     src.convertTo(m_tmp, m_tmp.type(), 1.0 / m_conversionFactor);
     cv::accumulateWeighted(tmp, m_avg, m_weight);
 
-    // convert avg back to src type
-    const cv::Mat& avg = m_avg;
+    // convert avg back to src type into a new buffer, downstream
+    // elements may still be using the previous output
+    m_out = CvMatData::create( in.properties() );
+    const cv::Mat& avg = m_avg.getReadOnly();
     avg.convertTo(m_out, m_out.type(), m_conversionFactor );
 
     m_outputPin->put(m_out);
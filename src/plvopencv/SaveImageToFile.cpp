@@ -52,12 +52,27 @@ enum ImageFormat {
     TIFF
 };
 
+enum OverflowPolicy {
+    OVERFLOW_BLOCK,
+    OVERFLOW_DROP,
+    OVERFLOW_SPILL
+};
+
+#define SAVEIMAGETOFILE_DEFAULT_JPEG_QUALITY    95
+#define SAVEIMAGETOFILE_DEFAULT_PNG_COMPRESSION 3
+#define SAVEIMAGETOFILE_DEFAULT_WRITER_THREADS  2
+#define SAVEIMAGETOFILE_DEFAULT_QUEUE_SIZE      16
+
 /**
  * Constructor.
  */
 SaveImageToFile::SaveImageToFile() :
         m_directory(SAVEIMAGETOFILE_DEFAULT_DIR),
-        m_fileExt(".bmp")
+        m_fileExt(".bmp"),
+        m_jpegQuality(SAVEIMAGETOFILE_DEFAULT_JPEG_QUALITY),
+        m_pngCompression(SAVEIMAGETOFILE_DEFAULT_PNG_COMPRESSION),
+        m_writerThreads(SAVEIMAGETOFILE_DEFAULT_WRITER_THREADS),
+        m_queueSize(SAVEIMAGETOFILE_DEFAULT_QUEUE_SIZE)
 {
     m_inputImage    = createInputPin<CvMatData>("image", this, IInputPin::CONNECTION_OPTIONAL );
     m_inputImages   = createInputPin< QList<CvMatData> >("image list", this, IInputPin::CONNECTION_OPTIONAL );
@@ -71,6 +86,10 @@ SaveImageToFile::SaveImageToFile() :
     m_fileFormat.add("Portable Image Format - *.pbm", PBM);
     m_fileFormat.add("Sun Rasters - *.sr", SR);
     m_fileFormat.add("TIFF Files - *.tiff", TIFF);
+
+    m_overflowPolicy.add("Block", OVERFLOW_BLOCK);
+    m_overflowPolicy.add("Drop", OVERFLOW_DROP);
+    m_overflowPolicy.add("Spill", OVERFLOW_SPILL);
 }
 
 SaveImageToFile::~SaveImageToFile()
@@ -91,6 +110,19 @@ bool SaveImageToFile::init()
     return dir.exists();
 }
 
+bool SaveImageToFile::start()
+{
+    m_validDirectories.clear();
+    m_writer.start(getWriterThreads(), getQueueSize(), &getMetrics());
+    return true;
+}
+
+bool SaveImageToFile::stop()
+{
+    m_writer.stop();
+    return true;
+}
+
 QString SaveImageToFile::getDirectory() const
 {
     QMutexLocker lock(m_propertyMutex);
@@ -103,6 +135,36 @@ plv::Enum SaveImageToFile::getFileFormat() const
     return m_fileFormat;
 }
 
+int SaveImageToFile::getJpegQuality() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_jpegQuality;
+}
+
+int SaveImageToFile::getPngCompression() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_pngCompression;
+}
+
+int SaveImageToFile::getWriterThreads() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_writerThreads;
+}
+
+int SaveImageToFile::getQueueSize() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_queueSize;
+}
+
+plv::Enum SaveImageToFile::getOverflowPolicy() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_overflowPolicy;
+}
+
 /**
  * Deals with the change of the directory property.
  */
@@ -151,6 +213,41 @@ void SaveImageToFile::setFileFormat(plv::Enum e)
     emit fileFormatChanged(m_fileFormat);
 }
 
+void SaveImageToFile::setJpegQuality(int quality)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_jpegQuality = qBound(0, quality, 100);
+    emit jpegQualityChanged(m_jpegQuality);
+}
+
+void SaveImageToFile::setPngCompression(int level)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_pngCompression = qBound(0, level, 9);
+    emit pngCompressionChanged(m_pngCompression);
+}
+
+void SaveImageToFile::setWriterThreads(int threads)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_writerThreads = threads < 1 ? 1 : threads;
+    emit writerThreadsChanged(m_writerThreads);
+}
+
+void SaveImageToFile::setQueueSize(int size)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_queueSize = size < 1 ? 1 : size;
+    emit queueSizeChanged(m_queueSize);
+}
+
+void SaveImageToFile::setOverflowPolicy(plv::Enum e)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_overflowPolicy = e;
+    emit overflowPolicyChanged(m_overflowPolicy);
+}
+
 bool SaveImageToFile::process()
 {
     QList<plv::CvMatData> images;
@@ -174,11 +271,15 @@ bool SaveImageToFile::process()
         {
             path.append('/');
         }
-        QDir dir(path);
-        if( !dir.exists() )
+        if( !m_validDirectories.contains(path) )
         {
-            qWarning() << "plv::opencv::SaveImageToFile::process() invalid path given to processor, ignoring.";
-            return true;
+            QDir dir(path);
+            if( !dir.exists() )
+            {
+                qWarning() << "plv::opencv::SaveImageToFile::process() invalid path given to processor, ignoring.";
+                return true;
+            }
+            m_validDirectories.insert(path);
         }
     }
     else
@@ -219,40 +320,65 @@ bool SaveImageToFile::process()
             return true;
     }
 
-    bool success = false;
+    std::vector<int> params;
+    {
+        QMutexLocker lock(m_propertyMutex);
+        switch(m_fileFormat.getSelectedIndex())
+        {
+        case JPG:
+            params.push_back(CV_IMWRITE_JPEG_QUALITY);
+            params.push_back(m_jpegQuality);
+            break;
+        case PNG:
+            params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+            params.push_back(m_pngCompression);
+            break;
+        default:
+            break;
+        }
+    }
+    int policy = getOverflowPolicy().getSelectedValue();
+
     bool multi_image = images.size() > 1;
     for(int i=0; i<images.size(); ++i)
     {
-        QString filename;
+        QString filenameBase;
         if(multi_image)
-            filename = QString("%1%2_%3%4").arg(path).arg(filenameBegin).arg(i).arg(m_fileExt);
+            filenameBase = QString("%1%2_%3").arg(path).arg(filenameBegin).arg(i);
         else
-            filename = QString("%1%2%3").arg(path).arg(filenameBegin).arg(m_fileExt);
+            filenameBase = QString("%1%2").arg(path).arg(filenameBegin);
 
-        QFile file(filename);
-        if( !file.exists() )
+        ImageWriteJob job;
+        job.filename = filenameBase + m_fileExt;
+        job.image    = images.at(i);
+        job.params   = params;
+
+        switch( policy )
         {
-            if( file.open(QIODevice::WriteOnly) )
+        case OVERFLOW_DROP:
+            if( !m_writer.tryWrite(job) )
+                getMetrics().itemDropped();
+            break;
+        case OVERFLOW_SPILL:
+            if( !m_writer.tryWrite(job) )
             {
-                file.close();
-                const cv::Mat& mat = images.at(i);
-
-                // The function imwrite saves the image to the specified file.
-                // The image format is chosen based on the filename extension,
-                // see imread for the list of extensions.
-                // Only 8-bit (or 16-bit in the case of PNG, JPEG 2000 and TIFF) single-channel
-                // or 3-channel (with BGR channel order) images can be saved using this function.
-                // If the format, depth or channel order is different, use Mat::convertTo ,
-                // and cvtColor to convert it before saving, or use the universal XML I/O functions
-                // to save the image to XML or YAML format.
-
-                success = cv::imwrite(filename.toStdString(), mat);
+                // BMP only stores 8-bit images, block for the writers otherwise
+                if( job.image.depth() == CV_8U )
+                {
+                    job.filename = filenameBase + ".bmp";
+                    job.params.clear();
+                    ImageWriter::writeNow(job);
+                }
+                else
+                {
+                    m_writer.write(job);
+                }
             }
-        }
-
-        if( !success )
-        {
-            qWarning() << "plv::opencv::SaveImageToFile::process() failed to save image " << filename;
+            break;
+        case OVERFLOW_BLOCK:
+        default:
+            m_writer.write(job);
+            break;
         }
     }
     return true;
@@ -27,6 +27,9 @@
 #include <plvcore/Enum.h>
 #include <plvcore/CvMatData.h>
 #include <QList>
+#include <QSet>
+
+#include "ImageWriter.h"
 
 namespace plv
 {
@@ -60,6 +63,14 @@ namespace plvopencv
         - SR
         - TIFF
         The default is set to BMP because it is lossless and is fast.
+
+        Images are encoded and written by a pool of writer threads so recording
+        does not slow down the pipeline. When the writers fall behind the
+        overflow policy decides what happens:
+        - Block: the processor waits until there is room in the queue
+        - Drop: the images are not saved
+        - Spill: the images are saved uncompressed as BMP right away, which is
+          much cheaper than encoding them
      */
     class SaveImageToFile : public plv::PipelineProcessor
     {
@@ -72,6 +83,11 @@ namespace plvopencv
 
         Q_PROPERTY( QString directory READ getDirectory WRITE setDirectory NOTIFY directoryChanged )
         Q_PROPERTY( plv::Enum fileFormat READ getFileFormat WRITE setFileFormat NOTIFY fileFormatChanged )
+        Q_PROPERTY( int jpegQuality READ getJpegQuality WRITE setJpegQuality NOTIFY jpegQualityChanged )
+        Q_PROPERTY( int pngCompression READ getPngCompression WRITE setPngCompression NOTIFY pngCompressionChanged )
+        Q_PROPERTY( int writerThreads READ getWriterThreads WRITE setWriterThreads NOTIFY writerThreadsChanged )
+        Q_PROPERTY( int queueSize READ getQueueSize WRITE setQueueSize NOTIFY queueSizeChanged )
+        Q_PROPERTY( plv::Enum overflowPolicy READ getOverflowPolicy WRITE setOverflowPolicy NOTIFY overflowPolicyChanged )
 
         /** required standard method declaration for plv::PipelineElement */
         PLV_PIPELINE_PROCESSOR
@@ -84,18 +100,48 @@ namespace plvopencv
         /** property methods */
         QString getDirectory() const;
         plv::Enum getFileFormat() const;
+        int getJpegQuality() const;
+        int getPngCompression() const;
+        int getWriterThreads() const;
+        int getQueueSize() const;
+        plv::Enum getOverflowPolicy() const;
 
         /** checks if directory exists */
         virtual bool init();
 
+        /** starts the writer threads */
+        virtual bool start();
+
+        /** waits until all queued images are written */
+        virtual bool stop();
+
     signals:
         void directoryChanged(QString newValue);
         void fileFormatChanged(plv::Enum newValue);
+        void jpegQualityChanged(int newValue);
+        void pngCompressionChanged(int newValue);
+        void writerThreadsChanged(int newValue);
+        void queueSizeChanged(int newValue);
+        void overflowPolicyChanged(plv::Enum newValue);
 
     public slots:
         void setDirectory(QString s);
         void setFileFormat(plv::Enum e);
 
+        /** JPEG quality from 0 to 100, higher is better */
+        void setJpegQuality(int quality);
+
+        /** PNG compression level from 0 to 9, higher is smaller and slower */
+        void setPngCompression(int level);
+
+        /** number of writer threads, takes effect on the next start */
+        void setWriterThreads(int threads);
+
+        /** number of images which can wait for a writer, takes effect on the next start */
+        void setQueueSize(int size);
+
+        void setOverflowPolicy(plv::Enum e);
+
     private:
         plv::InputPin< plv::CvMatData>*         m_inputImage;
         plv::InputPin< QList<plv::CvMatData> >* m_inputImages;
@@ -108,6 +154,17 @@ namespace plvopencv
 
         /** Additional properties */
         QString m_fileExt;   /** The filename extension selected through m_fileFormat. */
+        int m_jpegQuality;
+        int m_pngCompression;
+        int m_writerThreads;
+        int m_queueSize;
+        plv::Enum m_overflowPolicy;
+
+        /** directories received on the path pin which exist, so each
+            directory is only checked once per run */
+        QSet<QString> m_validDirectories;
+
+        ImageWriter m_writer;
     };
 }
 
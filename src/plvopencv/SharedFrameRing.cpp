@@ -0,0 +1,363 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvopencv module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include <QDebug>
+#include <cstring>
+#include <new>
+
+#include "SharedFrameRing.h"
+
+using namespace plvopencv;
+
+#define SHAREDFRAMERING_MAGIC   0x504c5652 /** "PLVR" */
+#define SHAREDFRAMERING_VERSION 2
+
+/** payloads start on cache line boundaries */
+#define SHAREDFRAMERING_ALIGN   64
+
+namespace
+{
+    inline qint64 alignUp( qint64 size )
+    {
+        return ( size + SHAREDFRAMERING_ALIGN - 1 ) / SHAREDFRAMERING_ALIGN * SHAREDFRAMERING_ALIGN;
+    }
+}
+
+SharedFrameRing::SharedFrameRing() :
+    m_memory( 0 ),
+    m_sequence( 0 ),
+    m_reader( -1 ),
+    m_signal( 0 )
+{
+    for( int i=0; i < SHAREDFRAMERING_MAX_READERS; ++i )
+        m_readerSignals[i] = 0;
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+    detach();
+}
+
+qint64 SharedFrameRing::headerSize( int slotCount )
+{
+    return alignUp( sizeof(Header) + slotCount * sizeof(Slot) );
+}
+
+bool SharedFrameRing::create( const QString& key, int slotCount, qint64 slotSize )
+{
+    detach();
+    slotSize = alignUp( slotSize );
+
+    m_memory = new QSharedMemory( key );
+    if( !m_memory->create( headerSize(slotCount) + slotCount * slotSize ) )
+    {
+        // reuse the segment of a previous writer which readers keep alive
+        if( m_memory->error() == QSharedMemory::AlreadyExists &&
+            m_memory->attach() && validate() &&
+            header()->slotSize >= slotSize )
+        {
+            m_sequence = static_cast<quint32>( int(header()->latest) );
+            qDebug() << "Publishing frames into existing segment " << key;
+            return true;
+        }
+
+        m_error = m_memory->errorString();
+        if( m_memory->isAttached() )
+            m_error = QString("Segment %1 exists with a different layout or smaller slots").arg(key);
+        detach();
+        return false;
+    }
+
+    Header* h = header();
+    h->magic = SHAREDFRAMERING_MAGIC;
+    h->version = SHAREDFRAMERING_VERSION;
+    h->slotCount = slotCount;
+    h->headerSize = (qint32)headerSize(slotCount);
+    h->slotSize = slotSize;
+    new (&h->latest) QAtomicInt( 0 );
+    for( int i=0; i < SHAREDFRAMERING_MAX_READERS; ++i )
+    {
+        new (&h->reader[i].attached) QAtomicInt( 0 );
+        new (&h->reader[i].waiting) QAtomicInt( 0 );
+    }
+
+    for( int i=0; i < slotCount; ++i )
+    {
+        Slot* s = slot(i);
+        new (&s->state) QAtomicInt( 0 );
+        new (&s->readers) QAtomicInt( 0 );
+        s->serial = 0;
+        s->type = s->rows = s->cols = 0;
+    }
+    m_sequence = 0;
+    return true;
+}
+
+bool SharedFrameRing::attach( const QString& key )
+{
+    detach();
+
+    m_memory = new QSharedMemory( key );
+
+    // read write, pinning a slot writes to the segment
+    if( !m_memory->attach() || !validate() )
+    {
+        m_error = m_memory->isAttached() ? QString("Segment %1 is not a frame ring").arg(key)
+                                         : m_memory->errorString();
+        detach();
+        return false;
+    }
+
+    // register for signals, without a free entry the reader polls
+    Header* h = header();
+    for( int i=0; i < SHAREDFRAMERING_MAX_READERS; ++i )
+    {
+        if( h->reader[i].attached.testAndSetOrdered( 0, 1 ) )
+        {
+            // creating resets a count a crashed reader may have left behind
+            QString signalKey = this->signalKey( i );
+            QSystemSemaphore* signal = new QSystemSemaphore( signalKey, 0, QSystemSemaphore::Create );
+
+            QMutexLocker lock( &m_signalMutex );
+            m_reader = i;
+            m_signal = signal;
+            m_signalKey = signalKey;
+            return true;
+        }
+    }
+    qWarning() << "All reader entries of segment " << key << " are in use, polling for frames";
+    return true;
+}
+
+QString SharedFrameRing::signalKey( int i ) const
+{
+    return QString("%1_reader%2").arg( m_memory->key() ).arg( i );
+}
+
+bool SharedFrameRing::validate()
+{
+    const Header* h = header();
+    return m_memory->size() >= (int)sizeof(Header) &&
+           h->magic == SHAREDFRAMERING_MAGIC &&
+           h->version == SHAREDFRAMERING_VERSION &&
+           h->slotCount > 0 &&
+           h->headerSize == headerSize(h->slotCount) &&
+           h->headerSize + h->slotCount * h->slotSize <= m_memory->size();
+}
+
+void SharedFrameRing::detach()
+{
+    closeSignals();
+    delete m_memory;
+    m_memory = 0;
+}
+
+void SharedFrameRing::abandon()
+{
+    closeSignals();
+    m_memory = 0;
+}
+
+void SharedFrameRing::closeSignals()
+{
+    if( m_reader >= 0 && isAttached() )
+    {
+        Reader* r = &header()->reader[m_reader];
+        r->waiting.fetchAndStoreOrdered( 0 );
+        r->attached.fetchAndStoreOrdered( 0 );
+    }
+
+    for( int i=0; i < SHAREDFRAMERING_MAX_READERS; ++i )
+    {
+        delete m_readerSignals[i];
+        m_readerSignals[i] = 0;
+    }
+
+    QMutexLocker lock( &m_signalMutex );
+    delete m_signal;
+    m_signal = 0;
+    m_reader = -1;
+    m_signalKey.clear();
+}
+
+int SharedFrameRing::getSlotCount() const
+{
+    return isAttached() ? header()->slotCount : 0;
+}
+
+QString SharedFrameRing::errorString() const
+{
+    return m_error;
+}
+
+qint64 SharedFrameRing::getSlotSize() const
+{
+    return isAttached() ? header()->slotSize : 0;
+}
+
+bool SharedFrameRing::publish( quint32 serial, const cv::Mat& mat )
+{
+    Header* h = header();
+    const qint64 rowSize = (qint64)mat.cols * mat.elemSize();
+    if( rowSize * mat.rows > h->slotSize )
+        return false;
+
+    // take the oldest slot no reader has pinned. Ages are taken
+    // relative to the last sequence number, so they survive wrapping
+    Slot* target = 0;
+    int targetIndex = -1;
+    int targetState = 0;
+    quint32 targetAge = 0;
+    for( int i=0; i < h->slotCount; ++i )
+    {
+        Slot* s = slot(i);
+        int state = s->state.fetchAndAddAcquire(0);
+        if( s->readers.fetchAndAddAcquire(0) != 0 )
+            continue;
+
+        // 0 marks a slot which has never been written
+        quint32 age = state == 0 ? 0xffffffff : m_sequence - static_cast<quint32>( state );
+        if( target == 0 || age > targetAge )
+        {
+            target = s;
+            targetIndex = i;
+            targetState = state;
+            targetAge = age;
+        }
+    }
+    if( target == 0 )
+        return false;
+
+    // mark the slot as being written, then check no reader
+    // pinned it in the mean time
+    if( !target->state.testAndSetOrdered( targetState, 0 ) )
+        return false;
+    if( target->readers.fetchAndAddOrdered(0) != 0 )
+    {
+        target->state.testAndSetOrdered( 0, targetState );
+        return false;
+    }
+
+    uchar* dst = payload( targetIndex );
+    if( mat.isContinuous() )
+    {
+        memcpy( dst, mat.data, rowSize * mat.rows );
+    }
+    else
+    {
+        for( int i=0; i < mat.rows; ++i )
+            memcpy( dst + i * rowSize, mat.ptr(i), rowSize );
+    }
+    target->serial = serial;
+    target->type = mat.type();
+    target->rows = mat.rows;
+    target->cols = mat.cols;
+
+    // 0 marks a slot which is written, wrapping skips it
+    if( ++m_sequence == 0 )
+        m_sequence = 1;
+    target->state.fetchAndStoreRelease( static_cast<int>( m_sequence ) );
+    h->latest.fetchAndStoreRelease( static_cast<int>( m_sequence ) );
+
+    signalReaders();
+    return true;
+}
+
+void SharedFrameRing::signalReaders()
+{
+    Header* h = header();
+    for( int i=0; i < SHAREDFRAMERING_MAX_READERS; ++i )
+    {
+        if( !h->reader[i].waiting.testAndSetOrdered( 1, 0 ) )
+            continue;
+
+        if( m_readerSignals[i] == 0 )
+            m_readerSignals[i] = new QSystemSemaphore( signalKey(i), 0, QSystemSemaphore::Open );
+        m_readerSignals[i]->release();
+    }
+}
+
+int SharedFrameRing::acquireLatest( quint32 after, quint32& sequence, quint32& serial, cv::Mat& mat )
+{
+    Header* h = header();
+    quint32 latest = static_cast<quint32>( h->latest.fetchAndAddAcquire(0) );
+    if( latest == 0 || ( after != 0 && !isNewer( latest, after ) ) )
+        return -1;
+
+    for( int i=0; i < h->slotCount; ++i )
+    {
+        Slot* s = slot(i);
+        if( static_cast<quint32>( s->state.fetchAndAddAcquire(0) ) != latest )
+            continue;
+
+        // pin, then make sure the writer did not take the slot meanwhile
+        s->readers.ref();
+        if( static_cast<quint32>( s->state.fetchAndAddAcquire(0) ) != latest )
+        {
+            s->readers.deref();
+            return -1;
+        }
+
+        sequence = latest;
+        serial = s->serial;
+        mat = cv::Mat( s->rows, s->cols, s->type, payload(i) );
+        return i;
+    }
+
+    // the latest frame is being overwritten already
+    return -1;
+}
+
+bool SharedFrameRing::waitForFrame( quint32 after )
+{
+    if( m_signal == 0 )
+        return false;
+
+    // flag the wait before checking, so a frame published after
+    // the check releases the semaphore. A release which arrives
+    // when we did not block only causes a spurious wake up later
+    Reader* r = &header()->reader[m_reader];
+    r->waiting.fetchAndStoreOrdered( 1 );
+
+    quint32 latest = static_cast<quint32>( header()->latest.fetchAndAddAcquire(0) );
+    if( latest == 0 || ( after != 0 && !isNewer( latest, after ) ) )
+        m_signal->acquire();
+
+    r->waiting.fetchAndStoreOrdered( 0 );
+    return true;
+}
+
+void SharedFrameRing::wake()
+{
+    QMutexLocker lock( &m_signalMutex );
+    if( m_signalKey.isEmpty() )
+        return;
+
+    // a handle of our own, m_signal may be blocked in acquire()
+    QSystemSemaphore signal( m_signalKey, 0, QSystemSemaphore::Open );
+    signal.release();
+}
+
+void SharedFrameRing::release( int i )
+{
+    if( isAttached() && i >= 0 && i < header()->slotCount )
+        slot(i)->readers.deref();
+}
@@ -0,0 +1,196 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvopencv module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef SHAREDFRAMERING_H
+#define SHAREDFRAMERING_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSharedMemory>
+#include <QString>
+#include <QSystemSemaphore>
+
+#include <opencv/cv.h>
+
+/** default number of frames in a shared memory ring */
+#ifndef SHAREDFRAMERING_DEFAULT_SLOTS
+#   define SHAREDFRAMERING_DEFAULT_SLOTS 8
+#endif
+
+/** number of readers the writer can signal, further readers poll */
+#ifndef SHAREDFRAMERING_MAX_READERS
+#   define SHAREDFRAMERING_MAX_READERS 16
+#endif
+
+namespace plvopencv
+{
+    /** A ring of image slots in a named shared memory segment, which
+      * passes frames from one ParleVision process to others on the same
+      * host. There is a single writer and any number of readers.
+      *
+      * Every published frame gets a sequence number. A slot holds the
+      * sequence number of its frame in its state, or 0 while it is being
+      * written. Readers pin the slot they use by counting themselves in
+      * the readers field of the slot and checking the state did not change
+      * while doing so. The writer never overwrites a pinned slot, it takes
+      * the oldest slot which is not pinned and drops the frame when every
+      * slot is pinned. So readers map the pixels without copying them and
+      * the writer never waits for a reader.
+      *
+      * Sequence numbers are unsigned and wrap around, skipping 0. They are
+      * compared by their difference, which is valid as long as a reader is
+      * less than 2^31 frames behind.
+      *
+      * Every reader registers in a table in the header and gets a system
+      * semaphore of its own. A reader which waits for a frame flags its
+      * entry and the writer releases the semaphore of every flagged reader
+      * when it publishes, so readers block instead of polling.
+      *
+      * A reader which crashes while holding a pin keeps its slot pinned
+      * until the segment is recreated, likewise for its reader entry.
+      */
+    class SharedFrameRing
+    {
+    public:
+        SharedFrameRing();
+        ~SharedFrameRing();
+
+        /** creates the segment with slotCount slots of slotSize bytes, or
+            attaches to the segment if it exists and is large enough,
+            for instance when the writer restarts while readers are
+            still attached */
+        bool create( const QString& key, int slotCount, qint64 slotSize );
+
+        /** attaches to the segment as a reader and registers for signals */
+        bool attach( const QString& key );
+
+        void detach();
+
+        /** detaches without unmapping the segment, for readers which
+            can not tell whether frames they handed out are still used */
+        void abandon();
+
+        inline bool isAttached() const { return m_memory != 0 && m_memory->isAttached(); }
+        QString errorString() const;
+
+        /** @returns the number of bytes one slot holds */
+        qint64 getSlotSize() const;
+
+        /** @returns the number of slots in the segment */
+        int getSlotCount() const;
+
+        /** copies mat into the oldest slot which is not pinned, makes it
+            the latest frame and signals the waiting readers. @returns false
+            when mat does not fit or all slots are pinned. Writer only */
+        bool publish( quint32 serial, const cv::Mat& mat );
+
+        /** pins the latest frame if it is newer than sequence number after,
+            0 takes any frame. mat refers to the pixels in the segment and
+            stays valid until the slot is released. @returns the slot or -1
+            if there is no new frame */
+        int acquireLatest( quint32 after, quint32& sequence, quint32& serial, cv::Mat& mat );
+
+        /** blocks until a frame newer than after is published or wake() is
+            called. @returns false without waiting when this reader could not
+            register for signals, the caller has to poll instead. Reader only */
+        bool waitForFrame( quint32 after );
+
+        /** interrupts waitForFrame(). Can be called from any thread */
+        void wake();
+
+        /** unpins a slot returned by acquireLatest() */
+        void release( int slot );
+
+    private:
+        Q_DISABLE_COPY( SharedFrameRing )
+
+        struct Reader
+        {
+            QAtomicInt attached;  /** 1 while a reader uses the entry */
+            QAtomicInt waiting;   /** 1 while the reader waits for a frame */
+        };
+
+        struct Header
+        {
+            quint32 magic;
+            quint32 version;
+            qint32 slotCount;
+            qint32 headerSize;    /** offset of the first payload */
+            qint64 slotSize;
+            QAtomicInt latest;    /** sequence number of the latest frame */
+            Reader reader[SHAREDFRAMERING_MAX_READERS];
+        };
+
+        struct Slot
+        {
+            QAtomicInt state;     /** sequence number of the frame, 0 while written */
+            QAtomicInt readers;   /** number of readers which pinned the slot */
+            quint32 serial;       /** serial of the frame in the writing pipeline */
+            qint32 type;
+            qint32 rows;
+            qint32 cols;
+        };
+
+        static qint64 headerSize( int slotCount );
+
+        /** checks the layout of an attached segment */
+        bool validate();
+
+        /** @returns true if sequence number a is newer than b */
+        static inline bool isNewer( quint32 a, quint32 b )
+        {
+            return static_cast<qint32>( a - b ) > 0;
+        }
+
+        /** key of the semaphore of reader entry i */
+        QString signalKey( int i ) const;
+
+        /** releases the semaphores of the readers which wait. Writer only */
+        void signalReaders();
+
+        /** gives up the reader entry and closes the semaphores */
+        void closeSignals();
+
+        inline Header* header() const { return reinterpret_cast<Header*>( m_memory->data() ); }
+        inline Slot* slot( int i ) const { return reinterpret_cast<Slot*>( header() + 1 ) + i; }
+        inline uchar* payload( int i ) const
+        {
+            return reinterpret_cast<uchar*>( m_memory->data() ) + header()->headerSize + i * header()->slotSize;
+        }
+
+        QSharedMemory* m_memory;
+        QString m_error;
+        quint32 m_sequence; /** sequence number of the last frame published by this writer */
+
+        /** semaphores of the reader entries, opened when first signalled. Writer only */
+        QSystemSemaphore* m_readerSignals[SHAREDFRAMERING_MAX_READERS];
+
+        /** reader entry and semaphore of this reader, -1 and 0 if there is none */
+        int m_reader;
+        QSystemSemaphore* m_signal;
+
+        /** protects m_signalKey, which wake() reads from other threads */
+        mutable QMutex m_signalMutex;
+        QString m_signalKey;
+    };
+}
+
+#endif // SHAREDFRAMERING_H
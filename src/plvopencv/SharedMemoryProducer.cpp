@@ -0,0 +1,186 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvopencv module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include <QDebug>
+
+#include "SharedMemoryProducer.h"
+#include <plvcore/CvMatDataPin.h>
+
+using namespace plv;
+using namespace plvopencv;
+
+#define SHAREDMEMORY_DEFAULT_SEGMENT "parlevision"
+
+/** milliseconds between attempts to attach to a segment which does not exist yet */
+#define SHAREDMEMORYPRODUCER_ATTACH_INTERVAL 100
+
+/** milliseconds between polls when the sink can not signal this reader */
+#define SHAREDMEMORYPRODUCER_POLL_INTERVAL 5
+
+SharedMemoryProducer::SharedMemoryProducer() :
+    m_segment(SHAREDMEMORY_DEFAULT_SEGMENT),
+    m_sequence(0)
+{
+    m_outputPin = createCvMatDataOutputPin("image_output", this );
+    m_outputPin->addAllChannels();
+    m_outputPin->addAllDepths();
+
+    m_outSerial = createOutputPin<int>("serial", this);
+}
+
+SharedMemoryProducer::~SharedMemoryProducer()
+{
+    detach();
+}
+
+bool SharedMemoryProducer::start()
+{
+    // attach again when the segment has been changed
+    if( m_ring.isAttached() && m_attachedSegment != getSegment() )
+        detach();
+    return true;
+}
+
+bool SharedMemoryProducer::deinit() throw()
+{
+    detach();
+    return true;
+}
+
+PrefetchProducer::FetchResult SharedMemoryProducer::fetch( PrefetchFrame& frame )
+{
+    // called on the I/O thread
+    releaseUnused();
+
+    if( !m_ring.isAttached() )
+    {
+        QString segment = getSegment();
+        if( !m_ring.attach(segment) )
+        {
+            // the sink might not have published anything yet
+            sleepUnlessStopped( SHAREDMEMORYPRODUCER_ATTACH_INTERVAL );
+            return FETCH_NONE;
+        }
+        m_attachedSegment = segment;
+        m_sequence = 0;
+    }
+
+    quint32 sequence;
+    quint32 serial;
+    cv::Mat mat;
+    int slot = m_ring.acquireLatest( m_sequence, sequence, serial, mat );
+    if( slot < 0 )
+    {
+        // blocks until the sink publishes a frame or wakeFetch() is called
+        if( !m_ring.waitForFrame( m_sequence ) )
+            sleepUnlessStopped( SHAREDMEMORYPRODUCER_POLL_INTERVAL );
+        return FETCH_NONE;
+    }
+
+    // frames published since the last one we took were skipped,
+    // sequence numbers wrap around skipping 0
+    if( m_sequence != 0 )
+    {
+        quint32 skipped = sequence - m_sequence - 1;
+        if( sequence < m_sequence )
+            --skipped;
+        for( ; skipped > 0; --skipped )
+            getMetrics().itemDropped();
+    }
+    m_sequence = sequence;
+
+    // keep half of the slots free for the writer and other readers,
+    // when the pipeline holds on to many images they are copied
+    if( m_pinned.size() >= m_ring.getSlotCount() / 2 )
+    {
+        CvMatData image = CvMatData::create( CvMatDataProperties(mat) );
+        mat.copyTo( image.getWritable(false) );
+        m_ring.release( slot );
+        frame.put( m_outputPin, image );
+        frame.put( m_outSerial, (int)serial );
+        return FETCH_FRAME;
+    }
+
+    // the image refers to the segment, writing to it makes a copy
+    PinnedFrame pinned;
+    pinned.slot = slot;
+    pinned.image = CvMatData( mat );
+    m_pinned.append( pinned );
+
+    frame.put( m_outputPin, pinned.image );
+    frame.put( m_outSerial, (int)serial );
+    return FETCH_FRAME;
+}
+
+void SharedMemoryProducer::wakeFetch()
+{
+    m_ring.wake();
+}
+
+void SharedMemoryProducer::releaseUnused()
+{
+    QList<PinnedFrame>::iterator itr = m_pinned.begin();
+    while( itr != m_pinned.end() )
+    {
+        if( !itr->image.isShared() )
+        {
+            m_ring.release( itr->slot );
+            itr = m_pinned.erase( itr );
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+}
+
+void SharedMemoryProducer::detach()
+{
+    releaseUnused();
+    if( m_pinned.isEmpty() )
+    {
+        m_ring.detach();
+    }
+    else
+    {
+        // unmapping would pull the pixels from under the images
+        qWarning() << "SharedMemoryProducer: " << m_pinned.size()
+                   << " images of segment " << m_attachedSegment
+                   << " are still in use, leaving it mapped";
+        m_pinned.clear();
+        m_ring.abandon();
+    }
+    m_sequence = 0;
+}
+
+QString SharedMemoryProducer::getSegment() const
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_segment;
+}
+
+void SharedMemoryProducer::setSegment(const QString& segment)
+{
+    QMutexLocker lock( m_propertyMutex );
+    m_segment = segment;
+    lock.unlock();
+    emit segmentChanged(segment);
+}
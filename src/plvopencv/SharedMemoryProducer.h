@@ -0,0 +1,108 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvopencv module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef SHAREDMEMORYPRODUCER_H
+#define SHAREDMEMORYPRODUCER_H
+
+#include <QList>
+
+#include <plvcore/PrefetchProducer.h>
+#include <plvcore/OutputPin.h>
+#include <plvcore/CvMatData.h>
+
+#include "SharedFrameRing.h"
+
+namespace plv
+{
+    class CvMatDataOutputPin;
+}
+
+namespace plvopencv
+{
+    /** Produces the images a SharedMemorySink in another process publishes.
+      * The images refer to the pixels in the shared memory segment, they are
+      * not copied. The slot of an image stays pinned until the pipeline no
+      * longer uses it, elements which write to the image get a copy as usual.
+      * When the pipeline holds on to half of the slots, further images are
+      * copied so the sink keeps slots to write to. Only the latest image is
+      * taken, images published while the pipeline is busy are skipped and
+      * counted as dropped.
+      */
+    class SharedMemoryProducer : public plv::PrefetchProducer
+    {
+        Q_OBJECT
+        Q_CLASSINFO("author", "Richard Loos")
+        Q_CLASSINFO("name", "Shared memory producer")
+        Q_CLASSINFO("description", "Produces the images a Shared memory sink in another "
+                    "process on this host publishes into the segment with the given name.")
+
+        Q_PROPERTY( QString segment READ getSegment WRITE setSegment NOTIFY segmentChanged )
+
+        /** the I/O thread of PrefetchProducer waits for the sink to signal a frame */
+        PLV_PREFETCH_PRODUCER
+
+    public:
+        SharedMemoryProducer();
+        virtual ~SharedMemoryProducer();
+
+        virtual bool start();
+        virtual bool deinit() throw();
+
+        /** property methods */
+        QString getSegment() const;
+
+    signals:
+        void segmentChanged(const QString& segment);
+
+    public slots:
+        /** takes effect the next time the pipeline is started */
+        void setSegment(const QString& segment);
+
+    protected:
+        /** interrupts the wait for a frame */
+        virtual void wakeFetch();
+
+    private:
+        /** an image handed out while its slot is pinned */
+        struct PinnedFrame
+        {
+            int slot;
+            plv::CvMatData image;
+        };
+
+        /** unpins the slots of images only this producer still refers to */
+        void releaseUnused();
+
+        /** unpins what can be unpinned and detaches, abandons the mapping
+            when images of it are still in use */
+        void detach();
+
+        QString m_segment;
+        QString m_attachedSegment;
+        quint32 m_sequence; /** sequence number of the last frame taken, 0 for none */
+        QList<PinnedFrame> m_pinned;
+        SharedFrameRing m_ring;
+        plv::CvMatDataOutputPin* m_outputPin;
+        plv::OutputPin<int>* m_outSerial;
+    };
+}
+
+#endif // SHAREDMEMORYPRODUCER_H
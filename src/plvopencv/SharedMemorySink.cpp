@@ -0,0 +1,114 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvopencv module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include <QDebug>
+
+#include "SharedMemorySink.h"
+#include <plvcore/CvMatData.h>
+#include <plvcore/CvMatDataPin.h>
+
+using namespace plv;
+using namespace plvopencv;
+
+#define SHAREDMEMORY_DEFAULT_SEGMENT "parlevision"
+
+SharedMemorySink::SharedMemorySink() :
+    m_segment(SHAREDMEMORY_DEFAULT_SEGMENT),
+    m_slotCount(SHAREDFRAMERING_DEFAULT_SLOTS)
+{
+    m_inputPin = createCvMatDataInputPin( "input", this );
+    m_inputPin->addAllChannels();
+    m_inputPin->addAllDepths();
+}
+
+SharedMemorySink::~SharedMemorySink()
+{
+}
+
+bool SharedMemorySink::stop()
+{
+    // the segment lives on while readers are attached
+    m_ring.detach();
+    m_oversizedSize = cv::Size();
+    return true;
+}
+
+bool SharedMemorySink::process()
+{
+    CvMatData in = m_inputPin->get();
+    const cv::Mat& src = in.getReadOnly();
+    if( src.empty() )
+        return true;
+
+    // the slots are sized for the first image
+    if( !m_ring.isAttached() &&
+        !m_ring.create( getSegment(), getSlotCount(), (qint64)src.total() * src.elemSize() ) )
+    {
+        setError( PlvPipelineRuntimeError,
+                  tr("Failed to create shared memory segment %1: %2").arg(getSegment()).arg(m_ring.errorString()) );
+        return false;
+    }
+
+    if( !m_ring.publish( getProcessingSerial(), src ) )
+    {
+        getMetrics().itemDropped();
+        // frames are dropped until the size changes, only warn about the first
+        if( (qint64)src.total() * src.elemSize() > m_ring.getSlotSize() && src.size() != m_oversizedSize )
+        {
+            m_oversizedSize = src.size();
+            qWarning() << "SharedMemorySink: images of " << src.cols << "x" << src.rows
+                       << " do not fit in the slots of segment " << getSegment() << " and are dropped";
+        }
+    }
+    return true;
+}
+
+QString SharedMemorySink::getSegment() const
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_segment;
+}
+
+void SharedMemorySink::setSegment(const QString& segment)
+{
+    QMutexLocker lock( m_propertyMutex );
+    m_segment = segment;
+    lock.unlock();
+    emit segmentChanged(segment);
+}
+
+int SharedMemorySink::getSlotCount() const
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_slotCount;
+}
+
+void SharedMemorySink::setSlotCount(int count)
+{
+    // one slot for the writer and at least one for the readers
+    if( count < 2 )
+        count = 2;
+
+    QMutexLocker lock( m_propertyMutex );
+    m_slotCount = count;
+    lock.unlock();
+    emit slotCountChanged(count);
+}
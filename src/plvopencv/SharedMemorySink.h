@@ -0,0 +1,89 @@
+/**
+  * Copyright (C)2010 by Michel Jansen and Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvopencv module of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef SHAREDMEMORYSINK_H
+#define SHAREDMEMORYSINK_H
+
+#include <plvcore/PipelineProcessor.h>
+
+#include "SharedFrameRing.h"
+
+namespace plv
+{
+    class CvMatDataInputPin;
+}
+
+namespace plvopencv
+{
+    /** Publishes images into a named shared memory segment, from which
+      * SharedMemoryProducers in other ParleVision processes on the same
+      * host read them without copying. The segment is created on the
+      * first image and its slots are sized for that image, larger images
+      * are dropped. Frames are dropped as well when readers hold on to
+      * every slot, the sink never waits for its readers.
+      */
+    class SharedMemorySink : public plv::PipelineProcessor
+    {
+        Q_OBJECT
+        Q_DISABLE_COPY( SharedMemorySink )
+        Q_CLASSINFO("author", "Richard Loos")
+        Q_CLASSINFO("name", "Shared memory sink")
+        Q_CLASSINFO("description", "Publishes images into the shared memory segment "
+                    "with the given name for Shared memory producers in other processes "
+                    "on this host. The segment holds the given number of slots.")
+
+        Q_PROPERTY( QString segment READ getSegment WRITE setSegment NOTIFY segmentChanged )
+        Q_PROPERTY( int slotCount READ getSlotCount WRITE setSlotCount NOTIFY slotCountChanged )
+
+        /** required standard method declaration for plv::PipelineProcessor */
+        PLV_PIPELINE_PROCESSOR
+
+    public:
+        SharedMemorySink();
+        virtual ~SharedMemorySink();
+
+        virtual bool stop();
+
+        /** property methods */
+        QString getSegment() const;
+        int getSlotCount() const;
+
+    signals:
+        void segmentChanged(const QString& segment);
+        void slotCountChanged(int count);
+
+    public slots:
+        /** takes effect the next time the pipeline is started */
+        void setSegment(const QString& segment);
+        void setSlotCount(int count);
+
+    private:
+        plv::CvMatDataInputPin* m_inputPin;
+        QString m_segment;
+        int m_slotCount;
+        SharedFrameRing m_ring;
+
+        /** size of the last image which did not fit, warned about once */
+        cv::Size m_oversizedSize;
+    };
+}
+
+#endif // SHAREDMEMORYSINK_H
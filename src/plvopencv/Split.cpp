@@ -68,7 +68,7 @@ bool Split::process()
     }
 
     // open input images for reading
-    const cv::Mat& in = inImg;
+    const cv::Mat& in = inImg.getReadOnly();
 
     //Create the vector with output data
     std::vector<CvMatData> outImgs;
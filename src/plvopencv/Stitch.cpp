@@ -111,10 +111,10 @@ bool Stitch::process()
     }
 
     // open input images for reading
-    const cv::Mat& in0 = in0Img;
-    const cv::Mat& in1 = in1Img;
-    const cv::Mat& in2 = in2Img;
-    const cv::Mat& in3 = in3Img;
+    const cv::Mat& in0 = in0Img.getReadOnly();
+    const cv::Mat& in1 = in1Img.getReadOnly();
+    const cv::Mat& in2 = in2Img.getReadOnly();
+    const cv::Mat& in3 = in3Img.getReadOnly();
 
     // create output image, output image size may vary depending on parameters
 //    int outWidthRow1 = -(in0x) + in0Img.width() + in1Img.width() + in1x;
@@ -86,9 +86,9 @@ bool Sub::process()
 
     CvMatData out = CvMatData::create(in1.properties());
 
-    const cv::Mat& src1 = in1;
-    const cv::Mat& src2 = in2;
-    const cv::Mat& mask = maskData;
+    const cv::Mat& src1 = in1.getReadOnly();
+    const cv::Mat& src2 = in2.getReadOnly();
+    const cv::Mat& mask = maskData.getReadOnly();
     cv::Mat& dst = out;
 
     cv::subtract( src1, src2, dst, mask );
@@ -27,6 +27,7 @@
 #include <opencv/highgui.h>
 #include <string>
 #include <plvcore/CvMatDataPin.h>
+#include <plvcore/Clock.h>
 #include <QDir>
 
 using namespace plv;
@@ -34,6 +35,8 @@ using namespace plvopencv;
 
 VideoProducer::VideoProducer() :
     m_filename(""), m_directory(""), m_frameCount(0), m_posMillis(0), m_ratio(0), m_fps(0),
+    m_frameRate(0.0), m_seekFrame(0), m_seekTime(0), m_seekPending(false), m_seekByTime(false),
+    m_maxThroughput(false), m_frameIndex(0), m_paceStart(0), m_paceFrame(0),
     m_capture( new cv::VideoCapture() )
 {
     //create the output pin
@@ -94,29 +97,82 @@ QString VideoProducer::getDirectory()
     return m_directory;
 }
 
-bool VideoProducer::validateExtension(const QString& filename)
+int VideoProducer::getSeekFrame()
 {
-    // TODO
-    return true;
+    QMutexLocker lock( m_propertyMutex );
+    return m_seekFrame;
 }
 
-bool VideoProducer::init()
+void VideoProducer::setSeekFrame(int frame)
 {
-    //build the path
+    QMutexLocker lock( m_propertyMutex );
+    m_seekFrame = frame < 0 ? 0 : frame;
+    m_seekPending = true;
+    m_seekByTime = false;
+    emit seekFrameChanged(m_seekFrame);
+}
+
+int VideoProducer::getSeekTime()
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_seekTime;
+}
+
+void VideoProducer::setSeekTime(int millis)
+{
+    QMutexLocker lock( m_propertyMutex );
+    m_seekTime = millis < 0 ? 0 : millis;
+    m_seekPending = true;
+    m_seekByTime = true;
+    emit seekTimeChanged(m_seekTime);
+}
+
+bool VideoProducer::getMaxThroughput()
+{
+    QMutexLocker lock( m_propertyMutex );
+    return m_maxThroughput;
+}
+
+void VideoProducer::setMaxThroughput(bool maxThroughput)
+{
+    QMutexLocker lock( m_propertyMutex );
+    m_maxThroughput = maxThroughput;
+    emit maxThroughputChanged(maxThroughput);
+}
+
+QString VideoProducer::getPath()
+{
+    QMutexLocker lock( m_propertyMutex );
     QString path =  m_directory;
     if(!path.endsWith('/')) path.append('/');
     path.append(m_filename);
+    return path;
+}
 
+bool VideoProducer::validateExtension(const QString& filename)
+{
+    // TODO
+    return true;
+}
+
+bool VideoProducer::init()
+{
+    QString path = getPath();
     if(!m_capture->open(path.toStdString()))
     {
         setError(PlvPipelineInitError, tr("Failed to open video %1.").arg(path));
         return false;
     }
 
+    // these do not change while decoding, only the position is
+    // derived per frame from the frame index
     m_frameCount = (int)m_capture->get(CV_CAP_PROP_FRAME_COUNT);
-    m_posMillis = (long)m_capture->get(CV_CAP_PROP_POS_MSEC);
-    m_ratio = m_capture->get(CV_CAP_PROP_POS_AVI_RATIO);
-    m_fps = (int)m_capture->get(CV_CAP_PROP_FPS);
+    m_frameRate = m_capture->get(CV_CAP_PROP_FPS);
+    m_fps = (int)m_frameRate;
+    m_posMillis = 0;
+    m_ratio = 0;
+    m_frameIndex = 0;
+    m_paceStart = 0;
     return true;
 }
 
@@ -126,31 +182,100 @@ bool VideoProducer::deinit() throw()
     return true;
 }
 
-bool VideoProducer::readyToProduce() const
+bool VideoProducer::seek(int frame)
 {
-    return m_capture->grab();
+    if( m_frameCount > 0 && frame >= m_frameCount )
+        frame = m_frameCount - 1;
+
+    // most backends seek to the nearest key frame, so check
+    // where we ended up and decode forward from there
+    int pos = -1;
+    if( m_capture->set(CV_CAP_PROP_POS_FRAMES, frame) )
+        pos = (int)m_capture->get(CV_CAP_PROP_POS_FRAMES);
+
+    if( pos < 0 || pos > frame )
+    {
+        QString path = getPath();
+        if( !m_capture->open(path.toStdString()) )
+        {
+            setFetchError(PlvPipelineRuntimeError, tr("Failed to reopen video %1.").arg(path));
+            return false;
+        }
+        pos = 0;
+    }
+
+    for( ; pos < frame; ++pos )
+    {
+        if( !m_capture->grab() )
+            break;
+    }
+    m_frameIndex = pos;
+    return true;
 }
 
-bool VideoProducer::produce()
+PrefetchProducer::FetchResult VideoProducer::fetch( PrefetchFrame& frame )
 {
+    // called on the decoding thread
+    QMutexLocker lock( m_propertyMutex );
+    bool seekPending = m_seekPending;
+    int seekFrame = m_seekFrame;
+    if( m_seekByTime )
+        seekFrame = m_frameRate > 0.0 ? cvRound( m_seekTime * m_frameRate / 1000.0 ) : 0;
+    bool maxThroughput = m_maxThroughput;
+    m_seekPending = false;
+    lock.unlock();
+
+    if( seekPending )
+    {
+        flushPrefetched();
+        if( !seek(seekFrame) )
+            return FETCH_ERROR;
+        m_paceStart = 0;
+    }
+
+    // pace at the frame rate of the video unless we should go all out
+    if( !maxThroughput && m_frameRate > 0.0 )
+    {
+        if( m_paceStart == 0 )
+        {
+            m_paceStart = Clock::now();
+            m_paceFrame = m_frameIndex;
+        }
+        qint64 due = m_paceStart + (qint64)((m_frameIndex - m_paceFrame) * 1e9 / m_frameRate);
+        qint64 wait = due - Clock::now();
+        if( wait > 1000000 && !sleepUnlessStopped( (unsigned long)(wait / 1000000) ) )
+            return FETCH_NONE;
+    }
+    else
+    {
+        m_paceStart = 0;
+    }
+
+    // grab blocks for a full decode
+    if( !m_capture->grab() )
+        return FETCH_END;
+
     if( !m_capture->retrieve(m_frame, 0) )
     {
-        setError(PlvPipelineInitError, tr("Failed to grab frame"));
-        return false;
+        setFetchError(PlvPipelineRuntimeError, tr("Failed to grab frame"));
+        return FETCH_ERROR;
     }
-    CvMatData d = CvMatData::create(m_frame.properties());
-    m_frame.copyTo(d);
-    m_outputPin->put(d);
 
-    m_frameCount = (long)m_capture->get(CV_CAP_PROP_FRAME_COUNT);
-    m_posMillis = (long)m_capture->get(CV_CAP_PROP_POS_MSEC);
-    m_ratio = m_capture->get(CV_CAP_PROP_POS_AVI_RATIO);
-    m_fps = (int)m_capture->get(CV_CAP_PROP_FPS);
+    // the decoder reuses its buffer so the frame is copied once,
+    // straight into a buffer from the pool
+    CvMatData d = CvMatData::create(CvMatDataProperties(m_frame));
+    m_frame.copyTo(d.getWritable(false));
 
-    m_outFrameCount->put(m_frameCount);
-    m_outPositionMillis->put(m_posMillis);
-    m_outRatio->put(m_ratio);
-    m_outFps->put(m_fps);
+    // derived from the frame index instead of asking the backend every frame
+    m_posMillis = m_frameRate > 0.0 ? (long)(m_frameIndex * 1000.0 / m_frameRate) : 0;
+    m_ratio = m_frameCount > 0 ? (double)m_frameIndex / m_frameCount : 0.0;
+    ++m_frameIndex;
 
-    return true;
+    frame.put(m_outputPin, d);
+    frame.put(m_outFrameCount, m_frameCount);
+    frame.put(m_outPositionMillis, m_posMillis);
+    frame.put(m_outRatio, m_ratio);
+    frame.put(m_outFps, m_fps);
+
+    return FETCH_FRAME;
 }
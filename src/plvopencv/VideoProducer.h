@@ -22,7 +22,7 @@
 #ifndef VIDEOPRODUCER_H
 #define VIDEOPRODUCER_H
 
-#include <plvcore/PipelineProducer.h>
+#include <plvcore/PrefetchProducer.h>
 #include <plvcore/OutputPin.h>
 #include <plvcore/CvMatData.h>
 
@@ -38,7 +38,7 @@ namespace cv
 
 namespace plvopencv
 {
-    class VideoProducer : public plv::PipelineProducer
+    class VideoProducer : public plv::PrefetchProducer
     {
         Q_OBJECT
         Q_CLASSINFO("author", "Richard Loos")
@@ -47,9 +47,12 @@ namespace plvopencv
 
         Q_PROPERTY( QString filename READ getFilename WRITE setFilename NOTIFY filenameChanged )
         Q_PROPERTY( QString directory READ getDirectory WRITE setDirectory NOTIFY directoryChanged )
+        Q_PROPERTY( int seekFrame READ getSeekFrame WRITE setSeekFrame NOTIFY seekFrameChanged )
+        Q_PROPERTY( int seekTime READ getSeekTime WRITE setSeekTime NOTIFY seekTimeChanged )
+        Q_PROPERTY( bool maxThroughput READ getMaxThroughput WRITE setMaxThroughput NOTIFY maxThroughputChanged )
 
-        /** required standard method declaration for Producer */
-        PLV_PIPELINE_PRODUCER
+        /** frames are decoded ahead on the I/O thread of PrefetchProducer */
+        PLV_PREFETCH_PRODUCER
 
     public:
         VideoProducer();
@@ -65,14 +68,32 @@ namespace plvopencv
         QString getDirectory();
         void updateDirectory(const QString& s){ setDirectory(s); directoryChanged(s); }
 
+        int getSeekFrame();
+        int getSeekTime();
+        bool getMaxThroughput();
+
     signals:
         void filenameChanged(const QString& newValue);
         void directoryChanged(const QString& newValue);
+        void seekFrameChanged(int newValue);
+        void seekTimeChanged(int newValue);
+        void maxThroughputChanged(bool newValue);
 
     public slots:
         void setFilename(const QString& filename);
         void setDirectory(const QString& directory);
 
+        /** jumps to the frame with the given index. Frames which have been
+            decoded ahead are discarded. Takes effect on the decoding thread */
+        void setSeekFrame(int frame);
+
+        /** jumps to the frame at the given time in milliseconds */
+        void setSeekTime(int millis);
+
+        /** when true frames are decoded as fast as the pipeline takes them,
+            else they are paced at the frame rate of the video */
+        void setMaxThroughput(bool maxThroughput);
+
     private:
         QString m_filename;  /** the filename of the image to load */
         QString m_directory; /** the directory which contains the image. */
@@ -80,8 +101,20 @@ namespace plvopencv
         long m_posMillis; /** Film current position in milliseconds or video capture timestamp */
         double m_ratio; /** Relative position of the video file (0 - start of the film, 1 - end of the film) */
         int m_fps; /** frame rate of the video */
+        double m_frameRate; /** exact frame rate, read once when the video is opened */
 
-        plv::CvMatData m_frame;
+        int m_seekFrame; /** last requested seek target in frames */
+        int m_seekTime; /** last requested seek target in milliseconds */
+        bool m_seekPending; /** the last requested seek has not been done yet */
+        bool m_seekByTime; /** the last requested seek was to m_seekTime */
+        bool m_maxThroughput;
+
+        /** state of the decoding thread */
+        int m_frameIndex; /** index of the next frame to decode */
+        qint64 m_paceStart; /** Clock::now() at which m_paceFrame was due */
+        int m_paceFrame;
+
+        cv::Mat m_frame; /** refers to the decoder's internal buffer */
         plv::CvMatDataOutputPin* m_outputPin;
         plv::OutputPin<int>* m_outFrameCount;
         plv::OutputPin<long>* m_outPositionMillis;
@@ -89,6 +122,14 @@ namespace plvopencv
         plv::OutputPin<int>* m_outFps;
         cv::VideoCapture* m_capture;
 
+        /** @returns the path of the video */
+        QString getPath();
+
+        /** seeks the capture to frame, reopening the video when the backend
+            can not seek backwards or lands past the requested frame.
+            Called on the decoding thread. */
+        bool seek(int frame);
+
         /** This method checks whether the extension of the filename is one of the
           * accepted extensions for images by OpenCV. See:
           * http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html */
@@ -96,7 +96,7 @@ bool ViolaJonesFaceDetector::process()
     CvMatData dstPtr = CvMatData::create(srcPtr.properties());
 
     // open for reading
-    const cv::Mat& src = srcPtr;
+    const cv::Mat& src = srcPtr.getReadOnly();
 
     // open image for writing
     cv::Mat& dst = dstPtr;
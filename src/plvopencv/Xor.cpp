@@ -62,8 +62,8 @@ bool Xor::process()
     }
 
     // open input images for reading
-    const cv::Mat& mat1 = img1;
-    const cv::Mat& mat2 = img2;
+    const cv::Mat& mat1 = img1.getReadOnly();
+    const cv::Mat& mat2 = img2.getReadOnly();
 
     //get a new output image of same depth and size as input image
     plv::CvMatData imgOut = CvMatData::create( img1.properties() );
@@ -49,6 +49,10 @@ SOURCES += plvopencvplugin.cpp \
     DelayImage.cpp \
     ViolaJonesFaceDetector.cpp \
     SaveImageToFile.cpp \
+    SharedFrameRing.cpp \
+    SharedMemorySink.cpp \
+    SharedMemoryProducer.cpp \
+    ImageWriter.cpp \
     ImageThreshold.cpp \
     Trigger.cpp \
     PixelSum.cpp \
@@ -87,6 +91,10 @@ HEADERS +=  plvopencvplugin.h \
             DelayImage.h \
             ViolaJonesFaceDetector.h  \
             SaveImageToFile.h  \
+            ImageWriter.h \
+            SharedFrameRing.h \
+            SharedMemorySink.h \
+            SharedMemoryProducer.h \
             ImageThreshold.h \
             Trigger.h \
             PixelSum.h \
@@ -36,6 +36,8 @@
 #include "RunningAverage.h"
 #include "ForegroundDetector.h"
 #include "Crop.h"
+#include "SharedMemorySink.h"
+#include "SharedMemoryProducer.h"
 
 #include <plvcore/PipelineElementFactory.h>
 
@@ -56,6 +58,7 @@ void PlvOpenCVPlugin::onLoad()
     plvRegisterPipelineElement<plvopencv::ImageProducer>();
     plvRegisterPipelineElement<plvopencv::ImageDirectoryProducer>();
     plvRegisterPipelineElement<plvopencv::VideoProducer>();
+    plvRegisterPipelineElement<plvopencv::SharedMemoryProducer>();
 
     //processors
     plvRegisterPipelineElement<plvopencv::ExampleProcessor>();
@@ -77,6 +80,7 @@ void PlvOpenCVPlugin::onLoad()
     plvRegisterPipelineElement<plvopencv::CropSubImage>();
     plvRegisterPipelineElement<plvopencv::Trigger>();
     plvRegisterPipelineElement<plvopencv::SaveImageToFile>();
+    plvRegisterPipelineElement<plvopencv::SharedMemorySink>();
     plvRegisterPipelineElement<plvopencv::ImageThreshold>();
     plvRegisterPipelineElement<plvopencv::Xor>();
     plvRegisterPipelineElement<plvopencv::Multiply>();
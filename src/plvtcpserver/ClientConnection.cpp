@@ -0,0 +1,474 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "ClientConnection.h"
+#include "TCPClientProducer.h"
+#include "ImageCodec.h"
+#include "Proto.h"
+
+#include <QtNetwork>
+#include <limits>
+
+#include <plvcore/CvMatData.h>
+
+ClientConnection::ClientConnection( TCPClientProducer* producer, const QString& address, int port,
+                                    const Subscription& subscription, bool lowDelay, bool autoReconnect ) :
+    QObject(0),
+    m_producer(producer),
+    m_address(address),
+    m_port(port),
+    m_subscription(subscription),
+    m_lowDelay(lowDelay),
+    m_autoReconnect(autoReconnect),
+    m_closed(false),
+    m_tcpSocket(0),
+    m_reconnectTimer(0),
+    m_blockSize(0),
+    m_protocolVersion(PROTO_VERSION_1),
+    m_ackPending(false),
+    m_ackSerial(0)
+{
+}
+
+ClientConnection::~ClientConnection()
+{
+}
+
+void ClientConnection::open()
+{
+    if( m_tcpSocket == 0 )
+    {
+        m_tcpSocket = new QTcpSocket(this);
+        connect(m_tcpSocket, SIGNAL(readyRead()), this, SLOT(readData()));
+        connect(m_tcpSocket, SIGNAL(error(QAbstractSocket::SocketError)),
+                this, SLOT(error(QAbstractSocket::SocketError)));
+        connect(m_tcpSocket, SIGNAL(disconnected()), this, SLOT(disconnected()));
+        connect(m_tcpSocket, SIGNAL(connected()), this, SLOT(connected()));
+
+        m_reconnectTimer = new QTimer(this);
+        m_reconnectTimer->setSingleShot(true);
+        m_reconnectTimer->setInterval(CLIENTCONNECTION_RECONNECT_INTERVAL);
+        connect(m_reconnectTimer, SIGNAL(timeout()), this, SLOT(reconnect()));
+    }
+
+    m_closed = false;
+    skipAvailable();
+
+    qDebug() << "Connecting to " << m_address << ":" << m_port;
+
+    // returns immediately, if this fails error is
+    // called by the signal slot connection
+    m_tcpSocket->connectToHost( QHostAddress(m_address), m_port );
+}
+
+void ClientConnection::close()
+{
+    m_closed = true;
+    if( m_tcpSocket == 0 )
+        return;
+
+    m_reconnectTimer->stop();
+
+    qDebug() << "Disconnecting ... ";
+    m_tcpSocket->disconnectFromHost();
+
+    // if not immediately disconnected wait 5 seconds
+    int timeout = 5*1000;
+    if( m_tcpSocket->state() != QAbstractSocket::UnconnectedState &&
+        !m_tcpSocket->waitForDisconnected(timeout) )
+    {
+        qWarning() << "Failed to disconnect from server: " << m_tcpSocket->errorString();
+    }
+    m_tcpSocket->abort();
+    m_blockSize = 0;
+}
+
+void ClientConnection::reconnect()
+{
+    if( m_closed || m_tcpSocket->state() != QAbstractSocket::UnconnectedState )
+        return;
+
+    qWarning() << "Reconnecting to " << m_address << ":" << m_port;
+    m_tcpSocket->connectToHost( QHostAddress(m_address), m_port );
+}
+
+void ClientConnection::connected()
+{
+    qDebug() << "TCPClientProducer connected";
+
+    // Optimize the socket for low latency. For a QTcpSocket this
+    // sets the TCP_NODELAY option and disables Nagle's algorithm.
+    m_tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, m_lowDelay ? 1 : 0);
+    m_ackPending = false;
+
+    // every connection starts in version 1, ask for the newest
+    m_protocolVersion = PROTO_VERSION_1;
+    requestProtocolVersion();
+}
+
+void ClientConnection::disconnected()
+{
+    qDebug() << "TCPClientProducer disconnected";
+
+    skipAvailable();
+    m_protocolVersion = PROTO_VERSION_1;
+
+    if( m_autoReconnect && !m_closed )
+        m_reconnectTimer->start();
+}
+
+void ClientConnection::skipAvailable()
+{
+    qint64 bytes = m_tcpSocket->bytesAvailable();
+    if( bytes > 0 )
+    {
+        QDataStream in(m_tcpSocket);
+        in.setVersion(QDataStream::Qt_4_0);
+
+        // can skip 2^32 bytes at a time, skip until no bytes left
+        while( bytes > (qint64) std::numeric_limits<int>::max() )
+        {
+            in.skipRawData( std::numeric_limits<int>::max() );
+            bytes -= (qint64) std::numeric_limits<int>::max();
+        }
+        in.skipRawData( bytes );
+
+        bytes = m_tcpSocket->bytesAvailable();
+        if( bytes > 0 )
+        {
+            qDebug() << QString("%1 bytes left in socket after reconnect").arg(bytes);
+        }
+    }
+    m_blockSize = 0;
+}
+
+void ClientConnection::error(QAbstractSocket::SocketError socketError)
+{
+    if( m_closed )
+        return;
+
+    QString msg;
+    switch (socketError)
+    {
+    case QAbstractSocket::RemoteHostClosedError:
+        msg = tr("The remote host closed the connection.");
+        break;
+    case QAbstractSocket::HostNotFoundError:
+        msg = tr("The host was not found. Please check the "
+                 "host name and port settings.");
+        break;
+    case QAbstractSocket::ConnectionRefusedError:
+        msg = tr("The connection was refused by the peer. "
+                 "Make sure the Parlevision server is running, "
+                 "and check that the host name and port "
+                 "settings are correct.");
+        break;
+    default:
+       msg = tr("The following error occurred: %1.").arg(m_tcpSocket->errorString());
+    }
+    m_producer->connectionError(msg);
+
+    // a failed connect does not emit disconnected
+    if( m_autoReconnect && m_tcpSocket->state() == QAbstractSocket::UnconnectedState )
+        m_reconnectTimer->start();
+}
+
+void ClientConnection::readData()
+{
+    readMessages();
+
+    if( m_ackPending )
+    {
+        m_ackPending = false;
+        ackFrame(m_ackSerial);
+    }
+}
+
+void ClientConnection::readMessages()
+{
+    QDataStream in(m_tcpSocket);
+    in.setVersion(QDataStream::Qt_4_0);
+    if( m_protocolVersion >= PROTO_VERSION_2 )
+        in.setByteOrder(QDataStream::LittleEndian);
+
+    if( m_blockSize == 0 )
+    {
+        if( m_tcpSocket->bytesAvailable() < (int)sizeof(quint32) )
+            return;
+        in >> m_blockSize;
+    }
+
+    if( m_tcpSocket->bytesAvailable() < m_blockSize )
+        return;
+
+    bool data = true;
+    while( data && !m_closed )
+    {
+        quint32 opcode;
+        in >> opcode;
+
+        switch( opcode )
+        {
+        case PROTO_INIT:
+            quint32 version;
+            in >> version;
+            in.skipRawData( m_blockSize - 2*sizeof(quint32) );
+
+            // all messages after the reply use the new version
+            m_protocolVersion = version;
+            if( m_protocolVersion >= PROTO_VERSION_2 )
+                in.setByteOrder(QDataStream::LittleEndian);
+            qDebug() << "TCPClientProducer using protocol version " << m_protocolVersion;
+            break;
+        case PROTO_FRAME:
+            parseFrame(in);
+            break;
+        case PROTO_FRAME_V2:
+            parseFrameV2(in);
+            break;
+        default:
+            // error, invalid opcode
+            qWarning() << "Invalid opcode, skipping message";
+
+            // skip this message
+            in.skipRawData( m_blockSize - sizeof(quint32) );
+        }
+
+        if( m_tcpSocket->bytesAvailable() >= (int)sizeof(quint32) )
+        {
+            in >> m_blockSize;
+        }
+        else
+        {
+            m_blockSize = 0;
+            data = false;
+        }
+
+        if( m_tcpSocket->bytesAvailable() < m_blockSize )
+            data = false;
+    }
+}
+
+bool ClientConnection::parseFrame( QDataStream& in )
+{
+    QVariantList frame;
+
+    quint32 serial;
+    quint32 numargs;
+
+    in >> serial;
+    in >> numargs;
+
+    if( numargs < 1 )
+    {
+        // no arguments sent with header, skip this frame
+        qWarning() << "Invalid frame received. Skipping.";
+
+        // skip this message
+        in.skipRawData( m_blockSize - 3*sizeof(quint32) );
+        return false;
+    }
+
+    // parse all arguments using QVariant, images are read
+    // into pooled matrices by the CvMatData stream operator
+    for( unsigned int i=0; i < numargs; ++i )
+    {
+        QVariant v;
+        in >> v;
+
+        if( !v.isValid() || in.status() != QDataStream::Ok )
+        {
+            qDebug() << "Frame is not correct, invalid variant.";
+            in.resetStatus();
+            return false;
+        }
+        frame.append(v);
+    }
+
+    frameReceived(serial, frame);
+    return true;
+}
+
+bool ClientConnection::parseFrameV2( QDataStream& in )
+{
+    quint32 serial;
+    quint32 numargs;
+
+    in >> serial;
+    in >> numargs;
+
+    // bytes of this message left after the opcode, serial and count
+    qint64 remaining = m_blockSize - 3*sizeof(quint32);
+    if( numargs < 1 || (qint64)numargs * PROTO_V2_DESCRIPTOR_FIELDS * sizeof(quint32) > remaining )
+    {
+        qWarning() << "Invalid frame received. Skipping.";
+        in.skipRawData( remaining );
+        return false;
+    }
+
+    QVector<quint32> descriptors( numargs * PROTO_V2_DESCRIPTOR_FIELDS );
+    for( int i=0; i < descriptors.size(); ++i )
+        in >> descriptors[i];
+    remaining -= descriptors.size() * sizeof(quint32);
+
+    QVariantList frame;
+    for( unsigned int i=0; i < numargs; ++i )
+    {
+        const quint32* d = descriptors.constData() + i * PROTO_V2_DESCRIPTOR_FIELDS;
+        quint32 kind   = d[0];
+        int type       = d[1];
+        int rows       = d[2];
+        int cols       = d[3];
+        quint32 length = d[4];
+
+        if( length > remaining )
+        {
+            qWarning() << "Frame is not correct, payload larger than message.";
+            in.skipRawData( remaining );
+            return false;
+        }
+
+        QVariant v;
+        if( kind == PROTO_PAYLOAD_MAT )
+        {
+            plv::CvMatData data;
+            if( length > 0 )
+            {
+                if( plv::CvMatData::imageSize( cols, rows, type ) != length )
+                {
+                    qWarning() << "Frame is not correct, matrix size does not match its type.";
+                    in.skipRawData( remaining );
+                    return false;
+                }
+
+                // read the pixels straight into a matrix from the pool
+                data = plv::CvMatData::create( cols, rows, type );
+                cv::Mat& mat = data.getWritable( false );
+                in.readRawData( reinterpret_cast<char*>( mat.data ), length );
+            }
+            v.setValue( data );
+        }
+        else if( kind == PROTO_PAYLOAD_VARIANT )
+        {
+            QByteArray bytes( length, 0 );
+            in.readRawData( bytes.data(), length );
+
+            QDataStream vin( bytes );
+            vin.setVersion(QDataStream::Qt_4_0);
+            vin.setByteOrder(QDataStream::LittleEndian);
+            vin >> v;
+        }
+        else if( kind == PROTO_PAYLOAD_JPEG ||
+                 kind == PROTO_PAYLOAD_PNG ||
+                 kind == PROTO_PAYLOAD_LOSSLESS )
+        {
+            QByteArray bytes( length, 0 );
+            in.readRawData( bytes.data(), length );
+
+            plv::CvMatData data;
+            if( !ImageCodec::decode( kind, type, rows, cols, bytes.constData(), length, data ) )
+            {
+                qWarning() << "Frame is not correct, failed to decode image.";
+                in.skipRawData( remaining - length );
+                return false;
+            }
+            v.setValue( data );
+        }
+        else
+        {
+            qWarning() << "Skipping payload of unknown kind " << kind;
+            in.skipRawData( length );
+            remaining -= length;
+            continue;
+        }
+        remaining -= length;
+
+        if( !v.isValid() )
+        {
+            qDebug() << "Frame is not correct, invalid variant.";
+            in.skipRawData( remaining );
+            return false;
+        }
+        frame.append(v);
+    }
+
+    frameReceived(serial, frame);
+    return true;
+}
+
+void ClientConnection::frameReceived(quint32 serial, const QVariantList& frame)
+{
+    // hand the frame to the producer first, with the block policy
+    // this waits until there is room so the ack is held back as well
+    if( !m_producer->queueFrame(frame) )
+        return;
+
+    // send ack to the server for flow control, version 1
+    // servers expect an ack for every single frame
+    if( m_protocolVersion >= PROTO_VERSION_2 )
+    {
+        m_ackPending = true;
+        m_ackSerial = serial;
+    }
+    else
+    {
+        ackFrame(serial);
+    }
+}
+
+void ClientConnection::requestProtocolVersion()
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_0);
+
+    // always sent in version 1, servers which do not know
+    // PROTO_INIT skip it and keep sending version 1 frames
+    out << (quint32)((PROTO_INIT_FIELDS-1)*sizeof(quint32)); // size of message excluding 4 bytes for size
+    out << (quint32)PROTO_INIT;
+    out << (quint32)PROTO_VERSION;
+    out << m_subscription.pins;
+    out << (quint32)m_subscription.maxFps;
+    out << (quint32)m_subscription.width;
+    out << (quint32)m_subscription.height;
+
+    if( m_tcpSocket->write(bytes) == -1 )
+    {
+        qWarning() << tr("Failed to write INIT to socket.");
+    }
+}
+
+void ClientConnection::ackFrame(quint32 frameNumber)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_0);
+
+    // write the header
+    out << (quint32)(2*sizeof(quint32)); // size of message excluding 4 bytes for size
+    out << (quint32)PROTO_ACK;
+    out << (quint32)frameNumber;
+
+    if( m_tcpSocket->write(bytes) == -1 )
+    {
+        qWarning() << tr("Failed to write ACK to socket.");
+    }
+}
@@ -0,0 +1,103 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef CLIENTCONNECTION_H
+#define CLIENTCONNECTION_H
+
+#include <QObject>
+#include <QAbstractSocket>
+#include <QDataStream>
+#include <QVariantList>
+
+#include "Subscription.h"
+
+QT_FORWARD_DECLARE_CLASS( QTcpSocket )
+QT_FORWARD_DECLARE_CLASS( QTimer )
+
+class TCPClientProducer;
+
+/** milliseconds between attempts to reconnect to the server */
+#ifndef CLIENTCONNECTION_RECONNECT_INTERVAL
+#   define CLIENTCONNECTION_RECONNECT_INTERVAL 1000
+#endif
+
+/** The connection of a TCPClientProducer to its server. It lives in a
+  * receive thread of its own which reads and parses the messages, so the
+  * GUI thread and the pipeline never wait on the network. Images are read
+  * straight into matrices from the CvMatData pool. Parsed frames are handed
+  * to the producer, the frames read in one go are acknowledged together.
+  * Connecting never blocks, with autoReconnect the connection keeps trying
+  * every CLIENTCONNECTION_RECONNECT_INTERVAL ms until it is closed.
+  */
+class ClientConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    ClientConnection( TCPClientProducer* producer, const QString& address, int port,
+                      const Subscription& subscription, bool lowDelay, bool autoReconnect );
+    virtual ~ClientConnection();
+
+public slots:
+    /** starts connecting to the server and returns immediately */
+    void open();
+
+    /** disconnects from the server and stops reconnecting */
+    void close();
+
+private slots:
+    void connected();
+    void disconnected();
+    void error(QAbstractSocket::SocketError socketError);
+    void readData();
+    void reconnect();
+
+private:
+    void readMessages();
+    bool parseFrame(QDataStream& in);
+    bool parseFrameV2(QDataStream& in);
+    void frameReceived(quint32 serial, const QVariantList& frame);
+    void requestProtocolVersion();
+    void ackFrame(quint32 frameNumber);
+
+    /** skips everything left in the socket */
+    void skipAvailable();
+
+    TCPClientProducer* m_producer;
+    QString m_address;
+    int m_port;
+    Subscription m_subscription;
+    bool m_lowDelay;
+    bool m_autoReconnect;
+    bool m_closed;
+
+    QTcpSocket* m_tcpSocket;      /** created in the receive thread by open() */
+    QTimer* m_reconnectTimer;
+    int m_blockSize;
+    int m_protocolVersion;
+
+    /** version 2 servers take cumulative acks, so the frames read in one go
+        are acknowledged with a single ack for the last of them */
+    bool m_ackPending;
+    quint32 m_ackSerial;
+};
+
+#endif // CLIENTCONNECTION_H
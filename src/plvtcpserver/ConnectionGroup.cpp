@@ -0,0 +1,135 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "ConnectionGroup.h"
+#include "ServerConnection.h"
+
+#include <QDebug>
+
+ConnectionGroup::ConnectionGroup( SubscriptionRegistry* subscriptions ) :
+    QObject(0),
+    m_connectionCount(0),
+    m_subscriptions(subscriptions)
+{
+}
+
+ConnectionGroup::~ConnectionGroup()
+{
+    qDeleteAll(m_connections);
+}
+
+void ConnectionGroup::addConnection(int socketDescriptor, bool lossless, int maxFrameQueue, int maxFramesInFlight,
+                                    bool lowDelay)
+{
+    ServerConnection* connection = new ServerConnection(socketDescriptor, lossless, maxFrameQueue, maxFramesInFlight,
+                                                        lowDelay, m_subscriptions);
+
+    connect( connection, SIGNAL(onError(PlvErrorType,QString)),
+             this, SLOT(connectionError(PlvErrorType,QString)) );
+    connect( connection, SIGNAL(waitingOnClient(ServerConnection*,bool)),
+             this, SIGNAL(waitingOnClient(ServerConnection*,bool)) );
+    connect( connection, SIGNAL(finished()),
+             this, SLOT(connectionFinished()) );
+
+    // counted by connectionAssigned() already
+    m_connections.append(connection);
+    connection->start();
+}
+
+void ConnectionGroup::queueFrame(WireFramePtr frame)
+{
+    foreach( ServerConnection* connection, m_connections )
+    {
+        connection->queueFrame(frame);
+    }
+}
+
+void ConnectionGroup::stopAll()
+{
+    QList<ServerConnection*> connections = m_connections;
+    m_connections.clear();
+    m_connectionCount = 0;
+
+    foreach( ServerConnection* connection, connections )
+    {
+        connection->disconnect(this);
+        connection->stop();
+        delete connection;
+    }
+}
+
+void ConnectionGroup::connectionFinished()
+{
+    ServerConnection* connection = qobject_cast<ServerConnection*>(sender());
+    if( m_connections.removeOne(connection) )
+    {
+        m_connectionCount.deref();
+        connection->deleteLater();
+    }
+}
+
+void ConnectionGroup::connectionError(PlvErrorType type, const QString& msg)
+{
+    // a client which goes away only ends its own connection,
+    // fatal errors stop the server
+    if( type != PlvNonFatalError )
+    {
+        emit onError(type, msg);
+        return;
+    }
+
+    qWarning() << "ConnectionGroup: dropping connection: " << msg;
+    ServerConnection* connection = qobject_cast<ServerConnection*>(sender());
+    if( connection != 0 && m_connections.contains(connection) )
+        connection->stop();
+}
+
+void ConnectionGroup::setMaxFrameQueue(int max)
+{
+    foreach( ServerConnection* connection, m_connections )
+    {
+        connection->setMaxFrameQueue(max);
+    }
+}
+
+void ConnectionGroup::setMaxFramesInFlight(int max)
+{
+    foreach( ServerConnection* connection, m_connections )
+    {
+        connection->setMaxFramesInFlight(max);
+    }
+}
+
+void ConnectionGroup::setLossless(bool lossless)
+{
+    foreach( ServerConnection* connection, m_connections )
+    {
+        connection->setLossless(lossless);
+    }
+}
+
+void ConnectionGroup::setLowDelay(bool lowDelay)
+{
+    foreach( ServerConnection* connection, m_connections )
+    {
+        connection->setLowDelay(lowDelay);
+    }
+}
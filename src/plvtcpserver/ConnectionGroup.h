@@ -0,0 +1,93 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef CONNECTIONGROUP_H
+#define CONNECTIONGROUP_H
+
+#include <QObject>
+#include <QList>
+#include <QAtomicInt>
+
+#include <plvcore/plvglobal.h>
+
+#include "WireFrame.h"
+
+class ServerConnection;
+class SubscriptionRegistry;
+
+/** The connections served by one I/O thread of the Server. The group
+  * lives in its I/O thread together with its connections, so all their
+  * sockets are multiplexed by the event loop of that thread. Frames reach
+  * the group with a single queued call and are handed to every connection
+  * by reference.
+  */
+class ConnectionGroup : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** subscriptions is where the connections register what their
+        clients subscribed to, it has to outlive the group */
+    ConnectionGroup( SubscriptionRegistry* subscriptions );
+    virtual ~ConnectionGroup();
+
+    /** number of connections in this group, including the ones assigned
+        to it which addConnection() has not created yet. Thread safe */
+    inline int getConnectionCount() const { return m_connectionCount; }
+
+    /** counts a connection which is about to be added with a queued call
+        to addConnection(), so connections accepted in a burst are spread
+        over the groups. Thread safe */
+    inline void connectionAssigned() { m_connectionCount.ref(); }
+
+public slots:
+    /** creates and starts a connection for the accepted socket */
+    void addConnection(int socketDescriptor, bool lossless, int maxFrameQueue, int maxFramesInFlight,
+                       bool lowDelay);
+
+    /** queues frame on every connection of this group */
+    void queueFrame(WireFramePtr frame);
+
+    /** disconnects and deletes all connections */
+    void stopAll();
+
+    void setMaxFrameQueue(int max);
+    void setMaxFramesInFlight(int max);
+    void setLossless(bool lossless);
+    void setLowDelay(bool lowDelay);
+
+signals:
+    void onError(PlvErrorType type, const QString& msg);
+    void waitingOnClient(ServerConnection* connection, bool waiting);
+
+private slots:
+    void connectionFinished();
+
+    /** drops the connection on a non fatal error, passes fatal errors on */
+    void connectionError(PlvErrorType type, const QString& msg);
+
+private:
+    QList<ServerConnection*> m_connections;
+    QAtomicInt m_connectionCount;
+    SubscriptionRegistry* m_subscriptions;
+};
+
+#endif // CONNECTIONGROUP_H
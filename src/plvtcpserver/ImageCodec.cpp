@@ -0,0 +1,229 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "ImageCodec.h"
+#include "Proto.h"
+
+#include <QDebug>
+#include <QStringList>
+#include <QtEndian>
+#include <opencv/highgui.h>
+
+#include <plvcore/CvMatData.h>
+
+namespace
+{
+    /** replaces every element by its difference with the same channel of
+        the element to its left, modulo the range of T */
+    template<typename T>
+    void deltaEncode( const cv::Mat& mat, T* out )
+    {
+        const int cn = mat.channels();
+        const int width = mat.cols * cn;
+        for( int r=0; r < mat.rows; ++r )
+        {
+            const T* row = mat.ptr<T>(r);
+            for( int i=0; i < cn && i < width; ++i )
+                out[i] = row[i];
+            for( int i=cn; i < width; ++i )
+                out[i] = (T)(row[i] - row[i-cn]);
+            out += width;
+        }
+    }
+
+    template<typename T>
+    void deltaDecode( cv::Mat& mat )
+    {
+        const int cn = mat.channels();
+        const int width = mat.cols * cn;
+        for( int r=0; r < mat.rows; ++r )
+        {
+            T* row = mat.ptr<T>(r);
+            for( int i=cn; i < width; ++i )
+                row[i] = (T)(row[i] + row[i-cn]);
+        }
+    }
+}
+
+bool ImageCodec::canEncode( int codec, int type )
+{
+    const int depth = CV_MAT_DEPTH( type );
+    const int channels = CV_MAT_CN( type );
+
+    switch( codec )
+    {
+    case CODEC_JPEG:
+        return depth == CV_8U && ( channels == 1 || channels == 3 );
+    case CODEC_PNG:
+        return ( depth == CV_8U || depth == CV_16U ) &&
+               ( channels == 1 || channels == 3 || channels == 4 );
+    case CODEC_LOSSLESS:
+        return true;
+    case CODEC_RAW:
+    default:
+        return false;
+    }
+}
+
+quint32 ImageCodec::encode( const ImageEncoding& encoding, const cv::Mat& mat, QByteArray& out )
+{
+    if( mat.empty() || !canEncode( encoding.codec, mat.type() ) )
+        return 0;
+
+    if( encoding.codec == CODEC_LOSSLESS )
+    {
+        const int rowSize = mat.cols * mat.elemSize();
+        QByteArray delta( rowSize * mat.rows, 0 );
+        switch( mat.depth() )
+        {
+        case CV_8U:
+        case CV_8S:
+            deltaEncode<uchar>( mat, reinterpret_cast<uchar*>( delta.data() ) );
+            break;
+        case CV_16U:
+        case CV_16S:
+            deltaEncode<ushort>( mat, reinterpret_cast<ushort*>( delta.data() ) );
+            break;
+        default:
+            // no prediction for wider types, only compress
+            for( int r=0; r < mat.rows; ++r )
+                memcpy( delta.data() + r * rowSize, mat.ptr(r), rowSize );
+            break;
+        }
+        out = qCompress( delta, IMAGECODEC_LOSSLESS_LEVEL );
+        return PROTO_PAYLOAD_LOSSLESS;
+    }
+
+    std::vector<int> params;
+    std::string ext;
+    quint32 kind;
+    if( encoding.codec == CODEC_JPEG )
+    {
+        ext = ".jpg";
+        kind = PROTO_PAYLOAD_JPEG;
+        params.push_back( CV_IMWRITE_JPEG_QUALITY );
+        params.push_back( encoding.param );
+    }
+    else
+    {
+        ext = ".png";
+        kind = PROTO_PAYLOAD_PNG;
+        params.push_back( CV_IMWRITE_PNG_COMPRESSION );
+        params.push_back( encoding.param );
+    }
+
+    std::vector<uchar> buffer;
+    if( !cv::imencode( ext, mat, buffer, params ) )
+        return 0;
+
+    out = QByteArray( reinterpret_cast<const char*>( &buffer[0] ), buffer.size() );
+    return kind;
+}
+
+bool ImageCodec::decode( quint32 kind, int type, int rows, int cols,
+                         const char* data, qint64 length, plv::CvMatData& out )
+{
+    // the descriptor comes from the network, check it before allocating
+    qint64 size = plv::CvMatData::imageSize( cols, rows, type );
+    if( size < 0 )
+        return false;
+
+    if( kind == PROTO_PAYLOAD_LOSSLESS )
+    {
+        // qUncompress allocates the size in the header of the data
+        if( length < 4 ||
+            qFromBigEndian<quint32>( reinterpret_cast<const uchar*>( data ) ) != size )
+            return false;
+
+        QByteArray delta = qUncompress( reinterpret_cast<const uchar*>( data ), length );
+        if( delta.size() != size )
+            return false;
+
+        out = plv::CvMatData::create( cols, rows, type );
+        cv::Mat& mat = out.getWritable( false );
+
+        // pooled matrices are continuous
+        memcpy( mat.data, delta.constData(), delta.size() );
+        switch( mat.depth() )
+        {
+        case CV_8U:
+        case CV_8S:
+            deltaDecode<uchar>( mat );
+            break;
+        case CV_16U:
+        case CV_16S:
+            deltaDecode<ushort>( mat );
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    if( kind == PROTO_PAYLOAD_JPEG || kind == PROTO_PAYLOAD_PNG )
+    {
+        cv::Mat buffer( 1, length, CV_8UC1, const_cast<char*>( data ) );
+        cv::Mat mat = cv::imdecode( buffer, CV_LOAD_IMAGE_UNCHANGED );
+        if( mat.type() != type || mat.rows != rows || mat.cols != cols )
+            return false;
+
+        out = plv::CvMatData( mat );
+        return true;
+    }
+    return false;
+}
+
+bool ImageCodec::parse( const QString& spec, ImageEncoding& encoding )
+{
+    QStringList parts = spec.trimmed().toLower().split(':');
+    QString name = parts.at(0).trimmed();
+
+    if( name == "raw" )
+    {
+        encoding = ImageEncoding( CODEC_RAW );
+    }
+    else if( name == "jpeg" || name == "jpg" )
+    {
+        encoding = ImageEncoding( CODEC_JPEG, IMAGECODEC_DEFAULT_JPEG_QUALITY );
+    }
+    else if( name == "png" )
+    {
+        encoding = ImageEncoding( CODEC_PNG, IMAGECODEC_DEFAULT_PNG_COMPRESSION );
+    }
+    else if( name == "lossless" )
+    {
+        encoding = ImageEncoding( CODEC_LOSSLESS );
+    }
+    else
+    {
+        return false;
+    }
+
+    if( parts.size() > 1 )
+    {
+        bool ok;
+        int param = parts.at(1).trimmed().toInt( &ok );
+        if( !ok )
+            return false;
+        encoding.param = param;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef IMAGECODEC_H
+#define IMAGECODEC_H
+
+#include <QByteArray>
+#include <QString>
+#include <opencv/cv.h>
+
+namespace plv
+{
+    class CvMatData;
+}
+
+#ifndef IMAGECODEC_DEFAULT_JPEG_QUALITY
+#   define IMAGECODEC_DEFAULT_JPEG_QUALITY 90
+#endif
+
+/** fast compression, the network is rarely the bottleneck on a LAN
+    once the images are compressed at all */
+#ifndef IMAGECODEC_DEFAULT_PNG_COMPRESSION
+#   define IMAGECODEC_DEFAULT_PNG_COMPRESSION 1
+#endif
+
+/** zlib level of the lossless codec */
+#ifndef IMAGECODEC_LOSSLESS_LEVEL
+#   define IMAGECODEC_LOSSLESS_LEVEL 1
+#endif
+
+/** How an image pin of the TCP server is sent */
+enum ImageCodecType
+{
+    CODEC_RAW,
+    CODEC_JPEG,     /** param is the quality from 0 to 100 */
+    CODEC_PNG,      /** param is the compression level from 0 to 9 */
+    CODEC_LOSSLESS  /** delta coding and fast zlib, meant for depth and 16 bit images */
+};
+
+struct ImageEncoding
+{
+    int codec;
+    int param;
+
+    ImageEncoding( int c = CODEC_RAW, int p = 0 ) : codec( c ), param( p ) {}
+};
+
+/** Encodes and decodes the compressed image payloads of version 2 of the
+  * TCP protocol, see Proto.h.
+  */
+class ImageCodec
+{
+public:
+    /** @returns true if the codec can encode images of this type. JPEG only
+        takes 8 bit images with 1 or 3 channels, PNG 8 or 16 bit images
+        with 1, 3 or 4 channels */
+    static bool canEncode( int codec, int type );
+
+    /** encodes mat into out. @returns the PROTO_PAYLOAD kind of the encoded
+        data or 0 if the image could not be encoded */
+    static quint32 encode( const ImageEncoding& encoding, const cv::Mat& mat, QByteArray& out );
+
+    /** decodes a payload of kind into out, which gets the type and size
+        given in the descriptor. @returns false if the data is corrupt or the
+        descriptor is not a valid image, nothing is allocated in that case */
+    static bool decode( quint32 kind, int type, int rows, int cols,
+                        const char* data, qint64 length, plv::CvMatData& out );
+
+    /** parses an encoding like "jpeg:80", "png", "lossless" or "raw".
+        A missing parameter is set to the default of the codec */
+    static bool parse( const QString& spec, ImageEncoding& encoding );
+};
+
+#endif // IMAGECODEC_H
@@ -22,8 +22,56 @@
 #ifndef PROTO_H
 #define PROTO_H
 
-#define PROTO_FRAME 0x000000
-#define PROTO_INIT  0x000001
-#define PROTO_ACK   0x000003
+/** Message opcodes. Every message starts with a quint32 holding the number
+    of bytes which follow it, then a quint32 opcode. Version 1 messages are
+    written with QDataStream in big endian order. */
+#define PROTO_FRAME    0x000000
+#define PROTO_INIT     0x000001
+#define PROTO_ACK      0x000003
+#define PROTO_FRAME_V2 0x000004
+
+/** Protocol versions. A connection starts at version 1. A client which
+    supports more sends PROTO_INIT with the highest version it supports and
+    the server replies with PROTO_INIT holding the version it will use from
+    then on. Servers which do not know PROTO_INIT skip the message and keep
+    sending version 1 frames, so both sides keep working with older peers. */
+#define PROTO_VERSION_1 1
+#define PROTO_VERSION_2 2
+#define PROTO_VERSION   PROTO_VERSION_2
+
+/** The PROTO_INIT message of a client can subscribe to part of the frames:
+
+        size | opcode | version | pins | maxFps | width | height
+
+    Bit i of pins selects value i of the frames, in the order of the input
+    pins of the server, 0 selects all values. maxFps limits the frame rate,
+    width and height the size images are scaled down to. 0 means no limit.
+    Clients which leave out these fields get everything. The number of
+    fields includes the opcode. */
+#define PROTO_INIT_FIELDS 6
+
+/** Version 2 frames are sent as PROTO_FRAME_V2 and only use fixed size
+    little endian quint32 fields:
+
+        size | opcode | serial | count | count descriptors | payloads
+
+    A descriptor is kind | type | rows | cols | length. The payloads follow
+    in descriptor order without padding. Matrix payloads hold the raw rows
+    of the matrix, type is its OpenCV type. Variant payloads hold a QVariant
+    written by a little endian QDataStream. Messages from the client to the
+    server keep the version 1 layout. */
+#define PROTO_V2_HEADER_FIELDS     4
+#define PROTO_V2_DESCRIPTOR_FIELDS 5
+
+#define PROTO_PAYLOAD_MAT     0x000001
+#define PROTO_PAYLOAD_VARIANT 0x000002
+
+/** Encoded matrix payloads. Type, rows and cols describe the decoded
+    matrix, length is the size of the encoded data. Lossless payloads are
+    zlib compressed (qCompress) rows where every 8 and 16 bit element holds
+    the difference with the same channel of the element to its left. */
+#define PROTO_PAYLOAD_JPEG     0x000003
+#define PROTO_PAYLOAD_PNG      0x000004
+#define PROTO_PAYLOAD_LOSSLESS 0x000005
 
 #endif // PROTO_H
@@ -21,6 +21,7 @@
 
 #include "Server.h"
 #include "ServerConnection.h"
+#include "ConnectionGroup.h"
 #include "Proto.h"
 #include <QImage>
 #include <QImageWriter>
@@ -28,62 +29,107 @@
 Server::Server(QObject *parent) : QTcpServer(parent),
     m_lossless(false),
     m_maxFramesInQueue(1),
-    m_maxFramesInFlight(1)
+    m_maxFramesInFlight(SERVER_DEFAULT_MAX_FRAMES_IN_FLIGHT),
+    m_lowDelay(false),
+    m_ioThreads(SERVER_DEFAULT_IO_THREADS)
 {
+    qRegisterMetaType<WireFramePtr>("WireFramePtr");
+    qRegisterMetaType<ServerConnection*>("ServerConnection*");
+
     connect( this, SIGNAL( stalled(ServerConnection*) ), parent, SLOT( stalled(ServerConnection*) ) );
     connect( this, SIGNAL( unstalled(ServerConnection*) ), parent, SLOT( unstalled(ServerConnection*) ) );
 }
 
-void Server::incomingConnection(int socketDescriptor)
+Server::~Server()
 {
-    qDebug() << "Server: incoming connection";
-
-    QMutexLocker lock(&m_serverPropMutex);
-    ServerConnection* connection = new ServerConnection(socketDescriptor, m_lossless, m_maxFramesInQueue, m_maxFramesInFlight);
-    lock.unlock();
-
-    // let errors go through the error reporting signal of this class
-    connect( this, SIGNAL( onError(PlvErrorType,QString)),
-             connection, SIGNAL(onError(PlvErrorType,QString)));
-
-    // move the connection to its own thread
-    QThreadEx* connectionThread = new QThreadEx();
-    connection->moveToThread(connectionThread);
-
-    // when the connection is done it is scheduled for deletion
-    connect( connection, SIGNAL(finished()),
-             connection, SLOT(deleteLater()));
-
-    // when the connection is done, it stops its thread
-    connect( connection, SIGNAL(finished()),
-             connectionThread, SLOT(quit()));
-
-    // start the connection when its thread is started
-    connect( connectionThread, SIGNAL(started()),
-             connection, SLOT(start()));
-
-    // inform server when this serverthead is waiting on the client
-    connect( connection, SIGNAL( waitingOnClient(ServerConnection*,bool)),
-             this, SLOT( serverThreadStalled(ServerConnection*,bool)) );
-
-    connect( parent(), SIGNAL( maxFrameQueueChanged(int) ),
-             connection, SLOT( setMaxFrameQueue(int) ) );
+    stopIoThreads();
+}
 
-    connect( parent(), SIGNAL( maxFramesInFlightChanged(int) ),
-             connection, SLOT( setMaxFramesInFlight(int)) );
+void Server::startIoThreads()
+{
+    Q_ASSERT( m_groups.isEmpty() );
+
+    for( int i=0; i < getIoThreads(); ++i )
+    {
+        ConnectionGroup* group = new ConnectionGroup(&m_subscriptions);
+        QThreadEx* thread = new QThreadEx();
+        group->moveToThread(thread);
+
+        // let errors of the connections go through the error reporting signal of this class
+        connect( group, SIGNAL(onError(PlvErrorType,QString)),
+                 this, SIGNAL(onError(PlvErrorType,QString)) );
+
+        // inform server when a connection is waiting on the client
+        connect( group, SIGNAL( waitingOnClient(ServerConnection*,bool)),
+                 this, SLOT( serverThreadStalled(ServerConnection*,bool)) );
+
+        // every group receives all broadcasts and hands them to its connections
+        connect( this, SIGNAL( broadcastFrame(WireFramePtr)),
+                 group, SLOT( queueFrame(WireFramePtr)));
+
+        connect( this, SIGNAL( maxFramesInQueueChanged(int) ),
+                 group, SLOT( setMaxFrameQueue(int) ) );
+        connect( this, SIGNAL( maxFramesInFlightChanged(int) ),
+                 group, SLOT( setMaxFramesInFlight(int) ) );
+        connect( this, SIGNAL( losslessChanged(bool) ),
+                 group, SLOT( setLossless(bool) ) );
+        connect( this, SIGNAL( lowDelayChanged(bool) ),
+                 group, SLOT( setLowDelay(bool) ) );
+
+        m_groups.append(group);
+        m_threads.append(thread);
+        thread->start();
+    }
+}
 
-    connect( parent(), SIGNAL( losslessChanged(bool) ),
-             connection, SLOT( setLossless(bool)) );
+void Server::stopIoThreads()
+{
+    disconnectAll();
+
+    for( int i=0; i < m_threads.size(); ++i )
+    {
+        QThreadEx* thread = m_threads.at(i);
+        thread->quit();
+        thread->wait();
+
+        // the thread is done so the group can be deleted from here
+        delete m_groups.at(i);
+        delete thread;
+    }
+    m_groups.clear();
+    m_threads.clear();
+}
 
-    // stop this connection when stopAllConnections is called
-    connect( this, SIGNAL(stopAllConnections()), connection, SLOT(stop()));
+void Server::incomingConnection(int socketDescriptor)
+{
+    qDebug() << "Server: incoming connection";
 
-    // start the connection thread and its event loop
-    connectionThread->start();
+    if( m_groups.isEmpty() )
+    {
+        qWarning() << "Server: no I/O threads running, refusing connection";
+        QTcpSocket socket;
+        socket.setSocketDescriptor(socketDescriptor);
+        socket.abort();
+        return;
+    }
+
+    // add the connection to the least loaded I/O thread. The group
+    // is charged now, the connection is only created by the queued call
+    ConnectionGroup* group = m_groups.first();
+    foreach( ConnectionGroup* g, m_groups )
+    {
+        if( g->getConnectionCount() < group->getConnectionCount() )
+            group = g;
+    }
+    group->connectionAssigned();
 
-    // connection receives all broadcasts and sends it to its connection
-    connect( this, SIGNAL( broadcastFrame(quint32,QByteArray)),
-             connection, SLOT( queueFrame(quint32,QByteArray)));
+    QMutexLocker lock(&m_serverPropMutex);
+    QMetaObject::invokeMethod(group, "addConnection", Qt::QueuedConnection,
+                              Q_ARG(int, socketDescriptor),
+                              Q_ARG(bool, m_lossless),
+                              Q_ARG(int, m_maxFramesInQueue),
+                              Q_ARG(int, m_maxFramesInFlight),
+                              Q_ARG(bool, m_lowDelay));
 }
 
 void Server::setMaxFramesInQueue(int max)
@@ -91,6 +137,8 @@ void Server::setMaxFramesInQueue(int max)
     Q_ASSERT_X(max >= 1, "Server::setMaxFramesInQueue", "max frames in queue should be larger than 0");
     QMutexLocker lock(&m_serverPropMutex);
     m_maxFramesInQueue = max;
+    lock.unlock();
+    emit maxFramesInQueueChanged(max);
 }
 
 void Server::setMaxFramesInFlight(int max)
@@ -98,12 +146,31 @@ void Server::setMaxFramesInFlight(int max)
     Q_ASSERT_X(max >= 1, "Server::setMaxFramesInFlight", "max frames in flight should be larger than 0");
     QMutexLocker lock(&m_serverPropMutex);
     m_maxFramesInFlight = max;
+    lock.unlock();
+    emit maxFramesInFlightChanged(max);
 }
 
 void Server::setLossless(bool lossless)
 {
     QMutexLocker lock(&m_serverPropMutex);
     m_lossless = lossless;
+    lock.unlock();
+    emit losslessChanged(lossless);
+}
+
+void Server::setLowDelay(bool lowDelay)
+{
+    QMutexLocker lock(&m_serverPropMutex);
+    m_lowDelay = lowDelay;
+    lock.unlock();
+    emit lowDelayChanged(lowDelay);
+}
+
+void Server::setIoThreads(int threads)
+{
+    Q_ASSERT_X(threads >= 1, "Server::setIoThreads", "number of I/O threads should be larger than 0");
+    QMutexLocker lock(&m_serverPropMutex);
+    m_ioThreads = threads;
 }
 
 int Server::getMaxFramesInFlight() const
@@ -124,14 +191,45 @@ bool Server::getLossless() const
     return m_lossless;
 }
 
-void Server::sendFrame(quint32 frameNumber, const QByteArray& data)
+bool Server::getLowDelay() const
+{
+    QMutexLocker lock(&m_serverPropMutex);
+    return m_lowDelay;
+}
+
+int Server::getIoThreads() const
+{
+    QMutexLocker lock(&m_serverPropMutex);
+    return m_ioThreads;
+}
+
+int Server::getConnectionCount() const
+{
+    int count = 0;
+    foreach( ConnectionGroup* group, m_groups )
+    {
+        count += group->getConnectionCount();
+    }
+    return count;
+}
+
+QList<Subscription> Server::getSubscriptions() const
+{
+    return m_subscriptions.getDistinct();
+}
+
+void Server::sendFrame(const WireFramePtr& frame)
 {
-    emit broadcastFrame(frameNumber, data);
+    emit broadcastFrame(frame);
 }
 
 void Server::disconnectAll()
 {
-    emit stopAllConnections();
+    // wait until every group has closed its connections
+    foreach( ConnectionGroup* group, m_groups )
+    {
+        QMetaObject::invokeMethod(group, "stopAll", Qt::BlockingQueuedConnection);
+    }
 }
 
 void Server::serverThreadStalled( ServerConnection* connection, bool isStalled )
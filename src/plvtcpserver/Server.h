@@ -28,43 +28,85 @@
 #include <QVariantList>
 #include <QMutex>
 
+#include "WireFrame.h"
+#include "Subscription.h"
+
+/** default number of I/O threads serving the connections */
+#ifndef SERVER_DEFAULT_IO_THREADS
+#   define SERVER_DEFAULT_IO_THREADS 2
+#endif
+
+/** default number of frames sent before the client has to acknowledge,
+    so the frame rate is not bound by the round trip time */
+#ifndef SERVER_DEFAULT_MAX_FRAMES_IN_FLIGHT
+#   define SERVER_DEFAULT_MAX_FRAMES_IN_FLIGHT 4
+#endif
+
 class ServerConnection;
+class ConnectionGroup;
+class QThreadEx;
 
+/** Accepts clients and spreads them over a fixed number of I/O threads,
+  * each serving a ConnectionGroup. Connections are added to the group with
+  * the fewest connections.
+  */
 class Server : public QTcpServer
 {
     Q_OBJECT
 
 public:
     Server(QObject *parent);
+    virtual ~Server();
+
+    /** starts the I/O threads, call before listen() */
+    void startIoThreads();
+
+    /** disconnects all connections and stops the I/O threads */
+    void stopIoThreads();
 
 public slots:
-    /** sends the content of the array to all connected clients.
-        Calls queueFrame slot of all server threads */
-    void sendFrame(quint32 frameNumber, const QByteArray& data);
+    /** sends the frame to all connected clients. The frame is shared by
+        reference. Makes one queued call per I/O thread */
+    void sendFrame(const WireFramePtr& frame);
 
-    /** stops all connection threads and disconnects connections */
+    /** disconnects all connections */
     void disconnectAll();
 
-    /** called when one of the connection threads has stalled */
+    /** called when one of the connections has stalled */
     void serverThreadStalled( ServerConnection* connection, bool stalled );
 
     void setLossless(bool lossless);
     void setMaxFramesInQueue(int max);
     void setMaxFramesInFlight(int max);
+    void setLowDelay(bool lowDelay);
+
+    /** number of I/O threads, takes effect on the next startIoThreads() */
+    void setIoThreads(int threads);
 
     int getMaxFramesInFlight() const;
     int getMaxFramesInQueue() const;
     bool getLossless() const;
+    bool getLowDelay() const;
+    int getIoThreads() const;
+
+    /** number of connected clients */
+    int getConnectionCount() const;
+
+    /** the distinct subscriptions of the connected clients which do not
+        take the whole frame, thread safe */
+    QList<Subscription> getSubscriptions() const;
 
 signals:
     /** is fired when an error has occured in this Server or in one
         of its Connection threads */
     void onError(PlvErrorType type, const QString& msg);
 
-    /** stops all connection threads and disconnects connections */
-    void stopAllConnections();
+    void broadcastFrame(WireFramePtr frame);
 
-    void broadcastFrame(quint32 serial, QByteArray);
+    void maxFramesInQueueChanged(int max);
+    void maxFramesInFlightChanged(int max);
+    void losslessChanged(bool lossless);
+    void lowDelayChanged(bool lowDelay);
 
     void stalled(ServerConnection*);
     void unstalled(ServerConnection*);
@@ -75,7 +117,13 @@ private:
     bool m_lossless;
     int m_maxFramesInQueue;
     int m_maxFramesInFlight;
+    bool m_lowDelay;
+    int m_ioThreads;
     mutable QMutex m_serverPropMutex;
+
+    QList<QThreadEx*> m_threads;
+    QList<ConnectionGroup*> m_groups; /** one per I/O thread */
+    SubscriptionRegistry m_subscriptions;
 };
 
 /** Helper class for a QThread to run its own event loop */
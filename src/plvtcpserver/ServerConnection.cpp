@@ -22,10 +22,13 @@
 #include "ServerConnection.h"
 #include "Proto.h"
 
+#include <plvcore/Clock.h>
+
 #include <QtNetwork>
 #include <assert.h>
 
-ServerConnection::ServerConnection(int socketDescriptor, bool lossless, int maxFrameQueue, int maxFramesInFlight) :
+ServerConnection::ServerConnection(int socketDescriptor, bool lossless, int maxFrameQueue, int maxFramesInFlight,
+                                   bool lowDelay, SubscriptionRegistry* subscriptions) :
     QObject(0),
     m_tcpSocket(0),
     m_socketDescriptor(socketDescriptor),
@@ -34,13 +37,23 @@ ServerConnection::ServerConnection(int socketDescriptor, bool lossless, int maxF
     m_lossless(lossless),
     m_maxFramesInQueue(maxFrameQueue),
     m_maxFramesInFlight(maxFramesInFlight),
-    m_blockSize(0)
+    m_blockSize(0),
+    m_version(PROTO_VERSION_1),
+    m_pendingVersion(0),
+    m_lowDelay(lowDelay),
+    m_srtt(0),
+    m_rttvar(0),
+    m_subscriptions(subscriptions),
+    m_nextFrameTime(0)
 {
     connect( this, SIGNAL( scheduleSend()), this, SLOT(sendData()), Qt::QueuedConnection );
 }
 
 ServerConnection::~ServerConnection()
 {
+    if( m_subscriptions != 0 )
+        m_subscriptions->remove(m_subscription);
+
     if( m_tcpSocket != 0 )
     {
         delete m_tcpSocket;
@@ -48,17 +61,29 @@ ServerConnection::~ServerConnection()
     }
 }
 
-void ServerConnection::queueFrame(quint32 frameNumber, QByteArray frameData)
+void ServerConnection::queueFrame(WireFramePtr frame)
 {
     if( m_tcpSocket == 0 )
         return;
 
-    Frame f(frameNumber, frameData);
+    // skip frames which come in faster than the client asked for. The
+    // send times are kept on a fixed schedule so the average rate is
+    // maxFps, but a late frame does not build up credit for a burst
+    if( m_subscription.maxFps > 0 )
+    {
+        qint64 now = plv::Clock::now();
+        if( now < m_nextFrameTime )
+            return;
+        qint64 interval = 1000000000LL / m_subscription.maxFps;
+        m_nextFrameTime = qMax( m_nextFrameTime + interval, now - interval );
+    }
+
+    Frame f(frame->getVariant(m_subscription));
 
     // append to queue of this connection
     m_frameQueue.append(f);
 
-    if( m_frameNumbersInFlight.size() < m_maxFramesInFlight )
+    if( m_framesInFlight.size() < m_maxFramesInFlight )
     {
         sendData();
     }
@@ -84,7 +109,7 @@ void ServerConnection::queueFrame(quint32 frameNumber, QByteArray frameData)
 
     if(m_frameQueue.size() > m_maxFramesInQueue)
     {
-        if( m_lossless )
+        if( m_lossless && m_frameQueue.size() <= SERVERCONNECTION_MAX_LOSSLESS_QUEUE )
         {
             if( !m_waiting )
             {
@@ -94,15 +119,24 @@ void ServerConnection::queueFrame(quint32 frameNumber, QByteArray frameData)
         }
         else
         {
-            // drop the oldest frame
-            Frame f = m_frameQueue.takeFirst();
-            qDebug() << "Connection " << m_tcpSocket->peerAddress().toString() << ":"
-                     << m_tcpSocket->peerPort() << " dropped frame " << f.serial;
+            dropOldestFrame();
         }
     }
     emit scheduleSend();
 }
 
+void ServerConnection::dropOldestFrame()
+{
+    // a frame which is partially written has to be finished
+    int i = m_frameQueue.first().sent > 0 ? 1 : 0;
+    if( i >= m_frameQueue.size() )
+        return;
+
+    Frame f = m_frameQueue.takeAt(i);
+    qDebug() << "Connection " << m_tcpSocket->peerAddress().toString() << ":"
+             << m_tcpSocket->peerPort() << " dropped frame " << f.serial;
+}
+
 void ServerConnection::sendData()
 {
     if( m_tcpSocket == 0 ||
@@ -122,47 +156,22 @@ void ServerConnection::sendData()
 //    }
 
     bool overflow = false;
-    while(!( m_frameNumbersInFlight.size() >= m_maxFramesInFlight ||
+    while(!( m_framesInFlight.size() >= m_maxFramesInFlight ||
              m_frameQueue.isEmpty() ||
              overflow ))
     {
         Frame& f = m_frameQueue.first();
-        if( f.sent == 0 )
+        if( writeFrame(f, overflow) )
         {
-            qint64 bytesSent = m_tcpSocket->write(f.bytes);
-            if( bytesSent < f.bytes.size() )
-            {
-                if( bytesSent != -1 )
-                    f.sent = bytesSent;
-                else
-                    overflow = true;
-            }
-            else
-            {
-                m_frameNumbersInFlight.append(f.serial);
-                m_frameQueue.removeFirst();
-            }
-        }
-        else
-        {
-            const char* ptr = f.bytes.data();
-            ptr += f.sent;
-            qint64 len = f.bytes.size() - f.sent;
-
-            qint64 bytesSent = m_tcpSocket->write(ptr, len);
-
-            if( bytesSent < len )
-            {
-                if( bytesSent != -1 )
-                    f.sent = f.sent + bytesSent;
-                else
-                    overflow = true;
-            }
-            else
-            {
-                m_frameNumbersInFlight.append(f.serial);
-                m_frameQueue.removeFirst();
-            }
+            FrameInFlight sent;
+            sent.serial = f.serial;
+            sent.sentAt = plv::Clock::now();
+            m_framesInFlight.append(sent);
+            m_frameQueue.removeFirst();
+
+            // the version switch has to go in between two frames
+            if( m_pendingVersion != 0 )
+                sendInitReply();
         }
 
         if( overflow )
@@ -173,28 +182,126 @@ void ServerConnection::sendData()
     }
 }
 
-void ServerConnection::ackFrame(quint32 serial)
+bool ServerConnection::writeFrame(Frame& f, bool& failed)
 {
-    if( m_frameNumbersInFlight.isEmpty() )
+    if( f.version == 0 )
+        f.version = m_version;
+
+    // write the chunks straight from the shared frame, skipping
+    // what has been written already
+    const QList<WireChunk>& chunks = f.wire->getChunks(f.version);
+    qint64 offset = 0;
+    foreach( const WireChunk& chunk, chunks )
     {
-        qWarning() << "Ignoring ack received for frame " << serial << " while no ack was expected.";
+        if( f.sent < offset + chunk.size )
+        {
+            qint64 skip = f.sent - offset;
+            qint64 len = chunk.size - skip;
+            qint64 bytesSent = m_tcpSocket->write(chunk.data + skip, len);
+            if( bytesSent == -1 )
+            {
+                failed = true;
+                return false;
+            }
+
+            f.sent += bytesSent;
+            if( bytesSent < len )
+                return false;
+        }
+        offset += chunk.size;
+    }
+    return true;
+}
+
+void ServerConnection::initReceived(quint32 version, const Subscription& subscription)
+{
+    // frames queued from now on are sent with the new subscription
+    if( m_subscriptions != 0 )
+    {
+        m_subscriptions->add(subscription);
+        m_subscriptions->remove(m_subscription);
+    }
+    m_subscription = subscription;
+    m_nextFrameTime = 0;
+
+    qDebug() << "Connection " << m_tcpSocket->peerAddress().toString() << ":"
+             << m_tcpSocket->peerPort() << " subscribed to pins " << subscription.pins
+             << " at " << subscription.maxFps << " fps, size "
+             << subscription.width << "x" << subscription.height;
+
+    m_pendingVersion = qBound(PROTO_VERSION_1, (int)version, PROTO_VERSION);
+
+    // a partially written frame has to be finished in the old version first
+    if( m_frameQueue.isEmpty() || m_frameQueue.first().sent == 0 )
+        sendInitReply();
+}
+
+void ServerConnection::sendInitReply()
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_0);
+
+    // the reply itself is still written in the old version
+    out << (quint32)(2*sizeof(quint32)); // size of message excluding 4 bytes for size
+    out << (quint32)PROTO_INIT;
+    out << (quint32)m_pendingVersion;
+
+    if( m_tcpSocket->write(bytes) == -1 )
+    {
+        qWarning() << "Failed to write INIT reply to socket.";
         return;
     }
-    quint32 expectedSerial = m_frameNumbersInFlight.first();
-    if( expectedSerial == serial )
+
+    qDebug() << "Connection " << m_tcpSocket->peerAddress().toString() << ":"
+             << m_tcpSocket->peerPort() << " uses protocol version " << m_pendingVersion;
+
+    m_version = m_pendingVersion;
+    m_pendingVersion = 0;
+}
+
+void ServerConnection::ackFrame(quint32 serial)
+{
+    int acked = -1;
+    for( int i=0; i < m_framesInFlight.size() && acked < 0; ++i )
     {
-        m_frameNumbersInFlight.removeFirst();
+        if( m_framesInFlight.at(i).serial == serial )
+            acked = i;
     }
-    else
+
+    if( acked < 0 )
     {
-        qWarning() << "Ignoring ack received for frame " << serial << " while expected frame " << expectedSerial << ".";
+        qWarning() << "Ignoring ack received for frame " << serial << " which is not in flight.";
+        return;
     }
 
+    // the ack covers all frames sent before serial as well
+    updateRtt( (plv::Clock::now() - m_framesInFlight.at(acked).sentAt) / 1000.0 );
+    m_framesInFlight.erase(m_framesInFlight.begin(), m_framesInFlight.begin() + acked + 1);
+
     if( m_lossless && m_waiting )
     {
         m_waiting = false;
         emit waitingOnClient(this, m_waiting);
     }
+
+    // the window has room again
+    if( !m_frameQueue.isEmpty() )
+        emit scheduleSend();
+}
+
+void ServerConnection::updateRtt(double sample)
+{
+    if( m_srtt == 0 )
+    {
+        m_srtt = sample;
+        m_rttvar = sample / 2;
+    }
+    else
+    {
+        m_rttvar = 0.75 * m_rttvar + 0.25 * qAbs(m_srtt - sample);
+        m_srtt = 0.875 * m_srtt + 0.125 * sample;
+    }
 }
 
 void ServerConnection::readyRead()
@@ -227,7 +334,31 @@ void ServerConnection::readyRead()
             break;
 
         case PROTO_INIT:
+        {
+            quint32 version;
+            in >> version;
+
+            // the subscription is optional, older clients only send the version
+            Subscription subscription;
+            int fields = 2;
+            if( m_blockSize >= (int)(PROTO_INIT_FIELDS * sizeof(quint32)) )
+            {
+                quint32 maxFps, width, height;
+                in >> subscription.pins >> maxFps >> width >> height;
+                subscription.maxFps = (int)maxFps;
+                subscription.width = (int)width;
+                subscription.height = (int)height;
+                fields = PROTO_INIT_FIELDS;
+            }
+            initReceived(version, subscription);
+
+            // skip fields added by later versions
+            in.skipRawData(m_blockSize - fields*sizeof(quint32));
+            break;
+        }
+
         case PROTO_FRAME:
+        case PROTO_FRAME_V2:
         default:
             // error, invalid opcode
             qWarning() << "Invalid or unexpected opcode, skipping message";
@@ -267,10 +398,6 @@ void ServerConnection::start()
 
     m_tcpSocket = new QTcpSocket();
 
-    // Try to optimize the socket for low latency.
-    // For a QTcpSocket this would set the TCP_NODELAY option
-    // and disable Nagle's algorithm.
-    //m_tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
 
     // connect signals of tcp socket
     connect( m_tcpSocket, SIGNAL(connected()), this, SLOT(connected()) );
@@ -286,11 +413,16 @@ void ServerConnection::start()
         emit finished();
         return;
     }
+
+    // Optimize the socket for low latency. For a QTcpSocket this
+    // sets the TCP_NODELAY option and disables Nagle's algorithm.
+    setLowDelay(m_lowDelay);
 }
 
 void ServerConnection::stop()
 {
-    m_tcpSocket->disconnectFromHost();
+    if( m_tcpSocket != 0 )
+        m_tcpSocket->disconnectFromHost();
 }
 
 void ServerConnection::connected()
@@ -302,6 +434,10 @@ void ServerConnection::connected()
 
 void ServerConnection::disconnected()
 {
+    qDebug() << "Connection " << m_tcpSocket->peerAddress().toString() << ":"
+             << m_tcpSocket->peerPort() << " closed, round trip time "
+             << m_srtt << " +- " << m_rttvar << " us";
+
     // schedule for deletion according to documentation of disconnected:
     // Warning: If you need to delete the sender() of
     // this signal in a slot connected to it, use the deleteLater() function.
@@ -326,6 +462,13 @@ void ServerConnection::setLossless(bool lossless)
     m_lossless = lossless;
 }
 
+void ServerConnection::setLowDelay(bool lowDelay)
+{
+    m_lowDelay = lowDelay;
+    if( m_tcpSocket != 0 )
+        m_tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, lowDelay ? 1 : 0);
+}
+
 void ServerConnection::error(QAbstractSocket::SocketError socketError)
 {
     switch (socketError)
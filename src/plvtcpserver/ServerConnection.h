@@ -29,32 +29,67 @@
 
 #include <plvcore/plvglobal.h>
 
+#include "WireFrame.h"
+#include "Subscription.h"
+
 //#define MAX_FRAMES_IN_QUEUE 1
 //#define MAX_FRAMES_IN_FLIGHT 1
 //#define MAX_BYTES_TO_WRITE 64
 
+/** frames a lossless connection queues while waiting on its client
+    before it drops frames after all */
+#ifndef SERVERCONNECTION_MAX_LOSSLESS_QUEUE
+#   define SERVERCONNECTION_MAX_LOSSLESS_QUEUE 64
+#endif
+
 class Frame
 {
 public:
     quint32 serial;
-    QByteArray bytes;
+    WireFramePtr wire;
+    int version; /** protocol version the frame is sent with, fixed once sending started */
     qint64 sent;
     QTime time;
 
-    Frame(quint32 s, QByteArray& b) : serial(s), bytes(b), sent(0)
+    Frame(const WireFramePtr& w) : serial(w->getSerial()), wire(w), version(0), sent(0)
     {
         time.start();
     }
 };
 
+/** A frame which has been written but not acknowledged yet */
+struct FrameInFlight
+{
+    quint32 serial;
+    qint64 sentAt; /** plv::Clock time at which the last byte was written */
+};
+
+/** Sends frames to a single client. Up to maxFramesInFlight frames are
+  * sent before the client has to acknowledge them. Acks are cumulative:
+  * an ack for a frame also acknowledges every frame sent before it, so
+  * clients can ack a batch of frames at once. The round trip time of the
+  * client is estimated from the acks like TCP does (RFC 6298).
+  * Clients can subscribe to a part of the frame in their PROTO_INIT
+  * message, the connection then sends the variant of each frame for that
+  * subscription and skips frames to stay under the requested frame rate.
+  */
 class ServerConnection : public QObject
 {
     Q_OBJECT
 
 public:
-    ServerConnection(int socketDescriptor, bool lossless, int maxFrameQueue, int maxFramesInFlight);
+    ServerConnection(int socketDescriptor, bool lossless, int maxFrameQueue, int maxFramesInFlight,
+                     bool lowDelay = false, SubscriptionRegistry* subscriptions = 0);
     virtual ~ServerConnection();
 
+    /** smoothed round trip time in microseconds, 0 before the first ack */
+    inline double getSmoothedRtt() const { return m_srtt; }
+
+    /** round trip time variation in microseconds */
+    inline double getRttVariation() const { return m_rttvar; }
+
+    inline const Subscription& getSubscription() const { return m_subscription; }
+
 public slots:
     void start();
     void stop();
@@ -65,8 +100,9 @@ public slots:
     /** queues the frame in the internal frame queue. The frame will
         be dropped if the queue is at its maximum size and the connection
         is not lossless. If the connection is lossless and the queue is full
-        it will emit the waitingOnClient signal */
-    void queueFrame(quint32 frameNumber, QByteArray frameData);
+        it will emit the waitingOnClient signal, and only drops frames when
+        the queue reaches SERVERCONNECTION_MAX_LOSSLESS_QUEUE */
+    void queueFrame(WireFramePtr frame);
 
     void sendData();
 
@@ -79,6 +115,10 @@ public slots:
     void setMaxFramesInFlight(int max);
     void setLossless(bool lossless);
 
+    /** disables Nagle's algorithm on the socket when enabled, so small
+        messages and the tail of frames are sent without delay */
+    void setLowDelay(bool lowDelay);
+
 signals:
     void onError(PlvErrorType type, const QString& msg);
     void finished();
@@ -91,8 +131,25 @@ signals:
     void scheduleSend();
 
 private:
+    /** acknowledges serial and all frames sent before it */
     void ackFrame(quint32 serial);
 
+    /** updates the round trip time estimate with a sample in microseconds */
+    void updateRtt(double sample);
+
+    /** drops the oldest frame which has not been partially sent */
+    void dropOldestFrame();
+
+    /** writes the rest of the frame, returns true when it has been written
+        completely. Sets failed when the socket did not accept data */
+    bool writeFrame(Frame& f, bool& failed);
+
+    /** handles the PROTO_INIT message of a client */
+    void initReceived(quint32 version, const Subscription& subscription);
+
+    /** tells the client which protocol version is used from now on */
+    void sendInitReply();
+
     QTcpSocket* m_tcpSocket;
     int m_socketDescriptor;
     QString m_errorString;
@@ -101,8 +158,16 @@ private:
     int m_maxFramesInQueue;
     int m_maxFramesInFlight;
     int m_blockSize;
-
-    QList<quint32> m_frameNumbersInFlight; /** framenumbers which have not been ack-ed yet */
+    int m_version;          /** protocol version frames are sent with */
+    int m_pendingVersion;   /** version to confirm after the current frame, 0 if none */
+    bool m_lowDelay;
+    double m_srtt;
+    double m_rttvar;
+    Subscription m_subscription;
+    SubscriptionRegistry* m_subscriptions; /** shared by all connections of the server, can be 0 */
+    qint64 m_nextFrameTime;  /** plv::Clock time from which the next frame may be queued */
+
+    QList<FrameInFlight> m_framesInFlight; /** frames which have not been ack-ed yet, in send order */
     QList<Frame> m_frameQueue;
 };
 
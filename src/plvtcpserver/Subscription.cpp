@@ -0,0 +1,69 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "Subscription.h"
+
+QString Subscription::key() const
+{
+    return QString("%1:%2x%3").arg(pins).arg(width).arg(height);
+}
+
+void SubscriptionRegistry::add( const Subscription& subscription )
+{
+    if( subscription.isDefault() )
+        return;
+
+    QMutexLocker lock( &m_mutex );
+    QString key = subscription.key();
+    if( m_entries.contains(key) )
+    {
+        ++m_entries[key].count;
+    }
+    else
+    {
+        Entry entry;
+        entry.subscription = subscription;
+        entry.count = 1;
+        m_entries.insert(key, entry);
+    }
+}
+
+void SubscriptionRegistry::remove( const Subscription& subscription )
+{
+    if( subscription.isDefault() )
+        return;
+
+    QMutexLocker lock( &m_mutex );
+    QString key = subscription.key();
+    if( m_entries.contains(key) && --m_entries[key].count == 0 )
+        m_entries.remove(key);
+}
+
+QList<Subscription> SubscriptionRegistry::getDistinct() const
+{
+    QMutexLocker lock( &m_mutex );
+    QList<Subscription> subscriptions;
+    foreach( const Entry& entry, m_entries )
+    {
+        subscriptions.append(entry.subscription);
+    }
+    return subscriptions;
+}
@@ -0,0 +1,73 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef SUBSCRIPTION_H
+#define SUBSCRIPTION_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+/** What a client asked for in its PROTO_INIT message */
+struct Subscription
+{
+    quint32 pins;   /** bit i selects value i of the frames, 0 selects all */
+    int maxFps;     /** highest frame rate the client wants, 0 is unlimited */
+    int width;      /** images are scaled down to fit width by height, */
+    int height;     /** 0 leaves that dimension unconstrained */
+
+    Subscription() : pins(0), maxFps(0), width(0), height(0) {}
+
+    /** @returns true if the client gets the frames as they are */
+    inline bool isDefault() const { return pins == 0 && width == 0 && height == 0; }
+
+    /** @returns a key which is the same for subscriptions which get the
+        same frame content. The frame rate does not change the content */
+    QString key() const;
+};
+
+/** The subscriptions of all connected clients, so the frame variants
+  * they need can be prepared once per frame instead of once per client.
+  * Thread safe.
+  */
+class SubscriptionRegistry
+{
+public:
+    void add( const Subscription& subscription );
+    void remove( const Subscription& subscription );
+
+    /** @returns one subscription for every distinct content key which is
+        not the default */
+    QList<Subscription> getDistinct() const;
+
+private:
+    struct Entry
+    {
+        Subscription subscription;
+        int count;
+    };
+
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+};
+
+#endif // SUBSCRIPTION_H
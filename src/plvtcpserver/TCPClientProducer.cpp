@@ -20,18 +20,27 @@
   */
 
 #include "TCPClientProducer.h"
+#include "ClientConnection.h"
 #include <QtNetwork>
-#include "Proto.h"
-#include <limits>
+
+enum DropPolicy {
+    DROP_OLDEST,
+    DROP_NEWEST,
+    DROP_BLOCK
+};
 
 TCPClientProducer::TCPClientProducer() :
-    m_tcpSocket(new QTcpSocket(this)),
     m_ipAddress(QHostAddress(QHostAddress::LocalHost).toString()),
     m_port(1337),
-    m_blockSize(0),
     m_networkSession(0),
-    m_configured( true ),
-    m_autoReconnect( false )
+    m_autoReconnect( false ),
+    m_lowDelay( false ),
+    m_maxFps( 0 ),
+    m_maxWidth( 0 ),
+    m_maxHeight( 0 ),
+    m_maxFrames( TCPCLIENTPRODUCER_DEFAULT_MAX_FRAMES ),
+    m_connection( 0 ),
+    m_stopping( false )
 {
     m_intOut      = plv::createOutputPin<int>("int", this);
     m_stringOut   = plv::createOutputPin<QString>("QString", this);
@@ -40,29 +49,20 @@ TCPClientProducer::TCPClientProducer() :
     m_imageOut1    = plv::createCvMatDataOutputPin("CvMatData1", this);
     m_imageOut2    = plv::createCvMatDataOutputPin("CvMatData2", this);
 
-    // Try to optimize the socket for low latency.
-    // For a QTcpSocket this would set the TCP_NODELAY option
-    // and disable Nagle's algorithm.
-    //m_tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
-
-    connect(m_tcpSocket, SIGNAL(readyRead()), this, SLOT(readData()));
-    connect(m_tcpSocket, SIGNAL(error(QAbstractSocket::SocketError)),
-            this, SLOT(displayError(QAbstractSocket::SocketError)));
-
-    connect(m_tcpSocket, SIGNAL(disconnected()), this, SLOT(disconnected()));
-    connect(m_tcpSocket, SIGNAL(connected()), this, SLOT(connected()));
+    m_dropPolicy.add("Drop oldest", DROP_OLDEST);
+    m_dropPolicy.add("Drop newest", DROP_NEWEST);
+    m_dropPolicy.add("Block", DROP_BLOCK);
 }
 
 TCPClientProducer::~TCPClientProducer()
 {
-    m_tcpSocket->disconnect();
-    delete m_tcpSocket;
+    if( m_connection != 0 )
+        stop();
 }
 
 bool TCPClientProducer::init()
 {
     assert( m_networkSession == 0 );
-    assert( m_tcpSocket != 0 );
 
     QNetworkConfigurationManager manager;
     if (manager.capabilities() & QNetworkConfigurationManager::NetworkSessionRequired)
@@ -104,97 +104,60 @@ bool TCPClientProducer::deinit() throw ()
 
 bool TCPClientProducer::start()
 {
-    // connect to server
-
     // if we did not find one, use IPv4 localhost
-    if( m_ipAddress.isEmpty() )
+    QString address = getServerIP();
+    if( address.isEmpty() )
     {
-        m_ipAddress = QHostAddress(QHostAddress::LocalHost).toString();
+        address = QHostAddress(QHostAddress::LocalHost).toString();
         qWarning() << "No valid IP address given, using localhost";
     }
 
-    QHostAddress address( m_ipAddress );
-
-    qDebug() << "Connecting to " << address.toString() << ":" << m_port;
-
-    // skip all data left in socket
-    qint64 bytes = m_tcpSocket->bytesAvailable();
-    if( bytes > 0 )
-    {
-        QDataStream in(m_tcpSocket);
-        in.setVersion(QDataStream::Qt_4_0);
-
-        // can skip 2^32 bytes at a time, skip until no bytes left
-        while( bytes > (qint64) std::numeric_limits<int>::max() )
-        {
-            in.skipRawData( std::numeric_limits<int>::max() );
-            bytes -= (qint64) std::numeric_limits<int>::max();
-        }
-        in.skipRawData( bytes );
-        
-        assert( m_tcpSocket->bytesAvailable() == 0 );
-        m_blockSize = 0;
-    }
-
-    // if this fails, error is automatically called
-    // by signal slots connection
-    m_tcpSocket->connectToHost( address, m_port );
-
-    int timeout = 5*1000;
-    if(m_tcpSocket->waitForConnected(timeout))
-        return true;
-
-    if( m_autoReconnect )
-    {
-        qWarning() << "TCPClientProducer failed to connect at startup, will keep trying to reconnect because autoreconnect is enabled.";
-        return true;
-    }
+    QMutexLocker lock( &m_frameListMutex );
+    m_frameList.clear();
+    m_stopping = false;
+    lock.unlock();
 
-    displayError(m_tcpSocket->error(), false);
-    return false;
+    // the connection reads, parses and reconnects in the receive
+    // thread, connecting does not wait for the server
+    m_connection = new ClientConnection( this, address, getPort(), getSubscription(),
+                                         getLowDelay(), getAutoReconnect() );
+    m_connection->moveToThread(&m_receiveThread);
+    m_receiveThread.start();
+    QMetaObject::invokeMethod(m_connection, "open", Qt::QueuedConnection);
+    return true;
 }
 
 bool TCPClientProducer::stop()
 {
+    if( m_connection == 0 )
+        return true;
+
+    // wake the receive thread if it is waiting for room
+    QMutexLocker lock( &m_frameListMutex );
+    m_stopping = true;
+    m_frameTaken.wakeAll();
+    lock.unlock();
+
     // disconnect from server
-    qDebug() << "Disconnecting ... ";
-    m_tcpSocket->disconnectFromHost();
+    QMetaObject::invokeMethod(m_connection, "close", Qt::BlockingQueuedConnection);
+    m_receiveThread.quit();
+    m_receiveThread.wait();
 
-    // if not immediately disconnected wait 5 seconds
-    int timeout = 5*1000;
-    if( m_tcpSocket->state() == QAbstractSocket::UnconnectedState || m_tcpSocket->waitForDisconnected(timeout) )
-    {
-        m_tcpSocket->abort();
-        return true;
-    }
-    displayError(m_tcpSocket->error(), false);
-    m_tcpSocket->abort();
-    m_blockSize = 0;
-    return false;
+    // the thread is done so the connection can be deleted from here
+    delete m_connection;
+    m_connection = 0;
+
+    lock.relock();
+    m_frameList.clear();
+    getMetrics().setBacklog(0);
+    return true;
 }
 
 bool TCPClientProducer::readyToProduce() const
 {
-    // check if we have a connection
-    QAbstractSocket::SocketState state = m_tcpSocket->state();
-    if( state == QAbstractSocket::UnconnectedState )
-    {
-        QHostAddress address( m_ipAddress );
-
-        qWarning() << "Reconnecting to " << address.toString() << ":" << m_port;
-
-        // if this fails, error is automatically called
-        // by signal slots connection
-        m_tcpSocket->connectToHost( address, m_port );
-
-        int timeout = 5*1000;
-        if(!m_tcpSocket->waitForConnected(timeout))
-        {
-            qWarning() << "TCPClientProducer failed to reconnect";
-            return false;
-        }
-    }
-    // check if there is data available
+    // check if there is data available, the connection
+    // reconnects by itself in the receive thread
+    QMutexLocker lock( &m_frameListMutex );
     return !m_frameList.isEmpty();
 }
 
@@ -203,6 +166,8 @@ bool TCPClientProducer::produce()
     // get data from queue
     QMutexLocker lock( &m_frameListMutex );
     QVariantList frame = m_frameList.takeFirst();
+    getMetrics().setBacklog(m_frameList.size());
+    m_frameTaken.wakeAll();
     lock.unlock();
 
     // do primitive dynamic matching of pins with framedata
@@ -230,181 +195,78 @@ bool TCPClientProducer::produce()
     return true;
 }
 
-void TCPClientProducer::readData()
+bool TCPClientProducer::queueFrame(const QVariantList& frame)
 {
-    QDataStream in(m_tcpSocket);
-    in.setVersion(QDataStream::Qt_4_0);
+    int policy = getDropPolicy().getSelectedValue();
+    int maxFrames = getMaxFrames();
 
-    if( m_blockSize == 0 )
-    {
-        if( m_tcpSocket->bytesAvailable() < (int)sizeof(quint32) )
-            return;
-        in >> m_blockSize;
-    }
-
-    qint64 bytesAvailable = m_tcpSocket->bytesAvailable();
-    if( bytesAvailable < m_blockSize )
-        return;
+    QMutexLocker lock( &m_frameListMutex );
+    if( m_stopping )
+        return false;
 
-    if( !m_configured )
-    {
-        // send configuration request
-    }
-    else
+    if( m_frameList.size() >= maxFrames )
     {
-        bool data = true;
-        //int frames = 0;
-        while( data )
+        switch( policy )
         {
-            quint32 opcode;
-            in >> opcode;
-
-            switch( opcode )
-            {
-            case PROTO_INIT:
-                //m_configured = parseConfig(in);
-                break;
-            case PROTO_FRAME:
-                if( m_configured )
-                {
-                    parseFrame(in);
-                }
-                else
-                {
-                    qDebug() << "Frame received while not configured.";
-                }
-                break;
-            default:
-                // error, invalid opcode
-                qWarning() << "Invalid opcode, skipping message";
-
-                // skip this message
-                in.skipRawData( m_blockSize - sizeof(quint32) );
-            }
-
-            if( m_tcpSocket->bytesAvailable() >= (int)sizeof(quint32) )
+        case DROP_BLOCK:
+            // stops reading the socket, so the server is held back by TCP
+            while( m_frameList.size() >= maxFrames && !m_stopping )
+                m_frameTaken.wait( &m_frameListMutex );
+            if( m_stopping )
+                return false;
+            break;
+        case DROP_NEWEST:
+            getMetrics().itemDropped();
+            return true;
+        case DROP_OLDEST:
+        default:
+            while( m_frameList.size() >= maxFrames )
             {
-                in >> m_blockSize;
+                m_frameList.removeFirst();
+                getMetrics().itemDropped();
             }
-            else
-            {
-                m_blockSize = 0;
-                data = false;
-            }
-
-            if( m_tcpSocket->bytesAvailable() < m_blockSize )
-                data = false;
-
-//            if( ++frames > 10 )
-//            {
-//                qint64 bytes = m_tcpSocket->bytesAvailable();
-//                qDebug() << "bytes: " << bytes;
-//                data = false;
-//            }
         }
     }
-}
-
-void TCPClientProducer::ackFrame(quint32 frameNumber)
-{
-    QByteArray bytes;
-    QDataStream out(&bytes, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_4_0);
 
-    // write the header
-    out << (quint32)(2*sizeof(quint32)); // size of message excluding 4 bytes for size
-    out << (quint32)PROTO_ACK;
-    out << (quint32)frameNumber;
+    m_frameList.append(frame);
+    getMetrics().setBacklog(m_frameList.size());
+    lock.unlock();
 
-    if( m_tcpSocket->write(bytes) == -1 )
-    {
-        //setError( PlvNonFatalError, m_tcpSocket->errorString() );
-        QString msg = tr("Failed to write ACK to socket.");
-            qWarning() << msg;
-    }
+    notifyReadyToProduce();
+    return true;
 }
 
-//bool TCPClientProducer::parseConfig( QDataStream& in )
-//{
-//    qint32 numargs;
-//    in >> numargs;
-
-//    if( numargs < 1 )
-//    {
-//        // no arguments sent with header, skip this frame
-//        return false;
-//    }
-
-//    qDebug() << "Parsing argument list of CONFIG message";
-//    for( int i=0; i < numargs; ++i )
-//    {
-//        QVariant::Type type;
-//        in >> type;
-
-//        QString name = QMetaType::typeName(type);
-//        if( name != 0 )
-//        {
-//            qDebug() << "Found type " << type << " with name " << name;
-//            m_types.append( type );
-//        }
-//        else
-//        {
-//            qDebug() << "Invalid type found with value " << type;
-//            return false;
-//        }
-//    }
-//    return true;
-//}
-
-bool TCPClientProducer::parseFrame( QDataStream& in )
-{
-    QVariantList frame;
-
-    quint32 serial;
-    quint32 numargs;
-
-    in >> serial;
-    in >> numargs;
-
-    if( numargs < 1 )
+void TCPClientProducer::connectionError(const QString& msg)
+{
+    if( !getAutoReconnect() )
     {
-        // no arguments sent with header, skip this frame
-        qWarning() << "Invalid frame received. Skipping.";
-
-        // skip this message
-        in.skipRawData( m_blockSize - 2*sizeof(quint32) );
-        return false;
+        setError(PlvPipelineRuntimeError, msg);
+        emit onError(PlvPipelineRuntimeError, this);
     }
-
-    // parse all arguments using QVariant
-    for( unsigned int i=0; i < numargs; ++i )
+    else
     {
-        QVariant v;
-        in >> v;
-
-        if( !v.isValid() )
-        {
-            qDebug() << "Frame is not correct, invalid variant.";
-            return false;
-        }
-
-        //qDebug() << "Variant parsed: " << v.type();
-        //if( v.type() != m_types[i] )
-        //{
-        //    // frame is not according to specifications
-        //    qDebug() << "Frame is not correct, variant of unexpected type.";
-        //    return false;
-        //}
-        frame.append(v);
+        qWarning() << msg;
     }
+}
 
-    // send ack to the server for flow control
-    ackFrame(serial);
-
-    QMutexLocker lock( &m_frameListMutex );
-    m_frameList.append(frame);
+Subscription TCPClientProducer::getSubscription() const
+{
+    Subscription subscription;
 
-    return true;
+    // bit i of the mask selects value i, no bits select all values
+    foreach( const QString& value, getValues().split(',', QString::SkipEmptyParts) )
+    {
+        bool ok;
+        int i = value.trimmed().toInt(&ok);
+        if( ok && i >= 0 && i < 32 )
+            subscription.pins |= 1u << i;
+        else
+            qWarning() << tr("Ignoring invalid value index %1 in subscription.").arg(value);
+    }
+    subscription.maxFps = getMaxFps();
+    subscription.width = getMaxWidth();
+    subscription.height = getMaxHeight();
+    return subscription;
 }
 
 void TCPClientProducer::sessionOpened()
@@ -423,78 +285,6 @@ void TCPClientProducer::sessionOpened()
     settings.endGroup();
 }
 
-void TCPClientProducer::connected()
-{
-    qDebug() << "TCPClientProducer connected";
-}
-
-void TCPClientProducer::disconnected()
-{
-    qDebug() << "TCPClientProducer disconnected";
-    
-    qint64 bytes = m_tcpSocket->bytesAvailable();
-    if( bytes > 0 )
-    {
-        QDataStream in(m_tcpSocket);
-        in.setVersion(QDataStream::Qt_4_0);
-
-        while( bytes > (qint64) std::numeric_limits<int>::max() )
-        {
-            in.skipRawData( std::numeric_limits<int>::max() );
-            bytes -= (qint64) std::numeric_limits<int>::max();
-        }
-        in.skipRawData( bytes );
-        
-        qint64 bytes = m_tcpSocket->bytesAvailable();
-        if( bytes > 0 )
-        {
-            qDebug() << QString("%1 bytes left in socket after reconnect").arg(bytes);
-        }
-        m_blockSize = 0;
-    }
-    //setError( PlvPipelineRuntimeError, tr("The remote host closed the connection."));
-}
-
-void TCPClientProducer::displayError(QAbstractSocket::SocketError socketError, bool signal)
-{
-    QString msg;
-    PlvErrorType type = PlvNoError;
-
-    switch (socketError)
-    {
-    case QAbstractSocket::RemoteHostClosedError:
-        type = PlvPipelineRuntimeError;
-        msg = tr("The remote host closed the connection.");
-        break;
-    case QAbstractSocket::HostNotFoundError:
-        type = PlvPipelineRuntimeError;
-        msg = tr("The host was not found. Please check the "
-                 "host name and port settings.");
-        break;
-    case QAbstractSocket::ConnectionRefusedError:
-        type = PlvPipelineRuntimeError;
-        msg = tr("The connection was refused by the peer. "
-                 "Make sure the Parlevision server is running, "
-                 "and check that the host name and port "
-                 "settings are correct.");
-        break;
-    default:
-       type = PlvPipelineRuntimeError;
-       msg = tr("The following error occurred: %1.").arg(m_tcpSocket->errorString());
-    }
-
-    if( !m_autoReconnect )
-    {
-        setError(type,msg);
-        if(signal) emit onError(type,this);
-    }
-    else
-    {
-        //emit sendMessageToPipeline( PlvNotifyMessage, msg );
-        qWarning() << msg;
-    }
-}
-
 /** propery methods */
 int TCPClientProducer::getPort() const
 {
@@ -535,3 +325,113 @@ void TCPClientProducer::setAutoReconnect(bool ar, bool doEmit )
     m_autoReconnect = ar;
     if( doEmit ) emit( autoReconnectChanged(ar) );
 }
+
+bool TCPClientProducer::getLowDelay() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_lowDelay;
+}
+
+void TCPClientProducer::setLowDelay(bool lowDelay)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_lowDelay = lowDelay;
+    lock.unlock();
+    emit lowDelayChanged(lowDelay);
+}
+
+QString TCPClientProducer::getValues() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_values;
+}
+
+void TCPClientProducer::setValues(const QString& values)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_values = values;
+    lock.unlock();
+    emit valuesChanged(values);
+}
+
+int TCPClientProducer::getMaxFps() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_maxFps;
+}
+
+void TCPClientProducer::setMaxFps(int fps)
+{
+    if( fps < 0 )
+        fps = 0;
+
+    QMutexLocker lock(m_propertyMutex);
+    m_maxFps = fps;
+    lock.unlock();
+    emit maxFpsChanged(fps);
+}
+
+int TCPClientProducer::getMaxWidth() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_maxWidth;
+}
+
+void TCPClientProducer::setMaxWidth(int width)
+{
+    if( width < 0 )
+        width = 0;
+
+    QMutexLocker lock(m_propertyMutex);
+    m_maxWidth = width;
+    lock.unlock();
+    emit maxWidthChanged(width);
+}
+
+int TCPClientProducer::getMaxHeight() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_maxHeight;
+}
+
+void TCPClientProducer::setMaxHeight(int height)
+{
+    if( height < 0 )
+        height = 0;
+
+    QMutexLocker lock(m_propertyMutex);
+    m_maxHeight = height;
+    lock.unlock();
+    emit maxHeightChanged(height);
+}
+
+int TCPClientProducer::getMaxFrames() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_maxFrames;
+}
+
+void TCPClientProducer::setMaxFrames(int frames)
+{
+    if( frames < 1 )
+        frames = 1;
+
+    QMutexLocker lock(m_propertyMutex);
+    m_maxFrames = frames;
+    lock.unlock();
+    emit maxFramesChanged(frames);
+}
+
+plv::Enum TCPClientProducer::getDropPolicy() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_dropPolicy;
+}
+
+void TCPClientProducer::setDropPolicy(plv::Enum policy)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_dropPolicy = policy;
+    lock.unlock();
+    emit dropPolicyChanged(policy);
+}
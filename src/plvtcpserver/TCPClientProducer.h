@@ -23,15 +23,25 @@
 #define TCPCLIENTPRODUCER_H
 
 #include <plvcore/PipelineProducer.h>
+#include <plvcore/Pipeline.h>
 #include <plvcore/Types.h>
 #include <plvcore/CvMatDataPin.h>
 #include <plvcore/OutputPin.h>
+#include <plvcore/Enum.h>
 
-#include <QAbstractSocket>
+#include <QWaitCondition>
+
+#include "Subscription.h"
 
-QT_FORWARD_DECLARE_CLASS( QTcpSocket )
 QT_FORWARD_DECLARE_CLASS( QNetworkSession )
 
+class ClientConnection;
+
+/** default number of received frames waiting to be produced */
+#ifndef TCPCLIENTPRODUCER_DEFAULT_MAX_FRAMES
+#   define TCPCLIENTPRODUCER_DEFAULT_MAX_FRAMES 4
+#endif
+
 class TCPClientProducer : public plv::PipelineProducer
 {
     Q_OBJECT
@@ -41,11 +51,24 @@ class TCPClientProducer : public plv::PipelineProducer
 
     Q_CLASSINFO("author", "Richard Loos")
     Q_CLASSINFO("name", "TCP Client")
-    Q_CLASSINFO("description", "TCP client")
+    Q_CLASSINFO("description", "TCP client. The client can subscribe to part of "
+                "what the server sends: values is a comma separated list of the "
+                "indices of the values of a frame to receive, empty for all. "
+                "maxFps limits the frame rate and maxWidth and maxHeight the "
+                "size of the images, 0 is no limit. Takes effect on connect. "
+                "At most maxFrames received frames wait for the pipeline, the "
+                "drop policy decides what happens to the next one.")
 
     Q_PROPERTY( int port READ getPort WRITE setPort NOTIFY portChanged  )
     Q_PROPERTY( QString serverIP READ getServerIP WRITE setServerIP NOTIFY serverIPChanged )
     Q_PROPERTY( bool autoReconnect READ getAutoReconnect WRITE setAutoReconnect NOTIFY autoReconnectChanged  )
+    Q_PROPERTY( bool lowDelay READ getLowDelay WRITE setLowDelay NOTIFY lowDelayChanged )
+    Q_PROPERTY( QString values READ getValues WRITE setValues NOTIFY valuesChanged )
+    Q_PROPERTY( int maxFps READ getMaxFps WRITE setMaxFps NOTIFY maxFpsChanged )
+    Q_PROPERTY( int maxWidth READ getMaxWidth WRITE setMaxWidth NOTIFY maxWidthChanged )
+    Q_PROPERTY( int maxHeight READ getMaxHeight WRITE setMaxHeight NOTIFY maxHeightChanged )
+    Q_PROPERTY( int maxFrames READ getMaxFrames WRITE setMaxFrames NOTIFY maxFramesChanged )
+    Q_PROPERTY( plv::Enum dropPolicy READ getDropPolicy WRITE setDropPolicy NOTIFY dropPolicyChanged )
 
 public:
     TCPClientProducer();
@@ -56,41 +79,79 @@ public:
     virtual bool start();
     virtual bool stop();
 
-    bool parseFrame(QDataStream& in);
-    //bool parseConfig(QDataStream& in);
+    /** called from the receive thread with every frame which has been
+        parsed. Applies the drop policy when maxFrames frames are waiting.
+        @returns false if the frame was not taken because the producer
+        is stopping */
+    bool queueFrame(const QVariantList& frame);
+
+    /** called from the receive thread when the connection failed */
+    void connectionError(const QString& msg);
 
     int getPort() const;
     QString getServerIP() const;
     bool getAutoReconnect() const;
+    bool getLowDelay() const;
+    QString getValues() const;
+    int getMaxFps() const;
+    int getMaxWidth() const;
+    int getMaxHeight() const;
+    int getMaxFrames() const;
+    plv::Enum getDropPolicy() const;
 
 signals:
     void portChanged(int port);
     void serverIPChanged(QString ip);
     void autoReconnectChanged(bool ar);
+    void lowDelayChanged(bool lowDelay);
+    void valuesChanged(const QString& values);
+    void maxFpsChanged(int fps);
+    void maxWidthChanged(int width);
+    void maxHeightChanged(int height);
+    void maxFramesChanged(int frames);
+    void dropPolicyChanged(plv::Enum policy);
 
 public slots:
     void setPort(int port, bool doEmit=false );
     void setServerIP( const QString& ip, bool doEmit=false );
-    void readData();
     void sessionOpened();
-    void displayError(QAbstractSocket::SocketError socketError, bool signal=true);
-    void connected();
-    void disconnected();
     void setAutoReconnect(bool ar, bool doEmit=false );
 
+    /** sends acks without delay (TCP_NODELAY), takes effect on the next connect */
+    void setLowDelay(bool lowDelay);
+
+    /** subscription of this client, sent to the server on connect */
+    void setValues(const QString& values);
+    void setMaxFps(int fps);
+    void setMaxWidth(int width);
+    void setMaxHeight(int height);
+
+    void setMaxFrames(int frames);
+    void setDropPolicy(plv::Enum policy);
+
 private:
-    void ackFrame(quint32 frameNumber);
+    /** @returns the subscription made from the properties */
+    Subscription getSubscription() const;
 
-    QTcpSocket* m_tcpSocket;
     QString m_ipAddress;
     int m_port;
-    int m_blockSize;
     QNetworkSession* m_networkSession;
-    bool m_configured;
-    QVector<QVariant::Type> m_types;
-    QList<QVariantList> m_frameList;
-    QMutex m_frameListMutex;
     bool m_autoReconnect;
+    bool m_lowDelay;
+    QString m_values;
+    int m_maxFps;
+    int m_maxWidth;
+    int m_maxHeight;
+    int m_maxFrames;
+    plv::Enum m_dropPolicy;
+
+    plv::QThreadEx m_receiveThread;
+    ClientConnection* m_connection; /** lives in m_receiveThread while started */
+
+    QList<QVariantList> m_frameList;
+    mutable QMutex m_frameListMutex;
+    QWaitCondition m_frameTaken;
+    bool m_stopping;
 
     plv::OutputPin<int>* m_intOut;
     plv::OutputPin<QString>* m_stringOut;
@@ -28,16 +28,56 @@
 #include <plvgui/ImageConverter.h>
 #include <QNetworkInterface>
 #include <QImageWriter>
+#include <QRunnable>
+#include <QStringList>
+
+/** default number of threads encoding images */
+#define TCPSERVERPROCESSOR_DEFAULT_ENCODE_THREADS 2
+
+namespace
+{
+    /** encodes the images of a single frame on the encode pool and
+        prepares the variants the subscribed clients need */
+    class EncodeTask : public QRunnable
+    {
+    public:
+        EncodeTask( TCPServerProcessor* processor, const WireFramePtr& frame,
+                    const QList<Subscription>& subscriptions ) :
+            m_processor( processor ), m_frame( frame ), m_subscriptions( subscriptions ) {}
+
+        void run()
+        {
+            m_frame->encode();
+            foreach( const Subscription& subscription, m_subscriptions )
+            {
+                m_frame->getVariant( subscription );
+            }
+            m_processor->encoded( m_frame );
+        }
+
+    private:
+        TCPServerProcessor* m_processor;
+        WireFramePtr m_frame;
+        QList<Subscription> m_subscriptions;
+    };
+}
 
 TCPServerProcessor::TCPServerProcessor() :
     m_port(1337),
     m_waiting(false),
-    m_convertCvMatToQImage(false)
-
+    m_convertCvMatToQImage(false),
+    m_jpegQuality(IMAGECODEC_DEFAULT_JPEG_QUALITY),
+    m_pngCompression(IMAGECODEC_DEFAULT_PNG_COMPRESSION),
+    m_encodeThreads(TCPSERVERPROCESSOR_DEFAULT_ENCODE_THREADS)
 {
     plv::createDynamicInputPin( "generic pin", this, plv::IInputPin::CONNECTION_OPTIONAL );
     m_cvMatDataTypeId = QMetaType::type("plv::CvMatData");
     m_server = new Server(this);
+
+    m_imageEncoding.add("Raw", CODEC_RAW);
+    m_imageEncoding.add("JPEG", CODEC_JPEG);
+    m_imageEncoding.add("PNG", CODEC_PNG);
+    m_imageEncoding.add("Lossless", CODEC_LOSSLESS);
 }
 
 TCPServerProcessor::~TCPServerProcessor()
@@ -63,10 +103,12 @@ bool TCPServerProcessor::init()
     if (ipAddress.isEmpty())
         ipAddress = QHostAddress(QHostAddress::LocalHost).toString();
 
+    m_server->startIoThreads();
     if( !m_server->listen( QHostAddress::Any, m_port ) )
     {
         QString msg = tr("Unable to start the server: %1.").arg(m_server->errorString());
         setError(PlvPipelineInitError, msg);
+        m_server->stopIoThreads();
         return false;
     }
 
@@ -82,8 +124,8 @@ bool TCPServerProcessor::init()
 
 bool TCPServerProcessor::deinit() throw ()
 {
-    m_server->disconnectAll();
     m_server->close();
+    m_server->stopIoThreads();
     disconnect(m_server, SIGNAL(onError(PlvErrorType, const QString&)),
                this, SLOT(serverError(PlvErrorType, const QString&)));
     return true;
@@ -91,14 +133,53 @@ bool TCPServerProcessor::deinit() throw ()
 
 bool TCPServerProcessor::start()
 {
+    updateEncodings();
+    m_encodePool.setMaxThreadCount(getEncodeThreads());
     return true;
 }
 
 bool TCPServerProcessor::stop()
 {
+    // every frame is sent when the last encoder is done
+    m_encodePool.waitForDone();
     return true;
 }
 
+void TCPServerProcessor::updateEncodings()
+{
+    QMutexLocker lock(m_propertyMutex);
+
+    switch( m_imageEncoding.getSelectedValue() )
+    {
+    case CODEC_JPEG:
+        m_defaultEncoding = ImageEncoding(CODEC_JPEG, m_jpegQuality);
+        break;
+    case CODEC_PNG:
+        m_defaultEncoding = ImageEncoding(CODEC_PNG, m_pngCompression);
+        break;
+    case CODEC_LOSSLESS:
+        m_defaultEncoding = ImageEncoding(CODEC_LOSSLESS);
+        break;
+    default:
+        m_defaultEncoding = ImageEncoding(CODEC_RAW);
+        break;
+    }
+
+    m_encodingOfPin.clear();
+    foreach( const QString& entry, m_pinEncodings.split(',', QString::SkipEmptyParts) )
+    {
+        QStringList parts = entry.split('=');
+        bool ok = parts.size() == 2;
+        int id = ok ? parts.at(0).trimmed().toInt(&ok) : 0;
+
+        ImageEncoding encoding;
+        if( ok && ImageCodec::parse(parts.at(1), encoding) )
+            m_encodingOfPin.insert(id, encoding);
+        else
+            qWarning() << tr("TCPServerProcessor ignoring invalid pin encoding %1").arg(entry);
+    }
+}
+
 bool TCPServerProcessor::isReadyForProcessing() const
 {
     QMutexLocker lock( m_propertyMutex );
@@ -157,6 +238,7 @@ void TCPServerProcessor::onOutputConnectionRemoved(plv::IOutputPin* pin, plv::Pi
 bool TCPServerProcessor::process()
 {
     QVariantList frameData;
+    QVector<ImageEncoding> encodings;
 
     plv::InputPinMap::iterator itr = m_inputPins.begin();
     for( ; itr != m_inputPins.end(); ++itr )
@@ -175,74 +257,68 @@ bool TCPServerProcessor::process()
                 QVariant v2;
                 v2.setValue(img);
                 frameData.append(v2);
+                encodings.append(ImageEncoding(CODEC_RAW));
             }
             else
             {
                 QVariant v;
                 pin->getVariant(v);
                 frameData.append(v);
+                encodings.append(m_encodingOfPin.value(pin->getId(), m_defaultEncoding));
             }
         }
     }
     quint32 frameNumber = (quint32)getProcessingSerial();
 
-    QByteArray block;
-    QDataStream out(&block, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_4_0);
+    // the frame is serialised by the connections in the protocol
+    // version each of them negotiated
+    WireFramePtr frame = new WireFrame(frameNumber, frameData, encodings);
 
-    // write the header
-    out << (quint32)0; // reserved for number of bytes later
-    out << (quint32)PROTO_FRAME;    // msg type
-    out << (quint32)frameNumber;    // frame number / serial number
-    out << (quint32)frameData.size(); // number of arguments
+    // variants for subscriptions made after this point are made
+    // by the first connection which needs them
+    QList<Subscription> subscriptions = m_server->getSubscriptions();
 
-    // write all data to the stream
-    foreach( const QVariant& v, frameData )
-    {
-#if 0
-        // we do not want QImage to convert
-        // to the default PNG because that
-        // is way too slow
-        if( v.type() == QVariant::Image )
-        {
-            out << QVariant::UserType;
+    QMutexLocker lock(&m_encodeMutex);
 
-            if(out.version() >= QDataStream::Qt_4_2)
-                out << qint8(v.isNull());
+    // bound the number of frames waiting for an encoder
+    while( m_encodeQueue.size() >= 2 * m_encodePool.maxThreadCount() )
+        m_encodeDone.wait(&m_encodeMutex);
 
-            QByteArray a("plv::QImageWrapper");
-            out << a;
+    PendingFrame pending;
+    pending.frame = frame;
+    pending.encoded = !frame->needsEncoding() && subscriptions.isEmpty();
+    m_encodeQueue.enqueue(pending);
 
-            if( !v.isValid() )
-            {
-                out << QString();
-            }
-            else
-            {
-                QImage img = v.value<QImage>();
-                QImageWriter writer(out.device(), "png");
-                if(!writer.write(img))
-                {
-                    QString err = writer.errorString();
-                    qWarning() << "Failed to write image to stream because " << err;
-                }
-            }
-        }
-        else
+    if( pending.encoded )
+        sendEncoded();
+    else
+        m_encodePool.start(new EncodeTask(this, frame, subscriptions));
+
+    return true;
+}
+
+void TCPServerProcessor::encoded(WireFrame* frame)
+{
+    QMutexLocker lock(&m_encodeMutex);
+    for( int i=0; i < m_encodeQueue.size(); ++i )
+    {
+        if( m_encodeQueue.at(i).frame.getPtr() == frame )
         {
-            out << v;
+            m_encodeQueue[i].encoded = true;
+            break;
         }
-#else
-        out << v;
-#endif
     }
+    sendEncoded();
+}
 
-    // calculate size of total data and write it as first 4 bytes
-    out.device()->seek(0);
-    out << (quint32)(block.size() - sizeof(quint32));
-
-    m_server->sendFrame(frameNumber, block);
-    return true;
+void TCPServerProcessor::sendEncoded()
+{
+    while( !m_encodeQueue.isEmpty() && m_encodeQueue.head().encoded )
+    {
+        PendingFrame pending = m_encodeQueue.dequeue();
+        m_server->sendFrame(pending.frame);
+    }
+    m_encodeDone.wakeAll();
 }
 
 void TCPServerProcessor::acceptConfigurationRequest()
@@ -326,6 +402,103 @@ void TCPServerProcessor::setLossless(bool lossless)
     emit losslessChanged(lossless);
 }
 
+plv::Enum TCPServerProcessor::getImageEncoding() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_imageEncoding;
+}
+
+void TCPServerProcessor::setImageEncoding(plv::Enum encoding)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_imageEncoding = encoding;
+    lock.unlock();
+    emit imageEncodingChanged(encoding);
+}
+
+int TCPServerProcessor::getJpegQuality() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_jpegQuality;
+}
+
+void TCPServerProcessor::setJpegQuality(int quality)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_jpegQuality = qBound(0, quality, 100);
+    lock.unlock();
+    emit jpegQualityChanged(m_jpegQuality);
+}
+
+int TCPServerProcessor::getPngCompression() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_pngCompression;
+}
+
+void TCPServerProcessor::setPngCompression(int level)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_pngCompression = qBound(0, level, 9);
+    lock.unlock();
+    emit pngCompressionChanged(m_pngCompression);
+}
+
+QString TCPServerProcessor::getPinEncodings() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_pinEncodings;
+}
+
+void TCPServerProcessor::setPinEncodings(QString encodings)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_pinEncodings = encodings;
+    lock.unlock();
+    emit pinEncodingsChanged(encodings);
+}
+
+int TCPServerProcessor::getEncodeThreads() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_encodeThreads;
+}
+
+void TCPServerProcessor::setEncodeThreads(int threads)
+{
+    QMutexLocker lock(m_propertyMutex);
+    m_encodeThreads = threads < 1 ? 1 : threads;
+    lock.unlock();
+    emit encodeThreadsChanged(m_encodeThreads);
+}
+
+int TCPServerProcessor::getIoThreads() const
+{
+    Q_ASSERT( m_server != 0 );
+    return m_server->getIoThreads();
+}
+
+void TCPServerProcessor::setIoThreads(int threads)
+{
+    if( threads > 0 )
+    {
+        m_server->setIoThreads(threads);
+        emit ioThreadsChanged(threads);
+    }
+}
+
+bool TCPServerProcessor::getLowDelay() const
+{
+    Q_ASSERT( m_server != 0 );
+    return m_server->getLowDelay();
+}
+
+void TCPServerProcessor::setLowDelay(bool lowDelay)
+{
+    m_server->setLowDelay(lowDelay);
+    emit lowDelayChanged(lowDelay);
+}
+
 void TCPServerProcessor::stalled(ServerConnection* connection)
 {
     Q_UNUSED(connection)
@@ -346,6 +519,14 @@ void TCPServerProcessor::unstalled(ServerConnection* connection)
 
 void TCPServerProcessor::serverError(PlvErrorType type, const QString& msg)
 {
+    // the connection groups drop connections with a non fatal error,
+    // those must not stop the pipeline
+    if( type == PlvNonFatalError )
+    {
+        qWarning() << "TCPServerProcessor: " << msg;
+        return;
+    }
+
     // propagate to pipeline element error handling
     setError(type,msg);
     emit onError(type,this);
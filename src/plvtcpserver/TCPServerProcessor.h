@@ -23,12 +23,18 @@
 #define TCPSERVERPROCESSOR_H
 
 #include <QObject>
+#include <QHash>
+#include <QQueue>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <plvcore/PipelineProcessor.h>
 #include <plvcore/RefPtr.h>
 #include <plvcore/Pin.h>
+#include <plvcore/Enum.h>
 #include <opencv/cv.h>
 
 #include "Server.h"
+#include "ImageCodec.h"
 
 namespace plv
 {
@@ -46,13 +52,27 @@ class TCPServerProcessor : public plv::PipelineProcessor
 
     Q_CLASSINFO("author", "Richard Loos")
     Q_CLASSINFO("name", "TCP Server")
-    Q_CLASSINFO("description", "TCP server")
+    Q_CLASSINFO("description", "TCP server. Images are sent with the image encoding, "
+                "which can be overridden per pin with pinEncodings, a comma separated "
+                "list of pin ids and encodings like 1=jpeg:80, 2=lossless. "
+                "Encodings are raw, jpeg[:quality], png[:level] and lossless. "
+                "Images are encoded once for all clients, on the encoder threads. "
+                "Clients which only speak version 1 of the protocol get raw images. "
+                "Clients can subscribe to a part of the pins, a maximum frame rate and "
+                "a maximum image size. Images are scaled once per size for all clients.")
 
     Q_PROPERTY( int port READ getPort WRITE setPort NOTIFY portChanged  )
     Q_PROPERTY( bool convertCvMatDataToQImage READ getConvertCvMatDataToQImage WRITE setConvertCvMatDataToQImage NOTIFY convertCvMatDataToQImageChanged )
     Q_PROPERTY( bool lossless READ getLossless WRITE setLossless NOTIFY losslessChanged )
     Q_PROPERTY( int maxFramesInQueue  READ getMaxFramesInQueue  WRITE setMaxFramesInQueue NOTIFY maxFramesInQueueChanged )
     Q_PROPERTY( int maxFramesInFlight READ getMaxFramesInFlight WRITE setMaxFramesInFlight NOTIFY maxFramesInFlightChanged )
+    Q_PROPERTY( plv::Enum imageEncoding READ getImageEncoding WRITE setImageEncoding NOTIFY imageEncodingChanged )
+    Q_PROPERTY( int jpegQuality READ getJpegQuality WRITE setJpegQuality NOTIFY jpegQualityChanged )
+    Q_PROPERTY( int pngCompression READ getPngCompression WRITE setPngCompression NOTIFY pngCompressionChanged )
+    Q_PROPERTY( QString pinEncodings READ getPinEncodings WRITE setPinEncodings NOTIFY pinEncodingsChanged )
+    Q_PROPERTY( int encodeThreads READ getEncodeThreads WRITE setEncodeThreads NOTIFY encodeThreadsChanged )
+    Q_PROPERTY( int ioThreads READ getIoThreads WRITE setIoThreads NOTIFY ioThreadsChanged )
+    Q_PROPERTY( bool lowDelay READ getLowDelay WRITE setLowDelay NOTIFY lowDelayChanged )
 
     /** required standard method declaration for plv::PipelineProcessor */
     PLV_PIPELINE_PROCESSOR
@@ -72,9 +92,19 @@ public:
     int getMaxFramesInFlight() const;
     int getMaxFramesInQueue() const;
     bool getLossless() const;
+    plv::Enum getImageEncoding() const;
+    int getJpegQuality() const;
+    int getPngCompression() const;
+    QString getPinEncodings() const;
+    int getEncodeThreads() const;
+    int getIoThreads() const;
+    bool getLowDelay() const;
 
     virtual bool isReadyForProcessing() const;
 
+    /** called by the encode tasks when frame has been encoded */
+    void encoded( WireFrame* frame );
+
     virtual void onInputConnectionSet(plv::IInputPin* pin, plv::PinConnection* connection);
     virtual void onInputConnectionRemoved(plv::IInputPin* pin, plv::PinConnection* connection);
 
@@ -87,6 +117,13 @@ signals:
     void maxFramesInQueueChanged(int max);
     void maxFramesInFlightChanged(int max);
     void losslessChanged(bool lossless);
+    void imageEncodingChanged(plv::Enum encoding);
+    void jpegQualityChanged(int quality);
+    void pngCompressionChanged(int level);
+    void pinEncodingsChanged(QString encodings);
+    void encodeThreadsChanged(int threads);
+    void ioThreadsChanged(int threads);
+    void lowDelayChanged(bool lowDelay);
 
 public slots:
     void setPort(int port, bool doEmit=false );
@@ -96,16 +133,54 @@ public slots:
     void setMaxFramesInQueue(int max);
     void setMaxFramesInFlight(int max);
     void setLossless(bool lossless);
+    void setImageEncoding(plv::Enum encoding);
+    void setJpegQuality(int quality);
+    void setPngCompression(int level);
+    void setPinEncodings(QString encodings);
+    void setEncodeThreads(int threads);
+
+    /** number of threads serving the client sockets, takes effect on the next init */
+    void setIoThreads(int threads);
+
+    /** sends without delay (TCP_NODELAY) at the cost of more, smaller packets */
+    void setLowDelay(bool lowDelay);
     void serverError(PlvErrorType type, const QString& msg);
 
 private:
     void acceptConfigurationRequest();
 
+    /** builds m_encodingOfPin from the encoding properties */
+    void updateEncodings();
+
+    /** sends the frames at the head of the queue which are encoded,
+        so frames are sent in serial order. Call with m_encodeMutex held */
+    void sendEncoded();
+
+    struct PendingFrame
+    {
+        WireFramePtr frame;
+        bool encoded;
+    };
+
     int m_port;
     Server* m_server;
     bool m_waiting;
     bool m_convertCvMatToQImage;
     int m_cvMatDataTypeId;
+
+    plv::Enum m_imageEncoding;
+    int m_jpegQuality;
+    int m_pngCompression;
+    QString m_pinEncodings;
+    int m_encodeThreads;
+
+    ImageEncoding m_defaultEncoding;
+    QHash<int, ImageEncoding> m_encodingOfPin; /** overrides by pin id */
+
+    QThreadPool m_encodePool;
+    QMutex m_encodeMutex;
+    QWaitCondition m_encodeDone;
+    QQueue<PendingFrame> m_encodeQueue; /** frames in serial order */
 };
 
 #endif // TCPSERVERPROCESSOR_H
@@ -0,0 +1,261 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#include "WireFrame.h"
+#include "Proto.h"
+
+#include <QDataStream>
+#include <QtEndian>
+
+#include <plvcore/CvMatData.h>
+#include <opencv/cv.h>
+
+WireFrame::WireFrame( quint32 serial, const QVariantList& values,
+                      const QVector<ImageEncoding>& encodings ) :
+    m_serial( serial ),
+    m_values( values ),
+    m_encodings( encodings ),
+    m_encodedKinds( values.size(), 0 ),
+    m_encoded( values.size() )
+{
+}
+
+WireFrame::~WireFrame()
+{
+}
+
+const QList<WireChunk>& WireFrame::getChunks( int version )
+{
+    QMutexLocker lock( &m_mutex );
+    if( version >= PROTO_VERSION_2 )
+    {
+        if( m_v2Chunks.isEmpty() )
+            serialiseV2();
+        return m_v2Chunks;
+    }
+
+    if( m_v1Chunks.isEmpty() )
+        serialiseV1();
+    return m_v1Chunks;
+}
+
+bool WireFrame::needsEncoding() const
+{
+    for( int i=0; i < m_encodings.size() && i < m_values.size(); ++i )
+    {
+        if( m_encodings.at(i).codec != CODEC_RAW )
+            return true;
+    }
+    return false;
+}
+
+void WireFrame::encode()
+{
+    const int cvMatDataTypeId = qMetaTypeId<plv::CvMatData>();
+    for( int i=0; i < m_encodings.size() && i < m_values.size(); ++i )
+    {
+        const QVariant& v = m_values.at(i);
+        if( m_encodings.at(i).codec == CODEC_RAW || v.userType() != cvMatDataTypeId )
+            continue;
+
+        // images the codec does not support are sent raw
+        plv::CvMatData data = v.value<plv::CvMatData>();
+        m_encodedKinds[i] = ImageCodec::encode( m_encodings.at(i), data.getReadOnly(), m_encoded[i] );
+    }
+}
+
+WireFramePtr WireFrame::getVariant( const Subscription& subscription )
+{
+    if( subscription.isDefault() )
+        return this;
+
+    QMutexLocker lock( &m_variantMutex );
+    const QString key = subscription.key();
+    if( m_variants.contains(key) )
+        return m_variants.value(key);
+
+    const int cvMatDataTypeId = qMetaTypeId<plv::CvMatData>();
+    QVariantList values;
+    QVector<ImageEncoding> encodings;
+    for( int i=0; i < m_values.size(); ++i )
+    {
+        // only 32 values can be selected, the rest is only sent to clients which take all
+        if( subscription.pins != 0 && ( i >= 32 || (subscription.pins & (1u << i)) == 0 ) )
+            continue;
+
+        QVariant v = m_values.at(i);
+        if( (subscription.width > 0 || subscription.height > 0) && v.userType() == cvMatDataTypeId )
+        {
+            v.setValue( scaled(i, v.value<plv::CvMatData>(), subscription.width, subscription.height) );
+        }
+        values.append(v);
+        encodings.append( i < m_encodings.size() ? m_encodings.at(i) : ImageEncoding() );
+    }
+
+    WireFramePtr variant = new WireFrame(m_serial, values, encodings);
+    variant->encode();
+    m_variants.insert(key, variant);
+    return variant;
+}
+
+plv::CvMatData WireFrame::scaled( int i, const plv::CvMatData& image, int width, int height )
+{
+    const cv::Mat& src = image.getReadOnly();
+    double scale = 1.0;
+    if( width > 0 && src.cols > width )
+        scale = (double)width / src.cols;
+    if( height > 0 && src.rows > height )
+        scale = qMin( scale, (double)height / src.rows );
+
+    // images are never scaled up
+    if( scale >= 1.0 )
+        return image;
+
+    const int cols = qMax( 1, qRound(src.cols * scale) );
+    const int rows = qMax( 1, qRound(src.rows * scale) );
+    const QString key = QString("%1:%2x%3").arg(i).arg(cols).arg(rows);
+    if( m_scaled.contains(key) )
+        return m_scaled.value(key).value<plv::CvMatData>();
+
+    plv::CvMatData dst = plv::CvMatData::create( cols, rows, src.type() );
+    cv::Mat& mat = dst.getWritable(false);
+    cv::resize( src, mat, mat.size(), 0, 0, cv::INTER_AREA );
+
+    QVariant v;
+    v.setValue(dst);
+    m_scaled.insert(key, v);
+    return dst;
+}
+
+void WireFrame::serialiseV1()
+{
+    QDataStream out(&m_v1Bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_0);
+
+    // write the header
+    out << (quint32)0; // reserved for number of bytes later
+    out << (quint32)PROTO_FRAME;    // msg type
+    out << (quint32)m_serial;       // frame number / serial number
+    out << (quint32)m_values.size(); // number of arguments
+
+    // write all data to the stream
+    foreach( const QVariant& v, m_values )
+    {
+        out << v;
+    }
+
+    // calculate size of total data and write it as first 4 bytes
+    out.device()->seek(0);
+    out << (quint32)(m_v1Bytes.size() - sizeof(quint32));
+
+    m_v1Chunks.append( WireChunk( m_v1Bytes.constData(), m_v1Bytes.size() ) );
+}
+
+void WireFrame::serialiseV2()
+{
+    const int cvMatDataTypeId = qMetaTypeId<plv::CvMatData>();
+    const int fields = PROTO_V2_HEADER_FIELDS + m_values.size() * PROTO_V2_DESCRIPTOR_FIELDS;
+    m_v2Header.resize( fields * sizeof(quint32) );
+
+    uchar* field = reinterpret_cast<uchar*>( m_v2Header.data() );
+    QList<WireChunk> payloads;
+    qint64 payloadSize = 0;
+
+    // size is filled in when the payloads are known
+    qToLittleEndian<quint32>( 0, field );
+    qToLittleEndian<quint32>( PROTO_FRAME_V2, field + 4 );
+    qToLittleEndian<quint32>( m_serial, field + 8 );
+    qToLittleEndian<quint32>( m_values.size(), field + 12 );
+    field += PROTO_V2_HEADER_FIELDS * sizeof(quint32);
+
+    for( int i=0; i < m_values.size(); ++i )
+    {
+        const QVariant& v = m_values.at(i);
+        quint32 kind, type, rows, cols;
+        qint64 length = 0;
+
+        if( m_encodedKinds.at(i) != 0 )
+        {
+            plv::CvMatData data = v.value<plv::CvMatData>();
+            const cv::Mat& mat = data.getReadOnly();
+            kind = m_encodedKinds.at(i);
+            type = mat.type();
+            rows = mat.rows;
+            cols = mat.cols;
+            length = m_encoded.at(i).size();
+            payloads.append( WireChunk( m_encoded.at(i).constData(), length ) );
+        }
+        else if( v.userType() == cvMatDataTypeId )
+        {
+            // the matrix memory is kept alive by m_values
+            plv::CvMatData data = v.value<plv::CvMatData>();
+            const cv::Mat& mat = data.getReadOnly();
+            kind = PROTO_PAYLOAD_MAT;
+            type = mat.type();
+            rows = mat.rows;
+            cols = mat.cols;
+
+            qint64 rowSize = (qint64)mat.cols * mat.elemSize();
+            length = rowSize * mat.rows;
+            if( length > 0 )
+            {
+                if( mat.isContinuous() )
+                {
+                    payloads.append( WireChunk( reinterpret_cast<const char*>( mat.data ), length ) );
+                }
+                else
+                {
+                    for( int i=0; i < mat.rows; ++i )
+                        payloads.append( WireChunk( reinterpret_cast<const char*>( mat.ptr(i) ), rowSize ) );
+                }
+            }
+        }
+        else
+        {
+            QByteArray bytes;
+            QDataStream out(&bytes, QIODevice::WriteOnly);
+            out.setVersion(QDataStream::Qt_4_0);
+            out.setByteOrder(QDataStream::LittleEndian);
+            out << v;
+
+            kind = PROTO_PAYLOAD_VARIANT;
+            type = rows = cols = 0;
+            length = bytes.size();
+            m_v2Variants.append( bytes );
+            payloads.append( WireChunk( m_v2Variants.last().constData(), length ) );
+        }
+
+        qToLittleEndian<quint32>( kind, field );
+        qToLittleEndian<quint32>( type, field + 4 );
+        qToLittleEndian<quint32>( rows, field + 8 );
+        qToLittleEndian<quint32>( cols, field + 12 );
+        qToLittleEndian<quint32>( (quint32)length, field + 16 );
+        field += PROTO_V2_DESCRIPTOR_FIELDS * sizeof(quint32);
+        payloadSize += length;
+    }
+
+    qint64 size = m_v2Header.size() + payloadSize;
+    qToLittleEndian<quint32>( (quint32)(size - sizeof(quint32)),
+                              reinterpret_cast<uchar*>( m_v2Header.data() ) );
+
+    m_v2Chunks.append( WireChunk( m_v2Header.constData(), m_v2Header.size() ) );
+    m_v2Chunks.append( payloads );
+}
@@ -0,0 +1,121 @@
+/**
+  * Copyright (C)2011 by Richard Loos
+  * All rights reserved.
+  *
+  * This file is part of the plvtcpserver plugin of ParleVision.
+  *
+  * ParleVision is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * ParleVision is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * A copy of the GNU General Public License can be found in the root
+  * of this software package directory in the file LICENSE.LGPL.
+  * If not, see <http://www.gnu.org/licenses/>.
+  */
+
+#ifndef WIREFRAME_H
+#define WIREFRAME_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QMutex>
+#include <QVariantList>
+#include <QVector>
+
+#include <plvcore/RefCounted.h>
+#include <plvcore/RefPtr.h>
+
+#include "ImageCodec.h"
+#include "Subscription.h"
+
+namespace plv
+{
+    class CvMatData;
+}
+
+/** A contiguous piece of a serialised message. The memory is owned by
+    the WireFrame it came from. */
+struct WireChunk
+{
+    const char* data;
+    qint64 size;
+
+    WireChunk( const char* d, qint64 s ) : data( d ), size( s ) {}
+};
+
+/** One frame of the TCP server, shared by reference between all
+  * connections. Each protocol version is serialised once, on first use,
+  * by whichever connection asks for it first. Version 2 only serialises
+  * a header: matrix payloads are written straight from the cv::Mat memory
+  * of the frame data, which the frame keeps alive. Images can be
+  * compressed with encode(), which is done once for all connections.
+  * Version 1 always sends the images as they are. Clients which subscribed
+  * to part of the pins or to smaller images get a variant of the frame,
+  * which is made once per distinct subscription.
+  */
+class WireFrame : public plv::RefCounted
+{
+public:
+    /** encodings holds the encoding of each value, values which are
+        not images or have no encoding are sent raw */
+    WireFrame( quint32 serial, const QVariantList& values,
+               const QVector<ImageEncoding>& encodings = QVector<ImageEncoding>() );
+    virtual ~WireFrame();
+
+    inline quint32 getSerial() const { return m_serial; }
+
+    /** @returns true if any of the images has to be encoded */
+    bool needsEncoding() const;
+
+    /** compresses the images. Has to be called before the frame is
+        shared, it is expensive so call it from a worker thread */
+    void encode();
+
+    /** @returns the chunks which make up the message for the protocol
+        version. These stay valid as long as this frame exists */
+    const QList<WireChunk>& getChunks( int version );
+
+    /** @returns the frame with the values and image size of the
+        subscription, encoded like this frame. Variants are made on first
+        use and shared by all clients with the same subscription. An image
+        is scaled once per size, also when it is used by several variants */
+    plv::RefPtr<WireFrame> getVariant( const Subscription& subscription );
+
+private:
+    /** @returns image i scaled down to fit width by height. Call with
+        m_variantMutex held */
+    plv::CvMatData scaled( int i, const plv::CvMatData& image, int width, int height );
+
+    void serialiseV1();
+    void serialiseV2();
+
+    quint32 m_serial;
+    QVariantList m_values;
+    QVector<ImageEncoding> m_encodings;
+    QVector<quint32> m_encodedKinds; /** payload kind per value, 0 if raw */
+    QVector<QByteArray> m_encoded;
+
+    QMutex m_mutex;
+    QByteArray m_v1Bytes;
+    QList<WireChunk> m_v1Chunks;
+    QByteArray m_v2Header;
+    QList<QByteArray> m_v2Variants;
+    QList<WireChunk> m_v2Chunks;
+
+    QMutex m_variantMutex;
+    QHash<QString, plv::RefPtr<WireFrame> > m_variants; /** by subscription key */
+    QHash<QString, QVariant> m_scaled; /** scaled images by value and size */
+};
+
+typedef plv::RefPtr<WireFrame> WireFramePtr;
+Q_DECLARE_METATYPE( WireFramePtr )
+
+#endif // WIREFRAME_H
@@ -19,7 +19,12 @@ SOURCES +=  tcpserverplugin.cpp \
             TCPServerProcessor.cpp \
             Server.cpp \
             ServerConnection.cpp \
-            TCPClientProducer.cpp
+            TCPClientProducer.cpp \
+            WireFrame.cpp \
+            ImageCodec.cpp \
+            ConnectionGroup.cpp \
+            Subscription.cpp \
+            ClientConnection.cpp
 
 HEADERS +=  tcpserverplugin.h \
             tcpserver_global.h \
@@ -27,4 +32,9 @@ HEADERS +=  tcpserverplugin.h \
             Server.h \
             ServerConnection.h \
             TCPClientProducer.h \
+            WireFrame.h \
+            ImageCodec.h \
+            ConnectionGroup.h \
+            Subscription.h \
+            ClientConnection.h \
 			Proto.h
@@ -58,7 +58,7 @@ bool BlobProducer::readyToProduce() const
 
 bool BlobProducer::produce()
 {
-    CvMatData out = CvMatData::create(640,480,CV_8UC1);
+    CvMatData out = CvMatData::create(m_width,m_height,CV_8UC1);
     cv::Mat& img = out;
     img = cv::Scalar::all(0);
 
@@ -138,3 +138,31 @@ void BlobProducer::setNumBlobs(int num)
     }
     emit numBlobsChanged(m_numBlobs);
 }
+
+int BlobProducer::getWidth() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_width;
+}
+
+void BlobProducer::setWidth(int w)
+{
+    QMutexLocker lock(m_propertyMutex);
+    if( w > 0 )
+        m_width = w;
+    emit widthChanged(m_width);
+}
+
+int BlobProducer::getHeight() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_height;
+}
+
+void BlobProducer::setHeight(int h)
+{
+    QMutexLocker lock(m_propertyMutex);
+    if( h > 0 )
+        m_height = h;
+    emit heightChanged(m_height);
+}
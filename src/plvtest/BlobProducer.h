@@ -15,6 +15,8 @@ public:
     Q_CLASSINFO("description", "A producer which generates an image with blobs.")
     Q_PROPERTY( int maxStep READ getMaxStep WRITE setMaxStep NOTIFY maxStepChanged )
     Q_PROPERTY( int numBlobs READ getNumBlobs WRITE setNumBlobs NOTIFY numBlobsChanged )
+    Q_PROPERTY( int width READ getWidth WRITE setWidth NOTIFY widthChanged )
+    Q_PROPERTY( int height READ getHeight WRITE setHeight NOTIFY heightChanged )
 
     /** required standard method declaration for plv::PipelineProcessor */
     PLV_PIPELINE_PRODUCER
@@ -26,14 +28,20 @@ public:
 
     int getMaxStep() const;
     int getNumBlobs() const;
+    int getWidth() const;
+    int getHeight() const;
 
 public slots:
     void setMaxStep(int step);
     void setNumBlobs(int num);
+    void setWidth(int w);
+    void setHeight(int h);
 
 signals:
     void maxStepChanged(int s);
     void numBlobsChanged(int n);
+    void widthChanged(int w);
+    void heightChanged(int h);
 
 private:
     int m_width;
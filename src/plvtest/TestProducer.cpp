@@ -28,7 +28,9 @@
 
 using namespace plv;
 
-TestProducer::TestProducer()
+TestProducer::TestProducer() :
+    m_width(800),
+    m_height(600)
 {
     m_intOut = createOutputPin<int>("int", this);
     m_stringOut = createOutputPin<QString>("QString", this);
@@ -77,8 +79,8 @@ bool TestProducer::produce()
     m_floatOut->put(float(serial));
     m_doubleOut->put(double(serial));
 
-    CvMatData bit16UChan1 = CvMatData::create(800,600,CV_16U,1);
-    CvMatData bit32FChan1 = CvMatData::create(800,600,CV_32F,1);
+    CvMatData bit16UChan1 = CvMatData::create(m_width,m_height,CV_16U,1);
+    CvMatData bit32FChan1 = CvMatData::create(m_width,m_height,CV_32F,1);
 
     {
         cv::Mat& mat16u = bit16UChan1;
@@ -121,3 +123,31 @@ bool TestProducer::produce()
     m_32bitSingleChannelImageOut->put(bit32FChan1);
     return true;
 }
+
+int TestProducer::getWidth() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_width;
+}
+
+void TestProducer::setWidth(int w)
+{
+    QMutexLocker lock(m_propertyMutex);
+    if( w > 0 )
+        m_width = w;
+    emit widthChanged(m_width);
+}
+
+int TestProducer::getHeight() const
+{
+    QMutexLocker lock(m_propertyMutex);
+    return m_height;
+}
+
+void TestProducer::setHeight(int h)
+{
+    QMutexLocker lock(m_propertyMutex);
+    if( h > 0 )
+        m_height = h;
+    emit heightChanged(m_height);
+}
@@ -38,6 +38,8 @@ class TestProducer : public plv::PipelineProducer
     Q_CLASSINFO("author", "Richard Loos")
     Q_CLASSINFO("name", "TestProducer")
     Q_CLASSINFO("description", "A producer to test stuff with")
+    Q_PROPERTY( int width READ getWidth WRITE setWidth NOTIFY widthChanged )
+    Q_PROPERTY( int height READ getHeight WRITE setHeight NOTIFY heightChanged )
 
     /** required standard method declaration for plv::PipelineProcessor */
     PLV_PIPELINE_PRODUCER
@@ -51,11 +53,21 @@ public:
     virtual bool start();
     virtual bool stop();
 
+    int getWidth() const;
+    int getHeight() const;
+
 signals:
+    void widthChanged(int w);
+    void heightChanged(int h);
 
 public slots:
+    void setWidth(int w);
+    void setHeight(int h);
 
 private:
+    int m_width;
+    int m_height;
+
     plv::OutputPin<int>* m_intOut;
     plv::OutputPin<QString>* m_stringOut;
     plv::OutputPin<float>* m_floatOut;